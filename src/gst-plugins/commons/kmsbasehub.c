@@ -22,6 +22,7 @@
 #include "kmsagnosticcaps.h"
 #include "kms-core-marshal.h"
 #include "kmshubport.h"
+#include "kmsrefstruct.h"
 
 #define PLUGIN_NAME "basehub"
 
@@ -93,6 +94,7 @@ static guint kms_base_hub_signals[LAST_SIGNAL] = { 0 };
 struct _KmsBaseHubPrivate
 {
   GHashTable *ports;
+  GHashTable *fanouts;
   GRecMutex mutex;
   gint port_count;
   gint pad_added_id;
@@ -110,6 +112,19 @@ struct _KmsBaseHubPortData
   GstPad *video_sink_target;
 };
 
+typedef struct _KmsBaseHubFanout KmsBaseHubFanout;
+
+/* Tee shared by every port fed from the same internal element pad */
+struct _KmsBaseHubFanout
+{
+  KmsRefStruct ref;
+  gchar *key;
+  GstElement *tee;
+  GstPad *source;
+  gboolean requested;
+  guint branches;
+};
+
 /* class initialization */
 
 G_DEFINE_TYPE_WITH_CODE (KmsBaseHub, kms_base_hub,
@@ -361,12 +376,50 @@ remove_target_cb (GstPad * pad, GstPad * peer, gpointer data)
   gst_ghost_pad_set_target (GST_GHOST_PAD (pad), NULL);
 }
 
+static gboolean
+kms_base_hub_link_src_target (KmsBaseHub * hub, const gchar * gp_name,
+    const gchar * template_name, GstPad * target)
+{
+  GstPad *gp;
+  gboolean ret;
+
+  gp = gst_element_get_static_pad (GST_ELEMENT (hub), gp_name);
+
+  if (gp == NULL) {
+    GstPadTemplate *templ;
+
+    templ =
+        gst_element_class_get_pad_template (GST_ELEMENT_CLASS
+        (G_OBJECT_GET_CLASS (hub)), template_name);
+    gp = gst_ghost_pad_new_no_target_from_template (gp_name, templ);
+    g_signal_connect_object (gp, "linked", G_CALLBACK (set_target_cb), target,
+        0);
+    g_signal_connect (gp, "unlinked", G_CALLBACK (remove_target_cb), NULL);
+
+    if (GST_STATE (hub) >= GST_STATE_PAUSED
+        || GST_STATE_PENDING (hub) >= GST_STATE_PAUSED
+        || GST_STATE_TARGET (hub) >= GST_STATE_PAUSED) {
+      gst_pad_set_active (gp, TRUE);
+    }
+
+    ret = gst_element_add_pad (GST_ELEMENT (hub), gp);
+    if (!ret) {
+      g_object_unref (gp);
+    }
+  } else {
+    ret = set_target (gp, target);
+    g_object_unref (gp);
+  }
+
+  return ret;
+}
+
 static gboolean
 kms_base_hub_link_src_pad (KmsBaseHub * hub, const gchar * gp_name,
     const gchar * template_name, GstElement * internal_element,
     const gchar * pad_name, gboolean remove_on_unlink)
 {
-  GstPad *gp, *target;
+  GstPad *target;
   gboolean ret;
 
   if (GST_OBJECT_PARENT (internal_element) != GST_OBJECT (hub)) {
@@ -390,36 +443,274 @@ kms_base_hub_link_src_pad (KmsBaseHub * hub, const gchar * gp_name,
     return FALSE;
   }
 
-  gp = gst_element_get_static_pad (GST_ELEMENT (hub), gp_name);
+  ret = kms_base_hub_link_src_target (hub, gp_name, template_name, target);
 
-  if (gp == NULL) {
-    GstPadTemplate *templ;
+  g_object_unref (target);
 
-    templ =
-        gst_element_class_get_pad_template (GST_ELEMENT_CLASS
-        (G_OBJECT_GET_CLASS (hub)), template_name);
-    gp = gst_ghost_pad_new_no_target_from_template (gp_name, templ);
-    g_signal_connect_object (gp, "linked", G_CALLBACK (set_target_cb), target,
-        0);
-    g_signal_connect (gp, "unlinked", G_CALLBACK (remove_target_cb), NULL);
+  return ret;
+}
 
-    if (GST_STATE (hub) >= GST_STATE_PAUSED
-        || GST_STATE_PENDING (hub) >= GST_STATE_PAUSED
-        || GST_STATE_TARGET (hub) >= GST_STATE_PAUSED) {
-      gst_pad_set_active (gp, TRUE);
+static void
+kms_base_hub_fanout_destroy (KmsBaseHubFanout * fanout)
+{
+  g_free (fanout->key);
+  g_clear_object (&fanout->tee);
+  g_clear_object (&fanout->source);
+
+  g_slice_free (KmsBaseHubFanout, fanout);
+}
+
+static KmsBaseHubFanout *
+kms_base_hub_fanout_new (KmsBaseHub * hub, const gchar * key,
+    GstElement * internal_element, const gchar * pad_name)
+{
+  KmsBaseHubFanout *fanout;
+  GstPad *source, *sink;
+  GstPadLinkReturn link_ret;
+  gboolean requested = FALSE;
+  GstElement *tee;
+
+  source = gst_element_get_static_pad (internal_element, pad_name);
+  if (source == NULL) {
+    source = gst_element_get_request_pad (internal_element, pad_name);
+    requested = TRUE;
+  }
+
+  if (source == NULL) {
+    GST_ERROR_OBJECT (hub, "Cannot get source pad");
+    return NULL;
+  }
+
+  tee = gst_element_factory_make ("tee", NULL);
+  g_object_set (tee, "allow-not-linked", TRUE, NULL);
+  gst_bin_add (GST_BIN (hub), tee);
+  gst_element_sync_state_with_parent (tee);
+
+  sink = gst_element_get_static_pad (tee, "sink");
+  link_ret = gst_pad_link (source, sink);
+  g_object_unref (sink);
+
+  if (GST_PAD_LINK_FAILED (link_ret)) {
+    GST_ERROR_OBJECT (hub, "Cannot link %" GST_PTR_FORMAT " to fan-out tee",
+        source);
+    if (requested) {
+      gst_element_release_request_pad (internal_element, source);
     }
+    g_object_unref (source);
+    gst_element_set_locked_state (tee, TRUE);
+    gst_element_set_state (tee, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (hub), tee);
+    return NULL;
+  }
 
-    ret = gst_element_add_pad (GST_ELEMENT (hub), gp);
-    if (!ret) {
-      g_object_unref (gp);
+  fanout = g_slice_new0 (KmsBaseHubFanout);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (fanout),
+      (GDestroyNotify) kms_base_hub_fanout_destroy);
+
+  fanout->key = g_strdup (key);
+  fanout->tee = g_object_ref (tee);
+  fanout->source = source;
+  fanout->requested = requested;
+
+  GST_DEBUG_OBJECT (hub, "New fan-out %s", key);
+
+  return fanout;
+}
+
+static void
+kms_base_hub_fanout_release (KmsBaseHub * hub, KmsBaseHubFanout * fanout)
+{
+  GstElement *internal_element;
+  GstPad *sink;
+
+  GST_DEBUG_OBJECT (hub, "Releasing fan-out %s", fanout->key);
+
+  sink = gst_element_get_static_pad (fanout->tee, "sink");
+  gst_pad_unlink (fanout->source, sink);
+  g_object_unref (sink);
+
+  internal_element = gst_pad_get_parent_element (fanout->source);
+  if (internal_element != NULL) {
+    if (fanout->requested) {
+      gst_element_release_request_pad (internal_element, fanout->source);
     }
-  } else {
-    ret = set_target (gp, target);
-    g_object_unref (gp);
+    g_object_unref (internal_element);
+  }
+
+  gst_element_set_locked_state (fanout->tee, TRUE);
+  gst_element_set_state (fanout->tee, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (hub), fanout->tee);
+
+  g_hash_table_remove (hub->priv->fanouts, fanout->key);
+}
+
+static void
+kms_base_hub_fanout_branch_unlinked (GstPad * pad, GstPad * peer,
+    KmsBaseHubFanout * fanout)
+{
+  GstElement *queue;
+  GstObject *parent;
+  KmsBaseHub *hub;
+  GstPad *sink, *tee_src;
+
+  queue = gst_pad_get_parent_element (pad);
+  if (queue == NULL) {
+    return;
+  }
+
+  parent = gst_object_get_parent (GST_OBJECT (queue));
+  if (parent == NULL) {
+    g_object_unref (queue);
+    return;
+  }
+
+  hub = KMS_BASE_HUB (parent);
+
+  KMS_BASE_HUB_LOCK (hub);
+
+  if (g_hash_table_lookup (hub->priv->fanouts, fanout->key) != fanout) {
+    /* Fan-out already released, the hub is being disposed */
+    goto end;
+  }
+
+  GST_DEBUG_OBJECT (hub, "Removing branch %" GST_PTR_FORMAT " from fan-out %s",
+      queue, fanout->key);
+
+  sink = gst_element_get_static_pad (queue, "sink");
+  tee_src = gst_pad_get_peer (sink);
+  if (tee_src != NULL) {
+    gst_pad_unlink (tee_src, sink);
+    gst_element_release_request_pad (fanout->tee, tee_src);
+    g_object_unref (tee_src);
+  }
+  g_object_unref (sink);
+
+  gst_element_set_locked_state (queue, TRUE);
+  gst_element_set_state (queue, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (hub), queue);
+
+  if (--fanout->branches == 0) {
+    kms_base_hub_fanout_release (hub, fanout);
+  }
+
+end:
+  KMS_BASE_HUB_UNLOCK (hub);
+
+  g_object_unref (parent);
+  g_object_unref (queue);
+}
+
+static gboolean
+kms_base_hub_link_src_fanout (KmsBaseHub * hub, const gchar * gp_name,
+    const gchar * template_name, GstElement * internal_element,
+    const gchar * pad_name)
+{
+  KmsBaseHubFanout *fanout;
+  GstElement *queue;
+  GstPad *target, *sink, *tee_src;
+  gboolean ret = FALSE;
+  gulong unlinked_id;
+  gchar *key;
+
+  if (GST_OBJECT_PARENT (internal_element) != GST_OBJECT (hub)) {
+    GST_ERROR_OBJECT (hub, "Cannot link %" GST_PTR_FORMAT " wrong hierarchy",
+        internal_element);
+    return FALSE;
+  }
+
+  key = g_strdup_printf ("%s:%s", GST_OBJECT_NAME (internal_element),
+      pad_name);
+
+  KMS_BASE_HUB_LOCK (hub);
+
+  fanout = g_hash_table_lookup (hub->priv->fanouts, key);
+  if (fanout == NULL) {
+    fanout = kms_base_hub_fanout_new (hub, key, internal_element, pad_name);
+
+    if (fanout == NULL) {
+      goto end;
+    }
+
+    g_hash_table_insert (hub->priv->fanouts, fanout->key, fanout);
+  }
+
+  /* Ports only get a leaky queue, a slow port must not stall the others */
+  queue = gst_element_factory_make ("queue", NULL);
+  g_object_set (queue, "leaky", 2, NULL);
+  gst_bin_add (GST_BIN (hub), queue);
+  fanout->branches++;
+
+  target = gst_element_get_static_pad (queue, "src");
+  unlinked_id = g_signal_connect_data (target, "unlinked",
+      G_CALLBACK (kms_base_hub_fanout_branch_unlinked),
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (fanout)),
+      (GClosureNotify) kms_ref_struct_unref, 0);
+
+  ret = kms_base_hub_link_src_target (hub, gp_name, template_name, target);
+
+  if (!ret) {
+    GST_ERROR_OBJECT (hub, "Cannot link %s to fan-out %s", gp_name, key);
+    g_signal_handler_disconnect (target, unlinked_id);
+    g_object_unref (target);
+    gst_bin_remove (GST_BIN (hub), queue);
+
+    if (--fanout->branches == 0) {
+      kms_base_hub_fanout_release (hub, fanout);
+    }
+
+    goto end;
   }
 
   g_object_unref (target);
 
+  /* The tee allows not linked branches, the port may link its pad later */
+  tee_src = gst_element_get_request_pad (fanout->tee, "src_%u");
+  sink = gst_element_get_static_pad (queue, "sink");
+  gst_pad_link (tee_src, sink);
+  g_object_unref (sink);
+  g_object_unref (tee_src);
+
+  gst_element_sync_state_with_parent (queue);
+
+end:
+  KMS_BASE_HUB_UNLOCK (hub);
+
+  g_free (key);
+
+  return ret;
+}
+
+gboolean
+kms_base_hub_link_video_src_fanout (KmsBaseHub * hub, gint id,
+    GstElement * internal_element, const gchar * pad_name)
+{
+  gchar *gp_name;
+  gboolean ret;
+
+  g_return_val_if_fail (KMS_IS_BASE_HUB (hub), FALSE);
+
+  gp_name = g_strdup_printf (VIDEO_SRC_PAD_PREFIX "%d", id);
+  ret = kms_base_hub_link_src_fanout (hub, gp_name, VIDEO_SRC_PAD_NAME,
+      internal_element, pad_name);
+  g_free (gp_name);
+
+  return ret;
+}
+
+gboolean
+kms_base_hub_link_audio_src_fanout (KmsBaseHub * hub, gint id,
+    GstElement * internal_element, const gchar * pad_name)
+{
+  gchar *gp_name;
+  gboolean ret;
+
+  g_return_val_if_fail (KMS_IS_BASE_HUB (hub), FALSE);
+
+  gp_name = g_strdup_printf (AUDIO_SRC_PAD_PREFIX "%d", id);
+  ret = kms_base_hub_link_src_fanout (hub, gp_name, AUDIO_SRC_PAD_NAME,
+      internal_element, pad_name);
+  g_free (gp_name);
+
   return ret;
 }
 
@@ -786,6 +1077,7 @@ kms_base_hub_dispose (GObject * object)
 
   KMS_BASE_HUB_LOCK (self);
   g_hash_table_remove_all (self->priv->ports);
+  g_hash_table_remove_all (self->priv->fanouts);
   KMS_BASE_HUB_UNLOCK (self);
 
   G_OBJECT_CLASS (kms_base_hub_parent_class)->dispose (object);
@@ -805,6 +1097,11 @@ kms_base_hub_finalize (GObject * object)
     self->priv->ports = NULL;
   }
 
+  if (self->priv->fanouts != NULL) {
+    g_hash_table_unref (self->priv->fanouts);
+    self->priv->fanouts = NULL;
+  }
+
   G_OBJECT_CLASS (kms_base_hub_parent_class)->finalize (object);
 }
 
@@ -880,6 +1177,8 @@ kms_base_hub_init (KmsBaseHub * self)
   self->priv->port_count = 0;
   self->priv->ports = g_hash_table_new_full (g_int_hash, g_int_equal,
       release_gint, kms_base_hub_port_data_destroy);
+  self->priv->fanouts = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      (GDestroyNotify) kms_ref_struct_unref);
 
   self->priv->pad_added_id = g_signal_connect (G_OBJECT (self),
       "pad-added", G_CALLBACK (hub_pad_added), NULL);
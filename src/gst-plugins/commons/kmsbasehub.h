@@ -98,6 +98,12 @@ gboolean kms_base_hub_link_audio_sink (KmsBaseHub * mixer, gint id,
     GstElement * internal_element, const gchar * pad_name,
     gboolean remove_on_unlink);
 
+/* Ports linked to the same internal element pad share a single tee */
+gboolean kms_base_hub_link_video_src_fanout (KmsBaseHub * mixer, gint id,
+    GstElement * internal_element, const gchar * pad_name);
+gboolean kms_base_hub_link_audio_src_fanout (KmsBaseHub * mixer, gint id,
+    GstElement * internal_element, const gchar * pad_name);
+
 gboolean kms_base_hub_unlink_video_src (KmsBaseHub * mixer, gint id);
 gboolean kms_base_hub_unlink_audio_src (KmsBaseHub * mixer, gint id);
 gboolean kms_base_hub_unlink_video_sink (KmsBaseHub * mixer, gint id);
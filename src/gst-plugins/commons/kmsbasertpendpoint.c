@@ -33,7 +33,13 @@
 #include "sdpagent/kmssdpredundantext.h"
 #include "sdpagent/kmssdprtpavpfmediahandler.h"
 #include "kmsremb.h"
+#include "kmstwcc.h"
 #include "kmsrefstruct.h"
+#include "kmsrtphdrext.h"
+#include "kmsrtpforward.h"
+#include "kmsssrcstats.h"
+#include "kmsfeccontroller.h"
+#include "kmsrtxcache.h"
 
 #include <gst/rtp/gstrtpdefs.h>
 #include <gst/rtp/gstrtpbuffer.h>
@@ -88,19 +94,12 @@ G_DEFINE_TYPE_WITH_CODE (KmsBaseRtpEndpoint, kms_base_rtp_endpoint,
   __pos;                      \
 })
 
-typedef struct _KmsSSRCStats KmsSSRCStats;
-struct _KmsSSRCStats
-{
-  guint ssrc;
-  GstElement *jitter_buffer;
-};
-
 typedef struct _KmsRTPSessionStats KmsRTPSessionStats;
 struct _KmsRTPSessionStats
 {
   GObject *rtp_session;
   GstSDPDirection direction;
-  GSList *ssrcs;                /* list of all jitter buffers associated to a ssrc */
+  KmsSsrcStatsTable *ssrcs;     /* counters of the remote SSRCs, not owned */
 };
 
 typedef struct _KmsBaseRTPStats KmsBaseRTPStats;
@@ -108,6 +107,8 @@ struct _KmsBaseRTPStats
 {
   gboolean enabled;
   GHashTable *rtp_stats;
+  /* Packets leaving the jitter buffers, counted without locking */
+  KmsSsrcStatsTable *ssrcs;
   GSList *probes;
   /* End-to-end average stream stats */
   GHashTable *avg_e2e;          /* <"pad_name", StreamE2EAvgStat> */
@@ -147,10 +148,23 @@ e2e_probe_data_destroy (E2EProbeData * data)
 
 /* RtpMediaConfig begin */
 
+/* One per rtpbin session, that is, per negotiated audio or video media */
 typedef struct _RtpMediaConfig
 {
   KmsRefStruct ref;
 
+  guint session;
+  KmsMediaType media;
+  gchar *mid;
+  KmsRtpSynchronizer *sync;
+  /* Video medias sent with ulpfec or red */
+  KmsFecController *fec_ctrl;
+  KmsRtxSender *rtx;
+
+  /* Owned by the endpoint bin, replaced when the media is renegotiated */
+  GstElement *payloader;
+  GstElement *depayloader;
+
   guint local_ssrc;
   guint ssrc;
   gboolean actived;
@@ -159,6 +173,11 @@ typedef struct _RtpMediaConfig
 static void
 rtp_media_config_destroy (RtpMediaConfig * config)
 {
+  g_free (config->mid);
+  g_clear_object (&config->sync);
+  kms_fec_controller_destroy (config->fec_ctrl);
+  kms_rtx_sender_destroy (config->rtx);
+
   g_slice_free (RtpMediaConfig, config);
 }
 
@@ -169,7 +188,7 @@ rtp_media_config_unref (RtpMediaConfig * config)
 }
 
 static RtpMediaConfig *
-rtp_media_config_new ()
+rtp_media_config_new (guint session, KmsMediaType media)
 {
   RtpMediaConfig *config;
 
@@ -178,9 +197,36 @@ rtp_media_config_new ()
   kms_ref_struct_init (KMS_REF_STRUCT_CAST (config),
       (GDestroyNotify) rtp_media_config_destroy);
 
+  config->session = session;
+  config->media = media;
+
   return config;
 }
 
+static RtpMediaConfig *
+rtp_media_config_ref (RtpMediaConfig * config)
+{
+  return (RtpMediaConfig *) kms_ref_struct_ref (KMS_REF_STRUCT_CAST (config));
+}
+
+static gint
+rtp_media_config_cmp (RtpMediaConfig * a, RtpMediaConfig * b)
+{
+  return (gint) a->session - (gint) b->session;
+}
+
+/* Extra medias are told apart by their pad description */
+static const gchar *
+rtp_media_config_get_description (RtpMediaConfig * config)
+{
+  if (config->session == AUDIO_RTP_SESSION
+      || config->session == VIDEO_RTP_SESSION) {
+    return NULL;
+  }
+
+  return config->mid;
+}
+
 /* RtpMediaConfig end */
 
 static void
@@ -212,9 +258,12 @@ struct _KmsBaseRtpEndpointPrivate
   gboolean rtcp_mux;
   gboolean rtcp_nack;
   gboolean rtcp_remb;
+  gboolean rtcp_transport_cc;
 
   RtpMediaConfig *audio_config;
   RtpMediaConfig *video_config;
+  /* Every media, including the two above */
+  GHashTable *media_configs;    /* <session, RtpMediaConfig> */
 
   gint32 target_bitrate;
   guint min_video_recv_bw;
@@ -229,6 +278,13 @@ struct _KmsBaseRtpEndpointPrivate
   KmsRembLocal *rl;
   KmsRembRemote *rm;
 
+  /* TWCC */
+  KmsTwccLocal *tl;
+  KmsTwccRemote *tr;
+
+  /* Paces video sent through rtpbin */
+  GstElement *video_pacer;
+
   /* Port range */
   guint min_port;
   guint max_port;
@@ -241,8 +297,7 @@ struct _KmsBaseRtpEndpointPrivate
   FILE *stats_file;
 
   /* Synchronization */
-  KmsRtpSynchronizer *sync_audio;
-  KmsRtpSynchronizer *sync_video;
+  KmsRtpSyncContext *sync_ctx;
   gboolean perform_video_sync;
 };
 
@@ -263,17 +318,22 @@ static guint obj_signals[LAST_SIGNAL] = { 0 };
 #define DEFAULT_RTCP_MUX    FALSE
 #define DEFAULT_RTCP_NACK    FALSE
 #define DEFAULT_RTCP_REMB    FALSE
+#define DEFAULT_RTCP_TRANSPORT_CC    FALSE
 #define DEFAULT_TARGET_BITRATE    0
 #define MIN_VIDEO_RECV_BW_DEFAULT 0
 #define MIN_VIDEO_SEND_BW_DEFAULT 100
 #define MAX_VIDEO_SEND_BW_DEFAULT 500
 
+/* Audio and video medias; extra ones need a mid and get their own pads */
+#define MAX_MEDIAS 32
+
 enum
 {
   PROP_0,
   PROP_RTCP_MUX,
   PROP_RTCP_NACK,
   PROP_RTCP_REMB,
+  PROP_RTCP_TRANSPORT_CC,
   PROP_TARGET_BITRATE,
   PROP_MIN_VIDEO_RECV_BW,
   PROP_MIN_VIDEO_SEND_BW,
@@ -304,190 +364,159 @@ is_proto (const gchar * term, const gchar * opt, const gchar * proto)
 
 /* RTP hdrext begin */
 
-typedef struct _HdrExtData
-{
-  GstPad *pad;
-  /* Useful to make buffers writable when needed. */
-  gboolean add_hdr;
-  gboolean set_time;
-  gint abs_send_time_id;
-} HdrExtData;
-
-static HdrExtData *
-hdr_ext_data_new (GstPad * pad, gboolean add_hdr, gboolean set_time,
-    gint abs_send_time_id)
+static gint
+kms_base_rtp_endpoint_get_transport_cc_id (const GstSDPMedia * media)
 {
-  HdrExtData *data;
-
-  data = g_slice_new0 (HdrExtData);
-  data->pad = pad;
-  data->add_hdr = add_hdr;
-  data->set_time = set_time;
-  data->abs_send_time_id = abs_send_time_id;
-
-  return data;
-}
+  if (g_strcmp0 (VIDEO_STREAM_NAME, gst_sdp_media_get_media (media)) != 0) {
+    /* TODO: check if needed for audio */
+    return -1;
+  }
 
-static void
-hdr_ext_data_destroy (HdrExtData * data)
-{
-  g_slice_free (HdrExtData, data);
-}
+  if (!sdp_utils_media_has_transport_cc (media)) {
+    return -1;
+  }
 
-static void
-hdr_ext_data_destroy_pointer (gpointer data)
-{
-  hdr_ext_data_destroy ((HdrExtData *) data);
+  return sdp_utils_get_extmap_id (media, RTP_HDR_EXT_TRANSPORT_CC_URI);
 }
 
 static void
-kms_base_rtp_endpoint_rtp_hdr_ext_set_time (guint8 * data)
+kms_base_rtp_endpoint_config_rtp_hdr_ext (KmsBaseRtpEndpoint * self,
+    const GstSDPMedia * media, GstElement * payloader)
 {
-  GstClockTime current_time, ms;
-  guint value;
-
-  current_time = kms_utils_get_time_nsecs ();
-  ms = GST_TIME_AS_MSECONDS (current_time);
-  value = (((ms << 18) / 1000) & 0x00ffffff);
-
-  data[0] = (guint8) (value >> 16);
-  data[1] = (guint8) (value >> 8);
-  data[2] = (guint8) (value);
-}
+  KmsRtpHdrExtWriter *writer;
+  gint abs_send_time_id, transport_cc_id;
+  GstPad *pad;
 
-static void
-kms_base_rtp_endpoint_add_rtp_hdr_ext (HdrExtData * data, GstBuffer * buffer)
-{
-  GstRTPBuffer rtp = { NULL, };
-  guint8 id = data->abs_send_time_id;
-  GstMapFlags map_flags;
-  guint8 *time;
-  guint size;
+  abs_send_time_id = sdp_utils_get_abs_send_time_id (media);
+  transport_cc_id = kms_base_rtp_endpoint_get_transport_cc_id (media);
 
-  if (data->add_hdr) {
-    map_flags = GST_MAP_WRITE;
-  } else {
-    map_flags = GST_MAP_READ;
+  if (abs_send_time_id == -1 && transport_cc_id == -1) {
+    GST_DEBUG_OBJECT (self, "RTP hdrexts not configured.");
+    return;
   }
 
-  if (!gst_rtp_buffer_map (buffer, map_flags, &rtp)) {
-    GST_WARNING_OBJECT (data->pad, "Can not map RTP buffer");
+  pad = gst_element_get_static_pad (payloader, "src");
+  if (pad == NULL) {
+    GST_WARNING_OBJECT (self, "No RTP pad to configure hdrext probe.");
     return;
   }
 
-  if (!gst_rtp_buffer_get_extension_onebyte_header (&rtp,
-          id, 0, (gpointer) & time, &size)) {
-    GST_TRACE_OBJECT (data->pad,
-        "RTP hdrext abs-send-time with id '%d' not found", id);
-
-    if (data->add_hdr) {
-      GST_TRACE_OBJECT (data->pad, " Adding new one.");
-    } else {
-      GST_WARNING_OBJECT (data->pad, "Cannot add new one: not writable");
-      goto end;
-    }
-
-    time = g_malloc0 (RTP_HDR_EXT_ABS_SEND_TIME_SIZE);
-    if (data->set_time) {
-      kms_base_rtp_endpoint_rtp_hdr_ext_set_time (time);
-    }
+  /* Reserve room for extensions as soon as the payloader outputs buffers */
+  writer = kms_rtp_hdr_ext_writer_create (pad, TRUE);
 
-    if (!gst_rtp_buffer_add_extension_onebyte_header (&rtp,
-            id, time, RTP_HDR_EXT_ABS_SEND_TIME_SIZE)) {
-      GST_WARNING_OBJECT (data->pad, "RTP hdrext abs-send-time not added");
-    }
+  if (abs_send_time_id != -1) {
+    kms_rtp_hdr_ext_writer_add (writer, KMS_RTP_HDR_EXT_ABS_SEND_TIME,
+        abs_send_time_id);
+  }
 
-    g_free (time);
-  } else if (data->set_time) {
-    if (size != RTP_HDR_EXT_ABS_SEND_TIME_SIZE) {
-      GST_WARNING_OBJECT (data->pad,
-          "RTP hdrext abs-send-time size with id '%d' not matching", id);
-    } else {
-      GST_TRACE_OBJECT (data->pad,
-          "RTP hdrext abs-send-time with id '%d' found. Update time.", id);
-      kms_base_rtp_endpoint_rtp_hdr_ext_set_time (time);
-    }
+  if (transport_cc_id != -1) {
+    kms_rtp_hdr_ext_writer_add (writer, KMS_RTP_HDR_EXT_TRANSPORT_CC,
+        transport_cc_id);
   }
 
-end:
-  gst_rtp_buffer_unmap (&rtp);
+  GST_DEBUG_OBJECT (self,
+      "Add probe for adding RTP hdrexts (abs-send-time: %d, transport-cc: %d, %"
+      GST_PTR_FORMAT ").", abs_send_time_id, transport_cc_id, pad);
+  kms_rtp_hdr_ext_writer_add_probe (writer);
+  g_object_unref (pad);
 }
 
-static gboolean
-kms_base_rtp_endpoint_add_rtp_hdr_ext_bufflist (GstBuffer ** buf, guint idx,
-    HdrExtData * data)
+static void
+kms_base_rtp_endpoint_transport_cc_sent (guint16 seqnum,
+    GstClockTime send_time, guint size, gpointer user_data)
 {
-  if (data->add_hdr) {
-    *buf = gst_buffer_make_writable (*buf);
-  }
-  kms_base_rtp_endpoint_add_rtp_hdr_ext (data, *buf);
+  KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (user_data);
+  KmsTwccRemote *tr = g_atomic_pointer_get (&self->priv->tr);
 
-  return TRUE;
+  if (tr != NULL) {
+    kms_twcc_remote_packet_sent (tr, seqnum, send_time, size);
+  }
 }
 
-static GstPadProbeReturn
-kms_base_rtp_endpoint_add_rtp_hdr_ext_probe (GstPad * pad,
-    GstPadProbeInfo * info, gpointer gp)
-{
-  HdrExtData *data = (HdrExtData *) gp;
-
-  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
-    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+/* RTP hdrext end */
 
-    if (data->add_hdr) {
-      buffer = gst_buffer_make_writable (buffer);
-    }
-    kms_base_rtp_endpoint_add_rtp_hdr_ext (data, buffer);
-    GST_PAD_PROBE_INFO_DATA (info) = buffer;
-  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
-    GstBufferList *bufflist = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+/* Pacer begin */
 
-    if (data->add_hdr) {
-      bufflist = gst_buffer_list_make_writable (bufflist);
-    }
-    gst_buffer_list_foreach (bufflist,
-        (GstBufferListFunc) kms_base_rtp_endpoint_add_rtp_hdr_ext_bufflist,
-        data);
+static GstPadProbeReturn
+kms_base_rtp_endpoint_pacer_remb_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstElement *pacer = GST_ELEMENT (user_data);
+  GstEvent *event = gst_pad_probe_info_get_event (info);
+  guint bitrate, ssrc;
 
-    GST_PAD_PROBE_INFO_DATA (info) = bufflist;
+  if (!kms_utils_remb_event_upstream_parse (event, &bitrate, &ssrc)) {
+    return GST_PAD_PROBE_OK;
   }
 
+  GST_TRACE_OBJECT (pacer, "Target bitrate %u for ssrc %u", bitrate, ssrc);
+  g_object_set (pacer, "bitrate", (gint) MIN (bitrate, G_MAXINT), NULL);
+
+  /* Let the event go on to the encoders */
   return GST_PAD_PROBE_OK;
 }
 
-static void
-kms_base_rtp_endpoint_config_rtp_hdr_ext (KmsBaseRtpEndpoint * self,
-    const GstSDPMedia * media, GstElement * payloader)
+/*
+ * Places a pacer after the rtpbin video src pad so that keyframe bursts and
+ * retransmissions are spread according to the target bitrate that REMB or
+ * TWCC send upstream to the encoders. Audio is not paced so it always goes
+ * out first. Takes ownership of @rtpbin_src and returns the pad to link.
+ */
+static GstPad *
+kms_base_rtp_endpoint_pace_video_src (KmsBaseRtpEndpoint * self,
+    GstPad * rtpbin_src)
 {
-  HdrExtData *data;
-  gint abs_send_time_id;
-  GstPad *pad;
+  GstElement *pacer;
+  GstPad *sink, *peer;
+
+  if (self->priv->video_pacer != NULL) {
+    pacer = self->priv->video_pacer;
+    sink = gst_element_get_static_pad (pacer, "sink");
+    peer = gst_pad_get_peer (sink);
+
+    if (peer != rtpbin_src) {
+      /* The pacer is kept, but it must be fed by the current rtpbin pad */
+      if (peer != NULL) {
+        gst_pad_unlink (peer, sink);
+      }
 
-  abs_send_time_id = sdp_utils_get_abs_send_time_id (media);
-  if (abs_send_time_id == -1) {
-    GST_DEBUG_OBJECT (self, "abs-send-time-id not configured.");
-    return;
+      gst_pad_link_full (rtpbin_src, sink, GST_PAD_LINK_CHECK_NOTHING);
+    }
+
+    g_clear_object (&peer);
+    g_object_unref (sink);
+    g_object_unref (rtpbin_src);
+
+    return gst_element_get_static_pad (pacer, "src");
   }
 
-  pad = gst_element_get_static_pad (payloader, "src");
-  if (pad == NULL) {
-    GST_WARNING_OBJECT (self, "No RTP pad to configure hdrext probe.");
-    return;
+  pacer = gst_element_factory_make ("rtppacer", NULL);
+  if (pacer == NULL) {
+    GST_WARNING_OBJECT (self, "Cannot create pacer, video will not be paced");
+    return rtpbin_src;
   }
 
-  data = hdr_ext_data_new (pad, TRUE, FALSE, abs_send_time_id);
+  gst_bin_add (GST_BIN (self), pacer);
+  gst_element_sync_state_with_parent (pacer);
 
-  GST_DEBUG_OBJECT (self,
-      "Add probe for adding abs-send-time (id: %d, %" GST_PTR_FORMAT
-      ").", abs_send_time_id, pad);
-  gst_pad_add_probe (pad,
-      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
-      kms_base_rtp_endpoint_add_rtp_hdr_ext_probe, data,
-      hdr_ext_data_destroy_pointer);
-  g_object_unref (pad);
+  sink = gst_element_get_static_pad (pacer, "sink");
+  gst_pad_link_full (rtpbin_src, sink, GST_PAD_LINK_CHECK_NOTHING);
+  g_object_unref (sink);
+  g_object_unref (rtpbin_src);
+
+  sink = gst_element_get_static_pad (self->priv->rtpbin,
+      VIDEO_RTPBIN_SEND_RTP_SINK);
+  gst_pad_add_probe (sink, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM,
+      kms_base_rtp_endpoint_pacer_remb_probe, g_object_ref (pacer),
+      g_object_unref);
+  g_object_unref (sink);
+
+  self->priv->video_pacer = pacer;
+
+  return gst_element_get_static_pad (pacer, "src");
 }
 
-/* RTP hdrext end */
+/* Pacer end */
 
 /* Media handler management begin */
 
@@ -565,7 +594,8 @@ kms_base_rtp_create_media_handler (KmsBaseSdpEndpoint * base_sdp,
 
   if (KMS_IS_SDP_RTP_AVPF_MEDIA_HANDLER (*handler)) {
     g_object_set (G_OBJECT (*handler), "nack", self->priv->rtcp_nack,
-        "goog-remb", self->priv->rtcp_remb, NULL);
+        "goog-remb", self->priv->rtcp_remb,
+        "transport-cc", self->priv->rtcp_transport_cc, NULL);
   }
   h_avp = KMS_SDP_RTP_AVP_MEDIA_HANDLER (*handler);
   kms_sdp_rtp_avp_media_handler_add_extmap (h_avp, RTP_HDR_EXT_ABS_SEND_TIME_ID,
@@ -577,6 +607,17 @@ kms_base_rtp_create_media_handler (KmsBaseSdpEndpoint * base_sdp,
     err = NULL;
   }
 
+  if (self->priv->rtcp_transport_cc) {
+    kms_sdp_rtp_avp_media_handler_add_extmap (h_avp,
+        RTP_HDR_EXT_TRANSPORT_CC_ID, RTP_HDR_EXT_TRANSPORT_CC_URI, &err);
+
+    if (err != NULL) {
+      GST_WARNING_OBJECT (base_sdp, "Cannot add extmap '%s'", err->message);
+      g_error_free (err);
+      err = NULL;
+    }
+  }
+
   if (self->priv->support_fec) {
     kms_base_rtp_configure_extensions (self, media, *handler);
   }
@@ -591,17 +632,56 @@ typedef struct _ConnectPayloaderData
   GstElement *payloader;
   gboolean connected_flag;
   KmsElementPadType type;
+  gchar *description;
 } ConnectPayloaderData;
 
+typedef struct _ReplacePayloaderData
+{
+  KmsBaseRtpEndpoint *self;
+  GstPad *sinkpad;
+  GstElement *old;
+  GstElement *payloader;
+  gchar *rtpbin_pad_name;
+} ReplacePayloaderData;
+
+static void
+replace_payloader_data_destroy (ReplacePayloaderData * data)
+{
+  g_object_unref (data->sinkpad);
+  g_free (data->rtpbin_pad_name);
+
+  g_slice_free (ReplacePayloaderData, data);
+}
+
+static ReplacePayloaderData *
+replace_payloader_data_new (KmsBaseRtpEndpoint * self, GstPad * sinkpad,
+    GstElement * old, GstElement * payloader, const gchar * rtpbin_pad_name)
+{
+  ReplacePayloaderData *data;
+
+  data = g_slice_new0 (ReplacePayloaderData);
+
+  data->self = self;
+  data->sinkpad = g_object_ref (sinkpad);
+  data->old = old;
+  data->payloader = payloader;
+  data->rtpbin_pad_name = g_strdup (rtpbin_pad_name);
+
+  return data;
+}
+
 static void
-connect_payloader_data_destroy (gpointer data)
+connect_payloader_data_destroy (ConnectPayloaderData * data)
 {
+  g_free (data->description);
+  g_object_unref (data->payloader);
+
   g_slice_free (ConnectPayloaderData, data);
 }
 
 static ConnectPayloaderData *
 connect_payloader_data_new (KmsBaseRtpEndpoint * self, GstElement * payloader,
-    KmsElementPadType type)
+    KmsElementPadType type, const gchar * description)
 {
   ConnectPayloaderData *data;
 
@@ -611,40 +691,23 @@ connect_payloader_data_new (KmsBaseRtpEndpoint * self, GstElement * payloader,
       (GDestroyNotify) connect_payloader_data_destroy);
 
   data->self = self;
-  data->payloader = payloader;
+  data->payloader = g_object_ref (payloader);
   data->type = type;
+  data->description = g_strdup (description);
 
   return data;
 }
 
-static KmsSSRCStats *
-ssrc_stats_new (guint ssrc, GstElement * jitter_buffer)
-{
-  KmsSSRCStats *stats;
-
-  stats = g_slice_new0 (KmsSSRCStats);
-
-  stats->jitter_buffer = gst_object_ref (jitter_buffer);
-  stats->ssrc = ssrc;
-
-  return stats;
-}
-
-static void
-ssrc_stats_destroy (KmsSSRCStats * stats)
-{
-  g_clear_object (&stats->jitter_buffer);
-  g_slice_free (KmsSSRCStats, stats);
-}
-
 static KmsRTPSessionStats *
-rtp_session_stats_new (GObject * rtp_session, GstSDPDirection direction)
+rtp_session_stats_new (GObject * rtp_session, GstSDPDirection direction,
+    KmsSsrcStatsTable * ssrcs)
 {
   KmsRTPSessionStats *stats;
 
   stats = g_slice_new0 (KmsRTPSessionStats);
   stats->rtp_session = g_object_ref (rtp_session);
   stats->direction = direction;
+  stats->ssrcs = ssrcs;
 
   return stats;
 }
@@ -652,10 +715,6 @@ rtp_session_stats_new (GObject * rtp_session, GstSDPDirection direction)
 static void
 rtp_session_stats_destroy (KmsRTPSessionStats * stats)
 {
-  if (stats->ssrcs != NULL) {
-    g_slist_free_full (stats->ssrcs, (GDestroyNotify) ssrc_stats_destroy);
-  }
-
   g_clear_object (&stats->rtp_session);
 
   g_slice_free (KmsRTPSessionStats, stats);
@@ -688,6 +747,414 @@ kms_base_rtp_endpoint_is_video_rtcp_nack (KmsBaseRtpEndpoint * self)
   return FALSE;
 }
 
+/* Media configs begin */
+
+static RtpMediaConfig *
+kms_base_rtp_endpoint_lookup_media_config (KmsBaseRtpEndpoint * self,
+    guint session)
+{
+  /* Called with the element lock held */
+  return g_hash_table_lookup (self->priv->media_configs,
+      GUINT_TO_POINTER (session));
+}
+
+static RtpMediaConfig *
+kms_base_rtp_endpoint_get_media_config (KmsBaseRtpEndpoint * self,
+    guint session)
+{
+  RtpMediaConfig *config;
+
+  KMS_ELEMENT_LOCK (self);
+
+  config = kms_base_rtp_endpoint_lookup_media_config (self, session);
+  if (config != NULL) {
+    rtp_media_config_ref (config);
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  return config;
+}
+
+static guint
+kms_base_rtp_endpoint_get_free_session (KmsBaseRtpEndpoint * self)
+{
+  guint session = VIDEO_RTP_SESSION + 1;
+
+  /* Called with the element lock held. Sessions of released medias are */
+  /* reused, so rtpbin does not grow on each renegotiation */
+  while (g_hash_table_contains (self->priv->media_configs,
+          GUINT_TO_POINTER (session))) {
+    session++;
+  }
+
+  return session;
+}
+
+/*
+ * The first audio and video medias use AUDIO_RTP_SESSION and
+ * VIDEO_RTP_SESSION. Any other media is identified by its mid and gets an
+ * rtpbin session of its own, up to MAX_MEDIAS medias of each type.
+ */
+static RtpMediaConfig *
+kms_base_rtp_endpoint_get_config_for_media (KmsBaseRtpEndpoint * self,
+    const GstSDPMedia * media)
+{
+  const gchar *media_str = gst_sdp_media_get_media (media);
+  const gchar *mid = gst_sdp_media_get_attribute_val (media, "mid");
+  RtpMediaConfig *config = NULL, *first;
+  GHashTableIter iter;
+  gpointer key, value;
+  KmsMediaType type;
+  guint n = 0;
+
+  if (g_strcmp0 (AUDIO_STREAM_NAME, media_str) == 0) {
+    first = self->priv->audio_config;
+    type = KMS_MEDIA_TYPE_AUDIO;
+  } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
+    first = self->priv->video_config;
+    type = KMS_MEDIA_TYPE_VIDEO;
+  } else {
+    GST_WARNING_OBJECT (self, "Media '%s' not supported", media_str);
+    return NULL;
+  }
+
+  KMS_ELEMENT_LOCK (self);
+
+  if (mid == NULL || first->mid == NULL || g_strcmp0 (first->mid, mid) == 0) {
+    if (first->mid == NULL) {
+      first->mid = g_strdup (mid);
+    }
+
+    config = first;
+    goto end;
+  }
+
+  g_hash_table_iter_init (&iter, self->priv->media_configs);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    RtpMediaConfig *c = value;
+
+    if (c->media != type) {
+      continue;
+    }
+
+    if (g_strcmp0 (c->mid, mid) == 0) {
+      config = c;
+      goto end;
+    }
+
+    n++;
+  }
+
+  /* Remote offers are not bounded by num-audio-medias or num-video-medias */
+  if (n >= MAX_MEDIAS) {
+    KMS_ELEMENT_UNLOCK (self);
+    GST_WARNING_OBJECT (self, "Only %u '%s' medias are supported", MAX_MEDIAS,
+        media_str);
+    return NULL;
+  }
+
+  config = rtp_media_config_new (kms_base_rtp_endpoint_get_free_session (self),
+      type);
+  config->mid = g_strdup (mid);
+  config->sync = kms_rtp_synchronizer_new (self->priv->sync_ctx, TRUE);
+  g_hash_table_insert (self->priv->media_configs,
+      GUINT_TO_POINTER (config->session), config);
+
+  GST_DEBUG_OBJECT (self, "Media '%s' (mid: %s) uses RTP session %u",
+      media_str, mid, config->session);
+
+end:
+  rtp_media_config_ref (config);
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  return config;
+}
+
+static gboolean
+kms_base_rtp_endpoint_get_media_session (KmsBaseRtpEndpoint * self,
+    const GstSDPMedia * media, guint * session)
+{
+  RtpMediaConfig *config;
+
+  config = kms_base_rtp_endpoint_get_config_for_media (self, media);
+  if (config == NULL) {
+    GST_ERROR_OBJECT (self, "'%s' not valid", gst_sdp_media_get_media (media));
+    return FALSE;
+  }
+
+  *session = config->session;
+  rtp_media_config_unref (config);
+
+  return TRUE;
+}
+
+static GstPad *
+kms_base_rtp_endpoint_get_rtpbin_pad (KmsBaseRtpEndpoint * self,
+    const gchar * prefix, guint session, gboolean request)
+{
+  gchar *name;
+  GstPad *pad;
+
+  name = g_strdup_printf ("%s%" G_GUINT32_FORMAT, prefix, session);
+
+  if (request) {
+    pad = gst_element_get_request_pad (self->priv->rtpbin, name);
+  } else {
+    pad = gst_element_get_static_pad (self->priv->rtpbin, name);
+  }
+
+  g_free (name);
+
+  return pad;
+}
+
+static gboolean
+kms_base_rtp_endpoint_get_session_by_mid (KmsBaseRtpEndpoint * self,
+    const gchar * mid, guint * session)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  gboolean found = FALSE;
+
+  KMS_ELEMENT_LOCK (self);
+
+  g_hash_table_iter_init (&iter, self->priv->media_configs);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    RtpMediaConfig *config = value;
+
+    if (g_strcmp0 (config->mid, mid) == 0) {
+      *session = config->session;
+      found = TRUE;
+      break;
+    }
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  return found;
+}
+
+static const gchar *
+kms_base_rtp_endpoint_get_session_media_str (KmsBaseRtpEndpoint * self,
+    guint session)
+{
+  RtpMediaConfig *config;
+
+  /* Called with the element lock held */
+  config = kms_base_rtp_endpoint_lookup_media_config (self, session);
+  if (config == NULL) {
+    return NULL;
+  }
+
+  return config->media == KMS_MEDIA_TYPE_AUDIO ? AUDIO_STREAM_NAME :
+      VIDEO_STREAM_NAME;
+}
+
+static gboolean
+kms_base_rtp_endpoint_sdp_has_media (const GstSDPMessage * sdp,
+    RtpMediaConfig * config)
+{
+  const gchar *media_str;
+  guint i, len;
+
+  media_str = config->media == KMS_MEDIA_TYPE_AUDIO ? AUDIO_STREAM_NAME :
+      VIDEO_STREAM_NAME;
+  len = gst_sdp_message_medias_len (sdp);
+
+  for (i = 0; i < len; i++) {
+    const GstSDPMedia *media = gst_sdp_message_get_media (sdp, i);
+
+    if (gst_sdp_media_get_port (media) == 0) {
+      /* Rejected */
+      continue;
+    }
+
+    if (g_strcmp0 (gst_sdp_media_get_media (media), media_str) == 0 &&
+        g_strcmp0 (gst_sdp_media_get_attribute_val (media, "mid"),
+            config->mid) == 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+static gint
+find_stats_probe (KmsStatsProbe * probe, GstPad * pad)
+{
+  return kms_stats_probe_watches (probe, pad) ? 0 : 1;
+}
+
+static void
+kms_base_rtp_endpoint_remove_element (KmsBaseRtpEndpoint * self,
+    GstElement * element)
+{
+  GST_DEBUG_OBJECT (self, "Removing %" GST_PTR_FORMAT, element);
+
+  gst_element_set_locked_state (element, TRUE);
+  gst_element_set_state (element, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (self), element);
+}
+
+/* Returns the endpoint sink pad feeding the payloader, if already created */
+static GstPad *
+kms_base_rtp_endpoint_get_payloader_sink (GstElement * payloader)
+{
+  GstPad *target, *peer, *sinkpad = NULL;
+
+  target = gst_element_get_static_pad (payloader, "sink");
+  peer = gst_pad_get_peer (target);
+  g_object_unref (target);
+
+  if (peer == NULL) {
+    return NULL;
+  }
+
+  if (GST_IS_PROXY_PAD (peer)) {
+    sinkpad = GST_PAD (gst_proxy_pad_get_internal (GST_PROXY_PAD (peer)));
+
+    if (sinkpad != NULL && !GST_IS_GHOST_PAD (sinkpad)) {
+      g_object_unref (sinkpad);
+      sinkpad = NULL;
+    }
+  }
+
+  g_object_unref (peer);
+
+  return sinkpad;
+}
+
+static void
+kms_base_rtp_endpoint_remove_payloader (KmsBaseRtpEndpoint * self,
+    GstElement * payloader)
+{
+  GstPad *sinkpad;
+
+  sinkpad = kms_base_rtp_endpoint_get_payloader_sink (payloader);
+  if (sinkpad != NULL) {
+    kms_element_remove_sink (KMS_ELEMENT (self), sinkpad);
+    g_object_unref (sinkpad);
+  }
+
+  /* Removing it from the bin also unlinks it from rtpbin */
+  kms_base_rtp_endpoint_remove_element (self, payloader);
+}
+
+static GstPadProbeReturn
+kms_base_rtp_endpoint_remove_depayloader_probe (GstPad * pad,
+    GstPadProbeInfo * info, gpointer depayloader)
+{
+  GstObject *parent;
+
+  parent = gst_object_get_parent (GST_OBJECT (depayloader));
+  if (parent == NULL) {
+    return GST_PAD_PROBE_REMOVE;
+  }
+
+  kms_base_rtp_endpoint_remove_element (KMS_BASE_RTP_ENDPOINT (parent),
+      depayloader);
+  gst_object_unref (parent);
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+static void
+kms_base_rtp_endpoint_remove_depayloader (KmsBaseRtpEndpoint * self,
+    GstElement * depayloader)
+{
+  GstPad *sink, *src, *peer;
+  GSList *l;
+
+  sink = gst_element_get_static_pad (depayloader, "sink");
+  src = gst_element_get_static_pad (depayloader, "src");
+
+  KMS_ELEMENT_LOCK (self);
+
+  l = g_slist_find_custom (self->priv->stats.probes, sink,
+      (GCompareFunc) find_stats_probe);
+  if (l != NULL) {
+    kms_stats_probe_destroy (l->data);
+    self->priv->stats.probes = g_slist_delete_link (self->priv->stats.probes,
+        l);
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  /* Free the output element for the media that replaces this one */
+  if (src != NULL) {
+    peer = gst_pad_get_peer (src);
+    if (peer != NULL) {
+      gst_pad_unlink (src, peer);
+      g_object_unref (peer);
+    }
+    g_object_unref (src);
+  }
+
+  peer = gst_pad_get_peer (sink);
+  g_object_unref (sink);
+
+  if (peer == NULL) {
+    kms_base_rtp_endpoint_remove_element (self, depayloader);
+    return;
+  }
+
+  /* rtpbin may still be pushing the old stream */
+  gst_pad_add_probe (peer, GST_PAD_PROBE_TYPE_IDLE,
+      kms_base_rtp_endpoint_remove_depayloader_probe,
+      g_object_ref (depayloader), g_object_unref);
+  g_object_unref (peer);
+}
+
+static void
+kms_base_rtp_endpoint_release_media_configs (KmsBaseRtpEndpoint * self,
+    const GstSDPMessage * sdp)
+{
+  GSList *released = NULL, *l;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  KMS_ELEMENT_LOCK (self);
+
+  g_hash_table_iter_init (&iter, self->priv->media_configs);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    RtpMediaConfig *config = value;
+
+    if (config == self->priv->audio_config ||
+        config == self->priv->video_config) {
+      continue;
+    }
+
+    if (kms_base_rtp_endpoint_sdp_has_media (sdp, config)) {
+      continue;
+    }
+
+    GST_DEBUG_OBJECT (self, "Media with mid '%s' removed, releasing session %u",
+        config->mid, config->session);
+    released = g_slist_prepend (released, rtp_media_config_ref (config));
+    g_hash_table_iter_remove (&iter);
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  for (l = released; l != NULL; l = l->next) {
+    RtpMediaConfig *config = l->data;
+
+    if (config->payloader != NULL) {
+      kms_base_rtp_endpoint_remove_payloader (self, config->payloader);
+    }
+
+    if (config->depayloader != NULL) {
+      kms_base_rtp_endpoint_remove_depayloader (self, config->depayloader);
+    }
+  }
+
+  g_slist_free_full (released, (GDestroyNotify) rtp_media_config_unref);
+}
+
+/* Media configs end */
+
 /* Configure media SDP begin */
 static GObject *
 kms_base_rtp_endpoint_create_rtp_session (KmsBaseRtpEndpoint * self,
@@ -716,7 +1183,8 @@ kms_base_rtp_endpoint_create_rtp_session (KmsBaseRtpEndpoint * self,
       GUINT_TO_POINTER (session_id));
 
   if (rtp_stats == NULL) {
-    rtp_stats = rtp_session_stats_new (rtpsession, direction);
+    rtp_stats = rtp_session_stats_new (rtpsession, direction,
+        self->priv->stats.ssrcs);
     g_hash_table_insert (self->priv->stats.rtp_stats,
         GUINT_TO_POINTER (session_id), rtp_stats);
   } else {
@@ -754,8 +1222,8 @@ kms_base_rtp_endpoint_configure_rtp_media (KmsBaseRtpEndpoint * self,
     KmsBaseRtpSession * base_rtp_sess, GstSDPMedia * media)
 {
   const gchar *proto_str = gst_sdp_media_get_proto (media);
-  const gchar *media_str = gst_sdp_media_get_media (media);
-  const gchar *rtpbin_pad_name = NULL;
+  gchar *rtpbin_pad_name;
+  RtpMediaConfig *config;
   GstSDPDirection dir;
   guint session_id;
   GObject *rtpsession;
@@ -768,28 +1236,28 @@ kms_base_rtp_endpoint_configure_rtp_media (KmsBaseRtpEndpoint * self,
     GST_DEBUG_OBJECT (self, "'%s' protocol not need RTP session", proto_str);
     return TRUE;
   }
-
-  /* TODO: think about this when multiple audio/video medias */
-  if (g_strcmp0 (AUDIO_STREAM_NAME, media_str) == 0) {
-    rtpbin_pad_name = AUDIO_RTPBIN_SEND_RTP_SINK;
-    session_id = AUDIO_RTP_SESSION;
-  } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
-    rtpbin_pad_name = VIDEO_RTPBIN_SEND_RTP_SINK;
-    session_id = VIDEO_RTP_SESSION;
-  } else {
-    GST_WARNING_OBJECT (self, "Media '%s' not supported", media_str);
+
+  config = kms_base_rtp_endpoint_get_config_for_media (self, media);
+  if (config == NULL) {
     return FALSE;
   }
 
+  session_id = config->session;
+  rtpbin_pad_name =
+      g_strdup_printf (RTPBIN_SEND_RTP_SINK "%" G_GUINT32_FORMAT, session_id);
+
   dir = sdp_utils_media_config_get_direction (media);
 
   rtpsession =
       kms_base_rtp_endpoint_create_rtp_session (self, session_id,
       rtpbin_pad_name,
       kms_base_rtp_endpoint_media_proto_to_rtp_profile (self, proto_str), dir);
+  g_free (rtpbin_pad_name);
+
   if (rtpsession == NULL) {
     GST_WARNING_OBJECT (self,
         "Cannot create RTP Session'%" G_GUINT32_FORMAT "'", session_id);
+    rtp_media_config_unref (config);
     return FALSE;
   }
 
@@ -805,14 +1273,16 @@ kms_base_rtp_endpoint_configure_rtp_media (KmsBaseRtpEndpoint * self,
   g_free (str);
   gst_structure_free (sdes);
 
+  config->local_ssrc = ssrc;
+
   if (session_id == AUDIO_RTP_SESSION) {
-    self->priv->audio_config->local_ssrc = ssrc;
     base_rtp_sess->local_audio_ssrc = ssrc;
   } else if (session_id == VIDEO_RTP_SESSION) {
-    self->priv->video_config->local_ssrc = ssrc;
     base_rtp_sess->local_video_ssrc = ssrc;
   }
 
+  rtp_media_config_unref (config);
+
   return TRUE;
 }
 
@@ -871,20 +1341,102 @@ kms_base_rtp_endpoint_create_remb_managers (KmsBaseRtpSession * sess,
   kms_remb_local_add_remote_session (self->priv->rl, rtpsession,
       sess->remote_video_ssrc);
 
+  if (self->priv->tr == NULL) {
+    pad = gst_element_get_static_pad (rtpbin, VIDEO_RTPBIN_SEND_RTP_SINK);
+    self->priv->rm =
+        kms_remb_remote_create (rtpsession,
+        self->priv->video_config->local_ssrc, self->priv->min_video_send_bw,
+        self->priv->max_video_send_bw, pad);
+    g_object_unref (pad);
+  } else {
+    /* Send-side estimation is done by TWCC */
+    GST_DEBUG_OBJECT (self, "Ignoring REMB from remote, TWCC in use");
+  }
+
+  g_object_unref (rtpsession);
+
+  if (self->priv->remb_params != NULL) {
+    kms_remb_local_set_params (self->priv->rl, self->priv->remb_params);
+
+    if (self->priv->rm != NULL) {
+      kms_remb_remote_set_params (self->priv->rm, self->priv->remb_params);
+    }
+  }
+
+  GST_DEBUG_OBJECT (self, "REMB managers added");
+}
+
+static void
+kms_base_rtp_endpoint_create_twcc_remote (KmsBaseRtpEndpoint * self)
+{
+  GstElement *rtpbin = self->priv->rtpbin;
+  KmsTwccRemote *tr;
+  GObject *rtpsession;
+  GstPad *pad;
+
+  if (self->priv->tr != NULL) {
+    /* TODO: support more than one media with TWCC */
+    GST_INFO_OBJECT (self, "Only support for one media with TWCC");
+    return;
+  }
+
+  if (self->priv->rm != NULL) {
+    /* Both estimators would push their targets to the same encoders */
+    GST_INFO_OBJECT (self, "Send-side estimation already done by REMB");
+    return;
+  }
+
+  g_signal_emit_by_name (rtpbin, "get-internal-session", VIDEO_RTP_SESSION,
+      &rtpsession);
+  if (rtpsession == NULL) {
+    GST_WARNING_OBJECT (self,
+        "There is not session with id %" G_GUINT32_FORMAT, VIDEO_RTP_SESSION);
+    return;
+  }
+
   pad = gst_element_get_static_pad (rtpbin, VIDEO_RTPBIN_SEND_RTP_SINK);
-  self->priv->rm =
-      kms_remb_remote_create (rtpsession,
+  tr = kms_twcc_remote_create (rtpsession,
       self->priv->video_config->local_ssrc, self->priv->min_video_send_bw,
       self->priv->max_video_send_bw, pad);
   g_object_unref (pad);
   g_object_unref (rtpsession);
 
   if (self->priv->remb_params != NULL) {
-    kms_remb_local_set_params (self->priv->rl, self->priv->remb_params);
-    kms_remb_remote_set_params (self->priv->rm, self->priv->remb_params);
+    kms_twcc_remote_set_params (tr, self->priv->remb_params);
   }
 
-  GST_DEBUG_OBJECT (self, "REMB managers added");
+  /* Sent packets are notified from the streaming thread */
+  g_atomic_pointer_set (&self->priv->tr, tr);
+
+  GST_DEBUG_OBJECT (self, "TWCC remote added");
+}
+
+static void
+kms_base_rtp_endpoint_create_twcc_local (KmsBaseRtpEndpoint * self,
+    const GstSDPMedia * media, GstPad * pad)
+{
+  gint transport_cc_id;
+  GObject *rtpsession;
+
+  transport_cc_id = kms_base_rtp_endpoint_get_transport_cc_id (media);
+  if (transport_cc_id == -1 || self->priv->tl != NULL) {
+    return;
+  }
+
+  g_signal_emit_by_name (self->priv->rtpbin, "get-internal-session",
+      VIDEO_RTP_SESSION, &rtpsession);
+  if (rtpsession == NULL) {
+    GST_WARNING_OBJECT (self,
+        "There is not session with id %" G_GUINT32_FORMAT, VIDEO_RTP_SESSION);
+    return;
+  }
+
+  self->priv->tl =
+      kms_twcc_local_create (rtpsession, pad, (guint8) transport_cc_id);
+  g_object_unref (rtpsession);
+
+  GST_DEBUG_OBJECT (self, "TWCC local added (id: %d, %" GST_PTR_FORMAT ")",
+      transport_cc_id, pad);
 }
 
 static GstPad *
@@ -892,22 +1444,21 @@ kms_base_rtp_endpoint_request_rtp_sink (KmsIRtpSessionManager * manager,
     KmsBaseRtpSession * sess, const GstSDPMedia * media)
 {
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (manager);
-  const gchar *media_str = gst_sdp_media_get_media (media);
   GstPad *pad;
+  guint session;
 
-  if (g_strcmp0 (AUDIO_STREAM_NAME, media_str) == 0) {
-    pad =
-        gst_element_get_request_pad (self->priv->rtpbin,
-        AUDIO_RTPBIN_RECV_RTP_SINK);
-  } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
-    pad =
-        gst_element_get_request_pad (self->priv->rtpbin,
-        VIDEO_RTPBIN_RECV_RTP_SINK);
-  } else {
-    GST_ERROR_OBJECT (self, "'%s' not valid", media_str);
+  if (!kms_base_rtp_endpoint_get_media_session (self, media, &session)) {
     return NULL;
   }
 
+  pad = kms_base_rtp_endpoint_get_rtpbin_pad (self, RTPBIN_RECV_RTP_SINK,
+      session, TRUE);
+
+  if (session == VIDEO_RTP_SESSION) {
+    /* With bundle this pad is requested once the remote SSRC is known */
+    kms_base_rtp_endpoint_create_twcc_local (self, media, pad);
+  }
+
   return pad;
 }
 
@@ -918,36 +1469,52 @@ kms_base_rtp_endpoint_request_rtp_src (KmsIRtpSessionManager * manager,
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (manager);
   const gchar *media_str = gst_sdp_media_get_media (media);
   GstPad *pad;
+  guint session;
 
-  if (g_strcmp0 (AUDIO_STREAM_NAME, media_str) == 0) {
-    pad =
-        gst_element_get_static_pad (self->priv->rtpbin,
-        AUDIO_RTPBIN_SEND_RTP_SRC);
-  } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
-    gint abs_send_time_id;
+  if (!kms_base_rtp_endpoint_get_media_session (self, media, &session)) {
+    return NULL;
+  }
 
-    pad =
-        gst_element_get_static_pad (self->priv->rtpbin,
-        VIDEO_RTPBIN_SEND_RTP_SRC);
+  pad = kms_base_rtp_endpoint_get_rtpbin_pad (self, RTPBIN_SEND_RTP_SRC,
+      session, FALSE);
+
+  if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
+    gint abs_send_time_id, transport_cc_id = -1;
 
     kms_utils_drop_until_keyframe (pad, TRUE);
 
-    /* TODO: check if needed for audio */
     abs_send_time_id = sdp_utils_get_abs_send_time_id (media);
-    if (abs_send_time_id != -1) {
-      HdrExtData *data = hdr_ext_data_new (pad, FALSE, TRUE, abs_send_time_id);
+
+    /* Pacing and transport-wide sequence numbers belong to the transport,
+     * they are only applied to the first video media */
+    if (session == VIDEO_RTP_SESSION) {
+      /* Send times must be stamped once packets leave the pacer */
+      pad = kms_base_rtp_endpoint_pace_video_src (self, pad);
+      transport_cc_id = kms_base_rtp_endpoint_get_transport_cc_id (media);
+    }
+
+    /* TODO: check if needed for audio */
+    if (abs_send_time_id != -1 || transport_cc_id != -1) {
+      KmsRtpHdrExtWriter *writer = kms_rtp_hdr_ext_writer_create (pad, FALSE);
+
+      if (abs_send_time_id != -1) {
+        kms_rtp_hdr_ext_writer_add (writer, KMS_RTP_HDR_EXT_ABS_SEND_TIME,
+            abs_send_time_id);
+      }
+
+      if (transport_cc_id != -1) {
+        kms_rtp_hdr_ext_writer_add (writer, KMS_RTP_HDR_EXT_TRANSPORT_CC,
+            transport_cc_id);
+        kms_rtp_hdr_ext_writer_set_transport_cc_callback (writer,
+            kms_base_rtp_endpoint_transport_cc_sent, self, NULL);
+      }
 
       GST_DEBUG_OBJECT (self,
-          "Add probe for updating abs-send-time (id: %d, %" GST_PTR_FORMAT ").",
-          abs_send_time_id, pad);
-      gst_pad_add_probe (pad,
-          GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
-          kms_base_rtp_endpoint_add_rtp_hdr_ext_probe,
-          data, hdr_ext_data_destroy_pointer);
+          "Add probe for updating RTP hdrexts (abs-send-time: %d, "
+          "transport-cc: %d, %" GST_PTR_FORMAT ").", abs_send_time_id,
+          transport_cc_id, pad);
+      kms_rtp_hdr_ext_writer_add_probe (writer);
     }
-  } else {
-    GST_ERROR_OBJECT (self, "'%s' not valid", media_str);
-    return NULL;
   }
 
   return pad;
@@ -958,23 +1525,14 @@ kms_base_rtp_endpoint_request_rtcp_sink (KmsIRtpSessionManager * manager,
     KmsBaseRtpSession * sess, const GstSDPMedia * media)
 {
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (manager);
-  const gchar *media_str = gst_sdp_media_get_media (media);
-  GstPad *pad;
+  guint session;
 
-  if (g_strcmp0 (AUDIO_STREAM_NAME, media_str) == 0) {
-    pad =
-        gst_element_get_request_pad (self->priv->rtpbin,
-        AUDIO_RTPBIN_RECV_RTCP_SINK);
-  } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
-    pad =
-        gst_element_get_request_pad (self->priv->rtpbin,
-        VIDEO_RTPBIN_RECV_RTCP_SINK);
-  } else {
-    GST_ERROR_OBJECT (self, "'%s' not valid", media_str);
+  if (!kms_base_rtp_endpoint_get_media_session (self, media, &session)) {
     return NULL;
   }
 
-  return pad;
+  return kms_base_rtp_endpoint_get_rtpbin_pad (self, RTPBIN_RECV_RTCP_SINK,
+      session, TRUE);
 }
 
 static GstPad *
@@ -982,23 +1540,14 @@ kms_base_rtp_endpoint_request_rtcp_src (KmsIRtpSessionManager * manager,
     KmsBaseRtpSession * sess, const GstSDPMedia * media)
 {
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (manager);
-  const gchar *media_str = gst_sdp_media_get_media (media);
-  GstPad *pad;
+  guint session;
 
-  if (g_strcmp0 (AUDIO_STREAM_NAME, media_str) == 0) {
-    pad =
-        gst_element_get_request_pad (self->priv->rtpbin,
-        AUDIO_RTPBIN_SEND_RTCP_SRC);
-  } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
-    pad =
-        gst_element_get_request_pad (self->priv->rtpbin,
-        VIDEO_RTPBIN_SEND_RTCP_SRC);
-  } else {
-    GST_ERROR_OBJECT (self, "'%s' not valid", media_str);
+  if (!kms_base_rtp_endpoint_get_media_session (self, media, &session)) {
     return NULL;
   }
 
-  return pad;
+  return kms_base_rtp_endpoint_get_rtpbin_pad (self, RTPBIN_SEND_RTCP_SRC,
+      session, TRUE);
 }
 
 static KmsConnectionState
@@ -1035,13 +1584,34 @@ kms_base_rtp_endpoint_start_transport_send (KmsBaseSdpEndpoint *
   KmsBaseRtpSession *base_rtp_sess = KMS_BASE_RTP_SESSION (sess);
   guint i, len;
 
+  /* Medias gone from the negotiation free their sessions for new ones */
+  kms_base_rtp_endpoint_release_media_configs (self, sess->neg_sdp);
+
   kms_base_rtp_session_start_transport_send (base_rtp_sess, offerer);
 
   len = gst_sdp_message_medias_len (sess->neg_sdp);
 
+  /* TWCC takes precedence over REMB for send-side estimation, so it is */
+  /* created first whatever the order of the medias in the SDP is */
+  for (i = 0; i < len; i++) {
+    const GstSDPMedia *media = gst_sdp_message_get_media (sess->neg_sdp, i);
+
+    if (kms_sdp_session_is_media_started (sess, i)) {
+      continue;
+    }
+
+    if (kms_base_rtp_endpoint_get_transport_cc_id (media) != -1) {
+      kms_base_rtp_endpoint_create_twcc_remote (self);
+    }
+  }
+
   for (i = 0; i < len; i++) {
     const GstSDPMedia *media = gst_sdp_message_get_media (sess->neg_sdp, i);
 
+    if (kms_sdp_session_is_media_started (sess, i)) {
+      continue;
+    }
+
     if (sdp_utils_media_has_remb (media)) {
       kms_base_rtp_endpoint_create_remb_managers (base_rtp_sess, self);
     }
@@ -1283,12 +1853,18 @@ kms_base_rtp_endpoint_do_connect_payloader (ConnectPayloaderData * data)
   GST_DEBUG_OBJECT (data->self, "Connecting payloader %" GST_PTR_FORMAT,
       data->payloader);
 
+  if (GST_OBJECT_PARENT (data->payloader) != GST_OBJECT (data->self)) {
+    GST_DEBUG_OBJECT (data->self, "Payloader %" GST_PTR_FORMAT
+        " replaced before being connected", data->payloader);
+    return;
+  }
+
   if (g_atomic_int_compare_and_exchange (&data->connected_flag, FALSE, TRUE)) {
     GstPad *target = gst_element_get_static_pad (data->payloader, "sink");
     GstPad *sinkpad;
 
-    sinkpad = kms_element_connect_sink_target (KMS_ELEMENT (data->self), target,
-        data->type);
+    sinkpad = kms_element_connect_sink_target_full (KMS_ELEMENT (data->self),
+        target, data->type, data->description, NULL, NULL);
     kms_base_rtp_endpoint_configure_2e2_latency (data->self, sinkpad,
         data->type);
     g_object_unref (target);
@@ -1315,13 +1891,14 @@ kms_base_rtp_endpoint_connect_payloader_cb (KmsIRtpConnection * conn,
 
 static void
 kms_base_rtp_endpoint_connect_payloader_async (KmsBaseRtpEndpoint * self,
-    KmsIRtpConnection * conn, GstElement * payloader, KmsElementPadType type)
+    KmsIRtpConnection * conn, GstElement * payloader, KmsElementPadType type,
+    const gchar * description)
 {
   ConnectPayloaderData *data;
   gboolean connected = FALSE;
   gulong handler_id = 0;
 
-  data = connect_payloader_data_new (self, payloader, type);
+  data = connect_payloader_data_new (self, payloader, type, description);
 
   handler_id = g_signal_connect_data (conn, "connected",
       G_CALLBACK (kms_base_rtp_endpoint_connect_payloader_cb),
@@ -1345,8 +1922,8 @@ kms_base_rtp_endpoint_connect_payloader_async (KmsBaseRtpEndpoint * self,
 
 static void
 kms_base_rtp_endpoint_connect_payloader (KmsBaseRtpEndpoint * self,
-    KmsIRtpConnection * conn, KmsElementPadType type, GstElement * payloader,
-    const gchar * rtpbin_pad_name)
+    KmsIRtpConnection * conn, KmsElementPadType type, const gchar * description,
+    GstElement * payloader, const gchar * rtpbin_pad_name)
 {
   GstElement *rtpbin = self->priv->rtpbin;
 
@@ -1356,7 +1933,66 @@ kms_base_rtp_endpoint_connect_payloader (KmsBaseRtpEndpoint * self,
 
   gst_element_link_pads (payloader, "src", rtpbin, rtpbin_pad_name);
 
-  kms_base_rtp_endpoint_connect_payloader_async (self, conn, payloader, type);
+  kms_base_rtp_endpoint_connect_payloader_async (self, conn, payloader, type,
+      description);
+}
+
+static GstPadProbeReturn
+kms_base_rtp_endpoint_replace_payloader_probe (GstPad * pad,
+    GstPadProbeInfo * info, gpointer user_data)
+{
+  ReplacePayloaderData *data = user_data;
+  GstPad *target;
+
+  /* Removing the old payloader frees the rtpbin send pad */
+  kms_base_rtp_endpoint_remove_element (data->self, data->old);
+  gst_element_link_pads (data->payloader, "src", data->self->priv->rtpbin,
+      data->rtpbin_pad_name);
+
+  target = gst_element_get_static_pad (data->payloader, "sink");
+  gst_ghost_pad_set_target (GST_GHOST_PAD (data->sinkpad), target);
+
+  /* The codec may have changed, let upstream negotiate it again */
+  gst_pad_push_event (target, gst_event_new_reconfigure ());
+  g_object_unref (target);
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+static void
+kms_base_rtp_endpoint_replace_payloader (KmsBaseRtpEndpoint * self,
+    KmsIRtpConnection * conn, KmsElementPadType type, const gchar * description,
+    GstElement * old, GstElement * payloader, const gchar * rtpbin_pad_name)
+{
+  ReplacePayloaderData *data;
+  GstPad *sinkpad, *target, *peer;
+
+  sinkpad = kms_base_rtp_endpoint_get_payloader_sink (old);
+  if (sinkpad == NULL) {
+    /* Old payloader was still waiting for the connection */
+    kms_base_rtp_endpoint_remove_element (self, old);
+    kms_base_rtp_endpoint_connect_payloader (self, conn, type, description,
+        payloader, rtpbin_pad_name);
+    return;
+  }
+
+  gst_bin_add (GST_BIN (self), payloader);
+  gst_element_sync_state_with_parent (payloader);
+
+  data = replace_payloader_data_new (self, sinkpad, old, payloader,
+      rtpbin_pad_name);
+  g_object_unref (sinkpad);
+
+  target = gst_element_get_static_pad (old, "sink");
+  peer = gst_pad_get_peer (target);
+  g_object_unref (target);
+
+  /* The endpoint sink pad keeps its upstream links, only its target and */
+  /* the rtpbin link change, while no buffer goes through it             */
+  gst_pad_add_probe (peer, GST_PAD_PROBE_TYPE_IDLE,
+      kms_base_rtp_endpoint_replace_payloader_probe, data,
+      (GDestroyNotify) replace_payloader_data_destroy);
+  g_object_unref (peer);
 }
 
 static void
@@ -1365,10 +2001,12 @@ kms_base_rtp_endpoint_set_media_payloader (KmsBaseRtpEndpoint * self,
     const GstSDPMedia * media)
 {
   const gchar *media_str = gst_sdp_media_get_media (media);
-  GstElement *payloader;
+  KmsIRtpConnection *conn;
+  RtpMediaConfig *config;
+  GstElement *payloader, *old;
   GstCaps *caps = NULL;
   guint j, f_len;
-  const gchar *rtpbin_pad_name;
+  gchar *rtpbin_pad_name;
   KmsElementPadType type;
 
   f_len = gst_sdp_media_formats_len (media);
@@ -1396,30 +2034,52 @@ kms_base_rtp_endpoint_set_media_payloader (KmsBaseRtpEndpoint * self,
 
   GST_DEBUG_OBJECT (self, "Found payloader %" GST_PTR_FORMAT, payloader);
 
-  if (g_strcmp0 (AUDIO_STREAM_NAME, media_str) == 0) {
+  config = kms_base_rtp_endpoint_get_config_for_media (self, media);
+  if (config == NULL) {
+    g_object_unref (payloader);
+    return;
+  }
+
+  if (config->media == KMS_MEDIA_TYPE_AUDIO) {
     type = KMS_ELEMENT_PAD_TYPE_AUDIO;
-    rtpbin_pad_name = AUDIO_RTPBIN_SEND_RTP_SINK;
-  } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
+  } else {
     /* TODO: check if is needed for audio  */
     kms_base_rtp_endpoint_config_rtp_hdr_ext (self, media, payloader);
     type = KMS_ELEMENT_PAD_TYPE_VIDEO;
-    rtpbin_pad_name = VIDEO_RTPBIN_SEND_RTP_SINK;
-  } else {
-    rtpbin_pad_name = NULL;
+  }
+
+  conn = kms_base_rtp_session_get_connection (sess, handler);
+  if (conn == NULL) {
+    rtp_media_config_unref (config);
     g_object_unref (payloader);
+    return;
   }
 
-  if (rtpbin_pad_name != NULL) {
-    KmsIRtpConnection *conn;
+  kms_rtp_forward_add_forwarder (payloader);
 
-    conn = kms_base_rtp_session_get_connection (sess, handler);
-    if (conn == NULL) {
-      return;
-    }
+  rtpbin_pad_name = g_strdup_printf (RTPBIN_SEND_RTP_SINK "%" G_GUINT32_FORMAT,
+      config->session);
 
-    kms_base_rtp_endpoint_connect_payloader (self, conn, type, payloader,
+  KMS_ELEMENT_LOCK (self);
+  old = config->payloader;
+  config->payloader = payloader;
+  KMS_ELEMENT_UNLOCK (self);
+
+  if (old != NULL) {
+    GST_DEBUG_OBJECT (self, "Media of session %u changed, replacing %"
+        GST_PTR_FORMAT, config->session, old);
+    kms_base_rtp_endpoint_replace_payloader (self, conn, type,
+        rtp_media_config_get_description (config), old, payloader,
+        rtpbin_pad_name);
+  } else {
+    kms_base_rtp_endpoint_connect_payloader (self, conn, type,
+        rtp_media_config_get_description (config), payloader,
         rtpbin_pad_name);
   }
+
+  g_free (rtpbin_pad_name);
+
+  rtp_media_config_unref (config);
 }
 
 /* Payloading configuration end */
@@ -1440,7 +2100,13 @@ kms_base_rtp_endpoint_connect_input_elements (KmsBaseSdpEndpoint *
     const gchar *media;
 
     if (sdp_utils_media_is_inactive (neg_media)) {
-      GST_DEBUG_OBJECT (self, "Media at possition %u is inactive", i);
+      GST_DEBUG_OBJECT (self, "Media at position %u is inactive", i);
+      continue;
+    }
+
+    /* Payloaders of running medias are kept */
+    if (kms_sdp_session_is_media_started (sess, i)) {
+      GST_DEBUG_OBJECT (self, "Media at position %u not changed", i);
       continue;
     }
 
@@ -1670,12 +2336,12 @@ kms_base_rtp_endpoint_request_pt_map (GstElement * rtpbin, guint session,
   caps = kms_base_rtp_endpoint_get_caps_for_pt (self, pt);
 
   if (caps != NULL) {
+    RtpMediaConfig *config;
     KmsRtpSynchronizer *sync = NULL;
 
-    if (session == AUDIO_RTP_SESSION) {
-      sync = self->priv->sync_audio;
-    } else if (session == VIDEO_RTP_SESSION) {
-      sync = self->priv->sync_video;
+    config = kms_base_rtp_endpoint_get_media_config (self, session);
+    if (config != NULL) {
+      sync = config->sync;
     }
 
     if (sync != NULL) {
@@ -1710,6 +2376,10 @@ kms_base_rtp_endpoint_request_pt_map (GstElement * rtpbin, guint session,
       }
     }
 
+    if (config != NULL) {
+      rtp_media_config_unref (config);
+    }
+
     return caps;
   }
 
@@ -1749,29 +2419,35 @@ static void
 kms_base_rtp_endpoint_rtpbin_pad_added (GstElement * rtpbin, GstPad * pad,
     KmsBaseRtpEndpoint * self)
 {
-  GstElement *agnostic, *depayloader;
-  gboolean added = TRUE;
+  GstElement *agnostic, *depayloader, *receiver, *old;
+  RtpMediaConfig *config = NULL;
+  gboolean added = FALSE;
   KmsMediaType media;
+  guint session;
   GstCaps *caps;
 
   GST_PAD_STREAM_LOCK (pad);
 
-  if (g_str_has_prefix (GST_OBJECT_NAME (pad), AUDIO_RTPBIN_RECV_RTP_SRC)) {
-    agnostic = kms_element_get_audio_agnosticbin (KMS_ELEMENT (self));
-    media = KMS_MEDIA_TYPE_AUDIO;
-  } else if (g_str_has_prefix (GST_OBJECT_NAME (pad),
-          VIDEO_RTPBIN_RECV_RTP_SRC)) {
-    agnostic = kms_element_get_video_agnosticbin (KMS_ELEMENT (self));
-    media = KMS_MEDIA_TYPE_VIDEO;
+  if (sscanf (GST_OBJECT_NAME (pad), RTPBIN_RECV_RTP_SRC "%u_",
+          &session) != 1) {
+    goto end;
+  }
 
-    if (self->priv->rl != NULL) {
-      self->priv->rl->event_manager = kms_utils_remb_event_manager_create (pad);
-    }
-  } else {
-    added = FALSE;
+  config = kms_base_rtp_endpoint_get_media_config (self, session);
+  if (config == NULL) {
+    GST_WARNING_OBJECT (self, "No media for session %u", session);
     goto end;
   }
 
+  media = config->media;
+  agnostic = kms_element_get_output_element_from_media_type (KMS_ELEMENT
+      (self), media, rtp_media_config_get_description (config));
+  added = TRUE;
+
+  if (session == VIDEO_RTP_SESSION && self->priv->rl != NULL) {
+    self->priv->rl->event_manager = kms_utils_remb_event_manager_create (pad);
+  }
+
   caps = gst_pad_query_caps (pad, NULL);
   GST_DEBUG_OBJECT (self,
       "New pad: %" GST_PTR_FORMAT " for linking to %" GST_PTR_FORMAT
@@ -1780,45 +2456,204 @@ kms_base_rtp_endpoint_rtpbin_pad_added (GstElement * rtpbin, GstPad * pad,
   depayloader = gst_base_rtp_get_depayloader_for_caps (caps);
   gst_caps_unref (caps);
 
+  if (depayloader != NULL) {
+    receiver = depayloader;
+  } else {
+    receiver = gst_element_factory_make ("fakesink", NULL);
+    g_object_set (receiver, "async", FALSE, "sync", FALSE, NULL);
+  }
+
+  KMS_ELEMENT_LOCK (self);
+  old = config->depayloader;
+  config->depayloader = receiver;
+  KMS_ELEMENT_UNLOCK (self);
+
+  if (old != NULL) {
+    /* The media was renegotiated and its payload changed */
+    kms_base_rtp_endpoint_remove_depayloader (self, old);
+  }
+
   if (depayloader != NULL) {
     GST_DEBUG_OBJECT (self, "Found depayloader %" GST_PTR_FORMAT, depayloader);
     kms_base_rtp_endpoint_update_stats (self, depayloader, media);
+    /* Let payloaders with the same codec reuse the received packets */
+    kms_rtp_forward_add_collector (depayloader);
     gst_bin_add (GST_BIN (self), depayloader);
     gst_element_link_pads (depayloader, "src", agnostic, "sink");
     gst_element_link_pads (rtpbin, GST_OBJECT_NAME (pad), depayloader, "sink");
     gst_element_sync_state_with_parent (depayloader);
   } else {
-    GstElement *fake = gst_element_factory_make ("fakesink", NULL);
-
-    g_object_set (fake, "async", FALSE, "sync", FALSE, NULL);
-
     GST_WARNING_OBJECT (self, "Depayloder not found for pad %" GST_PTR_FORMAT,
         pad);
 
-    gst_bin_add (GST_BIN (self), fake);
-    gst_element_link_pads (rtpbin, GST_OBJECT_NAME (pad), fake, "sink");
-    gst_element_sync_state_with_parent (fake);
+    gst_bin_add (GST_BIN (self), receiver);
+    gst_element_link_pads (rtpbin, GST_OBJECT_NAME (pad), receiver, "sink");
+    gst_element_sync_state_with_parent (receiver);
   }
 
 end:
   GST_PAD_STREAM_UNLOCK (pad);
 
+  if (config != NULL) {
+    rtp_media_config_unref (config);
+  }
+
   if (added) {
     g_signal_emit (G_OBJECT (self), obj_signals[MEDIA_START], 0, media, TRUE);
   }
 }
 
+typedef struct _ChangeLatencyData
+{
+  gint latency;
+  KmsSsrcStats *stats;
+} ChangeLatencyData;
+
+static ChangeLatencyData *
+change_latency_data_new (gint latency, KmsSsrcStats * stats)
+{
+  ChangeLatencyData *data = g_slice_new (ChangeLatencyData);
+
+  data->latency = latency;
+  data->stats = stats;
+
+  return data;
+}
+
+static void
+change_latency_data_destroy (ChangeLatencyData * data)
+{
+  g_slice_free (ChangeLatencyData, data);
+}
+
 static GstPadProbeReturn
 kms_base_rtp_endpoint_change_latency_probe (GstPad * pad,
     GstPadProbeInfo * info, gpointer user_data)
 {
   GstElement *jitterbuffer = GST_PAD_PARENT (pad);
-  gint latency = GPOINTER_TO_INT (user_data);
+  ChangeLatencyData *data = user_data;
+
+  GST_DEBUG_OBJECT (jitterbuffer, "Setting latency to: %d", data->latency);
+  g_object_set (jitterbuffer, "latency", data->latency, NULL);
+
+  if (data->stats != NULL) {
+    kms_ssrc_stats_set_latency (data->stats, data->latency);
+  }
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+static gboolean
+count_buffer_size (GstBuffer ** buf, guint idx, gsize * size)
+{
+  *size += gst_buffer_get_size (*buf);
+
+  return TRUE;
+}
+
+typedef struct _SsrcStatsProbeData
+{
+  KmsSsrcStats *stats;
+  /* First sequence number of the pending lost run, -1 if there is none */
+  gint lost_seqnum;
+  guint lost_events;
+} SsrcStatsProbeData;
+
+static SsrcStatsProbeData *
+ssrc_stats_probe_data_new (KmsSsrcStats * stats)
+{
+  SsrcStatsProbeData *data = g_slice_new0 (SsrcStatsProbeData);
+
+  data->stats = stats;
+  data->lost_seqnum = -1;
+
+  return data;
+}
+
+static void
+ssrc_stats_probe_data_destroy (SsrcStatsProbeData * data)
+{
+  /* The jitter buffer is gone, so the slot can count another source */
+  kms_ssrc_stats_release (data->stats);
+  g_slice_free (SsrcStatsProbeData, data);
+}
+
+static void
+ssrc_stats_probe_data_lost (SsrcStatsProbeData * data, GstEvent * event)
+{
+  const GstStructure *st = gst_event_get_structure (event);
+  guint seqnum;
+
+  if (data->lost_seqnum < 0 && gst_structure_get_uint (st, "seqnum", &seqnum)) {
+    data->lost_seqnum = seqnum & G_MAXUINT16;
+  }
+
+  data->lost_events++;
+  kms_ssrc_stats_add_lost (data->stats, 1);
+}
+
+/*
+ * A lost event may stand for a run of packets, which is only known once the
+ * next packet arrives: the packets missing up to it that were not notified
+ * one by one are counted here.
+ */
+static void
+ssrc_stats_probe_data_received (SsrcStatsProbeData * data, GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint16 span;
+
+  if (data->lost_seqnum < 0) {
+    return;
+  }
+
+  if (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    span = gst_rtp_buffer_get_seq (&rtp) - (guint16) data->lost_seqnum;
+    gst_rtp_buffer_unmap (&rtp);
+
+    if (span > data->lost_events) {
+      kms_ssrc_stats_add_lost (data->stats, span - data->lost_events);
+    }
+  }
+
+  data->lost_seqnum = -1;
+  data->lost_events = 0;
+}
+
+static GstPadProbeReturn
+kms_base_rtp_endpoint_ssrc_stats_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  SsrcStatsProbeData *data = user_data;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+    ssrc_stats_probe_data_received (data, buffer);
+    kms_ssrc_stats_add_packets (data->stats, 1, gst_buffer_get_size (buffer));
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    gsize size = 0;
+
+    if (gst_buffer_list_length (list) > 0) {
+      ssrc_stats_probe_data_received (data, gst_buffer_list_get (list, 0));
+    }
 
-  GST_DEBUG_OBJECT (jitterbuffer, "Setting latency to: %d", latency);
-  g_object_set (jitterbuffer, "latency", latency, NULL);
+    gst_buffer_list_foreach (list, (GstBufferListFunc) count_buffer_size,
+        &size);
+    kms_ssrc_stats_add_packets (data->stats, gst_buffer_list_length (list),
+        size);
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) &
+      GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+    /* Pushed by the jitter buffer when do-lost is enabled */
+    if (gst_event_has_name (event, "GstRTPPacketLost")) {
+      ssrc_stats_probe_data_lost (data, event);
+    }
+  }
 
-  return GST_PAD_PROBE_REMOVE;
+  return GST_PAD_PROBE_OK;
 }
 
 static gboolean
@@ -1889,7 +2724,7 @@ pad_added_jb (GstElement * jitterbuffer, GstPad * new_pad, gpointer sync)
 
   gst_pad_add_probe (new_pad,
       GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
-      rtcp_probe, sync, NULL);
+      rtcp_probe, g_object_ref (sync), g_object_unref);
 }
 
 static void
@@ -1897,50 +2732,58 @@ kms_base_rtp_endpoint_rtpbin_new_jitterbuffer (GstElement * rtpbin,
     GstElement * jitterbuffer,
     guint session, guint ssrc, KmsBaseRtpEndpoint * self)
 {
-  KmsRTPSessionStats *rtp_stats;
-  KmsSSRCStats *ssrc_stats;
+  KmsSsrcStats *ssrc_stats;
+  RtpMediaConfig *config;
+  gboolean video;
   GstPad *src_pad;
 
+  config = kms_base_rtp_endpoint_get_media_config (self, session);
+  if (config == NULL) {
+    GST_ERROR_OBJECT (self, "No media for session %u", session);
+    return;
+  }
+
+  video = config->media == KMS_MEDIA_TYPE_VIDEO;
+
   g_object_set (jitterbuffer, "mode", 4 /* synced */ ,
       "latency", JB_INITIAL_LATENCY, NULL);
 
+  ssrc_stats = kms_ssrc_stats_table_add (self->priv->stats.ssrcs, session,
+      ssrc);
+  if (ssrc_stats != NULL) {
+    kms_ssrc_stats_set_latency (ssrc_stats, JB_INITIAL_LATENCY);
+  }
+
+  /* Probes keep the synchronizer, the config may be released before them */
   src_pad = gst_element_get_static_pad (jitterbuffer, "src");
   gst_pad_add_probe (src_pad,
       GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
       kms_base_rtp_endpoint_change_latency_probe,
-      GINT_TO_POINTER (session ==
-          VIDEO_RTP_SESSION ? JB_READY_VIDEO_LATENCY : JB_READY_AUDIO_LATENCY),
-      NULL);
+      change_latency_data_new (video ? JB_READY_VIDEO_LATENCY :
+          JB_READY_AUDIO_LATENCY, ssrc_stats),
+      (GDestroyNotify) change_latency_data_destroy);
   gst_pad_add_probe (src_pad,
       GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
-      timestamps_probe, GINT_TO_POINTER (session ==
-          VIDEO_RTP_SESSION ? self->priv->sync_video : self->priv->sync_audio),
-      NULL);
-  g_object_unref (src_pad);
-
-  if ((session == AUDIO_RTP_SESSION) || self->priv->perform_video_sync) {
-    g_signal_connect (jitterbuffer, "pad-added", G_CALLBACK (pad_added_jb),
-        GINT_TO_POINTER (session ==
-            VIDEO_RTP_SESSION ? self->priv->sync_video : self->
-            priv->sync_audio));
+      timestamps_probe, g_object_ref (config->sync), g_object_unref);
+  if (ssrc_stats != NULL) {
+    gst_pad_add_probe (src_pad,
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST |
+        GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+        kms_base_rtp_endpoint_ssrc_stats_probe,
+        ssrc_stats_probe_data_new (ssrc_stats),
+        (GDestroyNotify) ssrc_stats_probe_data_destroy);
   }
+  g_object_unref (src_pad);
 
-  KMS_ELEMENT_LOCK (self);
-
-  rtp_stats =
-      g_hash_table_lookup (self->priv->stats.rtp_stats,
-      GUINT_TO_POINTER (session));
-
-  if (rtp_stats != NULL) {
-    ssrc_stats = ssrc_stats_new (ssrc, jitterbuffer);
-    rtp_stats->ssrcs = g_slist_prepend (rtp_stats->ssrcs, ssrc_stats);
-  } else {
-    GST_ERROR_OBJECT (self, "Session %u exists for SSRC %u", session, ssrc);
+  if (!video || self->priv->perform_video_sync) {
+    g_signal_connect_data (jitterbuffer, "pad-added",
+        G_CALLBACK (pad_added_jb), g_object_ref (config->sync),
+        (GClosureNotify) g_object_unref, 0);
   }
 
-  KMS_ELEMENT_UNLOCK (self);
+  rtp_media_config_unref (config);
 
-  if (session == VIDEO_RTP_SESSION) {
+  if (video) {
     gboolean rtcp_nack = kms_base_rtp_endpoint_is_video_rtcp_nack (self);
 
     g_object_set (jitterbuffer, "do-lost", TRUE,
@@ -1953,53 +2796,47 @@ kms_base_rtp_endpoint_stop_signal (KmsBaseRtpEndpoint * self, guint session,
     guint ssrc)
 {
   gboolean local = TRUE;
+  RtpMediaConfig *config;
   KmsMediaType media;
 
   KMS_ELEMENT_LOCK (self);
 
-  if (ssrc == self->priv->audio_config->ssrc
-      || ssrc == self->priv->video_config->ssrc) {
-    local = FALSE;
+  config = kms_base_rtp_endpoint_lookup_media_config (self, session);
+  if (config == NULL) {
+    KMS_ELEMENT_UNLOCK (self);
+    GST_WARNING_OBJECT (self, "No media supported for session %u", session);
+    return;
+  }
 
-    if (self->priv->audio_config->ssrc == ssrc)
-      self->priv->audio_config->ssrc = 0;
-    else if (self->priv->video_config->ssrc == ssrc)
-      self->priv->video_config->ssrc = 0;
+  if (ssrc == config->ssrc) {
+    local = FALSE;
+    config->ssrc = 0;
   }
 
-  KMS_ELEMENT_UNLOCK (self);
+  media = config->media;
 
-  switch (session) {
-    case AUDIO_RTP_SESSION:
-      media = KMS_MEDIA_TYPE_AUDIO;
-      break;
-    case VIDEO_RTP_SESSION:
-      media = KMS_MEDIA_TYPE_VIDEO;
-      break;
-    default:
-      GST_WARNING_OBJECT (self, "No media supported for session %u", session);
-      return;
-  }
+  KMS_ELEMENT_UNLOCK (self);
 
   g_signal_emit (G_OBJECT (self), obj_signals[MEDIA_STOP], 0, media, local);
 }
 
 static void
 ssrc_stats_add_jitter_stats (GstStructure * ssrc_stats,
-    GstElement * jitter_buffer)
+    const KmsSsrcStatsSnapshot * snapshot)
 {
   GstStructure *jitter_stats;
-  guint percent, latency;
-
-  g_object_get (jitter_buffer, "percent", &percent, "latency", &latency,
-      "stats", &jitter_stats, NULL);
 
-  if (jitter_stats == NULL)
-    return;
-
-  /* Append adition fields to the stats */
-  gst_structure_set (jitter_stats, "latency", G_TYPE_UINT, latency, "percent",
-      G_TYPE_UINT, percent, NULL);
+  /*
+   * Counted on the packet path, jitter buffers are not queried. Hence fields
+   * only known by the jitter buffer (num-late, num-duplicates, rtx-count,
+   * rtx-success-count, rtx-per-packet, rtx-rtt) and "percent" are no longer
+   * reported.
+   */
+  jitter_stats = gst_structure_new ("application/x-rtp-jitterbuffer-stats",
+      "num-pushed", G_TYPE_UINT64, snapshot->packets,
+      "octets-pushed", G_TYPE_UINT64, snapshot->octets,
+      "num-lost", G_TYPE_UINT64, (guint64) snapshot->lost,
+      "latency", G_TYPE_UINT, snapshot->latency, NULL);
 
   /* Append jitter buffer stats to the ssrc stats */
   gst_structure_set (ssrc_stats, "jitter-buffer", GST_TYPE_STRUCTURE,
@@ -2008,21 +2845,6 @@ ssrc_stats_add_jitter_stats (GstStructure * ssrc_stats,
   gst_structure_free (jitter_stats);
 }
 
-static GstElement *
-rtp_session_stats_get_jitter_buffer (KmsRTPSessionStats * rtp_stats, guint ssrc)
-{
-  GSList *e;
-
-  for (e = rtp_stats->ssrcs; e != NULL; e = e->next) {
-    KmsSSRCStats *ssrc_stats = e->data;
-
-    if (ssrc_stats->ssrc == ssrc)
-      return ssrc_stats->jitter_buffer;
-  }
-
-  return NULL;
-}
-
 static const GstStructure *
 get_structure_from_id (const GstStructure * structure, const gchar * fieldname)
 {
@@ -2104,7 +2926,7 @@ append_rtp_session_stats (gpointer * session, KmsRTPSessionStats * rtp_stats,
   g_object_get (rtp_stats->rtp_session, "sources", &arr, NULL);
 
   for (i = 0; i < arr->n_values; i++) {
-    GstElement *jitter_buffer;
+    KmsSsrcStatsSnapshot snapshot;
     GstStructure *ssrc_stats;
     gboolean internal;
     GObject *source;
@@ -2152,10 +2974,9 @@ append_rtp_session_stats (gpointer * session, KmsRTPSessionStats * rtp_stats,
 
     gst_structure_set (ssrc_stats, "id", G_TYPE_STRING, id, NULL);
 
-    jitter_buffer = rtp_session_stats_get_jitter_buffer (rtp_stats, ssrc);
-
-    if (jitter_buffer != NULL) {
-      ssrc_stats_add_jitter_stats (ssrc_stats, jitter_buffer);
+    if (kms_ssrc_stats_table_lookup (rtp_stats->ssrcs,
+            GPOINTER_TO_UINT (session), ssrc, &snapshot)) {
+      ssrc_stats_add_jitter_stats (ssrc_stats, &snapshot);
     }
 
     gst_structure_set (session_stats, name, GST_TYPE_STRUCTURE, ssrc_stats,
@@ -2199,7 +3020,8 @@ kms_base_rtp_endpoint_add_rtp_stats (KmsBaseRtpEndpoint * self,
     session_id = AUDIO_RTP_SESSION;
   } else if (g_strcmp0 (selector, VIDEO_STREAM_NAME) == 0) {
     session_id = VIDEO_RTP_SESSION;
-  } else {
+  } else if (!kms_base_rtp_endpoint_get_session_by_mid (self, selector,
+          &session_id)) {
     GST_WARNING_OBJECT (self, "Invalid selector provided: %s", selector);
     return stats;
   }
@@ -2235,6 +3057,9 @@ kms_base_rtp_endpoint_set_property (GObject * object, guint property_id,
     case PROP_RTCP_REMB:
       self->priv->rtcp_remb = g_value_get_boolean (value);
       break;
+    case PROP_RTCP_TRANSPORT_CC:
+      self->priv->rtcp_transport_cc = g_value_get_boolean (value);
+      break;
     case PROP_TARGET_BITRATE:
       self->priv->target_bitrate = g_value_get_int (value);
       break;
@@ -2278,13 +3103,20 @@ kms_base_rtp_endpoint_set_property (GObject * object, guint property_id,
       break;
     }
     case PROP_REMB_PARAMS:
-      if (self->priv->rl != NULL) {
+      if (self->priv->rl != NULL || self->priv->tr != NULL) {
         GstStructure *params = g_value_get_boxed (value);
 
         GST_DEBUG_OBJECT (self,
-            "Set to already created RembLocal and RembRemote");
-        kms_remb_local_set_params (self->priv->rl, params);
-        kms_remb_remote_set_params (self->priv->rm, params);
+            "Set to already created RembLocal, RembRemote and TwccRemote");
+        if (self->priv->rl != NULL) {
+          kms_remb_local_set_params (self->priv->rl, params);
+        }
+        if (self->priv->rm != NULL) {
+          kms_remb_remote_set_params (self->priv->rm, params);
+        }
+        if (self->priv->tr != NULL) {
+          kms_twcc_remote_set_params (self->priv->tr, params);
+        }
       } else {
         GST_DEBUG_OBJECT (self, "Set to aux structure");
         if (self->priv->remb_params != NULL) {
@@ -2343,6 +3175,9 @@ kms_base_rtp_endpoint_get_property (GObject * object, guint property_id,
     case PROP_RTCP_REMB:
       g_value_set_boolean (value, self->priv->rtcp_remb);
       break;
+    case PROP_RTCP_TRANSPORT_CC:
+      g_value_set_boolean (value, self->priv->rtcp_transport_cc);
+      break;
     case PROP_TARGET_BITRATE:
       g_value_set_int (value, self->priv->target_bitrate);
       break;
@@ -2358,13 +3193,20 @@ kms_base_rtp_endpoint_get_property (GObject * object, guint property_id,
       g_value_set_enum (value, self->priv->media_state);
       break;
     case PROP_REMB_PARAMS:
-      if (self->priv->rl != NULL) {
+      if (self->priv->rl != NULL || self->priv->tr != NULL) {
         GstStructure *params = gst_structure_new_empty ("remb-params");
 
         GST_DEBUG_OBJECT (self,
-            "Get from already created RembLocal and RembRemote");
-        kms_remb_local_get_params (self->priv->rl, &params);
-        kms_remb_remote_get_params (self->priv->rm, &params);
+            "Get from already created RembLocal, RembRemote and TwccRemote");
+        if (self->priv->rl != NULL) {
+          kms_remb_local_get_params (self->priv->rl, &params);
+        }
+        if (self->priv->rm != NULL) {
+          kms_remb_remote_get_params (self->priv->rm, &params);
+        }
+        if (self->priv->tr != NULL) {
+          kms_twcc_remote_get_params (self->priv->tr, &params);
+        }
         g_value_take_boxed (value, params);
       } else if (self->priv->remb_params != NULL) {
         GST_DEBUG_OBJECT (self, "Get from aux structure");
@@ -2392,25 +3234,28 @@ static void
 kms_base_rtp_endpoint_dispose (GObject * gobject)
 {
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (gobject);
+  GList *configs, *l;
 
   GST_DEBUG_OBJECT (self, "dispose");
 
-  if (self->priv->audio_config->ssrc != 0) {
-    kms_base_rtp_endpoint_stop_signal (self, AUDIO_RTP_SESSION,
-        self->priv->audio_config->ssrc);
-    g_signal_emit (G_OBJECT (self), obj_signals[MEDIA_STOP], 0,
-        KMS_MEDIA_TYPE_AUDIO, TRUE);
-  }
+  KMS_ELEMENT_LOCK (self);
+  configs = g_hash_table_get_values (self->priv->media_configs);
+  g_list_foreach (configs, (GFunc) rtp_media_config_ref, NULL);
+  KMS_ELEMENT_UNLOCK (self);
 
-  if (self->priv->video_config->ssrc != 0) {
-    kms_base_rtp_endpoint_stop_signal (self, VIDEO_RTP_SESSION,
-        self->priv->video_config->ssrc);
-    g_signal_emit (G_OBJECT (self), obj_signals[MEDIA_STOP], 0,
-        KMS_MEDIA_TYPE_VIDEO, TRUE);
+  configs = g_list_sort (configs, (GCompareFunc) rtp_media_config_cmp);
+
+  for (l = configs; l != NULL; l = l->next) {
+    RtpMediaConfig *config = l->data;
+
+    if (config->ssrc != 0) {
+      kms_base_rtp_endpoint_stop_signal (self, config->session, config->ssrc);
+      g_signal_emit (G_OBJECT (self), obj_signals[MEDIA_STOP], 0,
+          config->media, TRUE);
+    }
   }
 
-  rtp_media_config_unref (self->priv->audio_config);
-  rtp_media_config_unref (self->priv->video_config);
+  g_list_free_full (configs, (GDestroyNotify) rtp_media_config_unref);
 
   G_OBJECT_CLASS (kms_base_rtp_endpoint_parent_class)->dispose (gobject);
 }
@@ -2419,6 +3264,7 @@ static void
 kms_base_rtp_endpoint_destroy_stats (KmsBaseRtpEndpoint * self)
 {
   g_hash_table_destroy (self->priv->stats.rtp_stats);
+  kms_ssrc_stats_table_destroy (self->priv->stats.ssrcs);
   g_slist_free_full (self->priv->stats.probes,
       (GDestroyNotify) kms_stats_probe_destroy);
   g_hash_table_unref (self->priv->stats.avg_e2e);
@@ -2462,6 +3308,8 @@ kms_base_rtp_endpoint_finalize (GObject * gobject)
 
   kms_remb_local_destroy (self->priv->rl);
   kms_remb_remote_destroy (self->priv->rm);
+  kms_twcc_local_destroy (self->priv->tl);
+  kms_twcc_remote_destroy (self->priv->tr);
 
   sessions = kms_base_sdp_endpoint_get_sessions (base_endpoint);
   g_hash_table_foreach (sessions,
@@ -2471,8 +3319,8 @@ kms_base_rtp_endpoint_finalize (GObject * gobject)
     fclose (self->priv->stats_file);
   }
 
-  g_clear_object (&self->priv->sync_audio);
-  g_clear_object (&self->priv->sync_video);
+  g_hash_table_unref (self->priv->media_configs);
+  g_clear_object (&self->priv->sync_ctx);
 
   G_OBJECT_CLASS (kms_base_rtp_endpoint_parent_class)->finalize (gobject);
 }
@@ -2483,10 +3331,9 @@ typedef struct _KmsRembStats
   guint session;
 } KmsRembStats;
 
-static void
-merge_remb_stats (gpointer key, guint * value, KmsRembStats * rs)
+static GstStructure *
+get_remb_ssrc_stats (KmsRembStats * rs, guint ssrc)
 {
-  guint ssrc = GPOINTER_TO_UINT (key);
   gchar *session_id, *ssrc_id;
   const GstStructure *session_stats, *ssrc_stats;
 
@@ -2495,19 +3342,28 @@ merge_remb_stats (gpointer key, guint * value, KmsRembStats * rs)
   g_free (session_id);
 
   if (session_stats == NULL) {
-    return;
+    return NULL;
   }
 
   ssrc_id = g_strdup_printf ("ssrc-%u", ssrc);
   ssrc_stats = get_structure_from_id (session_stats, ssrc_id);
   g_free (ssrc_id);
 
+  return (GstStructure *) ssrc_stats;
+}
+
+static void
+merge_remb_stats (gpointer key, guint * value, KmsRembStats * rs)
+{
+  GstStructure *ssrc_stats;
+
+  ssrc_stats = get_remb_ssrc_stats (rs, GPOINTER_TO_UINT (key));
+
   if (ssrc_stats == NULL) {
     return;
   }
 
-  gst_structure_set ((GstStructure *) ssrc_stats, "remb", G_TYPE_UINT, *value,
-      NULL);
+  gst_structure_set (ssrc_stats, "remb", G_TYPE_UINT, *value, NULL);
 }
 
 static void
@@ -2537,6 +3393,129 @@ kms_base_rtp_endpoint_append_remb_stats (KmsBaseRtpEndpoint * self,
         (GHFunc) merge_remb_stats, &rs);
     KMS_REMB_BASE_UNLOCK (self->priv->rm);
   }
+
+  if (self->priv->tr != NULL) {
+    GstStructure *ssrc_stats;
+
+    rs.stats = stats;
+    rs.session = VIDEO_RTP_SESSION;
+    ssrc_stats =
+        get_remb_ssrc_stats (&rs, self->priv->video_config->local_ssrc);
+
+    if (ssrc_stats != NULL) {
+      gst_structure_set (ssrc_stats, "twcc-target-bitrate", G_TYPE_UINT,
+          kms_twcc_remote_get_target_bitrate (self->priv->tr), NULL);
+    }
+  }
+}
+
+static void
+kms_base_rtp_endpoint_append_pacer_stats (KmsBaseRtpEndpoint * self,
+    GstStructure * stats, gchar * selector)
+{
+  GstStructure *ssrc_stats, *pacer_stats;
+  GstClockTime delay, max_delay;
+  guint queued;
+  KmsRembStats rs;
+
+  if (g_strcmp0 (selector, VIDEO_STREAM_NAME) != 0 ||
+      self->priv->video_pacer == NULL) {
+    return;
+  }
+
+  rs.stats = stats;
+  rs.session = VIDEO_RTP_SESSION;
+  ssrc_stats = get_remb_ssrc_stats (&rs, self->priv->video_config->local_ssrc);
+
+  if (ssrc_stats == NULL) {
+    return;
+  }
+
+  g_object_get (self->priv->video_pacer, "stats", &pacer_stats, NULL);
+
+  if (gst_structure_get_uint64 (pacer_stats, "queue-delay", &delay) &&
+      gst_structure_get_uint64 (pacer_stats, "max-queue-delay", &max_delay) &&
+      gst_structure_get_uint (pacer_stats, "queued-packets", &queued)) {
+    gst_structure_set (ssrc_stats, "pacer-queue-delay", G_TYPE_UINT64, delay,
+        "pacer-max-queue-delay", G_TYPE_UINT64, max_delay,
+        "pacer-queued-packets", G_TYPE_UINT, queued, NULL);
+  }
+
+  gst_structure_free (pacer_stats);
+}
+
+static void
+kms_base_rtp_endpoint_append_fec_stats (KmsBaseRtpEndpoint * self,
+    GstStructure * stats, gchar * selector)
+{
+  GstStructure *ssrc_stats;
+  GHashTableIter iter;
+  gpointer value;
+  KmsRembStats rs;
+
+  if (g_strcmp0 (selector, AUDIO_STREAM_NAME) == 0) {
+    return;
+  }
+
+  rs.stats = stats;
+
+  KMS_ELEMENT_LOCK (self);
+
+  g_hash_table_iter_init (&iter, self->priv->media_configs);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    RtpMediaConfig *config = value;
+
+    if (config->fec_ctrl == NULL) {
+      continue;
+    }
+
+    rs.session = config->session;
+    ssrc_stats = get_remb_ssrc_stats (&rs, config->local_ssrc);
+
+    if (ssrc_stats != NULL) {
+      kms_fec_controller_get_stats (config->fec_ctrl, ssrc_stats);
+    }
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+}
+
+static void
+kms_base_rtp_endpoint_append_rtx_stats (KmsBaseRtpEndpoint * self,
+    GstStructure * stats, gchar * selector)
+{
+  GstStructure *ssrc_stats;
+  KmsRtxCacheStats rtx;
+  GHashTableIter iter;
+  gpointer value;
+  KmsRembStats rs;
+
+  rs.stats = stats;
+
+  KMS_ELEMENT_LOCK (self);
+
+  g_hash_table_iter_init (&iter, self->priv->media_configs);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    RtpMediaConfig *config = value;
+
+    if (config->rtx == NULL) {
+      continue;
+    }
+
+    rs.session = config->session;
+    ssrc_stats = get_remb_ssrc_stats (&rs, config->local_ssrc);
+
+    if (ssrc_stats == NULL) {
+      continue;
+    }
+
+    kms_rtx_sender_get_stats (config->rtx, &rtx);
+    gst_structure_set (ssrc_stats, "rtx-hits", G_TYPE_UINT64, rtx.hits,
+        "rtx-misses", G_TYPE_UINT64, rtx.misses, "rtx-expired",
+        G_TYPE_UINT64, rtx.expired, NULL);
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
 }
 
 static gchar *
@@ -2624,6 +3603,9 @@ kms_base_rtp_endpoint_stats (KmsElement * obj, gchar * selector)
   rtp_stats = gst_structure_new_empty (KMS_RTP_STRUCT_NAME);
   kms_base_rtp_endpoint_add_rtp_stats (self, rtp_stats, selector);
   kms_base_rtp_endpoint_append_remb_stats (self, rtp_stats, selector);
+  kms_base_rtp_endpoint_append_pacer_stats (self, rtp_stats, selector);
+  kms_base_rtp_endpoint_append_fec_stats (self, rtp_stats, selector);
+  kms_base_rtp_endpoint_append_rtx_stats (self, rtp_stats, selector);
 
   gst_structure_set (stats, KMS_RTC_STATISTICS_FIELD, GST_TYPE_STRUCTURE,
       rtp_stats, NULL);
@@ -2700,12 +3682,13 @@ static void
 kms_base_rtp_endpoint_constructed (GObject * gobject)
 {
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (gobject);
-  KmsRtpSyncContext *sync_ctx;
 
-  sync_ctx = kms_rtp_sync_context_new (GST_OBJECT_NAME (self));
-  self->priv->sync_audio = kms_rtp_synchronizer_new (sync_ctx, TRUE);
-  self->priv->sync_video = kms_rtp_synchronizer_new (sync_ctx, TRUE);
-  g_object_unref (sync_ctx);
+  /* Every media shares the context so that all of them are synchronized */
+  self->priv->sync_ctx = kms_rtp_sync_context_new (GST_OBJECT_NAME (self));
+  self->priv->audio_config->sync =
+      kms_rtp_synchronizer_new (self->priv->sync_ctx, TRUE);
+  self->priv->video_config->sync =
+      kms_rtp_synchronizer_new (self->priv->sync_ctx, TRUE);
 
   self->priv->perform_video_sync = TRUE;
 }
@@ -2755,6 +3738,7 @@ kms_base_rtp_endpoint_class_init (KmsBaseRtpEndpointClass * klass)
   base_endpoint_class->create_media_handler = kms_base_rtp_create_media_handler;
 
   base_endpoint_class->configure_media = kms_base_rtp_endpoint_configure_media;
+  base_endpoint_class->max_medias = MAX_MEDIAS;
 
   g_object_class_install_property (object_class, PROP_MEDIA_STATE,
       g_param_spec_enum ("media-state", "Media state", "Media state",
@@ -2776,6 +3760,12 @@ kms_base_rtp_endpoint_class_init (KmsBaseRtpEndpointClass * klass)
           "RTCP REMB", DEFAULT_RTCP_REMB,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_RTCP_TRANSPORT_CC,
+      g_param_spec_boolean ("rtcp-transport-cc", "RTCP transport-cc",
+          "RTCP transport-wide congestion control feedback",
+          DEFAULT_RTCP_TRANSPORT_CC,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (object_class, PROP_TARGET_BITRATE,
       g_param_spec_int ("target-bitrate", "Target bitrate",
           "Target bitrate (bps)", 0, G_MAXINT,
@@ -2884,26 +3874,16 @@ kms_base_rtp_endpoint_rtpbin_on_new_ssrc (GstElement * rtpbin, guint session,
     guint ssrc, gpointer user_data)
 {
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (user_data);
+  RtpMediaConfig *config;
 
   KMS_ELEMENT_LOCK (self);
 
-  switch (session) {
-    case AUDIO_RTP_SESSION:
-      if (self->priv->audio_config->ssrc != 0) {
-        break;
-      }
-
-      self->priv->audio_config->ssrc = ssrc;
-      break;
-    case VIDEO_RTP_SESSION:
-      if (self->priv->video_config->ssrc != 0) {
-        break;
-      }
+  config = kms_base_rtp_endpoint_lookup_media_config (self, session);
 
-      self->priv->video_config->ssrc = ssrc;
-      break;
-    default:
-      GST_WARNING_OBJECT (self, "No media supported for session %u", session);
+  if (config == NULL) {
+    GST_WARNING_OBJECT (self, "No media supported for session %u", session);
+  } else if (config->ssrc == 0) {
+    config->ssrc = ssrc;
   }
 
   KMS_ELEMENT_UNLOCK (self);
@@ -2914,28 +3894,29 @@ kms_base_rtp_endpoint_set_media_state (KmsBaseRtpEndpoint * self, guint session,
     KmsMediaState state)
 {
   gboolean actived = FALSE, emit = FALSE;
-  KmsMediaState new_state;
+  KmsMediaState new_state = KMS_MEDIA_STATE_DISCONNECTED;
+  RtpMediaConfig *config;
+  GHashTableIter iter;
+  gpointer key, value;
 
   KMS_ELEMENT_LOCK (self);
 
   actived = state == KMS_MEDIA_STATE_CONNECTED;
 
-  switch (session) {
-    case AUDIO_RTP_SESSION:
-      self->priv->audio_config->actived = actived;
-      break;
-    case VIDEO_RTP_SESSION:
-      self->priv->video_config->actived = actived;
-      break;
-    default:
-      GST_WARNING_OBJECT (self, "No media supported for session %u", session);
+  config = kms_base_rtp_endpoint_lookup_media_config (self, session);
+  if (config != NULL) {
+    config->actived = actived;
+  } else {
+    GST_WARNING_OBJECT (self, "No media supported for session %u", session);
   }
 
-  if (self->priv->audio_config->actived || self->priv->video_config->actived) {
-    /* There is still a media connection alive */
-    new_state = KMS_MEDIA_STATE_CONNECTED;
-  } else {
-    new_state = KMS_MEDIA_STATE_DISCONNECTED;
+  g_hash_table_iter_init (&iter, self->priv->media_configs);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    if (((RtpMediaConfig *) value)->actived) {
+      /* There is still a media connection alive */
+      new_state = KMS_MEDIA_STATE_CONNECTED;
+      break;
+    }
   }
 
   if (self->priv->media_state != new_state) {
@@ -2981,30 +3962,28 @@ kms_base_rtp_endpoint_rtpbin_on_ssrc_sdes (GstElement * rtpbin, guint session,
     guint ssrc, gpointer user_data)
 {
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (user_data);
+  RtpMediaConfig *config;
   KmsMediaType media;
 
   KMS_ELEMENT_LOCK (self);
 
-  if (ssrc != self->priv->audio_config->ssrc
-      && ssrc != self->priv->video_config->ssrc) {
+  config = kms_base_rtp_endpoint_lookup_media_config (self, session);
+
+  if (config == NULL) {
+    GST_WARNING_OBJECT (self, "No media supported for session %u", session);
+    KMS_ELEMENT_UNLOCK (self);
+    return;
+  }
+
+  if (ssrc != config->ssrc) {
     GST_WARNING_OBJECT (self, "SSRC %u not valid", ssrc);
     KMS_ELEMENT_UNLOCK (self);
     return;
   }
 
-  KMS_ELEMENT_UNLOCK (self);
+  media = config->media;
 
-  switch (session) {
-    case AUDIO_RTP_SESSION:
-      media = KMS_MEDIA_TYPE_AUDIO;
-      break;
-    case VIDEO_RTP_SESSION:
-      media = KMS_MEDIA_TYPE_VIDEO;
-      break;
-    default:
-      GST_WARNING_OBJECT (self, "No media supported for session %u", session);
-      return;
-  }
+  KMS_ELEMENT_UNLOCK (self);
 
   g_signal_emit (G_OBJECT (self), obj_signals[MEDIA_START], 0, media, FALSE);
 }
@@ -3019,6 +3998,46 @@ kms_base_rtp_endpoint_rtpbin_on_timeout (GstElement * rtpbin,
       KMS_MEDIA_STATE_DISCONNECTED);
 }
 
+static void
+kms_base_rtp_endpoint_update_fec_controller (KmsBaseRtpEndpoint * self,
+    guint session, guint ssrc)
+{
+  RtpMediaConfig *config;
+  GObject *rtpsession, *source = NULL;
+  GstStructure *stats;
+
+  config = kms_base_rtp_endpoint_get_media_config (self, session);
+  if (config == NULL) {
+    return;
+  }
+
+  if (config->fec_ctrl == NULL) {
+    goto end;
+  }
+
+  g_signal_emit_by_name (self->priv->rtpbin, "get-internal-session", session,
+      &rtpsession);
+  if (rtpsession == NULL) {
+    goto end;
+  }
+
+  /* Receiver reports from the remote peer describe our sent stream */
+  g_signal_emit_by_name (rtpsession, "get-source-by-ssrc", ssrc, &source);
+  g_object_unref (rtpsession);
+
+  if (source == NULL) {
+    goto end;
+  }
+
+  g_object_get (source, "stats", &stats, NULL);
+  kms_fec_controller_process_source_stats (config->fec_ctrl, stats);
+  gst_structure_free (stats);
+  g_object_unref (source);
+
+end:
+  rtp_media_config_unref (config);
+}
+
 static void
 kms_base_rtp_endpoint_rtpbin_on_ssrc_active (GstElement * rtpbin,
     guint session, guint ssrc, gpointer user_data)
@@ -3027,6 +4046,7 @@ kms_base_rtp_endpoint_rtpbin_on_ssrc_active (GstElement * rtpbin,
 
   kms_base_rtp_endpoint_set_media_state (self, session,
       KMS_MEDIA_STATE_CONNECTED);
+  kms_base_rtp_endpoint_update_fec_controller (self, session, ssrc);
 }
 
 static GstElement *
@@ -3116,20 +4136,19 @@ kms_base_rtp_endpoint_rtpbin_request_aux_receiver (GstElement * rtpbin,
 {
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (user_data);
   GstElement *receiver = NULL;
-  gchar *media_str;
+  const gchar *media_str;
   ExtData *edata;
 
-  if (session == AUDIO_RTP_SESSION) {
-    media_str = AUDIO_STREAM_NAME;
-  } else if (session == VIDEO_RTP_SESSION) {
-    media_str = VIDEO_STREAM_NAME;
-  } else {
-    GST_DEBUG_OBJECT (self, "No aux receiver required for session %u", session);
+  KMS_ELEMENT_LOCK (self);
+
+  media_str = kms_base_rtp_endpoint_get_session_media_str (self, session);
+  if (media_str == NULL) {
+    KMS_ELEMENT_UNLOCK (self);
+    GST_DEBUG_OBJECT (self, "No aux %s required for session %u", "receiver",
+        session);
     return NULL;
   }
 
-  KMS_ELEMENT_LOCK (self);
-
   edata = kms_list_lookup (self->priv->prot_medias, media_str);
 
   if (edata != NULL) {
@@ -3143,15 +4162,59 @@ kms_base_rtp_endpoint_rtpbin_request_aux_receiver (GstElement * rtpbin,
   return receiver;
 }
 
+static void
+kms_base_rtp_endpoint_create_fec_controller (KmsBaseRtpEndpoint * self,
+    guint session, GstElement * fec, GstElement * red)
+{
+  RtpMediaConfig *config;
+
+  /* Called with the element lock held */
+  config = kms_base_rtp_endpoint_lookup_media_config (self, session);
+  if (config == NULL || config->media != KMS_MEDIA_TYPE_VIDEO) {
+    return;
+  }
+
+  if (config->fec_ctrl != NULL) {
+    GST_WARNING_OBJECT (self, "Session %u already protected", session);
+    return;
+  }
+
+  config->fec_ctrl = kms_fec_controller_create (fec, red,
+      kms_base_rtp_endpoint_is_video_rtcp_nack (self));
+
+  GST_DEBUG_OBJECT (self, "FEC controller added to session %u", session);
+}
+
+static GstElement *
+kms_base_rtp_endpoint_create_rtx_sender (KmsBaseRtpEndpoint * self,
+    guint session)
+{
+  RtpMediaConfig *config;
+  GstElement *e;
+
+  /* Called with the element lock held */
+  e = gst_element_factory_make ("identity", NULL);
+  config = kms_base_rtp_endpoint_lookup_media_config (self, session);
+
+  if (config == NULL || config->rtx != NULL) {
+    GST_WARNING_OBJECT (self, "Session %u will not retransmit", session);
+    return e;
+  }
+
+  /* Forwarded packets are retransmitted from the cache of their source */
+  config->rtx = kms_rtx_sender_create (e, RTP_RTX_SIZE);
+
+  return e;
+}
+
 static GstElement *
 kms_base_rtp_endpoint_create_aux_sender (KmsBaseRtpEndpoint * self,
     guint session, ExtData * edata)
 {
+  GstElement *e, *fec = NULL, *red = NULL;
   GSList *list = NULL;
-  GstElement *e;
 
-  e = gst_element_factory_make ("rtprtxqueue", NULL);
-  g_object_set (e, "max-size-packets", RTP_RTX_SIZE, NULL);
+  e = kms_base_rtp_endpoint_create_rtx_sender (self, session);
   list = g_slist_prepend (list, e);
 
   if (edata == NULL) {
@@ -3160,17 +4223,21 @@ kms_base_rtp_endpoint_create_aux_sender (KmsBaseRtpEndpoint * self,
   }
 
   if (edata->red_pt != 0) {
-    e = gst_element_factory_make ("redenc", NULL);
-    g_object_set (e, "pt", edata->red_pt, NULL);
-    list = g_slist_prepend (list, e);
+    red = gst_element_factory_make ("redenc", NULL);
+    g_object_set (red, "pt", edata->red_pt, NULL);
+    list = g_slist_prepend (list, red);
   }
 
   if (edata->ulpfec_pt != 0) {
-    e = gst_element_factory_make ("ulpfecenc", NULL);
+    fec = gst_element_factory_make ("ulpfecenc", NULL);
     /* FIXME: Chrome does not seem to work well with FEC packages generated */
     /* in our side. Uncomment this when this issue is fixed.                */
-//    g_object_set (e, "pt", edata->ulpfec_pt, NULL);
-    list = g_slist_prepend (list, e);
+//    g_object_set (fec, "pt", edata->ulpfec_pt, NULL);
+    list = g_slist_prepend (list, fec);
+  }
+
+  if (fec != NULL || red != NULL) {
+    kms_base_rtp_endpoint_create_fec_controller (self, session, fec, red);
   }
 
 end:
@@ -3187,20 +4254,19 @@ kms_base_rtp_endpoint_rtpbin_request_aux_sender (GstElement * rtpbin,
 {
   KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (user_data);
   GstElement *sender = NULL;
-  gchar *media_str;
+  const gchar *media_str;
   ExtData *edata;
 
-  if (session == AUDIO_RTP_SESSION) {
-    media_str = AUDIO_STREAM_NAME;
-  } else if (session == VIDEO_RTP_SESSION) {
-    media_str = VIDEO_STREAM_NAME;
-  } else {
-    GST_DEBUG_OBJECT (self, "No aux receiver required for session %u", session);
+  KMS_ELEMENT_LOCK (self);
+
+  media_str = kms_base_rtp_endpoint_get_session_media_str (self, session);
+  if (media_str == NULL) {
+    KMS_ELEMENT_UNLOCK (self);
+    GST_DEBUG_OBJECT (self, "No aux %s required for session %u", "sender",
+        session);
     return NULL;
   }
 
-  KMS_ELEMENT_LOCK (self);
-
   edata = kms_list_lookup (self->priv->prot_medias, media_str);
 
   sender = kms_base_rtp_endpoint_create_aux_sender (self, session, edata);
@@ -3216,6 +4282,7 @@ kms_base_rtp_endpoint_init_stats (KmsBaseRtpEndpoint * self)
   self->priv->stats.enabled = FALSE;
   self->priv->stats.rtp_stats = g_hash_table_new_full (g_direct_hash,
       g_direct_equal, NULL, (GDestroyNotify) rtp_session_stats_destroy);
+  self->priv->stats.ssrcs = kms_ssrc_stats_table_new ();
   self->priv->stats.avg_e2e = g_hash_table_new_full (g_str_hash, g_str_equal,
       g_free, (GDestroyNotify) kms_ref_struct_unref);
 }
@@ -3248,6 +4315,7 @@ kms_base_rtp_endpoint_init (KmsBaseRtpEndpoint * self)
   self->priv->rtcp_mux = DEFAULT_RTCP_MUX;
   self->priv->rtcp_nack = DEFAULT_RTCP_NACK;
   self->priv->rtcp_remb = DEFAULT_RTCP_REMB;
+  self->priv->rtcp_transport_cc = DEFAULT_RTCP_TRANSPORT_CC;
 
   self->priv->min_video_recv_bw = MIN_VIDEO_RECV_BW_DEFAULT;
   self->priv->min_video_send_bw = MIN_VIDEO_SEND_BW_DEFAULT;
@@ -3287,8 +4355,17 @@ kms_base_rtp_endpoint_init (KmsBaseRtpEndpoint * self)
 
   gst_bin_add (GST_BIN (self), self->priv->rtpbin);
 
-  self->priv->audio_config = rtp_media_config_new ();
-  self->priv->video_config = rtp_media_config_new ();
+  self->priv->audio_config =
+      rtp_media_config_new (AUDIO_RTP_SESSION, KMS_MEDIA_TYPE_AUDIO);
+  self->priv->video_config =
+      rtp_media_config_new (VIDEO_RTP_SESSION, KMS_MEDIA_TYPE_VIDEO);
+  /* Owns the references to the configs */
+  self->priv->media_configs = g_hash_table_new_full (g_direct_hash,
+      g_direct_equal, NULL, (GDestroyNotify) rtp_media_config_unref);
+  g_hash_table_insert (self->priv->media_configs,
+      GUINT_TO_POINTER (AUDIO_RTP_SESSION), self->priv->audio_config);
+  g_hash_table_insert (self->priv->media_configs,
+      GUINT_TO_POINTER (VIDEO_RTP_SESSION), self->priv->video_config);
 
   kms_base_rtp_endpoint_init_stats (self);
 
@@ -303,6 +303,15 @@ kms_base_rtp_session_link_pads (GstPad * src, GstPad * sink)
   }
 }
 
+static void
+kms_base_rtp_session_learn_ssrc (KmsBaseRtpSession * self, guint32 ssrc,
+    KmsMediaType media)
+{
+  /* Called with the session lock held */
+  kms_ssrc_routes_add (self->ssrc_routes, ssrc, KMS_SSRC_ROUTE_NO_INDEX, media,
+      KMS_SSRC_ROLE_MEDIA);
+}
+
 static void
 rtp_ssrc_demux_new_ssrc_pad (GstElement * ssrcdemux, guint ssrc, GstPad * pad,
     KmsBaseRtpSession * self)
@@ -310,6 +319,9 @@ rtp_ssrc_demux_new_ssrc_pad (GstElement * ssrcdemux, guint ssrc, GstPad * pad,
   const gchar *rtp_pad_name = GST_OBJECT_NAME (pad);
   gchar *rtcp_pad_name;
   const GstSDPMedia *media;
+  const KmsSsrcRoute *found;
+  KmsSsrcRoute route;
+  gboolean routed;
   GstPad *src, *sink;
 
   GST_DEBUG_OBJECT (self, "pad: %" GST_PTR_FORMAT " ssrc: %" G_GUINT32_FORMAT,
@@ -317,12 +329,25 @@ rtp_ssrc_demux_new_ssrc_pad (GstElement * ssrcdemux, guint ssrc, GstPad * pad,
 
   KMS_SDP_SESSION_LOCK (self);
 
-  if (self->remote_audio_ssrc == ssrc
+  /* Announced SSRCs are resolved without querying the RTCP demuxer. Repair
+   * streams are left to the session manager as before */
+  found = kms_ssrc_routes_lookup (self->ssrc_routes, ssrc);
+  routed = found != NULL && found->role == KMS_SSRC_ROLE_MEDIA;
+  if (routed) {
+    route = *found;
+  }
+
+  if (routed) {
+    GST_TRACE_OBJECT (self, "SSRC %" G_GUINT32_FORMAT " routed to media %d",
+        ssrc, route.index);
+  } else if (self->remote_audio_ssrc == ssrc
       || ssrcs_are_mapped (ssrcdemux, self->local_audio_ssrc, ssrc)) {
-    media = self->audio_neg;
+    route.media = KMS_MEDIA_TYPE_AUDIO;
+    kms_base_rtp_session_learn_ssrc (self, ssrc, route.media);
   } else if (self->remote_video_ssrc == ssrc
       || ssrcs_are_mapped (ssrcdemux, self->local_video_ssrc, ssrc)) {
-    media = self->video_neg;
+    route.media = KMS_MEDIA_TYPE_VIDEO;
+    kms_base_rtp_session_learn_ssrc (self, ssrc, route.media);
   } else {
     if (!kms_i_rtp_session_manager_custom_ssrc_management (self->manager, self,
             ssrcdemux, ssrc, pad)) {
@@ -331,6 +356,25 @@ rtp_ssrc_demux_new_ssrc_pad (GstElement * ssrcdemux, guint ssrc, GstPad * pad,
     goto end;
   }
 
+  media = NULL;
+
+  if (routed) {
+    /* Each m-line goes to its own media in the session manager */
+    media = g_hash_table_lookup (self->neg_medias,
+        GINT_TO_POINTER (route.index));
+  }
+
+  if (media == NULL) {
+    media = route.media == KMS_MEDIA_TYPE_AUDIO ? self->audio_neg :
+        self->video_neg;
+  }
+
+  if (media == NULL) {
+    GST_ERROR_OBJECT (pad, "No media negotiated for SSRC %" G_GUINT32_FORMAT,
+        ssrc);
+    goto end;
+  }
+
   /* RTP */
   sink =
       kms_i_rtp_session_manager_request_rtp_sink (self->manager, self, media);
@@ -529,11 +573,56 @@ kms_base_rtp_session_add_connection_for_session (KmsBaseRtpSession * self,
   return TRUE;
 }
 
-static const gchar *
+static void
+kms_base_rtp_session_update_ssrc_routes (KmsBaseRtpSession * self,
+    const GstSDPMedia * remote_media, const GstSDPMedia * neg_media,
+    guint index, KmsMediaType media)
+{
+  GstSDPMedia *copy;
+  guint n;
+
+  gst_sdp_media_copy (neg_media, &copy);
+
+  KMS_SDP_SESSION_LOCK (self);
+
+  g_hash_table_insert (self->neg_medias, GUINT_TO_POINTER (index), copy);
+
+  /* Learnt SSRCs may belong to the m-line being renegotiated */
+  kms_ssrc_routes_remove_index (self->ssrc_routes, index);
+  kms_ssrc_routes_remove_learnt (self->ssrc_routes, media);
+  n = kms_ssrc_routes_add_media (self->ssrc_routes, remote_media, index,
+      media);
+
+  KMS_SDP_SESSION_UNLOCK (self);
+
+  GST_DEBUG_OBJECT (self, "%u remote SSRCs routed to media %u", n, index);
+}
+
+static gboolean
+kms_base_rtp_session_is_first_media (KmsBaseRtpSession * self, guint index,
+    const gchar * media_str)
+{
+  const GstSDPMessage *sdp = KMS_SDP_SESSION (self)->neg_sdp;
+  guint i;
+
+  for (i = 0; i < index; i++) {
+    const GstSDPMedia *media = gst_sdp_message_get_media (sdp, i);
+
+    if (g_strcmp0 (gst_sdp_media_get_media (media), media_str) == 0) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static gboolean
 kms_base_rtp_session_process_remote_ssrc (KmsBaseRtpSession * self,
-    const GstSDPMedia * remote_media, const GstSDPMedia * neg_media)
+    const GstSDPMedia * remote_media, const GstSDPMedia * neg_media,
+    guint index)
 {
   const gchar *media_str = gst_sdp_media_get_media (remote_media);
+  gboolean first;
   guint ssrc;
 
   ssrc = sdp_utils_media_get_fid_ssrc (remote_media, 0);
@@ -541,35 +630,48 @@ kms_base_rtp_session_process_remote_ssrc (KmsBaseRtpSession * self,
     ssrc = sdp_utils_media_get_ssrc (remote_media);
   }
 
+  /* Further medias of the same type are only reachable through the routes */
+  first = kms_base_rtp_session_is_first_media (self, index, media_str);
+
   if (g_strcmp0 (AUDIO_STREAM_NAME, media_str) == 0) {
-    GST_DEBUG_OBJECT (self, "Add remote audio ssrc: %u", ssrc);
-    self->remote_audio_ssrc = ssrc;
-    if (self->audio_neg != NULL) {
-      gst_sdp_media_free (self->audio_neg);
+    GST_DEBUG_OBJECT (self, "Add remote audio ssrc: %u (media %u)", ssrc,
+        index);
+    if (first) {
+      self->remote_audio_ssrc = ssrc;
+      if (self->audio_neg != NULL) {
+        gst_sdp_media_free (self->audio_neg);
+      }
+      gst_sdp_media_copy (neg_media, &self->audio_neg);
     }
-    gst_sdp_media_copy (neg_media, &self->audio_neg);
+    kms_base_rtp_session_update_ssrc_routes (self, remote_media, neg_media,
+        index, KMS_MEDIA_TYPE_AUDIO);
 
-    return AUDIO_RTP_SESSION_STR;
+    return TRUE;
   } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
-    GST_DEBUG_OBJECT (self, "Add remote video ssrc: %u", ssrc);
-    self->remote_video_ssrc = ssrc;
-    if (self->video_neg != NULL) {
-      gst_sdp_media_free (self->video_neg);
+    GST_DEBUG_OBJECT (self, "Add remote video ssrc: %u (media %u)", ssrc,
+        index);
+    if (first) {
+      self->remote_video_ssrc = ssrc;
+      if (self->video_neg != NULL) {
+        gst_sdp_media_free (self->video_neg);
+      }
+      gst_sdp_media_copy (neg_media, &self->video_neg);
     }
-    gst_sdp_media_copy (neg_media, &self->video_neg);
+    kms_base_rtp_session_update_ssrc_routes (self, remote_media, neg_media,
+        index, KMS_MEDIA_TYPE_VIDEO);
 
-    return VIDEO_RTP_SESSION_STR;
+    return TRUE;
   }
 
   GST_WARNING_OBJECT (self, "Media '%s' not supported", media_str);
 
-  return NULL;
+  return FALSE;
 }
 
 static gboolean
 kms_base_rtp_session_configure_connection (KmsBaseRtpSession * self,
     KmsSdpMediaHandler * handler, const GstSDPMedia * neg_media,
-    const GstSDPMedia * remote_media, gboolean offerer)
+    const GstSDPMedia * remote_media, guint index, gboolean offerer)
 {
   const gchar *neg_proto_str = gst_sdp_media_get_proto (neg_media);
   const gchar *neg_media_str = gst_sdp_media_get_media (neg_media);
@@ -598,8 +700,8 @@ kms_base_rtp_session_configure_connection (KmsBaseRtpSession * self,
     return FALSE;
   }
 
-  if (kms_base_rtp_session_process_remote_ssrc (self, remote_media,
-          neg_media) == NULL) {
+  if (!kms_base_rtp_session_process_remote_ssrc (self, remote_media,
+          neg_media, index)) {
     return TRUE;                /* It cannot be managed here but could be managed by the child class */
   }
 
@@ -702,6 +804,11 @@ kms_base_rtp_session_start_transport_send (KmsBaseRtpSession * self,
       continue;
     }
 
+    if (kms_sdp_session_is_media_started (sdp_sess, i)) {
+      GST_DEBUG_OBJECT (self, "Media (id=%u) not changed", i);
+      continue;
+    }
+
     handler =
         kms_sdp_agent_get_handler_by_index (KMS_SDP_SESSION (self)->agent, i);
 
@@ -711,7 +818,7 @@ kms_base_rtp_session_start_transport_send (KmsBaseRtpSession * self,
     }
 
     if (!kms_base_rtp_session_configure_connection (self, handler, neg_media,
-            rem_media, offerer)) {
+            rem_media, i, offerer)) {
       GST_WARNING_OBJECT (self, "Cannot configure connection for media %u.", i);
     }
 
@@ -791,6 +898,8 @@ kms_base_rtp_session_finalize (GObject * object)
   }
 
   g_hash_table_destroy (self->conns);
+  kms_ssrc_routes_destroy (self->ssrc_routes);
+  g_hash_table_unref (self->neg_medias);
 
   /* chain up */
   G_OBJECT_CLASS (kms_base_rtp_session_parent_class)->finalize (object);
@@ -812,6 +921,9 @@ kms_base_rtp_session_init (KmsBaseRtpSession * self)
 {
   self->conns =
       g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->ssrc_routes = kms_ssrc_routes_new (NULL);
+  self->neg_medias = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) gst_sdp_media_free);
 
   self->stats_enabled = FALSE;
 }
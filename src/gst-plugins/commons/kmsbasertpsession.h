@@ -23,6 +23,7 @@
 #include "kmsirtpsessionmanager.h"
 #include "kmsirtpconnection.h"
 #include "kmsconnectionstate.h"
+#include "kmsssrcroutes.h"
 
 G_BEGIN_DECLS
 
@@ -61,6 +62,11 @@ struct _KmsBaseRtpSession
   guint32 local_video_ssrc;
   guint32 remote_video_ssrc;
 
+  /* Remote SSRCs announced or learnt, protected by the session lock */
+  KmsSsrcRoutes *ssrc_routes;
+  /* Negotiated medias the routes point to */
+  GHashTable *neg_medias;       /* <m-line index, GstSDPMedia> */
+
   gboolean stats_enabled;
 };
 
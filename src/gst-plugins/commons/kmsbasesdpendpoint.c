@@ -540,6 +540,9 @@ kms_base_sdp_endpoint_start_media (KmsBaseSdpEndpoint * self,
 
   base_sdp_endpoint_class->start_transport_send (self, sess, offerer);
   base_sdp_endpoint_class->connect_input_elements (self, sess);
+
+  /* Next negotiations only need to start the medias that change */
+  kms_sdp_session_set_started (sess);
 }
 
 static gboolean
@@ -759,22 +762,26 @@ kms_base_sdp_endpoint_set_property (GObject * object, guint prop_id,
       self->priv->max_audio_recv_bw = g_value_get_uint (value);
       break;
     case PROP_NUM_AUDIO_MEDIAS:{
+      guint max =
+          KMS_BASE_SDP_ENDPOINT_CLASS (G_OBJECT_GET_CLASS (self))->max_medias;
       guint n = g_value_get_uint (value);
 
-      if (n > 1) {
-        GST_WARNING_OBJECT (self, "Only 1 audio media is supported");
-        n = 1;
+      if (n > max) {
+        GST_WARNING_OBJECT (self, "Only %u audio medias are supported", max);
+        n = max;
       }
 
       self->priv->num_audio_medias = n;
       break;
     }
     case PROP_NUM_VIDEO_MEDIAS:{
+      guint max =
+          KMS_BASE_SDP_ENDPOINT_CLASS (G_OBJECT_GET_CLASS (self))->max_medias;
       guint n = g_value_get_uint (value);
 
-      if (n > 1) {
-        GST_WARNING_OBJECT (self, "Only 1 video media is supported");
-        n = 1;
+      if (n > max) {
+        GST_WARNING_OBJECT (self, "Only %u video medias are supported", max);
+        n = max;
       }
 
       self->priv->num_video_medias = n;
@@ -923,6 +930,7 @@ kms_base_sdp_endpoint_class_init (KmsBaseSdpEndpointClass * klass)
   klass->connect_input_elements = kms_base_sdp_endpoint_connect_input_elements;
 
   klass->configure_media = kms_base_sdp_endpoint_configure_media_impl;
+  klass->max_medias = 1;
 
   klass->generate_offer = kms_base_sdp_endpoint_generate_offer;
   klass->process_offer = kms_base_sdp_endpoint_process_offer;
@@ -81,6 +81,9 @@ struct _KmsBaseSdpEndpointClass
 
   /* Virtual handler factory methods */
   void (*create_media_handler) (KmsBaseSdpEndpoint * self, const gchar *media, KmsSdpMediaHandler **handler);
+
+  /* Maximum number of audio medias, and of video medias, per session */
+  guint max_medias;
 };
 
 GType kms_base_sdp_endpoint_get_type (void);
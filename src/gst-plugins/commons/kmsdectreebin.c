@@ -21,6 +21,7 @@
 
 #include "kmsdectreebin.h"
 #include "kmsutils.h"
+#include "kmsrtpforward.h"
 
 #define GST_DEFAULT_NAME "dectreebin"
 #define GST_CAT_DEFAULT kms_dec_tree_bin_debug
@@ -121,6 +122,7 @@ kms_dec_tree_bin_configure (KmsDecTreeBin * self, const GstCaps * caps,
 
     pad = gst_element_get_static_pad (parse, "sink");
     kms_utils_drop_until_keyframe (pad, TRUE);
+    kms_rtp_forward_strip_meta (pad);
     gst_object_unref (pad);
 
     gst_bin_add_many (GST_BIN (self), parse, dec, NULL);
@@ -134,6 +136,7 @@ kms_dec_tree_bin_configure (KmsDecTreeBin * self, const GstCaps * caps,
   } else {
     pad = gst_element_get_static_pad (dec, "sink");
     kms_utils_drop_until_keyframe (pad, TRUE);
+    kms_rtp_forward_strip_meta (pad);
     gst_object_unref (pad);
 
     gst_bin_add (GST_BIN (self), dec);
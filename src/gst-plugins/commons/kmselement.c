@@ -42,6 +42,9 @@
 GST_DEBUG_CATEGORY_STATIC (kms_element_debug_category);
 #define GST_CAT_DEFAULT kms_element_debug_category
 
+G_DEFINE_QUARK (FLOW_OUT_PROBE, flow_out_probe);
+G_DEFINE_QUARK (DATA_TEE_SINK, data_tee_sink);
+
 G_DEFINE_TYPE_WITH_CODE (KmsElement, kms_element,
     GST_TYPE_BIN,
     GST_DEBUG_CATEGORY_INIT (kms_element_debug_category, PLUGIN_NAME,
@@ -102,13 +105,29 @@ typedef struct _KmsElementStats
   GHashTable *avg_iss;          /* <"pad_name", StreamInputAvgStat> */
 } KmsElementStats;
 
+typedef struct _KmsMediaFlowTimeoutData KmsMediaFlowTimeoutData;
+
 typedef struct _KmsOutputElementData
 {
   GstElement *element;
+  /* Sink standing in for element until a src pad is requested */
+  GstElement *placeholder;
   KmsElementPadType type;
+  gchar *description;
   guint pad_count;
+  /* Media flow out is only tracked while src pads are requested */
+  guint requested_pads;
+  KmsMediaFlowTimeoutData *flow_out;
+  gulong flow_out_handler;
 } KmsOutputElementData;
 
+typedef struct _KmsOutputSwapData
+{
+  KmsElement *self;
+  GstElement *from;
+  GstElement *to;
+} KmsOutputSwapData;
+
 typedef enum _KmsMediaFlowType
 {
   KMS_MEDIA_FLOW_IN,
@@ -127,7 +146,7 @@ typedef struct _KmsMediaFlowData
   KmsMediaFlowType media_flow_type;
 } KmsMediaFlowData;
 
-typedef struct _KmsMediaFlowTimeoutData
+struct _KmsMediaFlowTimeoutData
 {
   KmsRefStruct ref;
 
@@ -137,7 +156,7 @@ typedef struct _KmsMediaFlowTimeoutData
   GOnce init;
   KmsLoop *loop;
   guint source_id;
-} KmsMediaFlowTimeoutData;
+};
 
 struct _KmsElementPrivate
 {
@@ -153,6 +172,7 @@ struct _KmsElementPrivate
   GstCaps *video_caps;
 
   GHashTable *pendingpads;
+  GHashTable *requested_srcpads;        /* <"pad_name", KmsOutputElementData> */
 
   gint min_bitrate;
   gint max_bitrate;
@@ -218,12 +238,13 @@ GST_STATIC_PAD_TEMPLATE (DATA_SRC_PAD,
     );
 
 static KmsOutputElementData *
-create_output_element_data (KmsElementPadType type)
+create_output_element_data (KmsElementPadType type, const gchar * description)
 {
   KmsOutputElementData *data;
 
   data = g_slice_new0 (KmsOutputElementData);
   data->type = type;
+  data->description = g_strdup (description);
 
   return data;
 }
@@ -342,6 +363,11 @@ stream_input_avg_stat_new (KmsMediaType type)
 static void
 destroy_output_element_data (KmsOutputElementData * data)
 {
+  if (data->flow_out != NULL) {
+    media_flow_timeout_data_unref (data->flow_out);
+  }
+
+  g_free (data->description);
   g_slice_free (KmsOutputElementData, data);
 }
 
@@ -639,10 +665,12 @@ attach_timeout (gpointer data)
   return NULL;
 }
 
-static void
+static gulong
 add_flow_event_probes (GstPad * pad, KmsMediaFlowTimeoutData * fdto_data)
 {
-  gst_pad_add_probe (pad,
+  gulong id;
+
+  id = gst_pad_add_probe (pad,
       GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
       (GstPadProbeCallback) cb_buffer_received,
       media_flow_timeout_data_ref (fdto_data),
@@ -651,6 +679,31 @@ add_flow_event_probes (GstPad * pad, KmsMediaFlowTimeoutData * fdto_data)
   /* TODO: the timeout could be detached when all pads are removed,
      but it must be added if a new pad is added */
   g_once (&fdto_data->init, attach_timeout, fdto_data);
+
+  return id;
+}
+
+static void
+add_flow_out_event_probes (GstPad * pad, KmsMediaFlowTimeoutData * fdto_data)
+{
+  gulong id;
+
+  id = add_flow_event_probes (pad, fdto_data);
+  g_object_set_qdata (G_OBJECT (pad), flow_out_probe_quark (),
+      GSIZE_TO_POINTER (id));
+}
+
+static void
+remove_flow_out_event_probes (GstPad * pad, gpointer data)
+{
+  gulong id;
+
+  id = GPOINTER_TO_SIZE (g_object_steal_qdata (G_OBJECT (pad),
+          flow_out_probe_quark ()));
+
+  if (id != 0) {
+    gst_pad_remove_probe (pad, id);
+  }
 }
 
 static void
@@ -661,7 +714,7 @@ add_flow_event_probes_pad_added (GstElement * element, GstPad * pad,
     return;
   }
 
-  add_flow_event_probes (pad, fdto_data);
+  add_flow_out_event_probes (pad, fdto_data);
 }
 
 static void
@@ -672,17 +725,71 @@ media_flow_data_destroy_closure (gpointer data, GClosure * closure)
   media_flow_timeout_data_unref (fdto_data);
 }
 
-static void
+static gulong
 add_flow_out_event_probes_to_element_sinks (GstElement * element,
     KmsMediaFlowTimeoutData * fdto_data)
 {
-  g_signal_connect_data (element, "pad-added",
+  gulong handler;
+
+  handler = g_signal_connect_data (element, "pad-added",
       G_CALLBACK (add_flow_event_probes_pad_added),
       media_flow_timeout_data_ref (fdto_data), media_flow_data_destroy_closure,
       0);
 
   kms_element_for_each_sink_pad (element,
-      (KmsPadCallback) add_flow_event_probes, fdto_data);
+      (KmsPadCallback) add_flow_out_event_probes, fdto_data);
+
+  return handler;
+}
+
+/* Called with the element lock held */
+static void
+kms_element_add_flow_out_detection (KmsElement * self,
+    KmsOutputElementData * odata)
+{
+  if (odata->type == KMS_ELEMENT_PAD_TYPE_DATA || odata->element == NULL ||
+      odata->flow_out != NULL) {
+    return;
+  }
+
+  GST_DEBUG_OBJECT (self, "Tracking media flow out for %s stream %s",
+      kms_element_pad_type_str (odata->type), odata->description);
+
+  odata->flow_out = media_flow_timeout_data_new (self, odata->description,
+      odata->type, KMS_MEDIA_FLOW_OUT);
+  odata->flow_out_handler =
+      add_flow_out_event_probes_to_element_sinks (odata->element,
+      odata->flow_out);
+}
+
+/* Called with the element lock held. Returns TRUE if media was flowing */
+static gboolean
+kms_element_remove_flow_out_detection (KmsElement * self,
+    KmsOutputElementData * odata)
+{
+  gboolean flowing;
+
+  if (odata->flow_out == NULL) {
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (self, "Not tracking media flow out for %s stream %s",
+      kms_element_pad_type_str (odata->type), odata->description);
+
+  g_signal_handler_disconnect (odata->element, odata->flow_out_handler);
+  kms_element_for_each_sink_pad (odata->element,
+      remove_flow_out_event_probes, NULL);
+  odata->flow_out_handler = 0;
+
+  flowing =
+      g_atomic_int_compare_and_exchange (&odata->flow_out->media_flow_data->
+      media_flowing, 1, 0);
+
+  /* Dropping the last reference also removes the timeout */
+  media_flow_timeout_data_unref (odata->flow_out);
+  odata->flow_out = NULL;
+
+  return flowing;
 }
 
 static void
@@ -699,37 +806,185 @@ kms_element_set_video_output_properties (KmsElement * self,
       self->priv->min_bitrate);
 }
 
-GstElement *
-kms_element_get_output_element (KmsElement * self, KmsElementPadType pad_type,
-    const gchar * description)
+/* Output element swap begin */
+
+static KmsOutputSwapData *
+kms_output_swap_data_new (KmsElement * self, GstElement * from,
+    GstElement * to)
 {
-  KmsOutputElementData *odata;
-  const gchar *desc;
+  KmsOutputSwapData *data;
 
-  desc = KMS_FORMAT_PAD_DESCRIPTION (description);
+  data = g_slice_new0 (KmsOutputSwapData);
+  data->self = self;
+  data->from = from;
+  data->to = to;
 
-  GST_DEBUG_OBJECT (self, "Output element requested for track %s, stream %s",
-      kms_element_pad_type_str (pad_type), desc);
+  return data;
+}
 
-  KMS_ELEMENT_LOCK (self);
+static void
+kms_output_swap_data_destroy (KmsOutputSwapData * data)
+{
+  g_slice_free (KmsOutputSwapData, data);
+}
 
-  odata = kms_element_get_output_element_data (self, pad_type, desc);
-  if (odata == NULL) {
-    gchar *key;
+static void
+kms_output_swap_data_destroy_closure (gpointer data, GClosure * closure)
+{
+  kms_output_swap_data_destroy (data);
+}
 
-    key = create_id_from_pad_attrs (pad_type, GST_PAD_SRC, desc);
-    GST_DEBUG_OBJECT (self, "New output element for track %s, stream %s",
-        kms_element_pad_type_str (pad_type), key);
-    odata = create_output_element_data (pad_type);
-    g_hash_table_insert (self->priv->output_elements, key, odata);
+static void
+kms_element_remove_output_element (KmsElement * self, GstElement * element)
+{
+  GstElement *sink;
+
+  GST_DEBUG_OBJECT (self, "Removing output element %" GST_PTR_FORMAT, element);
+
+  sink = g_object_steal_qdata (G_OBJECT (element), data_tee_sink_quark ());
+
+  gst_element_set_locked_state (element, TRUE);
+  gst_element_set_state (element, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (self), element);
+
+  if (sink != NULL) {
+    kms_element_remove_output_element (self, sink);
   }
+}
 
-  if (odata->element != NULL) {
-    KMS_ELEMENT_UNLOCK (self);
-    return odata->element;
+static gboolean
+kms_element_link_output_upstream (GstPad * upstream, GstPad * sink)
+{
+  GstPad *ghost = NULL, *peer;
+  gboolean ret;
+
+  if (GST_IS_PROXY_PAD (upstream) && !GST_IS_GHOST_PAD (upstream)) {
+    /* Internal pad of a ghost pad targeting the output element */
+    ghost = GST_PAD (gst_proxy_pad_get_internal (GST_PROXY_PAD (upstream)));
+  }
+
+  if (ghost != NULL && GST_IS_GHOST_PAD (ghost)) {
+    ret = gst_ghost_pad_set_target (GST_GHOST_PAD (ghost), sink);
+  } else {
+    peer = gst_pad_get_peer (upstream);
+    if (peer != NULL) {
+      gst_pad_unlink (upstream, peer);
+      g_object_unref (peer);
+    }
+
+    ret = GST_PAD_LINK_SUCCESSFUL (gst_pad_link_full (upstream, sink,
+            GST_PAD_LINK_CHECK_NOTHING));
+  }
+
+  if (ghost != NULL) {
+    g_object_unref (ghost);
+  }
+
+  return ret;
+}
+
+static void kms_element_swap_output_element (KmsElement * self,
+    GstElement * from, GstElement * to);
+
+static GstPadProbeReturn
+kms_element_swap_output_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsOutputSwapData *data = user_data;
+  GstPad *from_sink, *to_sink, *peer;
+
+  from_sink = gst_element_get_static_pad (data->from, "sink");
+  peer = gst_pad_get_peer (from_sink);
+
+  if (peer != pad) {
+    /* Upstream was relinked since the swap was scheduled, follow it */
+    kms_element_swap_output_element (data->self, data->from, data->to);
+  } else {
+    to_sink = gst_element_get_static_pad (data->to, "sink");
+
+    if (!kms_element_link_output_upstream (pad, to_sink)) {
+      GST_ERROR_OBJECT (data->self, "Cannot link %" GST_PTR_FORMAT " to %"
+          GST_PTR_FORMAT, pad, data->to);
+    }
+
+    g_object_unref (to_sink);
+    kms_element_remove_output_element (data->self, data->from);
+  }
+
+  if (peer != NULL) {
+    g_object_unref (peer);
+  }
+
+  g_object_unref (from_sink);
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+static void
+kms_element_swap_output_on_linked (GstPad * pad, GstPad * peer,
+    gpointer user_data)
+{
+  KmsOutputSwapData *data = user_data;
+  KmsElement *self = data->self;
+  GstElement *from = data->from, *to = data->to;
+
+  /* Disconnecting frees data */
+  g_signal_handlers_disconnect_by_func (pad,
+      kms_element_swap_output_on_linked, data);
+
+  kms_element_swap_output_element (self, from, to);
+}
+
+/* Moves whatever feeds "from" to "to" and removes "from" afterwards */
+static void
+kms_element_swap_output_element (KmsElement * self, GstElement * from,
+    GstElement * to)
+{
+  KmsOutputSwapData *data;
+  GstPad *sink, *peer;
+
+  data = kms_output_swap_data_new (self, from, to);
+  sink = gst_element_get_static_pad (from, "sink");
+  peer = gst_pad_get_peer (sink);
+
+  if (peer == NULL) {
+    /* Subclass has not linked it yet, swap as soon as it does */
+    g_signal_connect_data (sink, "linked",
+        G_CALLBACK (kms_element_swap_output_on_linked), data,
+        kms_output_swap_data_destroy_closure, 0);
+  } else {
+    gst_pad_add_probe (peer, GST_PAD_PROBE_TYPE_IDLE,
+        kms_element_swap_output_probe, data,
+        (GDestroyNotify) kms_output_swap_data_destroy);
+    g_object_unref (peer);
   }
 
-  if (pad_type == KMS_ELEMENT_PAD_TYPE_DATA) {
+  g_object_unref (sink);
+}
+
+/* Output element swap end */
+
+/* Called with the element lock held */
+static GstElement *
+kms_element_create_output_placeholder (KmsElement * self)
+{
+  GstElement *sink;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+
+  gst_bin_add (GST_BIN (self), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  return sink;
+}
+
+/* Called with the element lock held */
+static void
+kms_element_create_output_element (KmsElement * self,
+    KmsOutputElementData * odata)
+{
+  if (odata->type == KMS_ELEMENT_PAD_TYPE_DATA) {
     GstElement *tee, *sink;
 
     tee = gst_element_factory_make ("tee", NULL);
@@ -739,34 +994,126 @@ kms_element_get_output_element (KmsElement * self, KmsElementPadType pad_type,
 
     gst_bin_add_many (GST_BIN (self), tee, sink, NULL);
     gst_element_link (tee, sink);
+    g_object_set_qdata (G_OBJECT (tee), data_tee_sink_quark (), sink);
 
     odata->element = tee;
-    KMS_ELEMENT_UNLOCK (self);
 
     gst_element_sync_state_with_parent (sink);
     gst_element_sync_state_with_parent (tee);
   } else {
-    KmsMediaFlowTimeoutData *fdto_data;
-
     odata->element = KMS_ELEMENT_GET_CLASS (self)->create_output_element (self);
-    fdto_data =
-        media_flow_timeout_data_new (self, desc, pad_type, KMS_MEDIA_FLOW_OUT);
-    add_flow_out_event_probes_to_element_sinks (odata->element, fdto_data);
-    media_flow_timeout_data_unref (fdto_data);
+
+    /* Until a src pad is requested there is no media flowing out */
+    if (odata->requested_pads > 0) {
+      kms_element_add_flow_out_detection (self, odata);
+    }
 
     /* Set video properties to the new element */
-    if (pad_type == KMS_ELEMENT_PAD_TYPE_VIDEO) {
+    if (odata->type == KMS_ELEMENT_PAD_TYPE_VIDEO) {
       kms_element_set_video_output_properties (self, odata->element);
     }
 
     gst_bin_add (GST_BIN (self), odata->element);
     gst_element_sync_state_with_parent (odata->element);
+  }
+}
+
+static void
+kms_element_release_requested_srcpad (KmsElement * self,
+    const gchar * pad_name)
+{
+  KmsOutputElementData *odata;
+  GstElement *output = NULL, *placeholder = NULL;
+  gboolean flowing = FALSE;
+
+  KMS_ELEMENT_LOCK (self);
+
+  odata = g_hash_table_lookup (self->priv->requested_srcpads, pad_name);
+  if (odata == NULL) {
+    KMS_ELEMENT_UNLOCK (self);
+    return;
+  }
+
+  g_hash_table_remove (self->priv->requested_srcpads, pad_name);
+
+  if (--odata->requested_pads == 0) {
+    flowing = kms_element_remove_flow_out_detection (self, odata);
+
+    if (odata->element != NULL) {
+      GST_DEBUG_OBJECT (self, "Last %s src pad released for stream %s",
+          kms_element_pad_type_str (odata->type), odata->description);
+
+      output = odata->element;
+      placeholder = kms_element_create_output_placeholder (self);
+      odata->element = NULL;
+      odata->placeholder = placeholder;
+    }
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  if (output != NULL) {
+    kms_element_swap_output_element (self, output, placeholder);
+  }
+
+  if (flowing) {
+    g_signal_emit (G_OBJECT (self), element_signals[SIGNAL_FLOW_OUT_MEDIA], 0,
+        FALSE, odata->description, odata->type);
+  }
+}
+
+GstElement *
+kms_element_get_output_element (KmsElement * self, KmsElementPadType pad_type,
+    const gchar * description)
+{
+  KmsOutputElementData *odata;
+  GstElement *element;
+  const gchar *desc;
+
+  desc = KMS_FORMAT_PAD_DESCRIPTION (description);
+
+  GST_DEBUG_OBJECT (self, "Output element requested for track %s, stream %s",
+      kms_element_pad_type_str (pad_type), desc);
+
+  KMS_ELEMENT_LOCK (self);
+
+  odata = kms_element_get_output_element_data (self, pad_type, desc);
+  if (odata == NULL) {
+    gchar *key;
+
+    key = create_id_from_pad_attrs (pad_type, GST_PAD_SRC, desc);
+    GST_DEBUG_OBJECT (self, "New output element for track %s, stream %s",
+        kms_element_pad_type_str (pad_type), key);
+    odata = create_output_element_data (pad_type, desc);
+    g_hash_table_insert (self->priv->output_elements, key, odata);
+  }
+
+  if (odata->element != NULL) {
+    element = odata->element;
+    KMS_ELEMENT_UNLOCK (self);
+    return element;
+  }
+
+  if (odata->requested_pads == 0) {
+    /* Nobody consumes this stream yet, drop it until a src pad is requested */
+    if (odata->placeholder == NULL) {
+      GST_DEBUG_OBJECT (self, "Deferring output element for track %s, "
+          "stream %s", kms_element_pad_type_str (pad_type), desc);
+      odata->placeholder = kms_element_create_output_placeholder (self);
+    }
+
+    element = odata->placeholder;
     KMS_ELEMENT_UNLOCK (self);
+    return element;
   }
 
-  kms_element_create_pending_src_pads (self, pad_type, desc, odata->element);
+  kms_element_create_output_element (self, odata);
+  element = odata->element;
+  KMS_ELEMENT_UNLOCK (self);
+
+  kms_element_create_pending_src_pads (self, pad_type, desc, element);
 
-  return odata->element;
+  return element;
 }
 
 GstElement *
@@ -1357,6 +1704,7 @@ kms_element_finalize (GObject * object)
 
   /* free resources allocated by this object */
   g_hash_table_unref (element->priv->pendingpads);
+  g_hash_table_unref (element->priv->requested_srcpads);
   g_hash_table_unref (element->priv->output_elements);
   g_hash_table_unref (element->priv->stats.avg_iss);
 
@@ -1385,6 +1733,7 @@ kms_element_request_new_srcpad (KmsElement * self,
 {
   const gchar *templ_name, *desc;
   KmsOutputElementData *odata;
+  GstElement *placeholder = NULL;
   gchar *pad_name, *key;
   guint counter = 0;
   gboolean added = TRUE;
@@ -1405,7 +1754,7 @@ kms_element_request_new_srcpad (KmsElement * self,
   if (odata == NULL) {
     GST_DEBUG_OBJECT (self, "New output element for track %s, stream %s",
         kms_element_pad_type_str (type), desc);
-    odata = create_output_element_data (type);
+    odata = create_output_element_data (type, desc);
     g_hash_table_insert (self->priv->output_elements, key, odata);
   } else {
     g_free (key);
@@ -1413,6 +1762,16 @@ kms_element_request_new_srcpad (KmsElement * self,
 
   counter = odata->pad_count++;
   pad_name = g_strdup_printf (templ_name, desc, counter);
+  odata->requested_pads++;
+
+  if (odata->element == NULL && odata->placeholder != NULL) {
+    GST_DEBUG_OBJECT (self, "First %s src pad requested for stream %s",
+        kms_element_pad_type_str (type), desc);
+
+    placeholder = odata->placeholder;
+    odata->placeholder = NULL;
+    kms_element_create_output_element (self, odata);
+  }
 
   if (odata->element == NULL) {
     KmsRequestNewSrcElementReturn ret =
@@ -1422,6 +1781,7 @@ kms_element_request_new_srcpad (KmsElement * self,
     if (ret == KMS_REQUEST_NEW_SRC_ELEMENT_NOT_SUPPORTED) {
       GST_WARNING_OBJECT (self, "source pad '%s' forbidden", pad_name);
       odata->pad_count--;
+      odata->requested_pads--;
       g_free (pad_name);
       KMS_ELEMENT_UNLOCK (self);
       return NULL;
@@ -1430,6 +1790,11 @@ kms_element_request_new_srcpad (KmsElement * self,
     added = ret != KMS_REQUEST_NEW_SRC_ELEMENT_NOT_SUPPORTED;
   }
 
+  g_hash_table_insert (self->priv->requested_srcpads, g_strdup (pad_name),
+      odata);
+
+  kms_element_add_flow_out_detection (self, odata);
+
   if (odata->element == NULL) {
     if (!g_hash_table_contains (self->priv->pendingpads, pad_name)) {
       PendingPad *pdata;
@@ -1440,9 +1805,16 @@ kms_element_request_new_srcpad (KmsElement * self,
 
     KMS_ELEMENT_UNLOCK (self);
   } else {
+    GstElement *element = odata->element;
+
     KMS_ELEMENT_UNLOCK (self);
+
+    if (placeholder != NULL) {
+      kms_element_swap_output_element (self, placeholder, element);
+    }
+
     if (added) {
-      kms_element_add_src_pad (self, odata->element, pad_name, templ_name);
+      kms_element_add_src_pad (self, element, pad_name, templ_name);
     }
   }
 
@@ -1573,6 +1945,7 @@ kms_element_release_requested_pad_action (KmsElement * self,
 
   if (released) {
     /* Pad was not created yet */
+    kms_element_release_requested_srcpad (self, pad_name);
     return TRUE;
   }
 
@@ -1592,6 +1965,7 @@ kms_element_release_requested_pad_action (KmsElement * self,
             case GST_PAD_SRC:
               kms_element_remove_target_pad (self, pad);
               kms_element_release_pad (GST_ELEMENT (self), pad);
+              kms_element_release_requested_srcpad (self, pad_name);
               done = TRUE;
               break;
             case GST_PAD_SINK:
@@ -1667,6 +2041,36 @@ kms_element_get_input_latency_stats (KmsElement * self, gchar * selector)
   return stats;
 }
 
+static guint64
+kms_element_get_dropped_frames (KmsElement * self)
+{
+  GHashTableIter iter;
+  gpointer value;
+  guint64 dropped = 0;
+
+  KMS_ELEMENT_LOCK (self);
+
+  g_hash_table_iter_init (&iter, self->priv->output_elements);
+
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    KmsOutputElementData *odata = value;
+    guint64 count;
+
+    if (odata->element == NULL ||
+        g_object_class_find_property (G_OBJECT_GET_CLASS (odata->element),
+            "dropped-frames") == NULL) {
+      continue;
+    }
+
+    g_object_get (odata->element, "dropped-frames", &count, NULL);
+    dropped += count;
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  return dropped;
+}
+
 static GstStructure *
 kms_element_stats_impl (KmsElement * self, gchar * selector)
 {
@@ -1681,7 +2085,9 @@ kms_element_stats_impl (KmsElement * self, gchar * selector)
     l_stats = kms_element_get_input_latency_stats (self, selector);
 
     e_stats = gst_structure_new (KMS_ELEMENT_STATS_STRUCT_NAME,
-        "input-latencies", GST_TYPE_STRUCTURE, l_stats, NULL);
+        "input-latencies", GST_TYPE_STRUCTURE, l_stats,
+        "dropped-frames", G_TYPE_UINT64,
+        kms_element_get_dropped_frames (self), NULL);
     gst_structure_free (l_stats);
 
     gst_structure_set (stats, KMS_MEDIA_ELEMENT_FIELD, GST_TYPE_STRUCTURE,
@@ -1933,6 +2339,8 @@ kms_element_init (KmsElement * element)
 
   element->priv->pendingpads = g_hash_table_new_full (g_str_hash, g_str_equal,
       g_free, (GDestroyNotify) destroy_pendingpads);
+  element->priv->requested_srcpads = g_hash_table_new_full (g_str_hash,
+      g_str_equal, g_free, NULL);
   element->priv->output_elements =
       g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
       (GDestroyNotify) destroy_output_element_data);
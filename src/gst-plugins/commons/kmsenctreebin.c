@@ -20,6 +20,7 @@
 #endif
 
 #include "kmsenctreebin.h"
+#include "kmsframedropper.h"
 #include "kmsutils.h"
 
 #define GST_DEFAULT_NAME "enctreebin"
@@ -40,6 +41,9 @@ G_DEFINE_TYPE (KmsEncTreeBin, kms_enc_tree_bin, KMS_TYPE_TREE_BIN);
 #define KMS_ENC_TREE_BIN_LIMIT(obj, value) \
   MAX((obj)->priv->min_bitrate,MIN((obj)->priv->max_bitrate, (value)))
 
+/* Video frames are dropped before the encoder above this latency */
+#define ENCODER_LATENCY_TARGET (200 * GST_MSECOND)
+
 typedef enum
 {
   VP8,
@@ -54,6 +58,7 @@ struct _KmsEncTreeBinPrivate
   GstElement *enc;
   EncoderType enc_type;
   RembEventManager *remb_manager;
+  KmsFrameDropper *dropper;
 
   gint remb_bitrate;
   gint tag_bitrate;
@@ -356,6 +361,16 @@ kms_enc_tree_bin_get_max_bitrate (KmsEncTreeBin * self)
   return self->priv->max_bitrate;
 }
 
+guint64
+kms_enc_tree_bin_get_dropped_frames (KmsEncTreeBin * self)
+{
+  if (self->priv->dropper == NULL) {
+    return 0;
+  }
+
+  return kms_frame_dropper_get_dropped (self->priv->dropper);
+}
+
 static void
 bitrate_callback (RembEventManager * remb_manager, guint bitrate,
     gpointer user_data)
@@ -452,7 +467,7 @@ kms_enc_tree_bin_configure (KmsEncTreeBin * self, const GstCaps * caps,
   KmsTreeBin *tree_bin = KMS_TREE_BIN (self);
   GstElement *rate, *convert, *mediator, *output_tee, *capsfilter = NULL;
   GstElement *queue;
-  GstPad *enc_src;
+  GstPad *enc_src, *queue_sink;
 
   self->priv->current_bitrate = target_bitrate;
 
@@ -473,13 +488,21 @@ kms_enc_tree_bin_configure (KmsEncTreeBin * self, const GstCaps * caps,
       bitrate_callback, self, NULL);
   gst_pad_add_probe (enc_src, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
       tag_event_probe, self, NULL);
-  g_object_unref (enc_src);
 
   rate = kms_utils_create_rate_for_caps (caps);
   convert = kms_utils_create_convert_for_caps (caps);
   mediator = kms_utils_create_mediator_element (caps);
   queue = gst_element_factory_make ("queue", NULL);
 
+  if (kms_utils_caps_are_video (caps)) {
+    /* Skip raw frames before they pile up in front of a slow encoder */
+    queue_sink = gst_element_get_static_pad (queue, "sink");
+    self->priv->dropper = kms_frame_dropper_new (queue_sink, enc_src,
+        ENCODER_LATENCY_TARGET);
+    g_object_unref (queue_sink);
+  }
+  g_object_unref (enc_src);
+
   if (rate) {
     gst_bin_add (GST_BIN (self), rate);
   }
@@ -557,6 +580,7 @@ kms_enc_tree_bin_init (KmsEncTreeBin * self)
   self->priv = KMS_ENC_TREE_BIN_GET_PRIVATE (self);
 
   self->priv->remb_manager = NULL;
+  self->priv->dropper = NULL;
 
   self->priv->remb_bitrate = -1;
   self->priv->tag_bitrate = -1;
@@ -577,6 +601,11 @@ kms_enc_tree_bin_dispose (GObject * object)
     self->priv->remb_manager = NULL;
   }
 
+  if (self->priv->dropper) {
+    kms_frame_dropper_destroy (self->priv->dropper);
+    self->priv->dropper = NULL;
+  }
+
   /* chain up */
   G_OBJECT_CLASS (kms_enc_tree_bin_parent_class)->dispose (object);
 }
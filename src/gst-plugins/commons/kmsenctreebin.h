@@ -56,6 +56,7 @@ KmsEncTreeBin * kms_enc_tree_bin_new (const GstCaps * caps, gint target_bitrate,
 void kms_enc_tree_bin_set_bitrate_limits (KmsEncTreeBin *self, gint min_bitrate, gint max_bitrate);
 gint kms_enc_tree_bin_get_min_bitrate (KmsEncTreeBin *self);
 gint kms_enc_tree_bin_get_max_bitrate (KmsEncTreeBin *self);
+guint64 kms_enc_tree_bin_get_dropped_frames (KmsEncTreeBin *self);
 
 G_END_DECLS
 #endif /* __KMS_ENC_TREE_BIN_H__ */
@@ -0,0 +1,261 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsfeccontroller.h"
+
+#define GST_CAT_DEFAULT kms_fec_controller_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "kmsfeccontroller"
+
+/* Weight of each new report in the smoothed loss */
+#define LOSS_SMOOTHING 0.3
+/* Below this loss retransmissions, if any, are enough */
+#define MIN_PROTECTED_LOSS 0.01
+/* Losses from which RED blocks are added */
+#define RED_LOSS 0.05
+#define MAX_FEC_PERCENTAGE 50
+/* Round trip time (ms) for which NACK and FEC are weighted the same */
+#define NACK_RTT_REFERENCE 100.0
+#define MIN_RTT_WEIGHT 0.5
+#define MAX_RTT_WEIGHT 2.0
+
+struct _KmsFecController
+{
+  GstElement *fec;
+  GstElement *red;
+  gboolean nack;
+
+  GMutex mutex;
+  gboolean has_loss;
+  gdouble loss;
+  guint percentage;
+  guint distance;
+
+  GstPad *media_pad;
+  gulong media_probe_id;
+  GstPad *protected_pad;
+  gulong protected_probe_id;
+
+  /* Pointer sized so that they are 64 bits wide on 64 bits platforms */
+  volatile gssize media_octets;
+  volatile gssize protected_octets;
+};
+
+static guint
+kms_fec_controller_calc_percentage (KmsFecController * fc, gdouble rtt_ms)
+{
+  gdouble weight;
+
+  if (fc->loss < MIN_PROTECTED_LOSS) {
+    return 0;
+  }
+
+  if (fc->nack) {
+    /* Retransmissions recover losses fast enough on short round trips */
+    weight = CLAMP (rtt_ms / NACK_RTT_REFERENCE, MIN_RTT_WEIGHT,
+        MAX_RTT_WEIGHT);
+  } else {
+    weight = MAX_RTT_WEIGHT;
+  }
+
+  return MIN ((guint) (fc->loss * 100.0 * weight + 0.5), MAX_FEC_PERCENTAGE);
+}
+
+void
+kms_fec_controller_update (KmsFecController * fc, guint fraction_lost,
+    guint rtt)
+{
+  gdouble rtt_ms;
+  guint percentage, distance;
+
+  g_return_if_fail (fc != NULL);
+
+  rtt_ms = (gdouble) rtt * 1000.0 / 65536.0;
+
+  g_mutex_lock (&fc->mutex);
+
+  if (fc->has_loss) {
+    fc->loss = fc->loss * (1.0 - LOSS_SMOOTHING) +
+        (fraction_lost / 256.0) * LOSS_SMOOTHING;
+  } else {
+    fc->loss = fraction_lost / 256.0;
+    fc->has_loss = TRUE;
+  }
+
+  percentage = kms_fec_controller_calc_percentage (fc, rtt_ms);
+  distance = fc->loss >= RED_LOSS ? 1 : 0;
+
+  if (fc->fec != NULL && percentage != fc->percentage) {
+    GST_DEBUG_OBJECT (fc->fec, "FEC percentage %u -> %u (loss: %.3f, rtt: "
+        "%.1f ms)", fc->percentage, percentage, fc->loss, rtt_ms);
+    g_object_set (fc->fec, "percentage", percentage, NULL);
+    fc->percentage = percentage;
+  }
+
+  if (fc->red != NULL && distance != fc->distance) {
+    GST_DEBUG_OBJECT (fc->red, "RED distance %u -> %u (loss: %.3f)",
+        fc->distance, distance, fc->loss);
+    g_object_set (fc->red, "distance", distance, NULL);
+    fc->distance = distance;
+  }
+
+  g_mutex_unlock (&fc->mutex);
+}
+
+void
+kms_fec_controller_process_source_stats (KmsFecController * fc,
+    const GstStructure * stats)
+{
+  gboolean internal, have_rb;
+  guint fraction_lost, rtt;
+
+  g_return_if_fail (fc != NULL);
+
+  /* Only reports from the remote peer tell how our stream is received */
+  if (gst_structure_get_boolean (stats, "internal", &internal) && !internal &&
+      gst_structure_get_boolean (stats, "have-rb", &have_rb) && have_rb &&
+      gst_structure_get_uint (stats, "rb-fractionlost", &fraction_lost) &&
+      gst_structure_get_uint (stats, "rb-round-trip", &rtt)) {
+    kms_fec_controller_update (fc, fraction_lost, rtt);
+  }
+}
+
+static gboolean
+kms_fec_controller_count_list_item (GstBuffer ** buf, guint idx,
+    volatile gssize * octets)
+{
+  g_atomic_pointer_add (octets, gst_buffer_get_size (*buf));
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+kms_fec_controller_count_probe (GstPad * pad, GstPadProbeInfo * info,
+    volatile gssize * octets)
+{
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    g_atomic_pointer_add (octets,
+        gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER (info)));
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    gst_buffer_list_foreach (GST_PAD_PROBE_INFO_BUFFER_LIST (info),
+        (GstBufferListFunc) kms_fec_controller_count_list_item,
+        (gpointer) octets);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPad *
+kms_fec_controller_add_count_probe (GstElement * e, const gchar * padname,
+    volatile gssize * octets, gulong * probe_id)
+{
+  GstPad *pad;
+
+  pad = gst_element_get_static_pad (e, padname);
+  *probe_id = gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      (GstPadProbeCallback) kms_fec_controller_count_probe, (gpointer) octets,
+      NULL);
+
+  return pad;
+}
+
+KmsFecController *
+kms_fec_controller_create (GstElement * fec_encoder, GstElement * red_encoder,
+    gboolean nack)
+{
+  KmsFecController *fc;
+
+  g_return_val_if_fail (fec_encoder != NULL || red_encoder != NULL, NULL);
+
+  fc = g_slice_new0 (KmsFecController);
+  g_mutex_init (&fc->mutex);
+  fc->nack = nack;
+
+  if (fec_encoder != NULL) {
+    fc->fec = g_object_ref (fec_encoder);
+    g_object_get (fc->fec, "percentage", &fc->percentage, NULL);
+  }
+
+  if (red_encoder != NULL) {
+    fc->red = g_object_ref (red_encoder);
+    g_object_get (fc->red, "distance", &fc->distance, NULL);
+  }
+
+  /* Media enters the first encoder and leaves the last one protected */
+  fc->media_pad = kms_fec_controller_add_count_probe (fc->fec != NULL ?
+      fc->fec : fc->red, "sink", &fc->media_octets, &fc->media_probe_id);
+  fc->protected_pad = kms_fec_controller_add_count_probe (fc->red != NULL ?
+      fc->red : fc->fec, "src", &fc->protected_octets,
+      &fc->protected_probe_id);
+
+  return fc;
+}
+
+void
+kms_fec_controller_destroy (KmsFecController * fc)
+{
+  if (fc == NULL) {
+    return;
+  }
+
+  gst_pad_remove_probe (fc->media_pad, fc->media_probe_id);
+  g_object_unref (fc->media_pad);
+  gst_pad_remove_probe (fc->protected_pad, fc->protected_probe_id);
+  g_object_unref (fc->protected_pad);
+
+  g_clear_object (&fc->fec);
+  g_clear_object (&fc->red);
+  g_mutex_clear (&fc->mutex);
+
+  g_slice_free (KmsFecController, fc);
+}
+
+void
+kms_fec_controller_get_stats (KmsFecController * fc, GstStructure * stats)
+{
+  guint64 media, protected;
+  gdouble overhead = 0.0;
+  guint percentage, distance;
+
+  g_return_if_fail (fc != NULL);
+
+  media = (gsize) g_atomic_pointer_get (&fc->media_octets);
+  protected = (gsize) g_atomic_pointer_get (&fc->protected_octets);
+
+  if (media > 0 && protected > media) {
+    overhead = (gdouble) (protected - media) / media;
+  }
+
+  g_mutex_lock (&fc->mutex);
+  percentage = fc->percentage;
+  distance = fc->distance;
+  g_mutex_unlock (&fc->mutex);
+
+  gst_structure_set (stats, "fec-percentage", G_TYPE_UINT, percentage,
+      "red-distance", G_TYPE_UINT, distance, "protection-overhead",
+      G_TYPE_DOUBLE, overhead, NULL);
+}
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
@@ -0,0 +1,51 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_FEC_CONTROLLER_H__
+#define __KMS_FEC_CONTROLLER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _KmsFecController KmsFecController;
+
+/*
+ * Sender side: adapts the protection of a stream to the losses and round
+ * trip time reported by the remote peer. The FEC percentage of @fec_encoder
+ * (ulpfecenc) grows with the losses, and more so when retransmissions are
+ * not negotiated (@nack) or round trips are long. @red_encoder (redenc) only
+ * adds redundant blocks under heavy losses. One of the encoders can be NULL.
+ */
+KmsFecController * kms_fec_controller_create (GstElement *fec_encoder,
+  GstElement *red_encoder, gboolean nack);
+void kms_fec_controller_destroy (KmsFecController *fc);
+
+/* Feeds the stats of a remote RTPSource, only its report blocks are used */
+void kms_fec_controller_process_source_stats (KmsFecController *fc,
+  const GstStructure *stats);
+
+/* Feeds a report block: @fraction_lost in 1/256 units, @rtt in 16.16 */
+void kms_fec_controller_update (KmsFecController *fc, guint fraction_lost,
+  guint rtt);
+
+/* Current protection and its overhead over the media sent */
+void kms_fec_controller_get_stats (KmsFecController *fc,
+  GstStructure *stats);
+
+G_END_DECLS
+#endif /* __KMS_FEC_CONTROLLER_H__ */
@@ -0,0 +1,320 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "kmsframedropper.h"
+#include "kmsrefstruct.h"
+#include "kmsstats.h"
+#include "kmsutils.h"
+#include <gst/video/video-event.h>
+
+#define GST_DEFAULT_NAME "kmsframedropper"
+#define GST_CAT_DEFAULT kms_frame_dropper_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+/* Frames that never reach the output are forgotten after this */
+#define MAX_PENDING_FRAMES 256
+
+#define KMS_FRAME_DROPPER_LOCK(obj) (g_mutex_lock (&(obj)->mutex))
+#define KMS_FRAME_DROPPER_UNLOCK(obj) (g_mutex_unlock (&(obj)->mutex))
+
+typedef struct _KmsPendingFrame
+{
+  GstClockTime pts;
+  GstClockTime admitted;
+} KmsPendingFrame;
+
+struct _KmsFrameDropper
+{
+  KmsRefStruct ref;
+
+  GMutex mutex;
+
+  GstPad *admission;
+  GstPad *output;
+  gulong admission_probe;
+  gulong output_probe;
+
+  GstClockTime latency_target;
+  gdouble avg_latency;
+  GQueue *pending;
+
+  gboolean enabled;
+  gboolean raw;
+  gboolean waiting_keyframe;
+  guint64 dropped;
+};
+
+#define kms_frame_dropper_ref(obj) \
+  (KmsFrameDropper *) kms_ref_struct_ref (KMS_REF_STRUCT_CAST (obj))
+#define kms_frame_dropper_unref(obj) \
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (obj))
+
+static void
+kms_pending_frame_destroy (KmsPendingFrame * frame)
+{
+  g_slice_free (KmsPendingFrame, frame);
+}
+
+static GstClockTime
+kms_frame_dropper_now (void)
+{
+  return g_get_monotonic_time () * GST_USECOND;
+}
+
+static void
+kms_frame_dropper_clear_pending (KmsFrameDropper * self)
+{
+  g_queue_foreach (self->pending, (GFunc) kms_pending_frame_destroy, NULL);
+  g_queue_clear (self->pending);
+}
+
+static gboolean
+kms_frame_dropper_admit_buffer (KmsFrameDropper * self, GstBuffer * buffer)
+{
+  gboolean delta;
+  KmsPendingFrame *frame;
+
+  delta = GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  if (!self->raw && !delta) {
+    self->waiting_keyframe = FALSE;
+  }
+
+  if (self->waiting_keyframe) {
+    /* Previous frames this one depends on have been dropped */
+    return FALSE;
+  }
+
+  if (self->avg_latency > self->latency_target &&
+      !g_queue_is_empty (self->pending)) {
+    if (self->raw || GST_BUFFER_FLAG_IS_SET (buffer,
+            GST_BUFFER_FLAG_DROPPABLE)) {
+      return FALSE;
+    }
+
+    if (delta) {
+      GST_DEBUG_OBJECT (self->admission,
+          "Dropping delta frames until next keyframe");
+      self->waiting_keyframe = TRUE;
+      gst_pad_push_event (self->admission,
+          gst_video_event_new_upstream_force_key_unit (GST_CLOCK_TIME_NONE,
+              FALSE, 0));
+      return FALSE;
+    }
+  }
+
+  if (!GST_BUFFER_PTS_IS_VALID (buffer)) {
+    return TRUE;
+  }
+
+  if (g_queue_get_length (self->pending) >= MAX_PENDING_FRAMES) {
+    kms_pending_frame_destroy (g_queue_pop_head (self->pending));
+  }
+
+  frame = g_slice_new (KmsPendingFrame);
+  frame->pts = GST_BUFFER_PTS (buffer);
+  frame->admitted = kms_frame_dropper_now ();
+  g_queue_push_tail (self->pending, frame);
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+kms_frame_dropper_admission_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsFrameDropper *self = user_data;
+  GstPadProbeReturn ret = GST_PAD_PROBE_OK;
+
+  if (!(GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER)) {
+    GstEvent *event = gst_pad_probe_info_get_event (info);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+      GstCaps *caps;
+
+      gst_event_parse_caps (event, &caps);
+      KMS_FRAME_DROPPER_LOCK (self);
+      self->raw = kms_utils_caps_are_raw (caps);
+      self->waiting_keyframe = FALSE;
+      KMS_FRAME_DROPPER_UNLOCK (self);
+    } else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+      KMS_FRAME_DROPPER_LOCK (self);
+      kms_frame_dropper_clear_pending (self);
+      self->avg_latency = 0;
+      KMS_FRAME_DROPPER_UNLOCK (self);
+    }
+
+    return GST_PAD_PROBE_OK;
+  }
+
+  KMS_FRAME_DROPPER_LOCK (self);
+  if (self->enabled && !kms_frame_dropper_admit_buffer (self,
+          gst_pad_probe_info_get_buffer (info))) {
+    self->dropped++;
+    ret = GST_PAD_PROBE_DROP;
+  }
+  KMS_FRAME_DROPPER_UNLOCK (self);
+
+  return ret;
+}
+
+static GstPadProbeReturn
+kms_frame_dropper_output_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsFrameDropper *self = user_data;
+  GstBuffer *buffer = gst_pad_probe_info_get_buffer (info);
+  KmsPendingFrame *frame;
+  GstClockTime pts;
+
+  if (!GST_BUFFER_PTS_IS_VALID (buffer)) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  pts = GST_BUFFER_PTS (buffer);
+
+  KMS_FRAME_DROPPER_LOCK (self);
+
+  /* Frames before this one were leaked by queues or skipped by the element */
+  while ((frame = g_queue_peek_head (self->pending)) != NULL &&
+      frame->pts <= pts) {
+    g_queue_pop_head (self->pending);
+
+    if (frame->pts == pts) {
+      GstClockTime latency = kms_frame_dropper_now () - frame->admitted;
+
+      self->avg_latency =
+          KMS_STATS_CALCULATE_LATENCY_AVG (latency, self->avg_latency);
+    }
+
+    kms_pending_frame_destroy (frame);
+  }
+
+  KMS_FRAME_DROPPER_UNLOCK (self);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+kms_frame_dropper_free (KmsFrameDropper * self)
+{
+  kms_frame_dropper_clear_pending (self);
+  g_queue_free (self->pending);
+
+  g_object_unref (self->admission);
+  g_object_unref (self->output);
+
+  g_mutex_clear (&self->mutex);
+
+  g_slice_free (KmsFrameDropper, self);
+}
+
+static void
+kms_frame_dropper_probe_destroy (gpointer data)
+{
+  kms_frame_dropper_unref (data);
+}
+
+KmsFrameDropper *
+kms_frame_dropper_new (GstPad * admission, GstPad * output,
+    GstClockTime latency_target)
+{
+  KmsFrameDropper *self;
+
+  g_return_val_if_fail (GST_IS_PAD (admission), NULL);
+  g_return_val_if_fail (GST_IS_PAD (output), NULL);
+
+  self = g_slice_new0 (KmsFrameDropper);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (self),
+      (GDestroyNotify) kms_frame_dropper_free);
+
+  g_mutex_init (&self->mutex);
+  self->admission = g_object_ref (admission);
+  self->output = g_object_ref (output);
+  self->latency_target = latency_target;
+  self->pending = g_queue_new ();
+  self->enabled = TRUE;
+  self->raw = TRUE;
+
+  self->admission_probe = gst_pad_add_probe (admission,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM |
+      GST_PAD_PROBE_TYPE_EVENT_FLUSH, kms_frame_dropper_admission_probe,
+      kms_frame_dropper_ref (self), kms_frame_dropper_probe_destroy);
+  self->output_probe = gst_pad_add_probe (output, GST_PAD_PROBE_TYPE_BUFFER,
+      kms_frame_dropper_output_probe, kms_frame_dropper_ref (self),
+      kms_frame_dropper_probe_destroy);
+
+  return self;
+}
+
+void
+kms_frame_dropper_destroy (KmsFrameDropper * self)
+{
+  gst_pad_remove_probe (self->admission, self->admission_probe);
+  gst_pad_remove_probe (self->output, self->output_probe);
+
+  kms_frame_dropper_unref (self);
+}
+
+void
+kms_frame_dropper_set_enabled (KmsFrameDropper * self, gboolean enabled)
+{
+  KMS_FRAME_DROPPER_LOCK (self);
+  self->enabled = enabled;
+  /* Measures taken before are not valid anymore */
+  kms_frame_dropper_clear_pending (self);
+  self->avg_latency = 0;
+  self->waiting_keyframe = FALSE;
+  KMS_FRAME_DROPPER_UNLOCK (self);
+}
+
+guint64
+kms_frame_dropper_get_dropped (KmsFrameDropper * self)
+{
+  guint64 dropped;
+
+  KMS_FRAME_DROPPER_LOCK (self);
+  dropped = self->dropped;
+  KMS_FRAME_DROPPER_UNLOCK (self);
+
+  return dropped;
+}
+
+GstClockTime
+kms_frame_dropper_get_latency (KmsFrameDropper * self)
+{
+  GstClockTime latency;
+
+  KMS_FRAME_DROPPER_LOCK (self);
+  latency = (GstClockTime) self->avg_latency;
+  KMS_FRAME_DROPPER_UNLOCK (self);
+
+  return latency;
+}
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
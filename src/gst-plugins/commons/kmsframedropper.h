@@ -0,0 +1,40 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __KMS_FRAME_DROPPER_H__
+#define __KMS_FRAME_DROPPER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _KmsFrameDropper KmsFrameDropper;
+
+/*
+ * Admission stage for expensive elements. Buffers are measured from the
+ * admission pad to the output pad and, while that latency is above the
+ * target, droppable frames are discarded on the admission pad.
+ */
+KmsFrameDropper * kms_frame_dropper_new (GstPad * admission, GstPad * output, GstClockTime latency_target);
+void kms_frame_dropper_destroy (KmsFrameDropper * dropper);
+void kms_frame_dropper_set_enabled (KmsFrameDropper * dropper, gboolean enabled);
+
+guint64 kms_frame_dropper_get_dropped (KmsFrameDropper * dropper);
+GstClockTime kms_frame_dropper_get_latency (KmsFrameDropper * dropper);
+
+G_END_DECLS
+
+#endif /* __KMS_FRAME_DROPPER_H__ */
@@ -17,6 +17,56 @@
 
 #include "kmsrecordingprofile.h"
 
+/* Parsed once, profiles are built for every new recording */
+static GstStaticCaps webm_video_caps = GST_STATIC_CAPS ("video/webm");
+static GstStaticCaps webm_audio_caps = GST_STATIC_CAPS ("audio/webm");
+static GstStaticCaps mp4_caps =
+GST_STATIC_CAPS ("video/quicktime, variant=(string)iso");
+static GstStaticCaps mkv_video_caps = GST_STATIC_CAPS ("video/x-matroska");
+static GstStaticCaps mkv_audio_caps = GST_STATIC_CAPS ("audio/x-matroska");
+static GstStaticCaps ksr_caps = GST_STATIC_CAPS ("application/x-ksr");
+static GstStaticCaps jpeg_caps = GST_STATIC_CAPS ("image/jpeg");
+static GstStaticCaps opus_caps = GST_STATIC_CAPS ("audio/x-opus");
+static GstStaticCaps mp3_caps =
+GST_STATIC_CAPS ("audio/mpeg,mpegversion=1,layer=3");
+static GstStaticCaps vp8_caps = GST_STATIC_CAPS ("video/x-vp8");
+static GstStaticCaps h264_caps = GST_STATIC_CAPS ("video/x-h264, "
+    "stream-format=(string)avc, alignment=(string)au");
+
+/* Shared profiles, see kms_recording_profile_get_profile */
+G_LOCK_DEFINE_STATIC (profiles);
+static GHashTable *profiles = NULL;
+
+/* Sink pad template caps of @muxer, read without creating an instance */
+static GstCaps *
+kms_recording_profile_get_template_caps (const gchar * muxer,
+    const gchar * templ_name)
+{
+  GstElementFactory *factory;
+  GstCaps *caps = NULL;
+  const GList *l;
+
+  factory = gst_element_factory_find (muxer);
+  if (factory == NULL) {
+    GST_WARNING ("Muxer %s not found", muxer);
+    return NULL;
+  }
+
+  for (l = gst_element_factory_get_static_pad_templates (factory);
+      l != NULL && caps == NULL; l = l->next) {
+    GstStaticPadTemplate *templ = l->data;
+
+    if (templ->direction == GST_PAD_SINK &&
+        g_strcmp0 (templ->name_template, templ_name) == 0) {
+      caps = gst_static_pad_template_get_caps (templ);
+    }
+  }
+
+  gst_object_unref (factory);
+
+  return caps;
+}
+
 static GstEncodingContainerProfile *
 kms_recording_profile_create_webm_profile (gboolean has_audio,
     gboolean has_video)
@@ -25,15 +75,15 @@ kms_recording_profile_create_webm_profile (gboolean has_audio,
   GstCaps *pc;
 
   if (has_video)
-    pc = gst_caps_from_string ("video/webm");
+    pc = gst_static_caps_get (&webm_video_caps);
   else
-    pc = gst_caps_from_string ("audio/webm");
+    pc = gst_static_caps_get (&webm_audio_caps);
 
   cprof = gst_encoding_container_profile_new ("Webm", NULL, pc, NULL);
   gst_caps_unref (pc);
 
   if (has_audio) {
-    GstCaps *ac = gst_caps_from_string ("audio/x-opus");
+    GstCaps *ac = gst_static_caps_get (&opus_caps);
 
     gst_encoding_container_profile_add_profile (cprof, (GstEncodingProfile *)
         gst_encoding_audio_profile_new (ac, NULL, NULL, 0));
@@ -42,7 +92,7 @@ kms_recording_profile_create_webm_profile (gboolean has_audio,
   }
 
   if (has_video) {
-    GstCaps *vc = gst_caps_from_string ("video/x-vp8");
+    GstCaps *vc = gst_static_caps_get (&vp8_caps);
 
     gst_encoding_container_profile_add_profile (cprof, (GstEncodingProfile *)
         gst_encoding_video_profile_new (vc, NULL, NULL, 0));
@@ -60,13 +110,13 @@ kms_recording_profile_create_mp4_profile (gboolean has_audio,
   GstEncodingContainerProfile *cprof;
   GstCaps *pc;
 
-  pc = gst_caps_from_string ("video/quicktime, variant=(string)iso");
+  pc = gst_static_caps_get (&mp4_caps);
 
   cprof = gst_encoding_container_profile_new ("Mp4", NULL, pc, NULL);
   gst_caps_unref (pc);
 
   if (has_audio) {
-    GstCaps *ac = gst_caps_from_string ("audio/mpeg,mpegversion=1,layer=3");
+    GstCaps *ac = gst_static_caps_get (&mp3_caps);
 
     gst_encoding_container_profile_add_profile (cprof, (GstEncodingProfile *)
         gst_encoding_audio_profile_new (ac, NULL, NULL, 0));
@@ -75,8 +125,7 @@ kms_recording_profile_create_mp4_profile (gboolean has_audio,
   }
 
   if (has_video) {
-    GstCaps *vc = gst_caps_from_string ("video/x-h264, "
-        "stream-format=(string)avc, alignment=(string)au");
+    GstCaps *vc = gst_static_caps_get (&h264_caps);
 
     gst_encoding_container_profile_add_profile (cprof, (GstEncodingProfile *)
         gst_encoding_video_profile_new (vc, NULL, NULL, 0));
@@ -88,28 +137,22 @@ kms_recording_profile_create_mp4_profile (gboolean has_audio,
 }
 
 static GstEncodingContainerProfile *
-kms_recording_profile_create_ksr_profile (gboolean has_audio,
+kms_recording_profile_create_mkv_profile (gboolean has_audio,
     gboolean has_video)
 {
   GstEncodingContainerProfile *cprof;
-  GstPadTemplate *templ;
-  GstElement *mux;
   GstCaps *pc;
 
-  pc = gst_caps_from_string ("application/x-ksr");
-  cprof = gst_encoding_container_profile_new ("Ksr", NULL, pc, NULL);
-  gst_caps_unref (pc);
+  if (has_video)
+    pc = gst_static_caps_get (&mkv_video_caps);
+  else
+    pc = gst_static_caps_get (&mkv_audio_caps);
 
-  /* Use matroska caps to define this profile */
-  mux = gst_element_factory_make ("matroskamux", NULL);
+  cprof = gst_encoding_container_profile_new ("Mkv", NULL, pc, NULL);
+  gst_caps_unref (pc);
 
   if (has_audio) {
-    GstCaps *ac;
-
-    templ =
-        gst_element_class_get_pad_template (GST_ELEMENT_GET_CLASS (mux),
-        "audio_%u");
-    ac = gst_pad_template_get_caps (templ);
+    GstCaps *ac = gst_static_caps_get (&opus_caps);
 
     gst_encoding_container_profile_add_profile (cprof, (GstEncodingProfile *)
         gst_encoding_audio_profile_new (ac, NULL, NULL, 0));
@@ -118,12 +161,7 @@ kms_recording_profile_create_ksr_profile (gboolean has_audio,
   }
 
   if (has_video) {
-    GstCaps *vc;
-
-    templ =
-        gst_element_class_get_pad_template (GST_ELEMENT_GET_CLASS (mux),
-        "video_%u");
-    vc = gst_pad_template_get_caps (templ);
+    GstCaps *vc = gst_static_caps_get (&vp8_caps);
 
     gst_encoding_container_profile_add_profile (cprof, (GstEncodingProfile *)
         gst_encoding_video_profile_new (vc, NULL, NULL, 0));
@@ -131,7 +169,44 @@ kms_recording_profile_create_ksr_profile (gboolean has_audio,
     gst_caps_unref (vc);
   }
 
-  g_object_unref (mux);
+  return cprof;
+}
+
+static GstEncodingContainerProfile *
+kms_recording_profile_create_ksr_profile (gboolean has_audio,
+    gboolean has_video)
+{
+  GstEncodingContainerProfile *cprof;
+  GstCaps *pc;
+
+  pc = gst_static_caps_get (&ksr_caps);
+  cprof = gst_encoding_container_profile_new ("Ksr", NULL, pc, NULL);
+  gst_caps_unref (pc);
+
+  /* Use matroska caps to define this profile */
+  if (has_audio) {
+    GstCaps *ac = kms_recording_profile_get_template_caps ("matroskamux",
+        "audio_%u");
+
+    if (ac != NULL) {
+      gst_encoding_container_profile_add_profile (cprof, (GstEncodingProfile *)
+          gst_encoding_audio_profile_new (ac, NULL, NULL, 0));
+
+      gst_caps_unref (ac);
+    }
+  }
+
+  if (has_video) {
+    GstCaps *vc = kms_recording_profile_get_template_caps ("matroskamux",
+        "video_%u");
+
+    if (vc != NULL) {
+      gst_encoding_container_profile_add_profile (cprof, (GstEncodingProfile *)
+          gst_encoding_video_profile_new (vc, NULL, NULL, 0));
+
+      gst_caps_unref (vc);
+    }
+  }
 
   return cprof;
 }
@@ -143,11 +218,11 @@ kms_recording_profile_create_jpeg_profile ()
   GstCaps *vc;
   GstCaps *pc;
 
-  pc = gst_caps_from_string ("image/jpeg");
+  pc = gst_static_caps_get (&jpeg_caps);
   cprof = gst_encoding_container_profile_new ("jpeg", NULL, pc, NULL);
   gst_caps_unref (pc);
 
-  vc = gst_caps_from_string ("image/jpeg");
+  vc = gst_static_caps_get (&jpeg_caps);
 
   gst_encoding_container_profile_add_profile (cprof, (GstEncodingProfile *)
       gst_encoding_video_profile_new (vc, NULL, NULL, 0));
@@ -178,6 +253,12 @@ kms_recording_profile_create_profile (KmsRecordingProfile profile,
       return kms_recording_profile_create_jpeg_profile ();
     case KMS_RECORDING_PROFILE_KSR:
       return kms_recording_profile_create_ksr_profile (has_audio, has_video);
+    case KMS_RECORDING_PROFILE_MKV:
+      return kms_recording_profile_create_mkv_profile (has_audio, has_video);
+    case KMS_RECORDING_PROFILE_MKV_VIDEO_ONLY:
+      return kms_recording_profile_create_mkv_profile (FALSE, has_video);
+    case KMS_RECORDING_PROFILE_MKV_AUDIO_ONLY:
+      return kms_recording_profile_create_mkv_profile (has_audio, FALSE);
     default:
       GST_WARNING ("Invalid recording profile");
       return NULL;
@@ -185,6 +266,269 @@ kms_recording_profile_create_profile (KmsRecordingProfile profile,
 
 }
 
+GstEncodingContainerProfile *
+kms_recording_profile_get_profile (KmsRecordingProfile profile,
+    gboolean has_audio, gboolean has_video)
+{
+  GstEncodingContainerProfile *cprof;
+  gpointer key;
+
+  /* Media types not recorded by the profile do not change it */
+  has_audio = has_audio && kms_recording_profile_supports_type (profile,
+      KMS_ELEMENT_PAD_TYPE_AUDIO);
+  has_video = has_video && kms_recording_profile_supports_type (profile,
+      KMS_ELEMENT_PAD_TYPE_VIDEO);
+  key = GUINT_TO_POINTER ((((guint) profile + 1) << 2) | (has_audio << 1) |
+      has_video);
+
+  G_LOCK (profiles);
+
+  if (profiles == NULL) {
+    profiles = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+        g_object_unref);
+  }
+
+  cprof = g_hash_table_lookup (profiles, key);
+
+  if (cprof == NULL) {
+    cprof = kms_recording_profile_create_profile (profile, has_audio,
+        has_video);
+
+    if (cprof != NULL) {
+      g_hash_table_insert (profiles, key, cprof);
+    }
+  }
+
+  if (cprof != NULL) {
+    g_object_ref (cprof);
+  }
+
+  G_UNLOCK (profiles);
+
+  return cprof;
+}
+
+static const gchar *
+kms_recording_profile_get_muxer (KmsRecordingProfile profile)
+{
+  switch (profile) {
+    case KMS_RECORDING_PROFILE_WEBM:
+    case KMS_RECORDING_PROFILE_WEBM_VIDEO_ONLY:
+    case KMS_RECORDING_PROFILE_WEBM_AUDIO_ONLY:
+      return "webmmux";
+    case KMS_RECORDING_PROFILE_MP4:
+    case KMS_RECORDING_PROFILE_MP4_VIDEO_ONLY:
+    case KMS_RECORDING_PROFILE_MP4_AUDIO_ONLY:
+      return "mp4mux";
+    case KMS_RECORDING_PROFILE_MKV:
+    case KMS_RECORDING_PROFILE_MKV_VIDEO_ONLY:
+    case KMS_RECORDING_PROFILE_MKV_AUDIO_ONLY:
+      return "matroskamux";
+    default:
+      /* KSR already muxes anything, JPEG is not a container */
+      return NULL;
+  }
+}
+
+static KmsRecordingProfile
+kms_recording_profile_get_mkv_equivalent (KmsRecordingProfile profile)
+{
+  switch (profile) {
+    case KMS_RECORDING_PROFILE_WEBM:
+    case KMS_RECORDING_PROFILE_MP4:
+      return KMS_RECORDING_PROFILE_MKV;
+    case KMS_RECORDING_PROFILE_WEBM_VIDEO_ONLY:
+    case KMS_RECORDING_PROFILE_MP4_VIDEO_ONLY:
+      return KMS_RECORDING_PROFILE_MKV_VIDEO_ONLY;
+    case KMS_RECORDING_PROFILE_WEBM_AUDIO_ONLY:
+    case KMS_RECORDING_PROFILE_MP4_AUDIO_ONLY:
+      return KMS_RECORDING_PROFILE_MKV_AUDIO_ONLY;
+    default:
+      return profile;
+  }
+}
+
+/*
+ * Encoded format of @caps as an encoding profile expects it: only the fields
+ * telling codecs apart are kept, parsers inserted by encodebin convert the
+ * rest. Returns NULL for raw or unknown media.
+ */
+static GstCaps *
+kms_recording_profile_get_stream_format (const GstCaps * caps)
+{
+  const GstStructure *st;
+  GstStructure *format;
+  const gchar *name;
+  gint value;
+
+  if (caps == NULL || gst_caps_is_any (caps) || gst_caps_is_empty (caps)) {
+    return NULL;
+  }
+
+  st = gst_caps_get_structure (caps, 0);
+  name = gst_structure_get_name (st);
+
+  if (g_str_has_prefix (name, "audio/x-raw")
+      || g_str_has_prefix (name, "video/x-raw")) {
+    return NULL;
+  }
+
+  format = gst_structure_new_empty (name);
+
+  if (gst_structure_get_int (st, "mpegversion", &value)) {
+    gst_structure_set (format, "mpegversion", G_TYPE_INT, value, NULL);
+  }
+
+  if (gst_structure_get_int (st, "layer", &value)) {
+    gst_structure_set (format, "layer", G_TYPE_INT, value, NULL);
+  }
+
+  return gst_caps_new_full (format, NULL);
+}
+
+static gboolean
+kms_recording_profile_muxer_accepts (const gchar * muxer,
+    const gchar * templ_name, const GstCaps * format)
+{
+  GstCaps *caps;
+  gboolean accepts;
+
+  caps = kms_recording_profile_get_template_caps (muxer, templ_name);
+  if (caps == NULL) {
+    return FALSE;
+  }
+
+  accepts = gst_caps_can_intersect (caps, format);
+  gst_caps_unref (caps);
+
+  return accepts;
+}
+
+/* Format to record @caps with, or NULL if @caps need transcoding */
+static GstCaps *
+kms_recording_profile_get_passthrough_format (KmsRecordingProfile profile,
+    const gchar * templ_name, const GstCaps * caps)
+{
+  const gchar *muxer = kms_recording_profile_get_muxer (profile);
+  GstCaps *format;
+
+  if (muxer == NULL) {
+    return NULL;
+  }
+
+  format = kms_recording_profile_get_stream_format (caps);
+  if (format == NULL) {
+    return NULL;
+  }
+
+  if (!kms_recording_profile_muxer_accepts (muxer, templ_name, format)) {
+    gst_caps_unref (format);
+    return NULL;
+  }
+
+  return format;
+}
+
+static gboolean
+kms_recording_profile_is_passthrough (KmsRecordingProfile profile,
+    const gchar * templ_name, gboolean needed, const GstCaps * caps)
+{
+  GstCaps *format;
+
+  if (!needed || caps == NULL) {
+    return TRUE;
+  }
+
+  format = kms_recording_profile_get_passthrough_format (profile, templ_name,
+      caps);
+  if (format == NULL) {
+    return FALSE;
+  }
+
+  gst_caps_unref (format);
+
+  return TRUE;
+}
+
+GstEncodingContainerProfile *
+kms_recording_profile_create_passthrough_profile (KmsRecordingProfile profile,
+    gboolean has_audio, gboolean has_video, const GstCaps * audio_caps,
+    const GstCaps * video_caps)
+{
+  GstEncodingContainerProfile *cprof;
+  GstCaps *audio_format, *video_format;
+  const GList *l;
+
+  cprof = kms_recording_profile_create_profile (profile, has_audio, has_video);
+  if (cprof == NULL) {
+    return NULL;
+  }
+
+  audio_format = kms_recording_profile_get_passthrough_format (profile,
+      "audio_%u", audio_caps);
+  video_format = kms_recording_profile_get_passthrough_format (profile,
+      "video_%u", video_caps);
+
+  for (l = gst_encoding_container_profile_get_profiles (cprof); l != NULL;
+      l = l->next) {
+    GstEncodingProfile *prof = l->data;
+
+    if (GST_IS_ENCODING_AUDIO_PROFILE (prof) && audio_format != NULL) {
+      GST_DEBUG ("Recording audio without transcoding: %" GST_PTR_FORMAT,
+          audio_format);
+      gst_encoding_profile_set_format (prof, audio_format);
+    } else if (GST_IS_ENCODING_VIDEO_PROFILE (prof) && video_format != NULL) {
+      GST_DEBUG ("Recording video without transcoding: %" GST_PTR_FORMAT,
+          video_format);
+      gst_encoding_profile_set_format (prof, video_format);
+    }
+  }
+
+  if (audio_format != NULL) {
+    gst_caps_unref (audio_format);
+  }
+
+  if (video_format != NULL) {
+    gst_caps_unref (video_format);
+  }
+
+  return cprof;
+}
+
+KmsRecordingProfile
+kms_recording_profile_select_passthrough (KmsRecordingProfile profile,
+    const GstCaps * audio_caps, const GstCaps * video_caps)
+{
+  gboolean has_audio, has_video;
+  KmsRecordingProfile mkv;
+
+  has_audio = kms_recording_profile_supports_type (profile,
+      KMS_ELEMENT_PAD_TYPE_AUDIO);
+  has_video = kms_recording_profile_supports_type (profile,
+      KMS_ELEMENT_PAD_TYPE_VIDEO);
+
+  if (kms_recording_profile_get_muxer (profile) == NULL ||
+      (kms_recording_profile_is_passthrough (profile, "audio_%u", has_audio,
+              audio_caps) &&
+          kms_recording_profile_is_passthrough (profile, "video_%u",
+              has_video, video_caps))) {
+    return profile;
+  }
+
+  mkv = kms_recording_profile_get_mkv_equivalent (profile);
+
+  if (kms_recording_profile_is_passthrough (mkv, "audio_%u", has_audio,
+          audio_caps) &&
+      kms_recording_profile_is_passthrough (mkv, "video_%u", has_video,
+          video_caps)) {
+    GST_DEBUG ("Recording profile %d changed to %d to avoid transcoding",
+        profile, mkv);
+    return mkv;
+  }
+
+  return profile;
+}
+
 gboolean
 kms_recording_profile_supports_type (KmsRecordingProfile profile,
     KmsElementPadType type)
@@ -196,13 +540,16 @@ kms_recording_profile_supports_type (KmsRecordingProfile profile,
   switch (profile) {
     case KMS_RECORDING_PROFILE_WEBM:
     case KMS_RECORDING_PROFILE_MP4:
+    case KMS_RECORDING_PROFILE_MKV:
       return TRUE;
     case KMS_RECORDING_PROFILE_WEBM_VIDEO_ONLY:
     case KMS_RECORDING_PROFILE_MP4_VIDEO_ONLY:
+    case KMS_RECORDING_PROFILE_MKV_VIDEO_ONLY:
     case KMS_RECORDING_PROFILE_JPEG_VIDEO_ONLY:
       return type == KMS_ELEMENT_PAD_TYPE_VIDEO;
     case KMS_RECORDING_PROFILE_WEBM_AUDIO_ONLY:
     case KMS_RECORDING_PROFILE_MP4_AUDIO_ONLY:
+    case KMS_RECORDING_PROFILE_MKV_AUDIO_ONLY:
       return type == KMS_ELEMENT_PAD_TYPE_AUDIO;
     case KMS_RECORDING_PROFILE_KSR:
       return TRUE;
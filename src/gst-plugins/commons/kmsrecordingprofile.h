@@ -35,12 +35,41 @@ typedef enum
   KMS_RECORDING_PROFILE_MP4_VIDEO_ONLY,
   KMS_RECORDING_PROFILE_MP4_AUDIO_ONLY,
   KMS_RECORDING_PROFILE_JPEG_VIDEO_ONLY,
-  KMS_RECORDING_PROFILE_KSR
+  KMS_RECORDING_PROFILE_KSR,
+  KMS_RECORDING_PROFILE_MKV,
+  KMS_RECORDING_PROFILE_MKV_VIDEO_ONLY,
+  KMS_RECORDING_PROFILE_MKV_AUDIO_ONLY
 } KmsRecordingProfile;
 
 GstEncodingContainerProfile * kms_recording_profile_create_profile (
     KmsRecordingProfile profile, gboolean has_audio, gboolean has_video);
 
+/*
+ * Returns a new reference to a profile built once and shared by every
+ * caller, so it must not be modified. Use
+ * kms_recording_profile_create_profile to get a profile of your own.
+ */
+GstEncodingContainerProfile * kms_recording_profile_get_profile (
+    KmsRecordingProfile profile, gboolean has_audio, gboolean has_video);
+
+/*
+ * Like kms_recording_profile_create_profile, but streams whose @audio_caps
+ * or @video_caps can be muxed as they are into the container of @profile
+ * are not transcoded. NULL or raw caps get the default format.
+ */
+GstEncodingContainerProfile * kms_recording_profile_create_passthrough_profile (
+    KmsRecordingProfile profile, gboolean has_audio, gboolean has_video,
+    const GstCaps * audio_caps, const GstCaps * video_caps);
+
+/*
+ * Returns @profile if its container can mux every given stream as it is.
+ * Otherwise returns the matroska profile with the same media types when
+ * that one can, or @profile if neither avoids transcoding.
+ */
+KmsRecordingProfile kms_recording_profile_select_passthrough (
+    KmsRecordingProfile profile, const GstCaps * audio_caps,
+    const GstCaps * video_caps);
+
 gboolean kms_recording_profile_supports_type (KmsRecordingProfile profile,
     KmsElementPadType type);
 
@@ -18,6 +18,7 @@
 #include "kmsremb.h"
 #include "kmsrtcp.h"
 #include "constants.h"
+#include <string.h>
 
 #define GST_CAT_DEFAULT kmsutils
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
@@ -662,10 +663,8 @@ static void
 process_psfb_afb (GObject * sess, guint ssrc, GstBuffer * fci_buffer)
 {
   KmsRembRemote *rm;
-  KmsRTCPPSFBAFBBuffer afb_buffer = { NULL, };
-  KmsRTCPPSFBAFBPacket afb_packet;
   KmsRTCPPSFBAFBREMBPacket remb_packet;
-  KmsRTCPPSFBAFBType type;
+  GstMapInfo map;
 
   if (!G_IS_OBJECT (sess)) {
     GST_WARNING ("Invalid session object");
@@ -679,29 +678,19 @@ process_psfb_afb (GObject * sess, guint ssrc, GstBuffer * fci_buffer)
     return;
   }
 
-  if (!kms_rtcp_psfb_afb_buffer_map (fci_buffer, GST_MAP_READ, &afb_buffer)) {
+  if (!gst_buffer_map (fci_buffer, &map, GST_MAP_READ)) {
     GST_WARNING_OBJECT (fci_buffer, "Buffer cannot be mapped");
     return;
   }
 
-  if (!kms_rtcp_psfb_afb_get_packet (&afb_buffer, &afb_packet)) {
-    GST_WARNING_OBJECT (fci_buffer, "Cannot get RTCP PSFB AFB packet");
-    goto end;
-  }
-
-  type = kms_rtcp_psfb_afb_packet_get_type (&afb_packet);
-  switch (type) {
-    case KMS_RTCP_PSFB_AFB_TYPE_REMB:
-      kms_rtcp_psfb_afb_remb_get_packet (&afb_packet, &remb_packet);
-      kms_remb_remote_update (rm, &remb_packet);
-      kms_remb_remote_update_target_ssrcs_stats (rm, &remb_packet);
-      break;
-    default:
-      break;
+  /* Only REMB is handled among AFB messages */
+  if (map.size >= 4 && memcmp (map.data, "REMB", 4) == 0
+      && kms_rtcp_remb_get_packet (map.data, map.size, &remb_packet)) {
+    kms_remb_remote_update (rm, &remb_packet);
+    kms_remb_remote_update_target_ssrcs_stats (rm, &remb_packet);
   }
 
-end:
-  kms_rtcp_psfb_afb_buffer_unmap (&afb_buffer);
+  gst_buffer_unmap (fci_buffer, &map);
 }
 
 static void
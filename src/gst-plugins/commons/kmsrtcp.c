@@ -120,33 +120,26 @@ kms_rtcp_psfb_afb_packet_get_type (KmsRTCPPSFBAFBPacket * packet)
 
 /* Inspired in The WebRTC project */
 gboolean
-kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
+kms_rtcp_remb_get_packet (const guint8 * fci, guint size,
     KmsRTCPPSFBAFBREMBPacket * remb_packet)
 {
-  GstMapInfo map;
+  const guint8 *fci_end;
   guint length;
-  guint8 *fci, *fci_end, br_exp;
+  guint8 br_exp;
   guint32 br_mantissa;
+  guint64 bitrate;
   int i;
 
-  g_return_val_if_fail (afb_packet != NULL, FALSE);
-  g_return_val_if_fail (afb_packet->type == KMS_RTCP_PSFB_AFB_TYPE_REMB, FALSE);
-  g_return_val_if_fail (GST_IS_BUFFER (afb_packet->rtcp_psfb_afb->buffer),
-      FALSE);
-  g_return_val_if_fail (afb_packet->rtcp_psfb_afb->map.flags & GST_MAP_READ,
-      FALSE);
+  g_return_val_if_fail (fci != NULL, FALSE);
   g_return_val_if_fail (remb_packet != NULL, FALSE);
 
-  map = afb_packet->rtcp_psfb_afb->map;
-  fci = map.data;
-  length = map.size;
-  fci_end = map.data + length;
+  fci_end = fci + size;
 
-  if (!is_remb (afb_packet)) {
+  if (size < 4 || memcmp (fci, "REMB", 4) != 0) {
     GST_ERROR ("This is not a REMB packet");
     return FALSE;
   }
-  fci += 4;                     /* Previously consumed by is_remb */
+  fci += 4;
 
   length = fci_end - fci;
   if (length < 4) {
@@ -160,7 +153,9 @@ kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
   br_mantissa = (fci[0] & 0x03) << 16;
   br_mantissa += (fci[1] << 8);
   br_mantissa += (fci[2]);
-  remb_packet->bitrate = br_mantissa << br_exp;
+  /* Saturate instead of overflowing with big exponents */
+  bitrate = (guint64) br_mantissa << MIN (br_exp, 32);
+  remb_packet->bitrate = MIN (bitrate, G_MAXUINT32);
   fci += 3;
 
   length = fci_end - fci;
@@ -170,13 +165,32 @@ kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
   }
 
   for (i = 0; i < remb_packet->n_ssrcs; i++) {
-    remb_packet->ssrcs[i] = g_ntohl (*(guint32 *) fci);
+    remb_packet->ssrcs[i] = GST_READ_UINT32_BE (fci);
     fci += 4;
   }
 
   return TRUE;
 }
 
+gboolean
+kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
+    KmsRTCPPSFBAFBREMBPacket * remb_packet)
+{
+  GstMapInfo map;
+
+  g_return_val_if_fail (afb_packet != NULL, FALSE);
+  g_return_val_if_fail (afb_packet->type == KMS_RTCP_PSFB_AFB_TYPE_REMB, FALSE);
+  g_return_val_if_fail (GST_IS_BUFFER (afb_packet->rtcp_psfb_afb->buffer),
+      FALSE);
+  g_return_val_if_fail (afb_packet->rtcp_psfb_afb->map.flags & GST_MAP_READ,
+      FALSE);
+  g_return_val_if_fail (remb_packet != NULL, FALSE);
+
+  map = afb_packet->rtcp_psfb_afb->map;
+
+  return kms_rtcp_remb_get_packet (map.data, map.size, remb_packet);
+}
+
 /* Inspired in The WebRTC project */
 static gboolean
 compute_mantissa_and_6_bit_base_2_expoonent (guint32 input_base10,
@@ -207,12 +221,17 @@ compute_mantissa_and_6_bit_base_2_expoonent (guint32 input_base10,
   return TRUE;
 }
 
-gboolean
-kms_rtcp_psfb_afb_remb_marshall_packet (GstRTCPPacket * rtcp_packet,
-    KmsRTCPPSFBAFBREMBPacket * remb_packet, guint32 sender_ssrc)
+#define REMB_FCI_HEADER_SIZE 8
+
+static guint
+remb_get_fci_size (KmsRTCPPSFBAFBREMBPacket * remb_packet)
+{
+  return REMB_FCI_HEADER_SIZE + 4 * remb_packet->n_ssrcs;
+}
+
+static gboolean
+remb_write_fci (guint8 * fci_data, KmsRTCPPSFBAFBREMBPacket * remb_packet)
 {
-  guint8 *fci_data;
-  guint16 len;
   guint32 mantissa = 0;
   guint8 exp = 0;
   int i;
@@ -223,31 +242,898 @@ kms_rtcp_psfb_afb_remb_marshall_packet (GstRTCPPacket * rtcp_packet,
     return FALSE;
   }
 
+  memmove (fci_data, "REMB", 4);
+  fci_data[4] = remb_packet->n_ssrcs;
+
+  fci_data[5] = (exp << 2) + ((mantissa >> 16) & 0x03);
+  fci_data[6] = mantissa >> 8;
+  fci_data[7] = mantissa;
+  fci_data += REMB_FCI_HEADER_SIZE;
+
+  for (i = 0; i < remb_packet->n_ssrcs; i++) {
+    GST_WRITE_UINT32_BE (fci_data, remb_packet->ssrcs[i]);
+    fci_data += 4;
+  }
+
+  return TRUE;
+}
+
+gboolean
+kms_rtcp_psfb_afb_remb_marshall_packet (GstRTCPPacket * rtcp_packet,
+    KmsRTCPPSFBAFBREMBPacket * remb_packet, guint32 sender_ssrc)
+{
+  guint8 *fci_data;
+  guint16 len;
+
   gst_rtcp_packet_fb_set_type (rtcp_packet, GST_RTCP_PSFB_TYPE_AFB);
   gst_rtcp_packet_fb_set_sender_ssrc (rtcp_packet, sender_ssrc);
   gst_rtcp_packet_fb_set_media_ssrc (rtcp_packet, 0);
 
   len = gst_rtcp_packet_fb_get_fci_length (rtcp_packet);
-  len += 2 + remb_packet->n_ssrcs;
+  len += remb_get_fci_size (remb_packet) / 4;
   if (!gst_rtcp_packet_fb_set_fci_length (rtcp_packet, len)) {
     GST_ERROR ("Cannot increase FCI length (%d)", len);
     return FALSE;
   }
 
   fci_data = gst_rtcp_packet_fb_get_fci (rtcp_packet);
-  memmove (fci_data, "REMB", 4);
-  fci_data[4] = remb_packet->n_ssrcs;
 
-  fci_data[5] = (exp << 2) + ((mantissa >> 16) & 0x03);
-  fci_data[6] = mantissa >> 8;
-  fci_data[7] = mantissa;
-  fci_data += 8;
+  return remb_write_fci (fci_data, remb_packet);
+}
 
-  for (i = 0; i < remb_packet->n_ssrcs; i++) {
-    *(guint32 *) fci_data = g_htonl (remb_packet->ssrcs[i]);
-    fci_data += 4;
+/* REMB end */
+
+/* TWCC begin */
+
+// Transport-wide Congestion Control feedback
+// (draft-holmer-rmcat-transport-wide-cc-extensions-01).
+//
+//    0                   1                   2                   3
+//    0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   |V=2|P|  FMT=15 |    PT=205     |           length              |
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   |                     SSRC of packet sender                     |
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   |                      SSRC of media source                     |
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   |      base sequence number     |      packet status count      |
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   |                 reference time                | fb pkt. count |
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   |          packet chunk         |         packet chunk          |
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   .                                                               .
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   |         packet chunk          |  recv delta   |  recv delta   |
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   .                                                               .
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+#define TWCC_HEADER_SIZE 8
+#define TWCC_CHUNK_SIZE 2
+#define TWCC_VECTOR_2BIT_SYMBOLS 7
+
+static guint
+twcc_status_get_delta_size (guint8 status)
+{
+  switch (status) {
+    case KMS_RTCP_TWCC_STATUS_SMALL_DELTA:
+      return 1;
+    case KMS_RTCP_TWCC_STATUS_LARGE_DELTA:
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+static void
+twcc_add_status (KmsRTCPTWCCPacket * twcc_packet, guint * n_status,
+    guint8 symbol)
+{
+  if (*n_status >= twcc_packet->status_count) {
+    return;
+  }
+
+  if (symbol > KMS_RTCP_TWCC_STATUS_LARGE_DELTA) {
+    /* Reserved symbol */
+    symbol = KMS_RTCP_TWCC_STATUS_NOT_RECEIVED;
+  }
+
+  twcc_packet->status[(*n_status)++] = symbol;
+}
+
+gboolean
+kms_rtcp_twcc_get_packet (const guint8 * fci, guint size,
+    KmsRTCPTWCCPacket * twcc_packet)
+{
+  const guint8 *fci_end;
+  guint32 reference_time;
+  guint n_status, i;
+
+  g_return_val_if_fail (fci != NULL, FALSE);
+  g_return_val_if_fail (twcc_packet != NULL, FALSE);
+
+  if (size < TWCC_HEADER_SIZE) {
+    GST_ERROR ("Inconsistent TWCC packet length");
+    return FALSE;
+  }
+
+  fci_end = fci + size;
+
+  twcc_packet->base_seq = GST_READ_UINT16_BE (fci);
+  twcc_packet->status_count = GST_READ_UINT16_BE (fci + 2);
+  reference_time = GST_READ_UINT24_BE (fci + 4);
+  if (reference_time & 0x800000) {
+    /* 24 bits signed */
+    reference_time |= 0xff000000;
+  }
+  twcc_packet->reference_time = (gint32) reference_time;
+  twcc_packet->fb_pkt_count = fci[7];
+  fci += TWCC_HEADER_SIZE;
+
+  if (twcc_packet->status_count > KMS_RTCP_TWCC_MAX_PACKETS) {
+    GST_ERROR ("TWCC packet with too many packets (%u)",
+        twcc_packet->status_count);
+    return FALSE;
+  }
+
+  n_status = 0;
+  while (n_status < twcc_packet->status_count) {
+    guint16 chunk;
+
+    if (fci + TWCC_CHUNK_SIZE > fci_end) {
+      GST_ERROR ("Inconsistent TWCC packet (chunks)");
+      return FALSE;
+    }
+
+    chunk = GST_READ_UINT16_BE (fci);
+    fci += TWCC_CHUNK_SIZE;
+
+    if (!(chunk & 0x8000)) {
+      /* Run length chunk */
+      guint8 symbol = (chunk >> 13) & 0x03;
+      guint run = chunk & 0x1fff;
+
+      if (run == 0) {
+        GST_ERROR ("Inconsistent TWCC packet (empty run length chunk)");
+        return FALSE;
+      }
+
+      for (i = 0; i < run; i++) {
+        twcc_add_status (twcc_packet, &n_status, symbol);
+      }
+    } else if (!(chunk & 0x4000)) {
+      /* Status vector chunk, 14 symbols of 1 bit */
+      for (i = 0; i < 14; i++) {
+        twcc_add_status (twcc_packet, &n_status, (chunk >> (13 - i)) & 0x01);
+      }
+    } else {
+      /* Status vector chunk, 7 symbols of 2 bits */
+      for (i = 0; i < TWCC_VECTOR_2BIT_SYMBOLS; i++) {
+        twcc_add_status (twcc_packet, &n_status,
+            (chunk >> (12 - 2 * i)) & 0x03);
+      }
+    }
   }
+
+  for (i = 0; i < twcc_packet->status_count; i++) {
+    guint8 status = twcc_packet->status[i];
+
+    if (fci + twcc_status_get_delta_size (status) > fci_end) {
+      GST_ERROR ("Inconsistent TWCC packet (deltas)");
+      return FALSE;
+    }
+
+    switch (status) {
+      case KMS_RTCP_TWCC_STATUS_SMALL_DELTA:
+        twcc_packet->deltas[i] = fci[0];
+        break;
+      case KMS_RTCP_TWCC_STATUS_LARGE_DELTA:
+        twcc_packet->deltas[i] = (gint16) GST_READ_UINT16_BE (fci);
+        break;
+      default:
+        twcc_packet->deltas[i] = 0;
+        break;
+    }
+
+    fci += twcc_status_get_delta_size (status);
+  }
+
   return TRUE;
 }
 
-/* REMB end */
+static gboolean
+twcc_check_status_count (KmsRTCPTWCCPacket * twcc_packet)
+{
+  if (twcc_packet->status_count == 0
+      || twcc_packet->status_count > KMS_RTCP_TWCC_MAX_PACKETS) {
+    GST_ERROR ("Invalid TWCC packet status count (%u)",
+        twcc_packet->status_count);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static guint
+twcc_get_fci_size (KmsRTCPTWCCPacket * twcc_packet)
+{
+  guint n_chunks, fci_size, i;
+
+  /* Only 2 bits status vector chunks are generated */
+  n_chunks = (twcc_packet->status_count + TWCC_VECTOR_2BIT_SYMBOLS - 1) /
+      TWCC_VECTOR_2BIT_SYMBOLS;
+  fci_size = TWCC_HEADER_SIZE + n_chunks * TWCC_CHUNK_SIZE;
+
+  for (i = 0; i < twcc_packet->status_count; i++) {
+    fci_size += twcc_status_get_delta_size (twcc_packet->status[i]);
+  }
+
+  return fci_size;
+}
+
+/* fci_data must be zeroed up to the next 32 bits boundary */
+static void
+twcc_write_fci (guint8 * fci_data, KmsRTCPTWCCPacket * twcc_packet)
+{
+  guint i, j;
+
+  GST_WRITE_UINT16_BE (fci_data, twcc_packet->base_seq);
+  GST_WRITE_UINT16_BE (fci_data + 2, twcc_packet->status_count);
+  GST_WRITE_UINT24_BE (fci_data + 4, twcc_packet->reference_time & 0xffffff);
+  fci_data[7] = twcc_packet->fb_pkt_count;
+  fci_data += TWCC_HEADER_SIZE;
+
+  for (i = 0; i < twcc_packet->status_count; i += TWCC_VECTOR_2BIT_SYMBOLS) {
+    guint16 chunk = 0xc000;
+
+    for (j = 0; j < TWCC_VECTOR_2BIT_SYMBOLS
+        && i + j < twcc_packet->status_count; j++) {
+      chunk |= (twcc_packet->status[i + j] & 0x03) << (12 - 2 * j);
+    }
+
+    GST_WRITE_UINT16_BE (fci_data, chunk);
+    fci_data += TWCC_CHUNK_SIZE;
+  }
+
+  for (i = 0; i < twcc_packet->status_count; i++) {
+    switch (twcc_packet->status[i]) {
+      case KMS_RTCP_TWCC_STATUS_SMALL_DELTA:
+        fci_data[0] = (guint8) twcc_packet->deltas[i];
+        break;
+      case KMS_RTCP_TWCC_STATUS_LARGE_DELTA:
+        GST_WRITE_UINT16_BE (fci_data, (guint16) twcc_packet->deltas[i]);
+        break;
+      default:
+        break;
+    }
+
+    fci_data += twcc_status_get_delta_size (twcc_packet->status[i]);
+  }
+}
+
+gboolean
+kms_rtcp_twcc_marshall_packet (GstRTCPPacket * rtcp_packet,
+    KmsRTCPTWCCPacket * twcc_packet, guint32 sender_ssrc, guint32 media_ssrc)
+{
+  guint8 *fci_data;
+  guint16 len;
+
+  if (!twcc_check_status_count (twcc_packet)) {
+    return FALSE;
+  }
+
+  gst_rtcp_packet_fb_set_type (rtcp_packet, KMS_RTCP_RTPFB_TYPE_TWCC);
+  gst_rtcp_packet_fb_set_sender_ssrc (rtcp_packet, sender_ssrc);
+  gst_rtcp_packet_fb_set_media_ssrc (rtcp_packet, media_ssrc);
+
+  len = (twcc_get_fci_size (twcc_packet) + 3) / 4;
+  if (!gst_rtcp_packet_fb_set_fci_length (rtcp_packet, len)) {
+    GST_ERROR ("Cannot increase FCI length (%d)", len);
+    return FALSE;
+  }
+
+  fci_data = gst_rtcp_packet_fb_get_fci (rtcp_packet);
+  memset (fci_data, 0, len * 4);
+  twcc_write_fci (fci_data, twcc_packet);
+
+  return TRUE;
+}
+
+/* TWCC end */
+
+/* Compound begin */
+
+// Compound packets are walked in place: every packet header is checked once
+// while iterating and the typed accessors only read fields that were already
+// validated, so no buffer is mapped or allocated per packet.
+//
+//    0                   1                   2                   3
+//    0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//   |V=2|P|  Count  |      PT       |             length            |
+//   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+#define RTCP_VERSION 2
+#define RTCP_HEADER_SIZE 4
+#define RTCP_SSRC_SIZE 4
+#define RTCP_SENDER_INFO_SIZE 20
+#define RTCP_REPORT_BLOCK_SIZE 24
+#define RTCP_FB_HEADER_SIZE (RTCP_HEADER_SIZE + 2 * RTCP_SSRC_SIZE)
+#define RTCP_NACK_SIZE 4
+#define RTCP_FIR_SIZE 8
+#define RTCP_MAX_COUNT 31
+
+static KmsRTCPPacketType
+compound_fb_get_type (guint8 pt, guint8 fmt, const guint8 * fci,
+    guint fci_size)
+{
+  if (pt == GST_RTCP_TYPE_RTPFB) {
+    switch (fmt) {
+      case GST_RTCP_RTPFB_TYPE_NACK:
+        return KMS_RTCP_PACKET_TYPE_NACK;
+      case KMS_RTCP_RTPFB_TYPE_TWCC:
+        return KMS_RTCP_PACKET_TYPE_TWCC;
+      default:
+        return KMS_RTCP_PACKET_TYPE_UNKNOWN;
+    }
+  }
+
+  switch (fmt) {
+    case GST_RTCP_PSFB_TYPE_PLI:
+      return KMS_RTCP_PACKET_TYPE_PLI;
+    case GST_RTCP_PSFB_TYPE_FIR:
+      return KMS_RTCP_PACKET_TYPE_FIR;
+    case GST_RTCP_PSFB_TYPE_AFB:
+      if (fci_size >= 4 && memcmp (fci, "REMB", 4) == 0) {
+        return KMS_RTCP_PACKET_TYPE_REMB;
+      }
+      return KMS_RTCP_PACKET_TYPE_UNKNOWN;
+    default:
+      return KMS_RTCP_PACKET_TYPE_UNKNOWN;
+  }
+}
+
+void
+kms_rtcp_compound_reader_init (KmsRTCPCompoundReader * reader,
+    const guint8 * data, guint size)
+{
+  g_return_if_fail (reader != NULL);
+
+  reader->data = data;
+  reader->size = data != NULL ? size : 0;
+  reader->offset = 0;
+  reader->error = FALSE;
+}
+
+gboolean
+kms_rtcp_compound_reader_next (KmsRTCPCompoundReader * reader,
+    KmsRTCPCompoundPacket * packet)
+{
+  const guint8 *data;
+  guint remaining, size, padding = 0, min_size;
+
+  g_return_val_if_fail (reader != NULL, FALSE);
+  g_return_val_if_fail (packet != NULL, FALSE);
+
+  if (reader->error || reader->offset >= reader->size) {
+    return FALSE;
+  }
+
+  data = reader->data + reader->offset;
+  remaining = reader->size - reader->offset;
+
+  if (remaining < RTCP_HEADER_SIZE || (data[0] >> 6) != RTCP_VERSION) {
+    GST_DEBUG ("Invalid RTCP packet header at offset %u", reader->offset);
+    goto invalid;
+  }
+
+  size = (GST_READ_UINT16_BE (data + 2) + 1) * 4;
+  if (size > remaining) {
+    GST_DEBUG ("RTCP packet length (%u) exceeds compound size (%u)", size,
+        remaining);
+    goto invalid;
+  }
+
+  if (data[0] & 0x20) {
+    padding = data[size - 1];
+    if (padding == 0 || padding > size - RTCP_HEADER_SIZE) {
+      GST_DEBUG ("Invalid RTCP padding (%u)", padding);
+      goto invalid;
+    }
+  }
+
+  reader->offset += size;
+  size -= padding;
+
+  packet->type = KMS_RTCP_PACKET_TYPE_UNKNOWN;
+  packet->pt = data[1];
+  packet->count = data[0] & 0x1f;
+  packet->ssrc = 0;
+  packet->media_ssrc = 0;
+
+  switch (packet->pt) {
+    case GST_RTCP_TYPE_SR:
+    case GST_RTCP_TYPE_RR:
+      min_size = RTCP_HEADER_SIZE + RTCP_SSRC_SIZE +
+          packet->count * RTCP_REPORT_BLOCK_SIZE;
+      if (packet->pt == GST_RTCP_TYPE_SR) {
+        min_size += RTCP_SENDER_INFO_SIZE;
+        packet->type = KMS_RTCP_PACKET_TYPE_SR;
+      } else {
+        packet->type = KMS_RTCP_PACKET_TYPE_RR;
+      }
+
+      if (size < min_size) {
+        GST_DEBUG ("Inconsistent RTCP report length (%u < %u)", size,
+            min_size);
+        goto invalid;
+      }
+
+      packet->ssrc = GST_READ_UINT32_BE (data + RTCP_HEADER_SIZE);
+      packet->body = data + RTCP_HEADER_SIZE + RTCP_SSRC_SIZE;
+      packet->body_size = size - RTCP_HEADER_SIZE - RTCP_SSRC_SIZE;
+      break;
+    case GST_RTCP_TYPE_RTPFB:
+    case GST_RTCP_TYPE_PSFB:
+      if (size < RTCP_FB_HEADER_SIZE) {
+        GST_DEBUG ("Inconsistent RTCP feedback length (%u)", size);
+        goto invalid;
+      }
+
+      packet->ssrc = GST_READ_UINT32_BE (data + RTCP_HEADER_SIZE);
+      packet->media_ssrc =
+          GST_READ_UINT32_BE (data + RTCP_HEADER_SIZE + RTCP_SSRC_SIZE);
+      packet->body = data + RTCP_FB_HEADER_SIZE;
+      packet->body_size = size - RTCP_FB_HEADER_SIZE;
+      packet->type = compound_fb_get_type (packet->pt, packet->count,
+          packet->body, packet->body_size);
+      break;
+    default:
+      packet->body = data + RTCP_HEADER_SIZE;
+      packet->body_size = size - RTCP_HEADER_SIZE;
+      break;
+  }
+
+  return TRUE;
+
+invalid:
+  reader->error = TRUE;
+
+  return FALSE;
+}
+
+gboolean
+kms_rtcp_compound_packet_get_sender_info (const KmsRTCPCompoundPacket *
+    packet, KmsRTCPSenderInfo * info)
+{
+  const guint8 *data;
+
+  g_return_val_if_fail (packet != NULL, FALSE);
+  g_return_val_if_fail (info != NULL, FALSE);
+
+  if (packet->type != KMS_RTCP_PACKET_TYPE_SR) {
+    return FALSE;
+  }
+
+  data = packet->body;
+  info->ntp_time = GST_READ_UINT64_BE (data);
+  info->rtp_time = GST_READ_UINT32_BE (data + 8);
+  info->packet_count = GST_READ_UINT32_BE (data + 12);
+  info->octet_count = GST_READ_UINT32_BE (data + 16);
+
+  return TRUE;
+}
+
+static const guint8 *
+compound_packet_get_report_blocks (const KmsRTCPCompoundPacket * packet)
+{
+  switch (packet->type) {
+    case KMS_RTCP_PACKET_TYPE_SR:
+      return packet->body + RTCP_SENDER_INFO_SIZE;
+    case KMS_RTCP_PACKET_TYPE_RR:
+      return packet->body;
+    default:
+      return NULL;
+  }
+}
+
+guint
+kms_rtcp_compound_packet_get_report_block_count (const KmsRTCPCompoundPacket
+    * packet)
+{
+  g_return_val_if_fail (packet != NULL, 0);
+
+  if (compound_packet_get_report_blocks (packet) == NULL) {
+    return 0;
+  }
+
+  return packet->count;
+}
+
+gboolean
+kms_rtcp_compound_packet_get_report_block (const KmsRTCPCompoundPacket *
+    packet, guint nth, KmsRTCPReportBlock * block)
+{
+  const guint8 *data;
+  guint32 packets_lost;
+
+  g_return_val_if_fail (packet != NULL, FALSE);
+  g_return_val_if_fail (block != NULL, FALSE);
+
+  data = compound_packet_get_report_blocks (packet);
+  if (data == NULL || nth >= packet->count) {
+    return FALSE;
+  }
+
+  data += nth * RTCP_REPORT_BLOCK_SIZE;
+  block->ssrc = GST_READ_UINT32_BE (data);
+  block->fraction_lost = data[4];
+  packets_lost = GST_READ_UINT24_BE (data + 5);
+  if (packets_lost & 0x800000) {
+    /* 24 bits signed */
+    packets_lost |= 0xff000000;
+  }
+  block->packets_lost = (gint32) packets_lost;
+  block->exthighestseq = GST_READ_UINT32_BE (data + 8);
+  block->jitter = GST_READ_UINT32_BE (data + 12);
+  block->lsr = GST_READ_UINT32_BE (data + 16);
+  block->dlsr = GST_READ_UINT32_BE (data + 20);
+
+  return TRUE;
+}
+
+guint
+kms_rtcp_compound_packet_get_nack_count (const KmsRTCPCompoundPacket * packet)
+{
+  g_return_val_if_fail (packet != NULL, 0);
+
+  if (packet->type != KMS_RTCP_PACKET_TYPE_NACK) {
+    return 0;
+  }
+
+  return packet->body_size / RTCP_NACK_SIZE;
+}
+
+gboolean
+kms_rtcp_compound_packet_get_nack (const KmsRTCPCompoundPacket * packet,
+    guint nth, guint16 * pid, guint16 * blp)
+{
+  const guint8 *data;
+
+  g_return_val_if_fail (packet != NULL, FALSE);
+
+  if (nth >= kms_rtcp_compound_packet_get_nack_count (packet)) {
+    return FALSE;
+  }
+
+  data = packet->body + nth * RTCP_NACK_SIZE;
+  if (pid != NULL) {
+    *pid = GST_READ_UINT16_BE (data);
+  }
+  if (blp != NULL) {
+    *blp = GST_READ_UINT16_BE (data + 2);
+  }
+
+  return TRUE;
+}
+
+guint
+kms_rtcp_compound_packet_get_fir_count (const KmsRTCPCompoundPacket * packet)
+{
+  g_return_val_if_fail (packet != NULL, 0);
+
+  if (packet->type != KMS_RTCP_PACKET_TYPE_FIR) {
+    return 0;
+  }
+
+  return packet->body_size / RTCP_FIR_SIZE;
+}
+
+gboolean
+kms_rtcp_compound_packet_get_fir (const KmsRTCPCompoundPacket * packet,
+    guint nth, guint32 * ssrc, guint8 * seqnum)
+{
+  const guint8 *data;
+
+  g_return_val_if_fail (packet != NULL, FALSE);
+
+  if (nth >= kms_rtcp_compound_packet_get_fir_count (packet)) {
+    return FALSE;
+  }
+
+  data = packet->body + nth * RTCP_FIR_SIZE;
+  if (ssrc != NULL) {
+    *ssrc = GST_READ_UINT32_BE (data);
+  }
+  if (seqnum != NULL) {
+    *seqnum = data[4];
+  }
+
+  return TRUE;
+}
+
+gboolean
+kms_rtcp_compound_packet_get_remb (const KmsRTCPCompoundPacket * packet,
+    KmsRTCPPSFBAFBREMBPacket * remb_packet)
+{
+  g_return_val_if_fail (packet != NULL, FALSE);
+
+  if (packet->type != KMS_RTCP_PACKET_TYPE_REMB) {
+    return FALSE;
+  }
+
+  return kms_rtcp_remb_get_packet (packet->body, packet->body_size,
+      remb_packet);
+}
+
+gboolean
+kms_rtcp_compound_packet_get_twcc (const KmsRTCPCompoundPacket * packet,
+    KmsRTCPTWCCPacket * twcc_packet)
+{
+  g_return_val_if_fail (packet != NULL, FALSE);
+
+  if (packet->type != KMS_RTCP_PACKET_TYPE_TWCC) {
+    return FALSE;
+  }
+
+  return kms_rtcp_twcc_get_packet (packet->body, packet->body_size,
+      twcc_packet);
+}
+
+void
+kms_rtcp_compound_writer_init (KmsRTCPCompoundWriter * writer, guint8 * data,
+    guint size)
+{
+  g_return_if_fail (writer != NULL);
+
+  writer->data = data;
+  writer->size = data != NULL ? size : 0;
+  writer->offset = 0;
+}
+
+guint
+kms_rtcp_compound_writer_get_size (KmsRTCPCompoundWriter * writer)
+{
+  g_return_val_if_fail (writer != NULL, 0);
+
+  return writer->offset;
+}
+
+/* Reserves a packet of @size bytes (multiple of 4) and writes its header */
+static guint8 *
+compound_writer_add_packet (KmsRTCPCompoundWriter * writer, guint8 pt,
+    guint8 count, guint size)
+{
+  guint8 *data;
+
+  if (size > writer->size - writer->offset || size / 4 - 1 > G_MAXUINT16) {
+    GST_DEBUG ("Not enough room for a RTCP packet of %u bytes", size);
+    return NULL;
+  }
+
+  data = writer->data + writer->offset;
+  data[0] = (RTCP_VERSION << 6) | (count & 0x1f);
+  data[1] = pt;
+  GST_WRITE_UINT16_BE (data + 2, size / 4 - 1);
+  writer->offset += size;
+
+  return data;
+}
+
+static guint8 *
+compound_writer_add_fb (KmsRTCPCompoundWriter * writer, guint8 pt,
+    guint8 fmt, guint32 sender_ssrc, guint32 media_ssrc, guint fci_size)
+{
+  guint8 *data;
+
+  data = compound_writer_add_packet (writer, pt, fmt,
+      RTCP_FB_HEADER_SIZE + fci_size);
+  if (data == NULL) {
+    return NULL;
+  }
+
+  GST_WRITE_UINT32_BE (data + RTCP_HEADER_SIZE, sender_ssrc);
+  GST_WRITE_UINT32_BE (data + RTCP_HEADER_SIZE + RTCP_SSRC_SIZE, media_ssrc);
+
+  return data + RTCP_FB_HEADER_SIZE;
+}
+
+static void
+compound_write_report_blocks (guint8 * data, const KmsRTCPReportBlock * blocks,
+    guint n_blocks)
+{
+  guint i;
+
+  for (i = 0; i < n_blocks; i++) {
+    const KmsRTCPReportBlock *block = &blocks[i];
+
+    GST_WRITE_UINT32_BE (data, block->ssrc);
+    data[4] = block->fraction_lost;
+    GST_WRITE_UINT24_BE (data + 5, block->packets_lost & 0xffffff);
+    GST_WRITE_UINT32_BE (data + 8, block->exthighestseq);
+    GST_WRITE_UINT32_BE (data + 12, block->jitter);
+    GST_WRITE_UINT32_BE (data + 16, block->lsr);
+    GST_WRITE_UINT32_BE (data + 20, block->dlsr);
+    data += RTCP_REPORT_BLOCK_SIZE;
+  }
+}
+
+gboolean
+kms_rtcp_compound_writer_add_sr (KmsRTCPCompoundWriter * writer, guint32 ssrc,
+    const KmsRTCPSenderInfo * info, const KmsRTCPReportBlock * blocks,
+    guint n_blocks)
+{
+  guint8 *data;
+
+  g_return_val_if_fail (writer != NULL, FALSE);
+  g_return_val_if_fail (info != NULL, FALSE);
+  g_return_val_if_fail (n_blocks <= RTCP_MAX_COUNT, FALSE);
+  g_return_val_if_fail (n_blocks == 0 || blocks != NULL, FALSE);
+
+  data = compound_writer_add_packet (writer, GST_RTCP_TYPE_SR, n_blocks,
+      RTCP_HEADER_SIZE + RTCP_SSRC_SIZE + RTCP_SENDER_INFO_SIZE +
+      n_blocks * RTCP_REPORT_BLOCK_SIZE);
+  if (data == NULL) {
+    return FALSE;
+  }
+
+  GST_WRITE_UINT32_BE (data + RTCP_HEADER_SIZE, ssrc);
+  data += RTCP_HEADER_SIZE + RTCP_SSRC_SIZE;
+
+  GST_WRITE_UINT64_BE (data, info->ntp_time);
+  GST_WRITE_UINT32_BE (data + 8, info->rtp_time);
+  GST_WRITE_UINT32_BE (data + 12, info->packet_count);
+  GST_WRITE_UINT32_BE (data + 16, info->octet_count);
+  data += RTCP_SENDER_INFO_SIZE;
+
+  compound_write_report_blocks (data, blocks, n_blocks);
+
+  return TRUE;
+}
+
+gboolean
+kms_rtcp_compound_writer_add_rr (KmsRTCPCompoundWriter * writer, guint32 ssrc,
+    const KmsRTCPReportBlock * blocks, guint n_blocks)
+{
+  guint8 *data;
+
+  g_return_val_if_fail (writer != NULL, FALSE);
+  g_return_val_if_fail (n_blocks <= RTCP_MAX_COUNT, FALSE);
+  g_return_val_if_fail (n_blocks == 0 || blocks != NULL, FALSE);
+
+  data = compound_writer_add_packet (writer, GST_RTCP_TYPE_RR, n_blocks,
+      RTCP_HEADER_SIZE + RTCP_SSRC_SIZE + n_blocks * RTCP_REPORT_BLOCK_SIZE);
+  if (data == NULL) {
+    return FALSE;
+  }
+
+  GST_WRITE_UINT32_BE (data + RTCP_HEADER_SIZE, ssrc);
+  compound_write_report_blocks (data + RTCP_HEADER_SIZE + RTCP_SSRC_SIZE,
+      blocks, n_blocks);
+
+  return TRUE;
+}
+
+gboolean
+kms_rtcp_compound_writer_add_nack (KmsRTCPCompoundWriter * writer,
+    guint32 sender_ssrc, guint32 media_ssrc, const guint16 * pids,
+    const guint16 * blps, guint n_nacks)
+{
+  guint8 *fci;
+  guint i;
+
+  g_return_val_if_fail (writer != NULL, FALSE);
+  g_return_val_if_fail (pids != NULL, FALSE);
+  g_return_val_if_fail (n_nacks > 0, FALSE);
+
+  fci = compound_writer_add_fb (writer, GST_RTCP_TYPE_RTPFB,
+      GST_RTCP_RTPFB_TYPE_NACK, sender_ssrc, media_ssrc,
+      n_nacks * RTCP_NACK_SIZE);
+  if (fci == NULL) {
+    return FALSE;
+  }
+
+  for (i = 0; i < n_nacks; i++) {
+    GST_WRITE_UINT16_BE (fci, pids[i]);
+    GST_WRITE_UINT16_BE (fci + 2, blps != NULL ? blps[i] : 0);
+    fci += RTCP_NACK_SIZE;
+  }
+
+  return TRUE;
+}
+
+gboolean
+kms_rtcp_compound_writer_add_pli (KmsRTCPCompoundWriter * writer,
+    guint32 sender_ssrc, guint32 media_ssrc)
+{
+  g_return_val_if_fail (writer != NULL, FALSE);
+
+  return compound_writer_add_fb (writer, GST_RTCP_TYPE_PSFB,
+      GST_RTCP_PSFB_TYPE_PLI, sender_ssrc, media_ssrc, 0) != NULL;
+}
+
+gboolean
+kms_rtcp_compound_writer_add_fir (KmsRTCPCompoundWriter * writer,
+    guint32 sender_ssrc, const guint32 * ssrcs, const guint8 * seqnums,
+    guint n_firs)
+{
+  guint8 *fci;
+  guint i;
+
+  g_return_val_if_fail (writer != NULL, FALSE);
+  g_return_val_if_fail (ssrcs != NULL, FALSE);
+  g_return_val_if_fail (seqnums != NULL, FALSE);
+  g_return_val_if_fail (n_firs > 0, FALSE);
+
+  /* Media source SSRC is not used in FIR (RFC 5104 4.3.1.1) */
+  fci = compound_writer_add_fb (writer, GST_RTCP_TYPE_PSFB,
+      GST_RTCP_PSFB_TYPE_FIR, sender_ssrc, 0, n_firs * RTCP_FIR_SIZE);
+  if (fci == NULL) {
+    return FALSE;
+  }
+
+  for (i = 0; i < n_firs; i++) {
+    GST_WRITE_UINT32_BE (fci, ssrcs[i]);
+    fci[4] = seqnums[i];
+    fci[5] = fci[6] = fci[7] = 0;
+    fci += RTCP_FIR_SIZE;
+  }
+
+  return TRUE;
+}
+
+gboolean
+kms_rtcp_compound_writer_add_remb (KmsRTCPCompoundWriter * writer,
+    guint32 sender_ssrc, KmsRTCPPSFBAFBREMBPacket * remb_packet)
+{
+  guint offset;
+  guint8 *fci;
+
+  g_return_val_if_fail (writer != NULL, FALSE);
+  g_return_val_if_fail (remb_packet != NULL, FALSE);
+
+  offset = writer->offset;
+  fci = compound_writer_add_fb (writer, GST_RTCP_TYPE_PSFB,
+      GST_RTCP_PSFB_TYPE_AFB, sender_ssrc, 0, remb_get_fci_size (remb_packet));
+  if (fci == NULL) {
+    return FALSE;
+  }
+
+  if (!remb_write_fci (fci, remb_packet)) {
+    writer->offset = offset;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+gboolean
+kms_rtcp_compound_writer_add_twcc (KmsRTCPCompoundWriter * writer,
+    guint32 sender_ssrc, guint32 media_ssrc, KmsRTCPTWCCPacket * twcc_packet)
+{
+  guint fci_size;
+  guint8 *fci;
+
+  g_return_val_if_fail (writer != NULL, FALSE);
+  g_return_val_if_fail (twcc_packet != NULL, FALSE);
+
+  if (!twcc_check_status_count (twcc_packet)) {
+    return FALSE;
+  }
+
+  fci_size = GST_ROUND_UP_4 (twcc_get_fci_size (twcc_packet));
+  fci = compound_writer_add_fb (writer, GST_RTCP_TYPE_RTPFB,
+      KMS_RTCP_RTPFB_TYPE_TWCC, sender_ssrc, media_ssrc, fci_size);
+  if (fci == NULL) {
+    return FALSE;
+  }
+
+  memset (fci, 0, fci_size);
+  twcc_write_fci (fci, twcc_packet);
+
+  return TRUE;
+}
+
+/* Compound end */
@@ -75,10 +75,166 @@ KmsRTCPPSFBAFBType kms_rtcp_psfb_afb_packet_get_type (KmsRTCPPSFBAFBPacket *
     packet);
 
 /* KmsRTCPPSFBAFBREMBPacket */
+gboolean kms_rtcp_remb_get_packet (const guint8 * fci, guint size,
+    KmsRTCPPSFBAFBREMBPacket * remb_packet);
 gboolean kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
     KmsRTCPPSFBAFBREMBPacket * remb_packet);
 
 gboolean kms_rtcp_psfb_afb_remb_marshall_packet (GstRTCPPacket *rtcp_packet, KmsRTCPPSFBAFBREMBPacket * remb_packet, guint32 sender_ssrc);
 
+/**
+ * KmsRTCPTWCCStatus:
+ * @KMS_RTCP_TWCC_STATUS_NOT_RECEIVED: Packet not received
+ * @KMS_RTCP_TWCC_STATUS_SMALL_DELTA: Packet received, 1 byte delta
+ * @KMS_RTCP_TWCC_STATUS_LARGE_DELTA: Packet received, 2 bytes signed delta
+ *
+ * Packet status symbols of Transport-wide Congestion Control feedback.
+ */
+typedef enum
+{
+  KMS_RTCP_TWCC_STATUS_NOT_RECEIVED = 0,
+  KMS_RTCP_TWCC_STATUS_SMALL_DELTA = 1,
+  KMS_RTCP_TWCC_STATUS_LARGE_DELTA = 2,
+} KmsRTCPTWCCStatus;
+
+/* https://tools.ietf.org/html/draft-holmer-rmcat-transport-wide-cc-extensions-01 */
+#define KMS_RTCP_RTPFB_TYPE_TWCC 15
+
+#define KMS_RTCP_TWCC_MAX_PACKETS 512
+#define KMS_RTCP_TWCC_REFERENCE_TIME_UNIT (64 * GST_MSECOND)
+#define KMS_RTCP_TWCC_DELTA_UNIT (250 * GST_USECOND)
+
+typedef struct _KmsRTCPTWCCPacket KmsRTCPTWCCPacket;
+
+struct _KmsRTCPTWCCPacket
+{
+  guint16 base_seq;
+  guint16 status_count;
+  gint32 reference_time;        /* KMS_RTCP_TWCC_REFERENCE_TIME_UNIT */
+  guint8 fb_pkt_count;
+  guint8 status[KMS_RTCP_TWCC_MAX_PACKETS];
+  gint16 deltas[KMS_RTCP_TWCC_MAX_PACKETS];     /* KMS_RTCP_TWCC_DELTA_UNIT */
+};
+
+/* KmsRTCPTWCCPacket */
+gboolean kms_rtcp_twcc_get_packet (const guint8 * fci, guint size,
+    KmsRTCPTWCCPacket * twcc_packet);
+
+gboolean kms_rtcp_twcc_marshall_packet (GstRTCPPacket *rtcp_packet, KmsRTCPTWCCPacket * twcc_packet, guint32 sender_ssrc, guint32 media_ssrc);
+
+/**
+ * KmsRTCPPacketType:
+ * @KMS_RTCP_PACKET_TYPE_UNKNOWN: Packet not handled by the compound accessors
+ * @KMS_RTCP_PACKET_TYPE_SR: Sender Report
+ * @KMS_RTCP_PACKET_TYPE_RR: Receiver Report
+ * @KMS_RTCP_PACKET_TYPE_NACK: Generic NACK
+ * @KMS_RTCP_PACKET_TYPE_TWCC: Transport-wide Congestion Control feedback
+ * @KMS_RTCP_PACKET_TYPE_PLI: Picture Loss Indication
+ * @KMS_RTCP_PACKET_TYPE_FIR: Full Intra Request
+ * @KMS_RTCP_PACKET_TYPE_REMB: Receiver Estimated Maximum Bitrate
+ *
+ * Packets recognized while walking a compound RTCP packet.
+ */
+typedef enum
+{
+  KMS_RTCP_PACKET_TYPE_UNKNOWN = 0,
+  KMS_RTCP_PACKET_TYPE_SR,
+  KMS_RTCP_PACKET_TYPE_RR,
+  KMS_RTCP_PACKET_TYPE_NACK,
+  KMS_RTCP_PACKET_TYPE_TWCC,
+  KMS_RTCP_PACKET_TYPE_PLI,
+  KMS_RTCP_PACKET_TYPE_FIR,
+  KMS_RTCP_PACKET_TYPE_REMB,
+} KmsRTCPPacketType;
+
+typedef struct _KmsRTCPCompoundReader KmsRTCPCompoundReader;
+typedef struct _KmsRTCPCompoundWriter KmsRTCPCompoundWriter;
+typedef struct _KmsRTCPCompoundPacket KmsRTCPCompoundPacket;
+typedef struct _KmsRTCPSenderInfo KmsRTCPSenderInfo;
+typedef struct _KmsRTCPReportBlock KmsRTCPReportBlock;
+
+struct _KmsRTCPCompoundReader
+{
+  const guint8 *data;
+  guint size;
+
+  /*< private > */
+  guint offset;
+  gboolean error;
+};
+
+struct _KmsRTCPCompoundWriter
+{
+  guint8 *data;
+  guint size;
+
+  /*< private > */
+  guint offset;
+};
+
+/*
+ * Points into the data given to the reader, it is valid as long as that
+ * memory is. @body is the FCI for feedback messages, what follows the sender
+ * SSRC for SR and RR, and what follows the header for the rest. Padding is
+ * not part of @body.
+ */
+struct _KmsRTCPCompoundPacket
+{
+  KmsRTCPPacketType type;
+  guint8 pt;
+  guint8 count;                 /* RC, SC or FMT */
+  guint32 ssrc;                 /* SR, RR and feedback messages only */
+  guint32 media_ssrc;           /* feedback messages only */
+  const guint8 *body;
+  guint body_size;
+};
+
+struct _KmsRTCPSenderInfo
+{
+  guint64 ntp_time;
+  guint32 rtp_time;
+  guint32 packet_count;
+  guint32 octet_count;
+};
+
+struct _KmsRTCPReportBlock
+{
+  guint32 ssrc;
+  guint8 fraction_lost;
+  gint32 packets_lost;
+  guint32 exthighestseq;
+  guint32 jitter;
+  guint32 lsr;
+  guint32 dlsr;
+};
+
+/* KmsRTCPCompoundReader */
+void kms_rtcp_compound_reader_init (KmsRTCPCompoundReader * reader, const guint8 * data, guint size);
+/* Returns FALSE at the end of the compound or when a malformed packet is found, @reader error is set in the later case */
+gboolean kms_rtcp_compound_reader_next (KmsRTCPCompoundReader * reader, KmsRTCPCompoundPacket * packet);
+#define kms_rtcp_compound_reader_has_error(reader) ((reader)->error)
+
+/* KmsRTCPCompoundPacket */
+gboolean kms_rtcp_compound_packet_get_sender_info (const KmsRTCPCompoundPacket * packet, KmsRTCPSenderInfo * info);
+guint kms_rtcp_compound_packet_get_report_block_count (const KmsRTCPCompoundPacket * packet);
+gboolean kms_rtcp_compound_packet_get_report_block (const KmsRTCPCompoundPacket * packet, guint nth, KmsRTCPReportBlock * block);
+guint kms_rtcp_compound_packet_get_nack_count (const KmsRTCPCompoundPacket * packet);
+gboolean kms_rtcp_compound_packet_get_nack (const KmsRTCPCompoundPacket * packet, guint nth, guint16 * pid, guint16 * blp);
+guint kms_rtcp_compound_packet_get_fir_count (const KmsRTCPCompoundPacket * packet);
+gboolean kms_rtcp_compound_packet_get_fir (const KmsRTCPCompoundPacket * packet, guint nth, guint32 * ssrc, guint8 * seqnum);
+gboolean kms_rtcp_compound_packet_get_remb (const KmsRTCPCompoundPacket * packet, KmsRTCPPSFBAFBREMBPacket * remb_packet);
+gboolean kms_rtcp_compound_packet_get_twcc (const KmsRTCPCompoundPacket * packet, KmsRTCPTWCCPacket * twcc_packet);
+
+/* KmsRTCPCompoundWriter: packets are written in place, add functions return FALSE and leave the writer untouched if there is not enough room */
+void kms_rtcp_compound_writer_init (KmsRTCPCompoundWriter * writer, guint8 * data, guint size);
+guint kms_rtcp_compound_writer_get_size (KmsRTCPCompoundWriter * writer);
+gboolean kms_rtcp_compound_writer_add_sr (KmsRTCPCompoundWriter * writer, guint32 ssrc, const KmsRTCPSenderInfo * info, const KmsRTCPReportBlock * blocks, guint n_blocks);
+gboolean kms_rtcp_compound_writer_add_rr (KmsRTCPCompoundWriter * writer, guint32 ssrc, const KmsRTCPReportBlock * blocks, guint n_blocks);
+gboolean kms_rtcp_compound_writer_add_nack (KmsRTCPCompoundWriter * writer, guint32 sender_ssrc, guint32 media_ssrc, const guint16 * pids, const guint16 * blps, guint n_nacks);
+gboolean kms_rtcp_compound_writer_add_pli (KmsRTCPCompoundWriter * writer, guint32 sender_ssrc, guint32 media_ssrc);
+gboolean kms_rtcp_compound_writer_add_fir (KmsRTCPCompoundWriter * writer, guint32 sender_ssrc, const guint32 * ssrcs, const guint8 * seqnums, guint n_firs);
+gboolean kms_rtcp_compound_writer_add_remb (KmsRTCPCompoundWriter * writer, guint32 sender_ssrc, KmsRTCPPSFBAFBREMBPacket * remb_packet);
+gboolean kms_rtcp_compound_writer_add_twcc (KmsRTCPCompoundWriter * writer, guint32 sender_ssrc, guint32 media_ssrc, KmsRTCPTWCCPacket * twcc_packet);
+
 G_END_DECLS
 #endif /* __KMS_RTCP_H__ */
@@ -0,0 +1,818 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "kmsrtpforward.h"
+#include "kmsrefstruct.h"
+#include "constants.h"
+
+#define GST_CAT_DEFAULT kms_rtp_forward_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "kmsrtpforward"
+
+/* Frames split in more packets than this are never forwarded */
+#define MAX_FRAME_PACKETS 512
+
+/* Encodings whose depayloaders output exactly one frame per packet group */
+static const gchar *forward_encodings[] = {
+  "VP8", "VP9", "H264", "OPUS", "PCMU", "PCMA", NULL
+};
+
+/* KmsRtpForwardMeta begin */
+
+GType
+kms_rtp_forward_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { KMS_RTP_FORWARD_META_TAG_STR, NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("KmsRtpForwardMetaAPI", tags);
+
+    g_once_init_leave (&type, _type);
+  }
+
+  return type;
+}
+
+static gboolean
+kms_rtp_forward_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  KmsRtpForwardMeta *fmeta = (KmsRtpForwardMeta *) meta;
+
+  fmeta->packets = NULL;
+  fmeta->caps = NULL;
+  fmeta->cache = NULL;
+
+  return TRUE;
+}
+
+static void
+kms_rtp_forward_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  KmsRtpForwardMeta *fmeta = (KmsRtpForwardMeta *) meta;
+
+  if (fmeta->packets != NULL) {
+    gst_buffer_list_unref (fmeta->packets);
+  }
+
+  if (fmeta->caps != NULL) {
+    gst_caps_unref (fmeta->caps);
+  }
+
+  if (fmeta->cache != NULL) {
+    kms_rtx_cache_unref (fmeta->cache);
+  }
+}
+
+const GstMetaInfo *
+kms_rtp_forward_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter (&meta_info)) {
+    const GstMetaInfo *mi = gst_meta_register (KMS_RTP_FORWARD_META_API_TYPE,
+        "KmsRtpForwardMeta",
+        sizeof (KmsRtpForwardMeta),
+        kms_rtp_forward_meta_init,
+        kms_rtp_forward_meta_free,
+        /* Not copied: a copy is usually made to modify the frame, which */
+        /* would not match the original packets any more                 */
+        NULL);
+
+    g_once_init_leave (&meta_info, mi);
+  }
+
+  return meta_info;
+}
+
+KmsRtpForwardMeta *
+kms_buffer_add_rtp_forward_meta (GstBuffer * buffer, GstBufferList * packets,
+    GstCaps * caps)
+{
+  KmsRtpForwardMeta *meta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (packets != NULL, NULL);
+  g_return_val_if_fail (GST_IS_CAPS (caps), NULL);
+
+  meta = (KmsRtpForwardMeta *) gst_buffer_add_meta (buffer,
+      KMS_RTP_FORWARD_META_INFO, NULL);
+
+  meta->packets = gst_buffer_list_ref (packets);
+  meta->caps = gst_caps_ref (caps);
+
+  return meta;
+}
+
+/* KmsRtpForwardMeta end */
+
+static GstPadProbeReturn
+kms_rtp_forward_strip_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstBuffer *buffer = gst_pad_probe_info_get_buffer (info);
+  KmsRtpForwardMeta *meta;
+
+  if (kms_buffer_get_rtp_forward_meta (buffer) == NULL) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  /* The meta is not kept if this makes a copy */
+  buffer = gst_buffer_make_writable (buffer);
+  meta = kms_buffer_get_rtp_forward_meta (buffer);
+  if (meta != NULL) {
+    gst_buffer_remove_meta (buffer, (GstMeta *) meta);
+  }
+
+  GST_PAD_PROBE_INFO_DATA (info) = buffer;
+
+  return GST_PAD_PROBE_OK;
+}
+
+void
+kms_rtp_forward_strip_meta (GstPad * pad)
+{
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      kms_rtp_forward_strip_probe, NULL, NULL);
+}
+
+static gboolean
+kms_rtp_forward_encoding_is_supported (const gchar * encoding_name)
+{
+  guint i;
+
+  if (encoding_name == NULL) {
+    return FALSE;
+  }
+
+  for (i = 0; forward_encodings[i] != NULL; i++) {
+    if (g_ascii_strcasecmp (forward_encodings[i], encoding_name) == 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/* Collector begin */
+
+typedef struct _KmsRtpForwardCollector
+{
+  KmsRefStruct ref;
+  GMutex mutex;
+
+  GstCaps *caps;
+  gboolean video;
+  gboolean disabled;
+
+  /* Packets received with the timestamp of the last packet */
+  GQueue *group;
+  guint32 group_ts;
+  guint16 last_seq;
+  gboolean last_marker;
+  gboolean gap;
+  /* A frame was output while chaining the last packet */
+  gboolean tagged;
+
+  /* Packets of the forwarded frames, for the senders retransmitting them */
+  KmsRtxCache *cache;
+} KmsRtpForwardCollector;
+
+static void
+kms_rtp_forward_collector_clear (KmsRtpForwardCollector * collector)
+{
+  GstBuffer *buffer;
+
+  while ((buffer = g_queue_pop_head (collector->group)) != NULL) {
+    gst_buffer_unref (buffer);
+  }
+
+  collector->gap = FALSE;
+}
+
+static void
+kms_rtp_forward_collector_destroy (KmsRtpForwardCollector * collector)
+{
+  kms_rtp_forward_collector_clear (collector);
+  g_queue_free (collector->group);
+
+  /* Senders may still hold the cache, but the source is gone */
+  kms_rtx_cache_clear (collector->cache);
+  kms_rtx_cache_unref (collector->cache);
+
+  if (collector->caps != NULL) {
+    gst_caps_unref (collector->caps);
+  }
+
+  g_mutex_clear (&collector->mutex);
+
+  g_slice_free (KmsRtpForwardCollector, collector);
+}
+
+static KmsRtpForwardCollector *
+kms_rtp_forward_collector_new (void)
+{
+  KmsRtpForwardCollector *collector;
+
+  collector = g_slice_new0 (KmsRtpForwardCollector);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (collector),
+      (GDestroyNotify) kms_rtp_forward_collector_destroy);
+
+  g_mutex_init (&collector->mutex);
+  collector->group = g_queue_new ();
+  collector->disabled = TRUE;
+  collector->cache = kms_rtx_cache_new (RTP_RTX_SIZE);
+
+  return collector;
+}
+
+static void
+kms_rtp_forward_collector_set_caps (KmsRtpForwardCollector * collector,
+    GstCaps * caps)
+{
+  const GstStructure *st;
+
+  gst_caps_replace (&collector->caps, caps);
+  kms_rtp_forward_collector_clear (collector);
+
+  st = gst_caps_get_structure (caps, 0);
+  collector->video =
+      g_strcmp0 (gst_structure_get_string (st, "media"), "video") == 0;
+  collector->disabled =
+      !kms_rtp_forward_encoding_is_supported (gst_structure_get_string (st,
+          "encoding-name"));
+}
+
+static void
+kms_rtp_forward_collector_add_packet (KmsRtpForwardCollector * collector,
+    GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint32 ts;
+  guint16 seq;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    kms_rtp_forward_collector_clear (collector);
+    return;
+  }
+
+  ts = gst_rtp_buffer_get_timestamp (&rtp);
+  seq = gst_rtp_buffer_get_seq (&rtp);
+  collector->last_marker = gst_rtp_buffer_get_marker (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (!g_queue_is_empty (collector->group)) {
+    if (ts != collector->group_ts) {
+      /* Previous group was output or dropped by the depayloader */
+      kms_rtp_forward_collector_clear (collector);
+    } else if (seq != (guint16) (collector->last_seq + 1)) {
+      collector->gap = TRUE;
+    }
+  }
+
+  if (g_queue_get_length (collector->group) >= MAX_FRAME_PACKETS) {
+    collector->gap = TRUE;
+  } else {
+    g_queue_push_tail (collector->group, gst_buffer_ref (buffer));
+  }
+
+  collector->group_ts = ts;
+  collector->last_seq = seq;
+  collector->tagged = FALSE;
+}
+
+static GstPadProbeReturn
+kms_rtp_forward_collector_sink_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsRtpForwardCollector *collector = user_data;
+
+  g_mutex_lock (&collector->mutex);
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    if (!collector->disabled) {
+      kms_rtp_forward_collector_add_packet (collector,
+          gst_pad_probe_info_get_buffer (info));
+    }
+  } else {
+    GstEvent *event = gst_pad_probe_info_get_event (info);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+      GstCaps *caps;
+
+      gst_event_parse_caps (event, &caps);
+      kms_rtp_forward_collector_set_caps (collector, caps);
+    } else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+      kms_rtp_forward_collector_clear (collector);
+    }
+  }
+
+  g_mutex_unlock (&collector->mutex);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+kms_rtp_forward_collector_src_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsRtpForwardCollector *collector = user_data;
+  KmsRtpForwardMeta *meta;
+  GstBufferList *packets;
+  GstBuffer *buffer;
+
+  g_mutex_lock (&collector->mutex);
+
+  if (collector->disabled || g_queue_is_empty (collector->group)) {
+    goto end;
+  }
+
+  if (collector->tagged || (collector->video && !collector->last_marker)) {
+    GST_INFO_OBJECT (pad, "Output not aligned with RTP packets, "
+        "frames from %" GST_PTR_FORMAT " will not be forwarded", collector->caps);
+    collector->disabled = TRUE;
+    kms_rtp_forward_collector_clear (collector);
+    goto end;
+  }
+
+  collector->tagged = TRUE;
+
+  if (collector->gap) {
+    kms_rtp_forward_collector_clear (collector);
+    goto end;
+  }
+
+  packets = gst_buffer_list_new_sized (g_queue_get_length (collector->group));
+  while ((buffer = g_queue_pop_head (collector->group)) != NULL) {
+    gst_buffer_list_add (packets, buffer);
+  }
+
+  buffer = gst_buffer_make_writable (gst_pad_probe_info_get_buffer (info));
+  GST_PAD_PROBE_INFO_DATA (info) = buffer;
+  meta = kms_buffer_add_rtp_forward_meta (buffer, packets, collector->caps);
+  meta->cache = kms_rtx_cache_ref (collector->cache);
+  gst_buffer_list_unref (packets);
+
+end:
+  g_mutex_unlock (&collector->mutex);
+
+  return GST_PAD_PROBE_OK;
+}
+
+void
+kms_rtp_forward_add_collector (GstElement * depayloader)
+{
+  KmsRtpForwardCollector *collector;
+  GstPad *pad;
+
+  collector = kms_rtp_forward_collector_new ();
+
+  pad = gst_element_get_static_pad (depayloader, "sink");
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      kms_rtp_forward_collector_sink_probe,
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (collector)),
+      (GDestroyNotify) kms_ref_struct_unref);
+  g_object_unref (pad);
+
+  pad = gst_element_get_static_pad (depayloader, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      kms_rtp_forward_collector_src_probe,
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (collector)),
+      (GDestroyNotify) kms_ref_struct_unref);
+  g_object_unref (pad);
+
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (collector));
+}
+
+/* Collector end */
+
+/* Forwarder begin */
+
+typedef enum
+{
+  SOURCE_PAYLOADER,
+  SOURCE_FORWARDED,
+  N_SOURCES
+} KmsRtpForwardSource;
+
+typedef struct _KmsRtpForwarder
+{
+  KmsRefStruct ref;
+  GMutex mutex;
+
+  /* Not owned, probes are removed along with the payloader pads */
+  GstElement *payloader;
+  GstPad *srcpad;
+  gboolean has_mtu;
+
+  /* Output configuration of the payloader */
+  gboolean configured;
+  gchar *encoding_name;
+  gint clock_rate;
+  guint pt;
+  guint ssrc;
+  guint seqnum_offset;
+  guint timestamp_offset;
+
+  /* Forwarded packets are being pushed */
+  gboolean forwarding;
+
+  /* Last packet sent from any source */
+  gboolean started;
+  KmsRtpForwardSource last_source;
+  guint16 last_seq;
+  guint32 last_ts;
+  GstClockTime last_pts;
+
+  guint16 seq_offset[N_SOURCES];
+  guint32 ts_offset[N_SOURCES];
+} KmsRtpForwarder;
+
+static void
+kms_rtp_forwarder_destroy (KmsRtpForwarder * fwd)
+{
+  g_free (fwd->encoding_name);
+  g_mutex_clear (&fwd->mutex);
+
+  g_slice_free (KmsRtpForwarder, fwd);
+}
+
+static KmsRtpForwarder *
+kms_rtp_forwarder_new (GstElement * payloader, GstPad * srcpad)
+{
+  KmsRtpForwarder *fwd;
+
+  fwd = g_slice_new0 (KmsRtpForwarder);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (fwd),
+      (GDestroyNotify) kms_rtp_forwarder_destroy);
+
+  g_mutex_init (&fwd->mutex);
+  fwd->payloader = payloader;
+  fwd->srcpad = srcpad;
+  fwd->has_mtu =
+      g_object_class_find_property (G_OBJECT_GET_CLASS (payloader),
+      "mtu") != NULL;
+  fwd->last_pts = GST_CLOCK_TIME_NONE;
+
+  return fwd;
+}
+
+static void
+kms_rtp_forwarder_set_caps (KmsRtpForwarder * fwd, GstCaps * caps)
+{
+  const GstStructure *st = gst_caps_get_structure (caps, 0);
+  gint pt = 0;
+
+  g_free (fwd->encoding_name);
+  fwd->encoding_name =
+      g_strdup (gst_structure_get_string (st, "encoding-name"));
+
+  fwd->configured = fwd->encoding_name != NULL &&
+      gst_structure_get_int (st, "clock-rate", &fwd->clock_rate) &&
+      gst_structure_get_int (st, "payload", &pt) &&
+      gst_structure_get_uint (st, "ssrc", &fwd->ssrc);
+  fwd->pt = pt;
+
+  if (!gst_structure_get_uint (st, "seqnum-offset", &fwd->seqnum_offset)) {
+    fwd->seqnum_offset = g_random_int_range (0, G_MAXUINT16);
+  }
+
+  if (!gst_structure_get_uint (st, "timestamp-offset",
+          &fwd->timestamp_offset)) {
+    fwd->timestamp_offset = g_random_int ();
+  }
+}
+
+/*
+ * Each source keeps its own offsets, computed when the output switches to
+ * it so that the receiver sees continuous sequence numbers and timestamps.
+ */
+static void
+kms_rtp_forwarder_map (KmsRtpForwarder * fwd, KmsRtpForwardSource source,
+    guint16 seq, guint32 ts, GstClockTime pts, guint16 * out_seq,
+    guint32 * out_ts)
+{
+  if (!fwd->started) {
+    if (source == SOURCE_FORWARDED) {
+      fwd->seq_offset[source] = fwd->seqnum_offset - seq;
+      fwd->ts_offset[source] = fwd->timestamp_offset - ts;
+    }
+  } else if (fwd->last_source != source) {
+    guint32 delta = 1;
+
+    if (GST_CLOCK_TIME_IS_VALID (pts) && GST_CLOCK_TIME_IS_VALID (fwd->last_pts)
+        && pts > fwd->last_pts && fwd->clock_rate > 0) {
+      delta = MAX (gst_util_uint64_scale_int (pts - fwd->last_pts,
+              fwd->clock_rate, GST_SECOND), 1);
+    }
+
+    GST_DEBUG_OBJECT (fwd->srcpad, "Switching to %s packets",
+        source == SOURCE_FORWARDED ? "forwarded" : "payloaded");
+
+    fwd->seq_offset[source] = (guint16) (fwd->last_seq + 1 - seq);
+    fwd->ts_offset[source] = fwd->last_ts + delta - ts;
+  }
+
+  *out_seq = seq + fwd->seq_offset[source];
+  *out_ts = ts + fwd->ts_offset[source];
+
+  fwd->started = TRUE;
+  fwd->last_source = source;
+  fwd->last_seq = *out_seq;
+  fwd->last_ts = *out_ts;
+  if (GST_CLOCK_TIME_IS_VALID (pts)) {
+    fwd->last_pts = pts;
+  }
+}
+
+static gboolean
+kms_rtp_forwarder_is_compatible (KmsRtpForwarder * fwd, GstCaps * caps)
+{
+  const GstStructure *st = gst_caps_get_structure (caps, 0);
+  gint clock_rate;
+
+  if (!fwd->configured) {
+    return FALSE;
+  }
+
+  if (!gst_structure_get_int (st, "clock-rate", &clock_rate) ||
+      clock_rate != fwd->clock_rate) {
+    return FALSE;
+  }
+
+  return g_ascii_strcasecmp (fwd->encoding_name,
+      gst_structure_get_string (st, "encoding-name")) == 0;
+}
+
+/*
+ * Forwarded packets get a plain header, so they fit if their payload would
+ * also fit in a packet built by the payloader.
+ */
+static gboolean
+kms_rtp_forwarder_fits_mtu (KmsRtpForwarder * fwd, GstBufferList * packets)
+{
+  guint i, len, mtu;
+
+  if (!fwd->has_mtu) {
+    return TRUE;
+  }
+
+  g_object_get (fwd->payloader, "mtu", &mtu, NULL);
+  len = gst_buffer_list_length (packets);
+
+  for (i = 0; i < len; i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    guint size;
+
+    if (!gst_rtp_buffer_map (gst_buffer_list_get (packets, i), GST_MAP_READ,
+            &rtp)) {
+      return FALSE;
+    }
+
+    size = gst_rtp_buffer_calc_packet_len (gst_rtp_buffer_get_payload_len
+        (&rtp), 0, 0);
+    gst_rtp_buffer_unmap (&rtp);
+
+    if (size > mtu) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/*
+ * Only a new RTP header is allocated for each packet, the payload memory is
+ * shared with the received packet.
+ */
+static GstBuffer *
+kms_rtp_forwarder_rewrite_packet (KmsRtpForwarder * fwd, GstBuffer * packet,
+    GstBuffer * frame, KmsRtxCache * cache)
+{
+  GstRTPBuffer in = GST_RTP_BUFFER_INIT, out = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer, *payload;
+  guint16 seq, in_seq;
+  gboolean marker;
+  guint32 ts;
+
+  if (!gst_rtp_buffer_map (packet, GST_MAP_READ, &in)) {
+    return NULL;
+  }
+
+  marker = gst_rtp_buffer_get_marker (&in);
+  in_seq = gst_rtp_buffer_get_seq (&in);
+  kms_rtp_forwarder_map (fwd, SOURCE_FORWARDED, in_seq,
+      gst_rtp_buffer_get_timestamp (&in), GST_BUFFER_PTS (frame), &seq, &ts);
+  payload = gst_rtp_buffer_get_payload_buffer (&in);
+  gst_rtp_buffer_unmap (&in);
+
+  buffer = gst_rtp_buffer_new_allocate (0, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &out);
+  gst_rtp_buffer_set_marker (&out, marker);
+  gst_rtp_buffer_set_payload_type (&out, fwd->pt);
+  gst_rtp_buffer_set_seq (&out, seq);
+  gst_rtp_buffer_set_timestamp (&out, ts);
+  gst_rtp_buffer_set_ssrc (&out, fwd->ssrc);
+  gst_rtp_buffer_unmap (&out);
+
+  buffer = gst_buffer_append (buffer, payload);
+
+  GST_BUFFER_PTS (buffer) = GST_BUFFER_PTS (frame);
+  GST_BUFFER_DTS (buffer) = GST_BUFFER_DTS (frame);
+  if (GST_BUFFER_FLAG_IS_SET (frame, GST_BUFFER_FLAG_DELTA_UNIT)) {
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  }
+
+  if (cache != NULL) {
+    kms_buffer_add_rtx_cache_meta (buffer, cache, in_seq);
+  }
+
+  return buffer;
+}
+
+static GstPadProbeReturn
+kms_rtp_forwarder_sink_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsRtpForwarder *fwd = user_data;
+  GstBuffer *frame = gst_pad_probe_info_get_buffer (info);
+  KmsRtpForwardMeta *meta;
+  GstBufferList *list;
+  guint i, len;
+
+  meta = kms_buffer_get_rtp_forward_meta (frame);
+  if (meta == NULL) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  g_mutex_lock (&fwd->mutex);
+
+  if (!kms_rtp_forwarder_is_compatible (fwd, meta->caps)) {
+    g_mutex_unlock (&fwd->mutex);
+    return GST_PAD_PROBE_OK;
+  }
+
+  if (!kms_rtp_forwarder_fits_mtu (fwd, meta->packets)) {
+    GST_LOG_OBJECT (pad, "Packets bigger than the MTU, payloading frame");
+    g_mutex_unlock (&fwd->mutex);
+    return GST_PAD_PROBE_OK;
+  }
+
+  len = gst_buffer_list_length (meta->packets);
+  list = gst_buffer_list_new_sized (len);
+
+  for (i = 0; i < len; i++) {
+    GstBuffer *packet = gst_buffer_list_get (meta->packets, i);
+    GstBuffer *buffer;
+
+    if (meta->cache != NULL) {
+      /* Only packets actually forwarded are kept for retransmissions */
+      kms_rtx_cache_store (meta->cache, packet);
+    }
+
+    buffer = kms_rtp_forwarder_rewrite_packet (fwd, packet, frame,
+        meta->cache);
+    if (buffer != NULL) {
+      gst_buffer_list_add (list, buffer);
+    }
+  }
+
+  fwd->forwarding = TRUE;
+  g_mutex_unlock (&fwd->mutex);
+
+  GST_TRACE_OBJECT (pad, "Forwarding %u packets instead of payloading", len);
+  gst_pad_push_list (fwd->srcpad, list);
+
+  g_mutex_lock (&fwd->mutex);
+  fwd->forwarding = FALSE;
+  g_mutex_unlock (&fwd->mutex);
+
+  return GST_PAD_PROBE_DROP;
+}
+
+static gboolean
+kms_rtp_forwarder_rewrite_payloaded (GstBuffer ** buffer, guint idx,
+    gpointer user_data)
+{
+  KmsRtpForwarder *fwd = user_data;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint16 seq, out_seq;
+  guint32 ts, out_ts;
+
+  if (!gst_rtp_buffer_map (*buffer, GST_MAP_READ, &rtp)) {
+    return TRUE;
+  }
+
+  seq = gst_rtp_buffer_get_seq (&rtp);
+  ts = gst_rtp_buffer_get_timestamp (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  kms_rtp_forwarder_map (fwd, SOURCE_PAYLOADER, seq, ts,
+      GST_BUFFER_PTS (*buffer), &out_seq, &out_ts);
+
+  if (seq == out_seq && ts == out_ts) {
+    return TRUE;
+  }
+
+  *buffer = gst_buffer_make_writable (*buffer);
+  if (gst_rtp_buffer_map (*buffer, GST_MAP_WRITE, &rtp)) {
+    gst_rtp_buffer_set_seq (&rtp, out_seq);
+    gst_rtp_buffer_set_timestamp (&rtp, out_ts);
+    gst_rtp_buffer_unmap (&rtp);
+  }
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+kms_rtp_forwarder_src_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsRtpForwarder *fwd = user_data;
+
+  g_mutex_lock (&fwd->mutex);
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = gst_pad_probe_info_get_event (info);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+      GstCaps *caps;
+
+      gst_event_parse_caps (event, &caps);
+      kms_rtp_forwarder_set_caps (fwd, caps);
+    }
+  } else if (fwd->forwarding) {
+    /* Already rewritten when the frame was forwarded */
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buffer = gst_pad_probe_info_get_buffer (info);
+
+    kms_rtp_forwarder_rewrite_payloaded (&buffer, 0, fwd);
+    GST_PAD_PROBE_INFO_DATA (info) = buffer;
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = gst_pad_probe_info_get_buffer_list (info);
+
+    list = gst_buffer_list_make_writable (list);
+    gst_buffer_list_foreach (list, kms_rtp_forwarder_rewrite_payloaded, fwd);
+    GST_PAD_PROBE_INFO_DATA (info) = list;
+  }
+
+  g_mutex_unlock (&fwd->mutex);
+
+  return GST_PAD_PROBE_OK;
+}
+
+void
+kms_rtp_forward_add_forwarder (GstElement * payloader)
+{
+  KmsRtpForwarder *fwd;
+  GstPad *sink, *src;
+
+  sink = gst_element_get_static_pad (payloader, "sink");
+  src = gst_element_get_static_pad (payloader, "src");
+
+  fwd = kms_rtp_forwarder_new (payloader, src);
+
+  gst_pad_add_probe (src,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST |
+      GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, kms_rtp_forwarder_src_probe,
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (fwd)),
+      (GDestroyNotify) kms_ref_struct_unref);
+
+  gst_pad_add_probe (sink, GST_PAD_PROBE_TYPE_BUFFER,
+      kms_rtp_forwarder_sink_probe,
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (fwd)),
+      (GDestroyNotify) kms_ref_struct_unref);
+
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (fwd));
+
+  g_object_unref (sink);
+  g_object_unref (src);
+}
+
+/* Forwarder end */
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
@@ -0,0 +1,89 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_RTP_FORWARD_H__
+#define __KMS_RTP_FORWARD_H__
+
+#include <gst/gst.h>
+#include "kmsrtxcache.h"
+
+G_BEGIN_DECLS
+
+typedef struct _KmsRtpForwardMeta KmsRtpForwardMeta;
+
+/* Elements modifying or decoding the frame must not keep the meta */
+#define KMS_RTP_FORWARD_META_TAG_STR "rtp-forward"
+
+/**
+ * KmsRtpForwardMeta:
+ * @meta: the parent type
+ * @packets: RTP packets the buffer was depayloaded from
+ * @caps: RTP caps of @packets
+ * @cache: retransmission cache holding @packets, or NULL
+ *
+ * Attached to depayloaded frames so that a payloader producing the same
+ * encoding can send the original packets instead of payloading again. The
+ * meta is never copied along with the frame.
+ */
+struct _KmsRtpForwardMeta {
+  GstMeta meta;
+
+  GstBufferList *packets;
+  GstCaps *caps;
+  KmsRtxCache *cache;
+};
+
+GType kms_rtp_forward_meta_api_get_type (void);
+#define KMS_RTP_FORWARD_META_API_TYPE \
+  (kms_rtp_forward_meta_api_get_type())
+
+#define kms_buffer_get_rtp_forward_meta(b) \
+  ((KmsRtpForwardMeta*)gst_buffer_get_meta((b), KMS_RTP_FORWARD_META_API_TYPE))
+
+/* implementation */
+const GstMetaInfo *kms_rtp_forward_meta_get_info (void);
+#define KMS_RTP_FORWARD_META_INFO (kms_rtp_forward_meta_get_info ())
+
+KmsRtpForwardMeta * kms_buffer_add_rtp_forward_meta (GstBuffer *buffer,
+  GstBufferList *packets, GstCaps *caps);
+
+/*
+ * Receiver side: frames output by @depayloader get the RTP packets they were
+ * built from attached as a KmsRtpForwardMeta. Only frames whose packets are
+ * all present and that are output once per packet group are tagged. Once
+ * forwarded, those packets are kept in a retransmission cache shared by
+ * every sender forwarding them.
+ */
+void kms_rtp_forward_add_collector (GstElement * depayloader);
+
+/* Removes the KmsRtpForwardMeta from the frames going through @pad */
+void kms_rtp_forward_strip_meta (GstPad * pad);
+
+/*
+ * Sender side: frames reaching @payloader with a compatible
+ * KmsRtpForwardMeta are sent as the original packets, rewriting only SSRC,
+ * payload type, sequence number and timestamp. Header extensions are removed
+ * so that they are written again for the outgoing session. Sequence numbers
+ * and timestamps remain continuous when switching between forwarded and
+ * payloaded frames. Frames whose packets would exceed the MTU of
+ * @payloader are payloaded. Forwarded packets carry a KmsRtxCacheMeta when
+ * the originals are in a retransmission cache.
+ */
+void kms_rtp_forward_add_forwarder (GstElement * payloader);
+
+G_END_DECLS
+#endif /* __KMS_RTP_FORWARD_H__ */
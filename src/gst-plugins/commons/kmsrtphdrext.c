@@ -0,0 +1,446 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "kmsrtphdrext.h"
+#include "kmsutils.h"
+#include "constants.h"
+
+#define GST_CAT_DEFAULT kms_rtp_hdr_ext_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "kmsrtphdrext"
+
+#define ONE_BYTE_HEADER_ID 0xBEDE
+#define ONE_BYTE_MAX_ID 14
+#define ONE_BYTE_RESERVED_ID 15
+
+typedef struct _KmsRtpHdrExt
+{
+  KmsRtpHdrExtType type;
+  guint8 id;
+  guint8 size;
+} KmsRtpHdrExt;
+
+struct _KmsRtpHdrExtWriter
+{
+  /* Not owned, the writer lives in a probe of this pad */
+  GstPad *pad;
+  gboolean reserve;
+
+  KmsRtpHdrExt exts[ONE_BYTE_MAX_ID];
+  guint n_exts;
+
+  /* Length of the one-byte header block in 32-bit words */
+  guint block_words;
+
+  gint transport_seqnum;        /* atomic */
+  gint video_orientation;       /* atomic */
+
+  KmsRtpHdrExtTransportCcCallback transport_cc_cb;
+  gpointer transport_cc_data;
+  GDestroyNotify transport_cc_notify;
+};
+
+typedef struct _KmsRtpHdrExtSlots
+{
+  guint8 *data[ONE_BYTE_RESERVED_ID];
+  guint8 size[ONE_BYTE_RESERVED_ID];
+} KmsRtpHdrExtSlots;
+
+static guint8
+kms_rtp_hdr_ext_type_get_size (KmsRtpHdrExtType type)
+{
+  switch (type) {
+    case KMS_RTP_HDR_EXT_ABS_SEND_TIME:
+      return RTP_HDR_EXT_ABS_SEND_TIME_SIZE;
+    case KMS_RTP_HDR_EXT_TRANSPORT_CC:
+      return RTP_HDR_EXT_TRANSPORT_CC_SIZE;
+    case KMS_RTP_HDR_EXT_VIDEO_ORIENTATION:
+      return RTP_HDR_EXT_VIDEO_ORIENTATION_SIZE;
+    default:
+      return 0;
+  }
+}
+
+KmsRtpHdrExtWriter *
+kms_rtp_hdr_ext_writer_create (GstPad * pad, gboolean reserve)
+{
+  KmsRtpHdrExtWriter *writer = g_slice_new0 (KmsRtpHdrExtWriter);
+
+  writer->pad = pad;
+  writer->reserve = reserve;
+
+  return writer;
+}
+
+void
+kms_rtp_hdr_ext_writer_destroy (KmsRtpHdrExtWriter * writer)
+{
+  if (writer == NULL) {
+    return;
+  }
+
+  if (writer->transport_cc_notify != NULL) {
+    writer->transport_cc_notify (writer->transport_cc_data);
+  }
+
+  g_slice_free (KmsRtpHdrExtWriter, writer);
+}
+
+gboolean
+kms_rtp_hdr_ext_writer_add (KmsRtpHdrExtWriter * writer,
+    KmsRtpHdrExtType type, guint8 id)
+{
+  guint8 size = kms_rtp_hdr_ext_type_get_size (type);
+  guint i, bytes;
+
+  if (id == 0 || id > ONE_BYTE_MAX_ID || size == 0) {
+    GST_WARNING_OBJECT (writer->pad, "Invalid RTP hdrext (id: %u, type: %d)",
+        id, type);
+    return FALSE;
+  }
+
+  bytes = 0;
+
+  for (i = 0; i < writer->n_exts; i++) {
+    if (writer->exts[i].id == id) {
+      GST_WARNING_OBJECT (writer->pad, "RTP hdrext id '%u' already used", id);
+      return FALSE;
+    }
+
+    bytes += writer->exts[i].size + 1;
+  }
+
+  writer->exts[writer->n_exts].type = type;
+  writer->exts[writer->n_exts].id = id;
+  writer->exts[writer->n_exts].size = size;
+  writer->n_exts++;
+
+  bytes += size + 1;
+  writer->block_words = (bytes + 3) / 4;
+
+  GST_DEBUG_OBJECT (writer->pad, "Added RTP hdrext (id: %u, type: %d)", id,
+      type);
+
+  return TRUE;
+}
+
+void
+kms_rtp_hdr_ext_writer_set_video_orientation (KmsRtpHdrExtWriter * writer,
+    guint8 cvo)
+{
+  g_atomic_int_set (&writer->video_orientation, cvo);
+}
+
+void
+kms_rtp_hdr_ext_writer_set_transport_cc_callback (KmsRtpHdrExtWriter *
+    writer, KmsRtpHdrExtTransportCcCallback cb, gpointer user_data,
+    GDestroyNotify notify)
+{
+  if (writer->transport_cc_notify != NULL) {
+    writer->transport_cc_notify (writer->transport_cc_data);
+  }
+
+  writer->transport_cc_cb = cb;
+  writer->transport_cc_data = user_data;
+  writer->transport_cc_notify = notify;
+}
+
+static void
+kms_rtp_hdr_ext_find_slots (GstRTPBuffer * rtp, KmsRtpHdrExtSlots * slots)
+{
+  gpointer data;
+  guint8 *pdata;
+  guint16 bits;
+  guint wordlen, len, offset;
+
+  memset (slots, 0, sizeof (KmsRtpHdrExtSlots));
+
+  if (!gst_rtp_buffer_get_extension_data (rtp, &bits, &data, &wordlen)) {
+    return;
+  }
+
+  if (bits != ONE_BYTE_HEADER_ID) {
+    return;
+  }
+
+  pdata = data;
+  len = wordlen * 4;
+  offset = 0;
+
+  while (offset < len) {
+    guint8 id = pdata[offset] >> 4;
+    guint8 size = (pdata[offset] & 0x0f) + 1;
+
+    if (id == 0) {
+      /* Padding */
+      offset++;
+      continue;
+    }
+
+    if (id == ONE_BYTE_RESERVED_ID || offset + 1 + size > len) {
+      break;
+    }
+
+    slots->data[id] = pdata + offset + 1;
+    slots->size[id] = size;
+    offset += 1 + size;
+  }
+}
+
+static gboolean
+kms_rtp_hdr_ext_writer_reserve (KmsRtpHdrExtWriter * writer,
+    GstRTPBuffer * rtp, KmsRtpHdrExtSlots * slots)
+{
+  gboolean missing = FALSE;
+  guint i;
+
+  if (!gst_rtp_buffer_get_extension (rtp)) {
+    gpointer data;
+    guint8 *pdata;
+    guint16 bits;
+    guint wordlen, offset;
+
+    /* Common case: allocate the whole block in a single step */
+    if (!gst_rtp_buffer_set_extension_data (rtp, ONE_BYTE_HEADER_ID,
+            writer->block_words)) {
+      GST_WARNING_OBJECT (writer->pad, "RTP hdrext block not reserved");
+      return FALSE;
+    }
+
+    gst_rtp_buffer_get_extension_data (rtp, &bits, &data, &wordlen);
+    pdata = data;
+    memset (pdata, 0, wordlen * 4);
+
+    offset = 0;
+    for (i = 0; i < writer->n_exts; i++) {
+      pdata[offset] = (writer->exts[i].id << 4) | (writer->exts[i].size - 1);
+      offset += writer->exts[i].size + 1;
+    }
+
+    kms_rtp_hdr_ext_find_slots (rtp, slots);
+
+    return TRUE;
+  }
+
+  kms_rtp_hdr_ext_find_slots (rtp, slots);
+
+  for (i = 0; i < writer->n_exts; i++) {
+    guint8 zeros[RTP_HDR_EXT_ABS_SEND_TIME_SIZE] = { 0, };
+    KmsRtpHdrExt *ext = &writer->exts[i];
+
+    if (slots->data[ext->id] != NULL) {
+      continue;
+    }
+
+    GST_TRACE_OBJECT (writer->pad, "Adding RTP hdrext with id '%u'", ext->id);
+
+    if (!gst_rtp_buffer_add_extension_onebyte_header (rtp, ext->id, zeros,
+            ext->size)) {
+      GST_WARNING_OBJECT (writer->pad, "RTP hdrext with id '%u' not added",
+          ext->id);
+    }
+
+    missing = TRUE;
+  }
+
+  if (missing) {
+    /* Extension data may have been reallocated */
+    kms_rtp_hdr_ext_find_slots (rtp, slots);
+  }
+
+  return TRUE;
+}
+
+static void
+kms_rtp_hdr_ext_set_abs_send_time (guint8 * data, GstClockTime now)
+{
+  GstClockTime ms;
+  guint value;
+
+  ms = GST_TIME_AS_MSECONDS (now);
+  value = (((ms << 18) / 1000) & 0x00ffffff);
+
+  data[0] = (guint8) (value >> 16);
+  data[1] = (guint8) (value >> 8);
+  data[2] = (guint8) (value);
+}
+
+static void
+kms_rtp_hdr_ext_writer_write (KmsRtpHdrExtWriter * writer,
+    KmsRtpHdrExtSlots * slots, GstClockTime now, guint size)
+{
+  guint i;
+
+  for (i = 0; i < writer->n_exts; i++) {
+    KmsRtpHdrExt *ext = &writer->exts[i];
+    guint8 *data = slots->data[ext->id];
+    guint16 seqnum;
+
+    if (data == NULL) {
+      GST_TRACE_OBJECT (writer->pad, "RTP hdrext with id '%u' not found",
+          ext->id);
+      continue;
+    }
+
+    if (slots->size[ext->id] != ext->size) {
+      GST_WARNING_OBJECT (writer->pad,
+          "RTP hdrext size with id '%u' not matching", ext->id);
+      continue;
+    }
+
+    switch (ext->type) {
+      case KMS_RTP_HDR_EXT_ABS_SEND_TIME:
+        if (!writer->reserve) {
+          kms_rtp_hdr_ext_set_abs_send_time (data, now);
+        }
+        break;
+      case KMS_RTP_HDR_EXT_TRANSPORT_CC:
+        if (!writer->reserve) {
+          seqnum = g_atomic_int_add (&writer->transport_seqnum, 1);
+          data[0] = (guint8) (seqnum >> 8);
+          data[1] = (guint8) (seqnum);
+
+          if (writer->transport_cc_cb != NULL) {
+            writer->transport_cc_cb (seqnum, now, size,
+                writer->transport_cc_data);
+          }
+        }
+        break;
+      case KMS_RTP_HDR_EXT_VIDEO_ORIENTATION:
+        data[0] = (guint8) g_atomic_int_get (&writer->video_orientation);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void
+kms_rtp_hdr_ext_writer_process_buffer (KmsRtpHdrExtWriter * writer,
+    GstBuffer * buffer, GstClockTime now)
+{
+  GstRTPBuffer rtp = { NULL, };
+  KmsRtpHdrExtSlots slots;
+
+  if (writer->n_exts == 0) {
+    return;
+  }
+
+  if (!gst_buffer_is_writable (buffer)) {
+    GST_WARNING_OBJECT (writer->pad, "RTP buffer is not writable");
+    return;
+  }
+
+  /* Memory shared with other consumers (e.g. the retransmission history) */
+  /* is copied by the writable map, so they never see the stamped values. */
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READWRITE, &rtp)) {
+    GST_WARNING_OBJECT (writer->pad, "Can not map RTP buffer");
+    return;
+  }
+
+  if (writer->reserve) {
+    if (!kms_rtp_hdr_ext_writer_reserve (writer, &rtp, &slots)) {
+      goto end;
+    }
+  } else {
+    kms_rtp_hdr_ext_find_slots (&rtp, &slots);
+  }
+
+  kms_rtp_hdr_ext_writer_write (writer, &slots, now,
+      gst_buffer_get_size (buffer));
+
+end:
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+typedef struct _ProcessListData
+{
+  KmsRtpHdrExtWriter *writer;
+  GstClockTime now;
+} ProcessListData;
+
+static gboolean
+kms_rtp_hdr_ext_writer_process_list_item (GstBuffer ** buf, guint idx,
+    ProcessListData * data)
+{
+  *buf = gst_buffer_make_writable (*buf);
+
+  kms_rtp_hdr_ext_writer_process_buffer (data->writer, *buf, data->now);
+
+  return TRUE;
+}
+
+void
+kms_rtp_hdr_ext_writer_process_list (KmsRtpHdrExtWriter * writer,
+    GstBufferList * list)
+{
+  ProcessListData data;
+
+  data.writer = writer;
+  data.now = kms_utils_get_time_nsecs ();
+
+  gst_buffer_list_foreach (list,
+      (GstBufferListFunc) kms_rtp_hdr_ext_writer_process_list_item, &data);
+}
+
+static GstPadProbeReturn
+kms_rtp_hdr_ext_writer_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsRtpHdrExtWriter *writer = user_data;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+    buffer = gst_buffer_make_writable (buffer);
+    kms_rtp_hdr_ext_writer_process_buffer (writer, buffer,
+        kms_utils_get_time_nsecs ());
+    GST_PAD_PROBE_INFO_DATA (info) = buffer;
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+
+    list = gst_buffer_list_make_writable (list);
+    kms_rtp_hdr_ext_writer_process_list (writer, list);
+    GST_PAD_PROBE_INFO_DATA (info) = list;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+gulong
+kms_rtp_hdr_ext_writer_add_probe (KmsRtpHdrExtWriter * writer)
+{
+  GST_DEBUG_OBJECT (writer->pad, "Add probe for %s %u RTP hdrexts",
+      writer->reserve ? "reserving" : "stamping", writer->n_exts);
+
+  return gst_pad_add_probe (writer->pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      kms_rtp_hdr_ext_writer_probe, writer,
+      (GDestroyNotify) kms_rtp_hdr_ext_writer_destroy);
+}
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
@@ -0,0 +1,71 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_RTP_HDR_EXT_H__
+#define __KMS_RTP_HDR_EXT_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  KMS_RTP_HDR_EXT_ABS_SEND_TIME,
+  KMS_RTP_HDR_EXT_TRANSPORT_CC,
+  KMS_RTP_HDR_EXT_VIDEO_ORIENTATION,
+} KmsRtpHdrExtType;
+
+typedef struct _KmsRtpHdrExtWriter KmsRtpHdrExtWriter;
+
+typedef void (*KmsRtpHdrExtTransportCcCallback) (guint16 seqnum,
+    GstClockTime send_time, guint size, gpointer user_data);
+
+/*
+ * A writer works in one of two stages:
+ *  - reserve: buffers are made writable and the one-byte header block for
+ *    every configured extension is allocated at once. Used just after the
+ *    payloader so that the send path never needs to grow the buffer.
+ *  - stamp: extensions already reserved are updated with the send time and
+ *    the transport-wide sequence number. Used on the rtpbin src pad.
+ * In both stages buffers must be writable; memory shared with other
+ * consumers is copied before being written.
+ * Buffer lists are handled in a single pass reading the clock only once.
+ */
+KmsRtpHdrExtWriter * kms_rtp_hdr_ext_writer_create (GstPad * pad,
+    gboolean reserve);
+void kms_rtp_hdr_ext_writer_destroy (KmsRtpHdrExtWriter * writer);
+
+gboolean kms_rtp_hdr_ext_writer_add (KmsRtpHdrExtWriter * writer,
+    KmsRtpHdrExtType type, guint8 id);
+void kms_rtp_hdr_ext_writer_set_video_orientation (KmsRtpHdrExtWriter * writer,
+    guint8 cvo);
+
+/* Called in stamp mode for every transport-wide sequence number written */
+void kms_rtp_hdr_ext_writer_set_transport_cc_callback (
+    KmsRtpHdrExtWriter * writer, KmsRtpHdrExtTransportCcCallback cb,
+    gpointer user_data, GDestroyNotify notify);
+
+void kms_rtp_hdr_ext_writer_process_buffer (KmsRtpHdrExtWriter * writer,
+    GstBuffer * buffer, GstClockTime now);
+void kms_rtp_hdr_ext_writer_process_list (KmsRtpHdrExtWriter * writer,
+    GstBufferList * list);
+
+/* The writer is owned by the probe and destroyed when it is removed */
+gulong kms_rtp_hdr_ext_writer_add_probe (KmsRtpHdrExtWriter * writer);
+
+G_END_DECLS
+#endif /* __KMS_RTP_HDR_EXT_H__ */
@@ -21,6 +21,7 @@
 
 #include "kmsrtppaytreebin.h"
 #include "kmsutils.h"
+#include "kmsrtpforward.h"
 
 #define GST_DEFAULT_NAME "rtppaytreebin"
 #define GST_CAT_DEFAULT kms_rtp_pay_tree_bin_debug
@@ -100,6 +101,8 @@ kms_rtp_pay_tree_bin_configure (KmsRtpPayTreeBin * self, const GstCaps * caps)
   kms_utils_drop_until_keyframe (pad, TRUE);
   gst_object_unref (pad);
 
+  kms_rtp_forward_add_forwarder (pay);
+
   gst_bin_add (GST_BIN (self), pay);
   gst_element_sync_state_with_parent (pay);
 
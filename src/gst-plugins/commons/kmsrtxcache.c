@@ -0,0 +1,694 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "kmsrtxcache.h"
+#include "kmsrefstruct.h"
+
+#define GST_CAT_DEFAULT kms_rtx_cache_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "kmsrtxcache"
+
+#define RTX_REQUEST_EVENT_NAME "GstRTPRetransmissionRequest"
+
+/* Pointer sized so that they are 64 bits wide on 64 bits platforms */
+static volatile gssize memory_budget = KMS_RTX_CACHE_DEFAULT_MEMORY_BUDGET;
+static volatile gssize memory_usage = 0;
+
+static guint
+round_up_pow2 (guint size)
+{
+  return 1 << g_bit_storage (MAX (size, 2) - 1);
+}
+
+void
+kms_rtx_cache_set_memory_budget (gsize bytes)
+{
+  g_atomic_pointer_set (&memory_budget, bytes);
+}
+
+gsize
+kms_rtx_cache_get_memory_usage (void)
+{
+  return (gsize) g_atomic_pointer_get (&memory_usage);
+}
+
+static gboolean
+kms_rtx_cache_over_budget (void)
+{
+  return (gssize) g_atomic_pointer_get (&memory_usage) >
+      (gssize) g_atomic_pointer_get (&memory_budget);
+}
+
+/* KmsRtxCache begin */
+
+typedef struct _CacheSlot
+{
+  GstBuffer *buffer;            /* NULL once dropped */
+  gsize size;
+  guint16 seq;
+  gboolean used;
+} CacheSlot;
+
+struct _KmsRtxCache
+{
+  KmsRefStruct ref;
+  GMutex mutex;
+
+  CacheSlot *slots;
+  guint mask;
+  guint stored;
+
+  /* Stored packets are always in this window */
+  gboolean started;
+  guint16 oldest;
+  guint16 newest;
+  /* Nothing is stored between oldest and this one */
+  guint16 next_drop;
+
+  KmsRtxCacheStats stats;
+};
+
+static void
+kms_rtx_cache_drop_slot (KmsRtxCache * cache, CacheSlot * slot)
+{
+  g_atomic_pointer_add (&memory_usage, -(gssize) slot->size);
+  gst_buffer_unref (slot->buffer);
+  slot->buffer = NULL;
+  cache->stored--;
+}
+
+static void
+kms_rtx_cache_clear_slots (KmsRtxCache * cache)
+{
+  guint i;
+
+  for (i = 0; i <= cache->mask && cache->stored > 0; i++) {
+    if (cache->slots[i].buffer != NULL) {
+      kms_rtx_cache_drop_slot (cache, &cache->slots[i]);
+    }
+  }
+}
+
+static void
+kms_rtx_cache_destroy (KmsRtxCache * cache)
+{
+  kms_rtx_cache_clear_slots (cache);
+
+  g_free (cache->slots);
+  g_mutex_clear (&cache->mutex);
+
+  g_slice_free (KmsRtxCache, cache);
+}
+
+KmsRtxCache *
+kms_rtx_cache_new (guint size)
+{
+  KmsRtxCache *cache;
+
+  size = round_up_pow2 (size);
+
+  cache = g_slice_new0 (KmsRtxCache);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (cache),
+      (GDestroyNotify) kms_rtx_cache_destroy);
+
+  g_mutex_init (&cache->mutex);
+  cache->slots = g_new0 (CacheSlot, size);
+  cache->mask = size - 1;
+
+  return cache;
+}
+
+KmsRtxCache *
+kms_rtx_cache_ref (KmsRtxCache * cache)
+{
+  return (KmsRtxCache *) kms_ref_struct_ref (KMS_REF_STRUCT_CAST (cache));
+}
+
+void
+kms_rtx_cache_unref (KmsRtxCache * cache)
+{
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (cache));
+}
+
+static void
+kms_rtx_cache_move_window (KmsRtxCache * cache, guint16 newest)
+{
+  guint16 oldest = cache->oldest;
+  guint i;
+
+  cache->newest = newest;
+  if ((guint16) (newest - oldest) <= cache->mask) {
+    return;
+  }
+
+  cache->oldest = newest - cache->mask;
+
+  for (i = 0; i <= cache->mask && oldest != cache->oldest; i++, oldest++) {
+    CacheSlot *slot = &cache->slots[oldest & cache->mask];
+
+    if (slot->buffer != NULL && slot->seq == oldest) {
+      kms_rtx_cache_drop_slot (cache, slot);
+    }
+  }
+
+  if (oldest != cache->oldest) {
+    /* Jumped further than the ring size */
+    kms_rtx_cache_clear_slots (cache);
+  }
+
+  if ((gint16) (cache->next_drop - cache->oldest) < 0) {
+    cache->next_drop = cache->oldest;
+  }
+}
+
+static void
+kms_rtx_cache_make_room (KmsRtxCache * cache)
+{
+  while (cache->stored > 0 && (gint16) (cache->newest - cache->next_drop) >=
+      KMS_RTX_CACHE_RESERVED_PACKETS && kms_rtx_cache_over_budget ()) {
+    CacheSlot *slot = &cache->slots[cache->next_drop & cache->mask];
+
+    if (slot->used && slot->seq == cache->next_drop && slot->buffer != NULL) {
+      GST_TRACE ("Memory budget exceeded, dropping packet %" G_GUINT16_FORMAT,
+          slot->seq);
+      kms_rtx_cache_drop_slot (cache, slot);
+    }
+
+    cache->next_drop++;
+  }
+}
+
+void
+kms_rtx_cache_store (KmsRtxCache * cache, GstBuffer * packet)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  CacheSlot *slot;
+  guint16 seq;
+
+  if (!gst_rtp_buffer_map (packet, GST_MAP_READ, &rtp)) {
+    return;
+  }
+
+  seq = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  g_mutex_lock (&cache->mutex);
+
+  if (!cache->started) {
+    cache->oldest = cache->newest = cache->next_drop = seq;
+    cache->started = TRUE;
+  } else if ((gint16) (seq - cache->newest) > 0) {
+    kms_rtx_cache_move_window (cache, seq);
+  } else if ((gint16) (seq - cache->oldest) < 0) {
+    /* Would replace a newer packet */
+    g_mutex_unlock (&cache->mutex);
+    return;
+  }
+
+  if ((gint16) (seq - cache->next_drop) < 0) {
+    /* Late packet */
+    cache->next_drop = seq;
+  }
+
+  slot = &cache->slots[seq & cache->mask];
+  if (slot->buffer == packet && slot->seq == seq) {
+    /* Already stored by another sender */
+    g_mutex_unlock (&cache->mutex);
+    return;
+  }
+
+  if (slot->buffer != NULL) {
+    kms_rtx_cache_drop_slot (cache, slot);
+  }
+
+  slot->buffer = gst_buffer_ref (packet);
+  slot->size = gst_buffer_get_size (packet);
+  slot->seq = seq;
+  slot->used = TRUE;
+  cache->stored++;
+  g_atomic_pointer_add (&memory_usage, slot->size);
+
+  kms_rtx_cache_make_room (cache);
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+void
+kms_rtx_cache_clear (KmsRtxCache * cache)
+{
+  g_mutex_lock (&cache->mutex);
+  kms_rtx_cache_clear_slots (cache);
+  g_mutex_unlock (&cache->mutex);
+}
+
+KmsRtxCacheResult
+kms_rtx_cache_lookup (KmsRtxCache * cache, guint16 seq, GstBuffer ** packet)
+{
+  KmsRtxCacheResult result = KMS_RTX_CACHE_MISS;
+  CacheSlot *slot;
+
+  *packet = NULL;
+
+  g_mutex_lock (&cache->mutex);
+
+  if (!cache->started || (gint16) (seq - cache->newest) > 0) {
+    goto end;
+  }
+
+  if ((gint16) (seq - cache->oldest) < 0) {
+    result = KMS_RTX_CACHE_EXPIRED;
+    goto end;
+  }
+
+  slot = &cache->slots[seq & cache->mask];
+  if (!slot->used || slot->seq != seq) {
+    goto end;
+  }
+
+  if (slot->buffer != NULL) {
+    *packet = gst_buffer_ref (slot->buffer);
+    result = KMS_RTX_CACHE_HIT;
+  } else {
+    result = KMS_RTX_CACHE_EXPIRED;
+  }
+
+end:
+  switch (result) {
+    case KMS_RTX_CACHE_HIT:
+      cache->stats.hits++;
+      break;
+    case KMS_RTX_CACHE_MISS:
+      cache->stats.misses++;
+      break;
+    case KMS_RTX_CACHE_EXPIRED:
+      cache->stats.expired++;
+      break;
+  }
+
+  g_mutex_unlock (&cache->mutex);
+
+  return result;
+}
+
+void
+kms_rtx_cache_get_stats (KmsRtxCache * cache, KmsRtxCacheStats * stats)
+{
+  g_mutex_lock (&cache->mutex);
+  *stats = cache->stats;
+  g_mutex_unlock (&cache->mutex);
+}
+
+/* KmsRtxCache end */
+
+/* KmsRtxCacheMeta begin */
+
+GType
+kms_rtx_cache_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { KMS_RTX_CACHE_META_TAG_STR, NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("KmsRtxCacheMetaAPI", tags);
+
+    g_once_init_leave (&type, _type);
+  }
+
+  return type;
+}
+
+static gboolean
+kms_rtx_cache_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  KmsRtxCacheMeta *cmeta = (KmsRtxCacheMeta *) meta;
+
+  cmeta->cache = NULL;
+  cmeta->seq = 0;
+
+  return TRUE;
+}
+
+static void
+kms_rtx_cache_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  KmsRtxCacheMeta *cmeta = (KmsRtxCacheMeta *) meta;
+
+  if (cmeta->cache != NULL) {
+    kms_rtx_cache_unref (cmeta->cache);
+  }
+}
+
+const GstMetaInfo *
+kms_rtx_cache_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter (&meta_info)) {
+    const GstMetaInfo *mi = gst_meta_register (KMS_RTX_CACHE_META_API_TYPE,
+        "KmsRtxCacheMeta",
+        sizeof (KmsRtxCacheMeta),
+        kms_rtx_cache_meta_init,
+        kms_rtx_cache_meta_free,
+        /* Not copied: a copy may be modified, it is then kept by the sender */
+        NULL);
+
+    g_once_init_leave (&meta_info, mi);
+  }
+
+  return meta_info;
+}
+
+KmsRtxCacheMeta *
+kms_buffer_add_rtx_cache_meta (GstBuffer * buffer, KmsRtxCache * cache,
+    guint16 seq)
+{
+  KmsRtxCacheMeta *meta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (cache != NULL, NULL);
+
+  meta = (KmsRtxCacheMeta *) gst_buffer_add_meta (buffer,
+      KMS_RTX_CACHE_META_INFO, NULL);
+
+  meta->cache = kms_rtx_cache_ref (cache);
+  meta->seq = seq;
+
+  return meta;
+}
+
+/* KmsRtxCacheMeta end */
+
+/* KmsRtxSender begin */
+
+/* Header of a sent packet whose payload is in a shared cache */
+typedef struct _SharedPacket
+{
+  KmsRtxCache *cache;           /* NULL if not shared */
+  guint16 cache_seq;
+
+  guint16 seq;
+  /* Including CSRCs and header extensions */
+  guint8 *header;
+  guint header_len;
+} SharedPacket;
+
+struct _KmsRtxSender
+{
+  KmsRefStruct ref;
+  GMutex mutex;
+
+  GstPad *sinkpad;
+  gulong sink_probe_id;
+  GstPad *srcpad;
+  gulong src_probe_id;
+
+  /* Packets not found in any shared cache */
+  KmsRtxCache *own;
+  SharedPacket *shared;
+  guint mask;
+
+  /* Retransmissions pushed along with the next packet */
+  GstBufferList *pending;
+
+  KmsRtxCacheStats stats;
+};
+
+static void
+kms_rtx_sender_clear_shared (SharedPacket * packet)
+{
+  if (packet->cache != NULL) {
+    kms_rtx_cache_unref (packet->cache);
+    packet->cache = NULL;
+  }
+
+  g_free (packet->header);
+  packet->header = NULL;
+  packet->header_len = 0;
+}
+
+static void
+kms_rtx_sender_free (KmsRtxSender * sender)
+{
+  guint i;
+
+  for (i = 0; i <= sender->mask; i++) {
+    kms_rtx_sender_clear_shared (&sender->shared[i]);
+  }
+
+  g_free (sender->shared);
+  kms_rtx_cache_unref (sender->own);
+
+  if (sender->pending != NULL) {
+    gst_buffer_list_unref (sender->pending);
+  }
+
+  g_mutex_clear (&sender->mutex);
+
+  g_slice_free (KmsRtxSender, sender);
+}
+
+static void
+kms_rtx_sender_record (KmsRtxSender * sender, GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  KmsRtxCacheMeta *meta;
+  SharedPacket *packet;
+  guint16 seq;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    return;
+  }
+
+  seq = gst_rtp_buffer_get_seq (&rtp);
+  packet = &sender->shared[seq & sender->mask];
+  kms_rtx_sender_clear_shared (packet);
+
+  meta = kms_buffer_get_rtx_cache_meta (buffer);
+  if (meta != NULL) {
+    packet->cache = kms_rtx_cache_ref (meta->cache);
+    packet->cache_seq = meta->seq;
+    packet->seq = seq;
+    packet->header_len = gst_rtp_buffer_get_header_len (&rtp);
+  }
+
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (meta == NULL) {
+    kms_rtx_cache_store (sender->own, buffer);
+    return;
+  }
+
+  packet->header = g_malloc (packet->header_len);
+  gst_buffer_extract (buffer, 0, packet->header, packet->header_len);
+  /* Padding of the sent packet is not appended to the cached payload */
+  packet->header[0] &= ~0x20;
+}
+
+static gboolean
+kms_rtx_sender_record_list_item (GstBuffer ** buffer, guint idx,
+    KmsRtxSender * sender)
+{
+  kms_rtx_sender_record (sender, *buffer);
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+kms_rtx_sender_sink_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsRtxSender *sender = user_data;
+  GstBufferList *pending;
+
+  g_mutex_lock (&sender->mutex);
+
+  pending = sender->pending;
+  sender->pending = NULL;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    kms_rtx_sender_record (sender, gst_pad_probe_info_get_buffer (info));
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    gst_buffer_list_foreach (gst_pad_probe_info_get_buffer_list (info),
+        (GstBufferListFunc) kms_rtx_sender_record_list_item, sender);
+  }
+
+  g_mutex_unlock (&sender->mutex);
+
+  if (pending != NULL) {
+    GST_LOG_OBJECT (sender->srcpad, "Retransmitting %u packets",
+        gst_buffer_list_length (pending));
+    gst_pad_push_list (sender->srcpad, pending);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Only the sent header is allocated, the payload is the cached one */
+static GstBuffer *
+kms_rtx_sender_rebuild (SharedPacket * packet, GstBuffer * cached)
+{
+  GstRTPBuffer in = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer, *payload;
+
+  if (!gst_rtp_buffer_map (cached, GST_MAP_READ, &in)) {
+    return NULL;
+  }
+
+  payload = gst_rtp_buffer_get_payload_buffer (&in);
+  gst_rtp_buffer_unmap (&in);
+
+  buffer = gst_buffer_new_allocate (NULL, packet->header_len, NULL);
+  gst_buffer_fill (buffer, 0, packet->header, packet->header_len);
+
+  return gst_buffer_append (buffer, payload);
+}
+
+static void
+kms_rtx_sender_retransmit (KmsRtxSender * sender, guint16 seq)
+{
+  SharedPacket *packet = &sender->shared[seq & sender->mask];
+  GstBuffer *buffer = NULL, *cached;
+  KmsRtxCacheResult result;
+
+  if (packet->cache != NULL && packet->seq == seq) {
+    result = kms_rtx_cache_lookup (packet->cache, packet->cache_seq, &cached);
+    if (result == KMS_RTX_CACHE_HIT) {
+      buffer = kms_rtx_sender_rebuild (packet, cached);
+      gst_buffer_unref (cached);
+    }
+  } else {
+    result = kms_rtx_cache_lookup (sender->own, seq, &buffer);
+  }
+
+  switch (result) {
+    case KMS_RTX_CACHE_HIT:
+      sender->stats.hits++;
+      break;
+    case KMS_RTX_CACHE_MISS:
+      sender->stats.misses++;
+      break;
+    case KMS_RTX_CACHE_EXPIRED:
+      sender->stats.expired++;
+      break;
+  }
+
+  if (buffer == NULL) {
+    GST_DEBUG_OBJECT (sender->srcpad, "Can not retransmit packet %"
+        G_GUINT16_FORMAT " (%s)", seq,
+        result == KMS_RTX_CACHE_EXPIRED ? "expired" : "not found");
+    return;
+  }
+
+  if (sender->pending == NULL) {
+    sender->pending = gst_buffer_list_new ();
+  }
+
+  gst_buffer_list_add (sender->pending, buffer);
+}
+
+static GstPadProbeReturn
+kms_rtx_sender_src_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsRtxSender *sender = user_data;
+  GstEvent *event = gst_pad_probe_info_get_event (info);
+  const GstStructure *st;
+  guint seqnum;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CUSTOM_UPSTREAM) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  st = gst_event_get_structure (event);
+  if (!gst_structure_has_name (st, RTX_REQUEST_EVENT_NAME) ||
+      !gst_structure_get_uint (st, "seqnum", &seqnum)) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  g_mutex_lock (&sender->mutex);
+  kms_rtx_sender_retransmit (sender, seqnum);
+  g_mutex_unlock (&sender->mutex);
+
+  /* Handled here, like rtprtxqueue does */
+  return GST_PAD_PROBE_DROP;
+}
+
+KmsRtxSender *
+kms_rtx_sender_create (GstElement * element, guint size)
+{
+  KmsRtxSender *sender;
+
+  sender = g_slice_new0 (KmsRtxSender);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (sender),
+      (GDestroyNotify) kms_rtx_sender_free);
+
+  g_mutex_init (&sender->mutex);
+  sender->own = kms_rtx_cache_new (size);
+  sender->mask = round_up_pow2 (size) - 1;
+  sender->shared = g_new0 (SharedPacket, sender->mask + 1);
+
+  sender->sinkpad = gst_element_get_static_pad (element, "sink");
+  sender->sink_probe_id = gst_pad_add_probe (sender->sinkpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      kms_rtx_sender_sink_probe,
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (sender)),
+      (GDestroyNotify) kms_ref_struct_unref);
+
+  sender->srcpad = gst_element_get_static_pad (element, "src");
+  sender->src_probe_id = gst_pad_add_probe (sender->srcpad,
+      GST_PAD_PROBE_TYPE_EVENT_UPSTREAM, kms_rtx_sender_src_probe,
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (sender)),
+      (GDestroyNotify) kms_ref_struct_unref);
+
+  return sender;
+}
+
+void
+kms_rtx_sender_destroy (KmsRtxSender * sender)
+{
+  if (sender == NULL) {
+    return;
+  }
+
+  gst_pad_remove_probe (sender->sinkpad, sender->sink_probe_id);
+  g_object_unref (sender->sinkpad);
+  gst_pad_remove_probe (sender->srcpad, sender->src_probe_id);
+  g_object_unref (sender->srcpad);
+
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (sender));
+}
+
+void
+kms_rtx_sender_get_stats (KmsRtxSender * sender, KmsRtxCacheStats * stats)
+{
+  g_mutex_lock (&sender->mutex);
+  *stats = sender->stats;
+  g_mutex_unlock (&sender->mutex);
+}
+
+/* KmsRtxSender end */
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
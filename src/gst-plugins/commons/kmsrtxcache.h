@@ -0,0 +1,119 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_RTX_CACHE_H__
+#define __KMS_RTX_CACHE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define KMS_RTX_CACHE_DEFAULT_MEMORY_BUDGET (64 * 1024 * 1024)  /* bytes */
+/* Newest packets of each cache, never dropped to honour the budget */
+#define KMS_RTX_CACHE_RESERVED_PACKETS 64
+
+/* Elements modifying the packet must not keep the meta */
+#define KMS_RTX_CACHE_META_TAG_STR "rtx-cache"
+
+typedef struct _KmsRtxCache KmsRtxCache;
+typedef struct _KmsRtxCacheMeta KmsRtxCacheMeta;
+typedef struct _KmsRtxSender KmsRtxSender;
+
+typedef enum
+{
+  KMS_RTX_CACHE_HIT,
+  KMS_RTX_CACHE_MISS,           /* never stored */
+  KMS_RTX_CACHE_EXPIRED         /* stored, but too old or over budget */
+} KmsRtxCacheResult;
+
+typedef struct _KmsRtxCacheStats
+{
+  guint64 hits;
+  guint64 misses;
+  guint64 expired;
+} KmsRtxCacheStats;
+
+/*
+ * Packets held by every cache in the process share this budget. When it is
+ * exceeded, the cache storing a new packet drops its oldest ones, but it
+ * always keeps its last KMS_RTX_CACHE_RESERVED_PACKETS packets. Those are
+ * not limited by the budget, so that a cache is never drained by the traffic
+ * of the others.
+ */
+void kms_rtx_cache_set_memory_budget (gsize bytes);
+gsize kms_rtx_cache_get_memory_usage (void);
+
+/*
+ * Ring of RTP packets indexed by sequence number. @size is rounded up to a
+ * power of two. Caches are refcounted so that they can be shared by every
+ * sender of the same packets.
+ */
+KmsRtxCache * kms_rtx_cache_new (guint size);
+KmsRtxCache * kms_rtx_cache_ref (KmsRtxCache *cache);
+void kms_rtx_cache_unref (KmsRtxCache *cache);
+
+void kms_rtx_cache_store (KmsRtxCache *cache, GstBuffer *packet);
+/* Drops every packet, later lookups of them are expired */
+void kms_rtx_cache_clear (KmsRtxCache *cache);
+KmsRtxCacheResult kms_rtx_cache_lookup (KmsRtxCache *cache, guint16 seq,
+  GstBuffer **packet);
+void kms_rtx_cache_get_stats (KmsRtxCache *cache, KmsRtxCacheStats *stats);
+
+/**
+ * KmsRtxCacheMeta:
+ * @meta: the parent type
+ * @cache: cache holding the packet this buffer was rewritten from
+ * @seq: sequence number of that packet in @cache
+ *
+ * Lets senders retransmit a rewritten packet without keeping a copy of it.
+ * The meta is never copied along with the packet.
+ */
+struct _KmsRtxCacheMeta {
+  GstMeta meta;
+
+  KmsRtxCache *cache;
+  guint16 seq;
+};
+
+GType kms_rtx_cache_meta_api_get_type (void);
+#define KMS_RTX_CACHE_META_API_TYPE \
+  (kms_rtx_cache_meta_api_get_type())
+
+#define kms_buffer_get_rtx_cache_meta(b) \
+  ((KmsRtxCacheMeta*)gst_buffer_get_meta((b), KMS_RTX_CACHE_META_API_TYPE))
+
+/* implementation */
+const GstMetaInfo *kms_rtx_cache_meta_get_info (void);
+#define KMS_RTX_CACHE_META_INFO (kms_rtx_cache_meta_get_info ())
+
+KmsRtxCacheMeta * kms_buffer_add_rtx_cache_meta (GstBuffer *buffer,
+  KmsRtxCache *cache, guint16 seq);
+
+/*
+ * Sender side: answers the retransmission requests reaching the src pad of
+ * @element, like rtprtxqueue does. Packets going through @element with a
+ * KmsRtxCacheMeta are retransmitted from the shared cache with the header
+ * they were sent with, only the rest of them are kept by the sender, up to
+ * @size packets.
+ */
+KmsRtxSender * kms_rtx_sender_create (GstElement *element, guint size);
+void kms_rtx_sender_destroy (KmsRtxSender *sender);
+void kms_rtx_sender_get_stats (KmsRtxSender *sender,
+  KmsRtxCacheStats *stats);
+
+G_END_DECLS
+#endif /* __KMS_RTX_CACHE_H__ */
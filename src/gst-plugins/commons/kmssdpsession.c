@@ -21,6 +21,7 @@
 
 #include "kmssdpsession.h"
 #include "kmsutils.h"
+#include "sdp_utils.h"
 
 #define GST_DEFAULT_NAME "kmssdpsession"
 #define GST_CAT_DEFAULT kms_sdp_session_debug
@@ -228,6 +229,67 @@ kms_sdp_session_set_addr (KmsSdpSession * self, const gchar * addr)
   g_object_set (self->agent, "addr", addr, NULL);
 }
 
+static gboolean
+kms_sdp_session_equal_media_at (const GstSDPMessage * msg1,
+    const GstSDPMessage * msg2, guint index)
+{
+  if (msg1 == NULL || msg2 == NULL) {
+    return FALSE;
+  }
+
+  if (index >= gst_sdp_message_medias_len (msg1) ||
+      index >= gst_sdp_message_medias_len (msg2)) {
+    return FALSE;
+  }
+
+  return sdp_utils_equal_medias (gst_sdp_message_get_media (msg1, index),
+      gst_sdp_message_get_media (msg2, index));
+}
+
+/*
+ * Returns TRUE if the media at @index was already started with the same
+ * negotiated and remote descriptions, so it does not need to be configured
+ * again.
+ */
+gboolean
+kms_sdp_session_is_media_started (KmsSdpSession * self, guint index)
+{
+  gboolean ret;
+
+  KMS_SDP_SESSION_LOCK (self);
+
+  ret = kms_sdp_session_equal_media_at (self->started_neg_sdp, self->neg_sdp,
+      index) && kms_sdp_session_equal_media_at (self->started_remote_sdp,
+      self->remote_sdp, index);
+
+  KMS_SDP_SESSION_UNLOCK (self);
+
+  return ret;
+}
+
+void
+kms_sdp_session_set_started (KmsSdpSession * self)
+{
+  KMS_SDP_SESSION_LOCK (self);
+
+  if (self->started_neg_sdp != NULL) {
+    gst_sdp_message_free (self->started_neg_sdp);
+    self->started_neg_sdp = NULL;
+  }
+
+  if (self->started_remote_sdp != NULL) {
+    gst_sdp_message_free (self->started_remote_sdp);
+    self->started_remote_sdp = NULL;
+  }
+
+  if (self->neg_sdp != NULL && self->remote_sdp != NULL) {
+    gst_sdp_message_copy (self->neg_sdp, &self->started_neg_sdp);
+    gst_sdp_message_copy (self->remote_sdp, &self->started_remote_sdp);
+  }
+
+  KMS_SDP_SESSION_UNLOCK (self);
+}
+
 static void
 kms_sdp_session_finalize (GObject * object)
 {
@@ -247,6 +309,14 @@ kms_sdp_session_finalize (GObject * object)
     gst_sdp_message_free (self->neg_sdp);
   }
 
+  if (self->started_neg_sdp != NULL) {
+    gst_sdp_message_free (self->started_neg_sdp);
+  }
+
+  if (self->started_remote_sdp != NULL) {
+    gst_sdp_message_free (self->started_remote_sdp);
+  }
+
   g_clear_object (&self->ptmanager);
   g_clear_object (&self->agent);
   g_free (self->id_str);
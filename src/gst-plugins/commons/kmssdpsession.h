@@ -64,6 +64,11 @@ struct _KmsSdpSession
   GstSDPMessage *local_sdp;
   GstSDPMessage *remote_sdp;
   GstSDPMessage *neg_sdp;
+
+  /* Descriptions of the media currently running, used to leave unchanged
+   * medias untouched on renegotiations */
+  GstSDPMessage *started_neg_sdp;
+  GstSDPMessage *started_remote_sdp;
 };
 
 struct _KmsSdpSessionClass
@@ -86,6 +91,8 @@ GstSDPMessage * kms_sdp_session_get_remote_sdp (KmsSdpSession * self);
 void kms_sdp_session_set_use_ipv6 (KmsSdpSession * self, gboolean use_ipv6);
 gboolean kms_sdp_session_get_use_ipv6 (KmsSdpSession * self);
 void kms_sdp_session_set_addr (KmsSdpSession *self, const gchar * addr);
+gboolean kms_sdp_session_is_media_started (KmsSdpSession * self, guint index);
+void kms_sdp_session_set_started (KmsSdpSession * self);
 
 G_END_DECLS
 #endif /* __KMS_SDP_SESSION_H__ */
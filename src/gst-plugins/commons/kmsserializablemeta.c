@@ -17,6 +17,29 @@
 
 #include "kmsserializablemeta.h"
 
+#include <string.h>
+
+#define KMS_SERIALIZABLE_META_FORMAT_VERSION 1
+#define KMS_SERIALIZABLE_META_MAX_DEPTH 16
+
+/* Field types of the binary format */
+#define TAG_BOOLEAN 'b'
+#define TAG_INT 'i'
+#define TAG_UINT 'u'
+#define TAG_INT64 'l'
+#define TAG_UINT64 'L'
+#define TAG_DOUBLE 'd'
+#define TAG_STRING 's'
+#define TAG_STRUCTURE 'S'
+#define TAG_VALUE 'v'
+
+typedef struct _KmsMetaReader
+{
+  const guint8 *data;
+  gsize size;
+  gsize offset;
+} KmsMetaReader;
+
 GType
 kms_serializable_meta_api_get_type (void)
 {
@@ -110,6 +133,22 @@ add_fields_to_structure (GQuark field_id, const GValue * value, gpointer st)
   return TRUE;
 }
 
+static gboolean
+move_fields_to_structure (GQuark field_id, GValue * value, gpointer st)
+{
+  GstStructure *data = GST_STRUCTURE (st);
+  GValue moved;
+
+  /* Source structure is freed afterwards, so values are not copied */
+  moved = *value;
+  memset (value, 0, sizeof (GValue));
+  g_value_init (value, G_TYPE_BOOLEAN);
+
+  gst_structure_id_take_value (data, field_id, &moved);
+
+  return TRUE;
+}
+
 KmsSerializableMeta *
 kms_buffer_add_serializable_meta (GstBuffer * buffer, GstStructure * data)
 {
@@ -120,10 +159,13 @@ kms_buffer_add_serializable_meta (GstBuffer * buffer, GstStructure * data)
   meta = (KmsSerializableMeta *) gst_buffer_get_meta (buffer,
       KMS_SERIALIZABLE_META_API_TYPE);
 
-  if (meta != NULL) {
-    gst_structure_foreach (data, add_fields_to_structure, meta->data);
-    gst_structure_free (data);
-
+  if (meta != NULL && meta->data == NULL) {
+    meta->data = data;
+  } else if (meta != NULL) {
+    if (data != NULL) {
+      gst_structure_map_in_place (data, move_fields_to_structure, meta->data);
+      gst_structure_free (data);
+    }
   } else {
     meta = (KmsSerializableMeta *) gst_buffer_add_meta (buffer,
         KMS_SERIALIZABLE_META_INFO, NULL);
@@ -150,3 +192,437 @@ kms_serializable_meta_get_metadata (GstBuffer * buffer)
 
   return meta->data;
 }
+
+static void
+kms_serializable_meta_write_varint (GByteArray * array, guint64 value)
+{
+  guint8 byte;
+
+  do {
+    byte = value & 0x7f;
+    value >>= 7;
+
+    if (value != 0) {
+      byte |= 0x80;
+    }
+
+    g_byte_array_append (array, &byte, 1);
+  } while (value != 0);
+}
+
+static void
+kms_serializable_meta_write_zigzag (GByteArray * array, gint64 value)
+{
+  kms_serializable_meta_write_varint (array,
+      ((guint64) value << 1) ^ (guint64) (value >> 63));
+}
+
+/* NULL strings are encoded with a zero length */
+static void
+kms_serializable_meta_write_string (GByteArray * array, const gchar * str)
+{
+  gsize len;
+
+  if (str == NULL) {
+    kms_serializable_meta_write_varint (array, 0);
+    return;
+  }
+
+  len = strlen (str);
+  kms_serializable_meta_write_varint (array, len + 1);
+  g_byte_array_append (array, (const guint8 *) str, len);
+}
+
+static gboolean kms_serializable_meta_write_structure (GByteArray * array,
+    const GstStructure * st, guint depth);
+
+static gboolean
+kms_serializable_meta_write_value (GByteArray * array, const GValue * value,
+    guint depth)
+{
+  GType type = G_VALUE_TYPE (value);
+  guint8 tag;
+
+  if (type == G_TYPE_BOOLEAN) {
+    tag = TAG_BOOLEAN;
+    g_byte_array_append (array, &tag, 1);
+    kms_serializable_meta_write_varint (array, g_value_get_boolean (value));
+  } else if (type == G_TYPE_INT) {
+    tag = TAG_INT;
+    g_byte_array_append (array, &tag, 1);
+    kms_serializable_meta_write_zigzag (array, g_value_get_int (value));
+  } else if (type == G_TYPE_UINT) {
+    tag = TAG_UINT;
+    g_byte_array_append (array, &tag, 1);
+    kms_serializable_meta_write_varint (array, g_value_get_uint (value));
+  } else if (type == G_TYPE_INT64) {
+    tag = TAG_INT64;
+    g_byte_array_append (array, &tag, 1);
+    kms_serializable_meta_write_zigzag (array, g_value_get_int64 (value));
+  } else if (type == G_TYPE_UINT64) {
+    tag = TAG_UINT64;
+    g_byte_array_append (array, &tag, 1);
+    kms_serializable_meta_write_varint (array, g_value_get_uint64 (value));
+  } else if (type == G_TYPE_DOUBLE) {
+    gdouble d = g_value_get_double (value);
+    guint64 bits;
+
+    memcpy (&bits, &d, sizeof (bits));
+    bits = GUINT64_TO_LE (bits);
+
+    tag = TAG_DOUBLE;
+    g_byte_array_append (array, &tag, 1);
+    g_byte_array_append (array, (const guint8 *) &bits, sizeof (bits));
+  } else if (type == G_TYPE_STRING) {
+    tag = TAG_STRING;
+    g_byte_array_append (array, &tag, 1);
+    kms_serializable_meta_write_string (array, g_value_get_string (value));
+  } else if (type == GST_TYPE_STRUCTURE && gst_value_get_structure (value)) {
+    tag = TAG_STRUCTURE;
+    g_byte_array_append (array, &tag, 1);
+    return kms_serializable_meta_write_structure (array,
+        gst_value_get_structure (value), depth + 1);
+  } else {
+    gchar *str = gst_value_serialize (value);
+
+    if (str == NULL) {
+      GST_WARNING ("Cannot serialize values of type %s", g_type_name (type));
+      return FALSE;
+    }
+
+    tag = TAG_VALUE;
+    g_byte_array_append (array, &tag, 1);
+    kms_serializable_meta_write_string (array, g_type_name (type));
+    kms_serializable_meta_write_string (array, str);
+    g_free (str);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+kms_serializable_meta_write_structure (GByteArray * array,
+    const GstStructure * st, guint depth)
+{
+  gint i, n;
+
+  if (depth > KMS_SERIALIZABLE_META_MAX_DEPTH) {
+    GST_WARNING ("Too many nested structures");
+    return FALSE;
+  }
+
+  n = gst_structure_n_fields (st);
+
+  kms_serializable_meta_write_string (array, gst_structure_get_name (st));
+  kms_serializable_meta_write_varint (array, n);
+
+  for (i = 0; i < n; i++) {
+    const gchar *name = gst_structure_nth_field_name (st, i);
+
+    kms_serializable_meta_write_string (array, name);
+
+    if (!kms_serializable_meta_write_value (array,
+            gst_structure_get_value (st, name), depth)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+GBytes *
+kms_serializable_meta_serialize (GstBuffer * buffer)
+{
+  GstStructure *data;
+  GByteArray *array;
+  guint8 version = KMS_SERIALIZABLE_META_FORMAT_VERSION;
+
+  data = kms_serializable_meta_get_metadata (buffer);
+
+  if (data == NULL) {
+    return NULL;
+  }
+
+  array = g_byte_array_new ();
+  g_byte_array_append (array, &version, 1);
+
+  if (!kms_serializable_meta_write_structure (array, data, 0)) {
+    g_byte_array_unref (array);
+    return NULL;
+  }
+
+  return g_byte_array_free_to_bytes (array);
+}
+
+static gboolean
+kms_serializable_meta_read_byte (KmsMetaReader * reader, guint8 * byte)
+{
+  if (reader->offset >= reader->size) {
+    return FALSE;
+  }
+
+  *byte = reader->data[reader->offset++];
+
+  return TRUE;
+}
+
+static gboolean
+kms_serializable_meta_read_varint (KmsMetaReader * reader, guint64 * value)
+{
+  guint shift = 0;
+  guint8 byte;
+
+  *value = 0;
+
+  do {
+    if (shift >= 64 || !kms_serializable_meta_read_byte (reader, &byte)) {
+      return FALSE;
+    }
+
+    *value |= (guint64) (byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+
+  return TRUE;
+}
+
+static gboolean
+kms_serializable_meta_read_zigzag (KmsMetaReader * reader, gint64 * value)
+{
+  guint64 v;
+
+  if (!kms_serializable_meta_read_varint (reader, &v)) {
+    return FALSE;
+  }
+
+  *value = (gint64) (v >> 1) ^ -(gint64) (v & 1);
+
+  return TRUE;
+}
+
+static gboolean
+kms_serializable_meta_read_string (KmsMetaReader * reader, gchar ** str)
+{
+  guint64 len;
+
+  if (!kms_serializable_meta_read_varint (reader, &len)) {
+    return FALSE;
+  }
+
+  if (len == 0) {
+    *str = NULL;
+    return TRUE;
+  }
+
+  len--;
+  if (len > reader->size - reader->offset) {
+    return FALSE;
+  }
+
+  *str = g_strndup ((const gchar *) reader->data + reader->offset, len);
+  reader->offset += len;
+
+  return TRUE;
+}
+
+static GstStructure *kms_serializable_meta_read_structure (KmsMetaReader *
+    reader, guint depth);
+
+static gboolean
+kms_serializable_meta_read_value (KmsMetaReader * reader, GValue * value,
+    guint depth)
+{
+  GstStructure *st;
+  guint64 u;
+  gint64 i;
+  gchar *str, *type_name;
+  guint8 tag;
+
+  if (!kms_serializable_meta_read_byte (reader, &tag)) {
+    return FALSE;
+  }
+
+  switch (tag) {
+    case TAG_BOOLEAN:
+      if (!kms_serializable_meta_read_varint (reader, &u)) {
+        return FALSE;
+      }
+      g_value_init (value, G_TYPE_BOOLEAN);
+      g_value_set_boolean (value, u != 0);
+      break;
+    case TAG_INT:
+      if (!kms_serializable_meta_read_zigzag (reader, &i)) {
+        return FALSE;
+      }
+      g_value_init (value, G_TYPE_INT);
+      g_value_set_int (value, (gint) i);
+      break;
+    case TAG_UINT:
+      if (!kms_serializable_meta_read_varint (reader, &u)) {
+        return FALSE;
+      }
+      g_value_init (value, G_TYPE_UINT);
+      g_value_set_uint (value, (guint) u);
+      break;
+    case TAG_INT64:
+      if (!kms_serializable_meta_read_zigzag (reader, &i)) {
+        return FALSE;
+      }
+      g_value_init (value, G_TYPE_INT64);
+      g_value_set_int64 (value, i);
+      break;
+    case TAG_UINT64:
+      if (!kms_serializable_meta_read_varint (reader, &u)) {
+        return FALSE;
+      }
+      g_value_init (value, G_TYPE_UINT64);
+      g_value_set_uint64 (value, u);
+      break;
+    case TAG_DOUBLE:{
+      gdouble d;
+
+      if (reader->size - reader->offset < sizeof (u)) {
+        return FALSE;
+      }
+
+      memcpy (&u, reader->data + reader->offset, sizeof (u));
+      reader->offset += sizeof (u);
+      u = GUINT64_FROM_LE (u);
+      memcpy (&d, &u, sizeof (d));
+
+      g_value_init (value, G_TYPE_DOUBLE);
+      g_value_set_double (value, d);
+      break;
+    }
+    case TAG_STRING:
+      if (!kms_serializable_meta_read_string (reader, &str)) {
+        return FALSE;
+      }
+      g_value_init (value, G_TYPE_STRING);
+      g_value_take_string (value, str);
+      break;
+    case TAG_STRUCTURE:
+      st = kms_serializable_meta_read_structure (reader, depth + 1);
+      if (st == NULL) {
+        return FALSE;
+      }
+      g_value_init (value, GST_TYPE_STRUCTURE);
+      g_value_take_boxed (value, st);
+      break;
+    case TAG_VALUE:{
+      gboolean ret;
+      GType type;
+
+      if (!kms_serializable_meta_read_string (reader, &type_name)) {
+        return FALSE;
+      }
+
+      type = type_name != NULL ? g_type_from_name (type_name) : G_TYPE_INVALID;
+
+      /* g_value_init aborts on types that cannot be instantiated as values */
+      if (type == G_TYPE_INVALID || !G_TYPE_IS_VALUE_TYPE (type) ||
+          G_TYPE_IS_ABSTRACT (type)) {
+        GST_WARNING ("Cannot deserialize values of type %s", type_name);
+        g_free (type_name);
+        return FALSE;
+      }
+
+      g_free (type_name);
+
+      if (!kms_serializable_meta_read_string (reader, &str)) {
+        return FALSE;
+      }
+
+      g_value_init (value, type);
+      ret = str != NULL && gst_value_deserialize (value, str);
+      g_free (str);
+
+      if (!ret) {
+        g_value_unset (value);
+        return FALSE;
+      }
+      break;
+    }
+    default:
+      GST_WARNING ("Unknown field type %c", tag);
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static GstStructure *
+kms_serializable_meta_read_structure (KmsMetaReader * reader, guint depth)
+{
+  GstStructure *st;
+  guint64 n, i;
+  gchar *name;
+
+  if (depth > KMS_SERIALIZABLE_META_MAX_DEPTH) {
+    return NULL;
+  }
+
+  if (!kms_serializable_meta_read_string (reader, &name) || name == NULL) {
+    return NULL;
+  }
+
+  st = gst_structure_new_empty (name);
+  g_free (name);
+
+  if (!kms_serializable_meta_read_varint (reader, &n)) {
+    goto error;
+  }
+
+  for (i = 0; i < n; i++) {
+    GValue value = G_VALUE_INIT;
+
+    if (!kms_serializable_meta_read_string (reader, &name) || name == NULL) {
+      goto error;
+    }
+
+    if (!kms_serializable_meta_read_value (reader, &value, depth)) {
+      g_free (name);
+      goto error;
+    }
+
+    gst_structure_take_value (st, name, &value);
+    g_free (name);
+  }
+
+  return st;
+
+error:
+  gst_structure_free (st);
+
+  return NULL;
+}
+
+KmsSerializableMeta *
+kms_buffer_add_serializable_meta_from_bytes (GstBuffer * buffer,
+    GBytes * bytes)
+{
+  KmsMetaReader reader;
+  GstStructure *data;
+  guint8 version;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (bytes != NULL, NULL);
+
+  reader.data = g_bytes_get_data (bytes, &reader.size);
+  reader.offset = 0;
+
+  if (!kms_serializable_meta_read_byte (&reader, &version) ||
+      version != KMS_SERIALIZABLE_META_FORMAT_VERSION) {
+    GST_WARNING ("Unsupported serializable metadata format");
+    return NULL;
+  }
+
+  data = kms_serializable_meta_read_structure (&reader, 0);
+
+  if (data == NULL) {
+    GST_WARNING ("Malformed serializable metadata");
+    return NULL;
+  }
+
+  return kms_buffer_add_serializable_meta (buffer, data);
+}
@@ -89,6 +89,33 @@ KmsSerializableMeta * kms_buffer_add_serializable_meta (GstBuffer *buffer,
  */
 GstStructure * kms_serializable_meta_get_metadata (GstBuffer *buffer);
 
+/**
+ * kms_serializable_meta_serialize
+ *
+ * Serializes the metadata of a buffer in a compact binary format, cheaper to
+ * produce and to parse than the string representation of the structure.
+ * Fields of types without a binary encoding are stored with
+ * gst_value_serialize().
+ *
+ * @param buffer: the buffer which contains the metadata
+ * @return The serialized metadata or NULL if the buffer has no metadata or
+ * it can not be serialized [transfer full]
+ */
+GBytes * kms_serializable_meta_serialize (GstBuffer *buffer);
+
+/**
+ * kms_buffer_add_serializable_meta_from_bytes
+ *
+ * Parses metadata generated by kms_serializable_meta_serialize() and adds it
+ * to the buffer as kms_buffer_add_serializable_meta() does.
+ *
+ * @param buffer: the buffer where add the metadata
+ * @param bytes: the serialized metadata
+ * @return The metadata inserted in the buffer or NULL if bytes are not valid
+ */
+KmsSerializableMeta * kms_buffer_add_serializable_meta_from_bytes (
+  GstBuffer *buffer, GBytes *bytes);
+
 G_END_DECLS
 
 #endif /* __KMS_SERIALIZABLE_META_H__ */
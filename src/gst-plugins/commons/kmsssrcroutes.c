@@ -0,0 +1,264 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+
+#include "kmsssrcroutes.h"
+
+#define GST_CAT_DEFAULT kms_ssrc_routes_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "kmsssrcroutes"
+
+#define SSRC_ATTR "ssrc"
+#define SSRC_GROUP_ATTR "ssrc-group"
+
+/* KmsSsrcRoutes begin */
+
+struct _KmsSsrcRoutes
+{
+  GHashTable *table;            /* ssrc -> KmsSsrcRoute */
+};
+
+static KmsSsrcRoute *
+kms_ssrc_route_new (gint index, KmsMediaType media, KmsSsrcRole role)
+{
+  KmsSsrcRoute *route = g_slice_new (KmsSsrcRoute);
+
+  route->index = index;
+  route->media = media;
+  route->role = role;
+
+  return route;
+}
+
+static void
+kms_ssrc_route_destroy (KmsSsrcRoute * route)
+{
+  g_slice_free (KmsSsrcRoute, route);
+}
+
+KmsSsrcRoutes *
+kms_ssrc_routes_new (const KmsSsrcRoutes * copy)
+{
+  KmsSsrcRoutes *routes = g_slice_new (KmsSsrcRoutes);
+
+  routes->table = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      (GDestroyNotify) kms_ssrc_route_destroy);
+
+  if (copy != NULL) {
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init (&iter, copy->table);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+      KmsSsrcRoute *route = value;
+
+      g_hash_table_insert (routes->table, key,
+          kms_ssrc_route_new (route->index, route->media, route->role));
+    }
+  }
+
+  return routes;
+}
+
+void
+kms_ssrc_routes_destroy (KmsSsrcRoutes * routes)
+{
+  g_hash_table_unref (routes->table);
+
+  g_slice_free (KmsSsrcRoutes, routes);
+}
+
+void
+kms_ssrc_routes_add (KmsSsrcRoutes * routes, guint32 ssrc, gint index,
+    KmsMediaType media, KmsSsrcRole role)
+{
+  GST_TRACE ("SSRC %" G_GUINT32_FORMAT " routed to m-line %d (role %d)", ssrc,
+      index, role);
+
+  g_hash_table_insert (routes->table, GUINT_TO_POINTER (ssrc),
+      kms_ssrc_route_new (index, media, role));
+}
+
+static gboolean
+kms_ssrc_route_has_index (gpointer key, gpointer value, gpointer user_data)
+{
+  KmsSsrcRoute *route = value;
+
+  return route->index == GPOINTER_TO_INT (user_data);
+}
+
+void
+kms_ssrc_routes_remove_index (KmsSsrcRoutes * routes, gint index)
+{
+  g_hash_table_foreach_remove (routes->table, kms_ssrc_route_has_index,
+      GINT_TO_POINTER (index));
+}
+
+static gboolean
+kms_ssrc_route_is_learnt (gpointer key, gpointer value, gpointer user_data)
+{
+  KmsSsrcRoute *route = value;
+
+  return route->index == KMS_SSRC_ROUTE_NO_INDEX &&
+      route->media == GPOINTER_TO_INT (user_data);
+}
+
+void
+kms_ssrc_routes_remove_learnt (KmsSsrcRoutes * routes, KmsMediaType media)
+{
+  g_hash_table_foreach_remove (routes->table, kms_ssrc_route_is_learnt,
+      GINT_TO_POINTER (media));
+}
+
+const KmsSsrcRoute *
+kms_ssrc_routes_lookup (const KmsSsrcRoutes * routes, guint32 ssrc)
+{
+  return g_hash_table_lookup (routes->table, GUINT_TO_POINTER (ssrc));
+}
+
+guint
+kms_ssrc_routes_size (const KmsSsrcRoutes * routes)
+{
+  return g_hash_table_size (routes->table);
+}
+
+static gboolean
+parse_ssrc (const gchar * str, const gchar ** end, guint32 * ssrc)
+{
+  gchar *endptr;
+  guint64 val;
+
+  if (!g_ascii_isdigit (*str)) {
+    return FALSE;
+  }
+
+  val = g_ascii_strtoull (str, &endptr, 10);
+
+  if (val > G_MAXUINT32) {
+    GST_WARNING ("SSRC '%s' not valid", str);
+    return FALSE;
+  }
+
+  *ssrc = val;
+  *end = endptr;
+
+  return TRUE;
+}
+
+static void
+kms_ssrc_routes_add_group (KmsSsrcRoutes * routes, GHashTable * added,
+    const gchar * group, gint index, KmsMediaType type)
+{
+  KmsSsrcRole role;
+  const gchar *p;
+  gboolean first = TRUE;
+  guint32 ssrc;
+
+  if (g_str_has_prefix (group, "FID ")) {
+    role = KMS_SSRC_ROLE_RTX;
+  } else if (g_str_has_prefix (group, "FEC-FR ") ||
+      g_str_has_prefix (group, "FEC ")) {
+    role = KMS_SSRC_ROLE_FEC;
+  } else {
+    /* SIM and other semantics only group media SSRCs */
+    role = KMS_SSRC_ROLE_MEDIA;
+  }
+
+  p = strchr (group, ' ');
+
+  while (p != NULL) {
+    gboolean known;
+
+    while (*p == ' ') {
+      p++;
+    }
+
+    if (!parse_ssrc (p, &p, &ssrc)) {
+      break;
+    }
+
+    known = g_hash_table_contains (added, GUINT_TO_POINTER (ssrc));
+
+    /* First SSRC of a group is the one being repaired. Repair roles take
+     * precedence over the media role given by other groups */
+    if (!first && role != KMS_SSRC_ROLE_MEDIA) {
+      kms_ssrc_routes_add (routes, ssrc, index, type, role);
+    } else if (!known) {
+      kms_ssrc_routes_add (routes, ssrc, index, type, KMS_SSRC_ROLE_MEDIA);
+    }
+
+    g_hash_table_add (added, GUINT_TO_POINTER (ssrc));
+    first = FALSE;
+  }
+}
+
+guint
+kms_ssrc_routes_add_media (KmsSsrcRoutes * routes, const GstSDPMedia * media,
+    gint index, KmsMediaType type)
+{
+  GHashTable *added;
+  guint i, len, n;
+
+  added = g_hash_table_new (g_direct_hash, g_direct_equal);
+  len = gst_sdp_media_attributes_len (media);
+
+  /* Groups go first so that roles are kept wherever they appear */
+  for (i = 0; i < len; i++) {
+    const GstSDPAttribute *attr = gst_sdp_media_get_attribute (media, i);
+
+    if (attr->value != NULL && g_strcmp0 (attr->key, SSRC_GROUP_ATTR) == 0) {
+      kms_ssrc_routes_add_group (routes, added, attr->value, index, type);
+    }
+  }
+
+  for (i = 0; i < len; i++) {
+    const GstSDPAttribute *attr = gst_sdp_media_get_attribute (media, i);
+    const gchar *end;
+    guint32 ssrc;
+
+    if (attr->value == NULL || g_strcmp0 (attr->key, SSRC_ATTR) != 0) {
+      continue;
+    }
+
+    if (!parse_ssrc (attr->value, &end, &ssrc)) {
+      GST_WARNING ("Invalid ssrc attribute '%s'", attr->value);
+      continue;
+    }
+
+    if (!g_hash_table_contains (added, GUINT_TO_POINTER (ssrc))) {
+      kms_ssrc_routes_add (routes, ssrc, index, type, KMS_SSRC_ROLE_MEDIA);
+      g_hash_table_add (added, GUINT_TO_POINTER (ssrc));
+    }
+  }
+
+  n = g_hash_table_size (added);
+  g_hash_table_unref (added);
+
+  return n;
+}
+
+/* KmsSsrcRoutes end */
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
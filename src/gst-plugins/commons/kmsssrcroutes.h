@@ -0,0 +1,74 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_SSRC_ROUTES_H__
+#define __KMS_SSRC_ROUTES_H__
+
+#include <gst/gst.h>
+#include <gst/sdp/gstsdpmessage.h>
+#include "kmsmediatype.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  KMS_SSRC_ROLE_MEDIA,
+  KMS_SSRC_ROLE_RTX,
+  KMS_SSRC_ROLE_FEC
+} KmsSsrcRole;
+
+/* Index of routes not bound to an m-line, e.g. learnt from RTCP. They are
+ * dropped with kms_ssrc_routes_remove_learnt */
+#define KMS_SSRC_ROUTE_NO_INDEX -1
+
+typedef struct _KmsSsrcRoute
+{
+  gint index;                   /* m-line */
+  KmsMediaType media;
+  KmsSsrcRole role;
+} KmsSsrcRoute;
+
+/* KmsSsrcRoutes begin */
+typedef struct _KmsSsrcRoutes KmsSsrcRoutes;
+
+/*
+ * SSRC to m-line table. Lookups are O(1) regardless of the number of
+ * m-lines, simulcast layers or repair streams sharing a bundle. It is not
+ * thread safe: sessions access it under their own lock, which they already
+ * hold to link the pads of each new SSRC.
+ */
+KmsSsrcRoutes * kms_ssrc_routes_new (const KmsSsrcRoutes *copy);
+void kms_ssrc_routes_destroy (KmsSsrcRoutes *routes);
+void kms_ssrc_routes_add (KmsSsrcRoutes *routes, guint32 ssrc, gint index,
+  KmsMediaType media, KmsSsrcRole role);
+void kms_ssrc_routes_remove_index (KmsSsrcRoutes *routes, gint index);
+void kms_ssrc_routes_remove_learnt (KmsSsrcRoutes *routes, KmsMediaType media);
+const KmsSsrcRoute * kms_ssrc_routes_lookup (const KmsSsrcRoutes *routes,
+  guint32 ssrc);
+guint kms_ssrc_routes_size (const KmsSsrcRoutes *routes);
+
+/*
+ * Adds the SSRCs announced in @media (a=ssrc and a=ssrc-group). SSRCs
+ * following the first one in FID groups are RTX, and in FEC-FR or FEC groups
+ * they are FEC. Returns the number of SSRCs added.
+ */
+guint kms_ssrc_routes_add_media (KmsSsrcRoutes *routes,
+  const GstSDPMedia *media, gint index, KmsMediaType type);
+/* KmsSsrcRoutes end */
+
+G_END_DECLS
+#endif /* __KMS_SSRC_ROUTES_H__ */
@@ -0,0 +1,222 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsssrcstats.h"
+
+#define GST_CAT_DEFAULT kms_ssrc_stats_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "kmsssrcstats"
+
+typedef enum
+{
+  SLOT_FREE,
+  SLOT_CLAIMED,                 /* being initialized */
+  SLOT_READY
+} SlotState;
+
+struct _KmsSsrcStats
+{
+  volatile gint state;
+  /* Jitter buffers counting on the slot, it is freed with the last one */
+  volatile gint users;
+
+  /* Immutable once the slot is ready */
+  guint session;
+  guint32 ssrc;
+
+  /* Pointer sized so that they are 64 bits wide on 64 bits platforms */
+  volatile gssize packets;
+  volatile gssize octets;
+  volatile gint lost;
+  volatile gint latency;
+};
+
+struct _KmsSsrcStatsTable
+{
+  KmsSsrcStats slots[KMS_SSRC_STATS_MAX_SOURCES];
+};
+
+static void
+kms_ssrc_stats_reset (KmsSsrcStats * stats)
+{
+  g_atomic_pointer_set (&stats->packets, 0);
+  g_atomic_pointer_set (&stats->octets, 0);
+  g_atomic_int_set (&stats->lost, 0);
+  g_atomic_int_set (&stats->latency, 0);
+}
+
+KmsSsrcStatsTable *
+kms_ssrc_stats_table_new (void)
+{
+  return g_slice_new0 (KmsSsrcStatsTable);
+}
+
+void
+kms_ssrc_stats_table_destroy (KmsSsrcStatsTable * table)
+{
+  g_slice_free (KmsSsrcStatsTable, table);
+}
+
+static KmsSsrcStats *
+kms_ssrc_stats_table_find (KmsSsrcStatsTable * table, guint session,
+    guint32 ssrc)
+{
+  guint i;
+
+  /* Released slots leave holes, so all of them are checked */
+  for (i = 0; i < KMS_SSRC_STATS_MAX_SOURCES; i++) {
+    KmsSsrcStats *stats = &table->slots[i];
+    gint state = g_atomic_int_get (&stats->state);
+
+    if (state == SLOT_READY && stats->session == session
+        && stats->ssrc == ssrc) {
+      return stats;
+    }
+  }
+
+  return NULL;
+}
+
+/* Takes a user on a ready slot, unless its last user just released it */
+static gboolean
+kms_ssrc_stats_use (KmsSsrcStats * stats, guint session, guint32 ssrc)
+{
+  gint users;
+
+  do {
+    users = g_atomic_int_get (&stats->users);
+    if (users == 0) {
+      return FALSE;
+    }
+  } while (!g_atomic_int_compare_and_exchange (&stats->users, users,
+          users + 1));
+
+  if (g_atomic_int_get (&stats->state) == SLOT_READY &&
+      stats->session == session && stats->ssrc == ssrc) {
+    return TRUE;
+  }
+
+  /* The slot was claimed again for another source meanwhile */
+  kms_ssrc_stats_release (stats);
+
+  return FALSE;
+}
+
+KmsSsrcStats *
+kms_ssrc_stats_table_add (KmsSsrcStatsTable * table, guint session,
+    guint32 ssrc)
+{
+  KmsSsrcStats *stats;
+  guint i;
+
+  stats = kms_ssrc_stats_table_find (table, session, ssrc);
+  if (stats != NULL && kms_ssrc_stats_use (stats, session, ssrc)) {
+    GST_DEBUG ("SSRC %" G_GUINT32_FORMAT " in session %u added again", ssrc,
+        session);
+    kms_ssrc_stats_reset (stats);
+    return stats;
+  }
+
+  for (i = 0; i < KMS_SSRC_STATS_MAX_SOURCES; i++) {
+    stats = &table->slots[i];
+
+    if (!g_atomic_int_compare_and_exchange (&stats->state, SLOT_FREE,
+            SLOT_CLAIMED)) {
+      continue;
+    }
+
+    stats->session = session;
+    stats->ssrc = ssrc;
+    g_atomic_int_set (&stats->users, 1);
+    kms_ssrc_stats_reset (stats);
+
+    /* Publish the slot once it is initialized */
+    g_atomic_int_set (&stats->state, SLOT_READY);
+
+    return stats;
+  }
+
+  GST_WARNING ("No stats available for SSRC %" G_GUINT32_FORMAT
+      " in session %u, more than %u sources", ssrc, session,
+      KMS_SSRC_STATS_MAX_SOURCES);
+
+  return NULL;
+}
+
+gboolean
+kms_ssrc_stats_table_lookup (KmsSsrcStatsTable * table, guint session,
+    guint32 ssrc, KmsSsrcStatsSnapshot * snapshot)
+{
+  KmsSsrcStats *stats;
+
+  stats = kms_ssrc_stats_table_find (table, session, ssrc);
+  if (stats == NULL) {
+    return FALSE;
+  }
+
+  snapshot->session = stats->session;
+  snapshot->ssrc = stats->ssrc;
+  snapshot->packets = (gsize) g_atomic_pointer_get (&stats->packets);
+  snapshot->octets = (gsize) g_atomic_pointer_get (&stats->octets);
+  snapshot->lost = g_atomic_int_get (&stats->lost);
+  snapshot->latency = g_atomic_int_get (&stats->latency);
+
+  /* The slot may have been released and claimed again meanwhile */
+  return g_atomic_int_get (&stats->state) == SLOT_READY &&
+      stats->session == session && stats->ssrc == ssrc;
+}
+
+void
+kms_ssrc_stats_release (KmsSsrcStats * stats)
+{
+  if (!g_atomic_int_dec_and_test (&stats->users)) {
+    return;
+  }
+
+  GST_DEBUG ("Releasing stats of SSRC %" G_GUINT32_FORMAT " in session %u",
+      stats->ssrc, stats->session);
+
+  g_atomic_int_set (&stats->state, SLOT_FREE);
+}
+
+void
+kms_ssrc_stats_add_packets (KmsSsrcStats * stats, guint packets, gsize octets)
+{
+  g_atomic_pointer_add (&stats->packets, packets);
+  g_atomic_pointer_add (&stats->octets, octets);
+}
+
+void
+kms_ssrc_stats_add_lost (KmsSsrcStats * stats, guint lost)
+{
+  g_atomic_int_add (&stats->lost, lost);
+}
+
+void
+kms_ssrc_stats_set_latency (KmsSsrcStats * stats, guint latency)
+{
+  g_atomic_int_set (&stats->latency, latency);
+}
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
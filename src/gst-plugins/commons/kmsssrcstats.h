@@ -0,0 +1,68 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_SSRC_STATS_H__
+#define __KMS_SSRC_STATS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Remote SSRCs counted per endpoint */
+#define KMS_SSRC_STATS_MAX_SOURCES 64
+
+typedef struct _KmsSsrcStats KmsSsrcStats;
+typedef struct _KmsSsrcStatsTable KmsSsrcStatsTable;
+
+typedef struct _KmsSsrcStatsSnapshot
+{
+  guint session;
+  guint32 ssrc;
+  guint64 packets;
+  guint64 octets;
+  guint lost;
+  guint latency;
+} KmsSsrcStatsSnapshot;
+
+/*
+ * Counters of the packets received from each remote SSRC. Slots are
+ * preallocated: they are claimed and updated with atomic operations, so
+ * neither streaming threads nor stats requests take any lock. A slot is
+ * freed for another SSRC once all its users have released it.
+ */
+KmsSsrcStatsTable * kms_ssrc_stats_table_new (void);
+void kms_ssrc_stats_table_destroy (KmsSsrcStatsTable *table);
+
+/*
+ * Returns the counters of @ssrc in @session, claiming a new slot if needed.
+ * Counters are reset when an already known SSRC is added again. Returns NULL
+ * if there are no free slots. Each successful call must be paired with a
+ * kms_ssrc_stats_release() once the counters are no longer updated.
+ */
+KmsSsrcStats * kms_ssrc_stats_table_add (KmsSsrcStatsTable *table,
+  guint session, guint32 ssrc);
+void kms_ssrc_stats_release (KmsSsrcStats *stats);
+gboolean kms_ssrc_stats_table_lookup (KmsSsrcStatsTable *table, guint session,
+  guint32 ssrc, KmsSsrcStatsSnapshot *snapshot);
+
+void kms_ssrc_stats_add_packets (KmsSsrcStats *stats, guint packets,
+  gsize octets);
+void kms_ssrc_stats_add_lost (KmsSsrcStats *stats, guint lost);
+void kms_ssrc_stats_set_latency (KmsSsrcStats *stats, guint latency);
+
+G_END_DECLS
+#endif /* __KMS_SSRC_STATS_H__ */
@@ -0,0 +1,813 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+#include "kmstwcc.h"
+#include "kmsrtcp.h"
+#include "kmsutils.h"
+#include "constants.h"
+
+#define GST_CAT_DEFAULT kms_twcc_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "kmstwcc"
+
+#define TWCC_MIN 30000          /* bps */
+
+/* Number of tracked sequence numbers, must be a power of 2 */
+#define TWCC_WINDOW_SIZE 1024
+#define TWCC_WINDOW_MASK (TWCC_WINDOW_SIZE - 1)
+
+/* Keep feedback small enough to fit in a compound RTCP packet */
+#define TWCC_MAX_REPORT_PACKETS 256
+
+/* Worst case RTPFB packet: all deltas large, chunks of 7 symbols */
+#define TWCC_MAX_REPORT_SIZE \
+  (12 + 8 + 2 * ((TWCC_MAX_REPORT_PACKETS + 6) / 7) + \
+  2 * TWCC_MAX_REPORT_PACKETS)
+
+/* Feedback built on window overflow waiting for the next RTCP packet */
+#define TWCC_MAX_QUEUED_REPORTS 32
+
+/* Early RTCP is requested this often while packets are being received */
+#define TWCC_FEEDBACK_INTERVAL (50 * GST_MSECOND)
+#define TWCC_FEEDBACK_MAX_DELAY (10 * GST_MSECOND)
+
+#define TWCC_DELTAS_PER_REFERENCE \
+  (KMS_RTCP_TWCC_REFERENCE_TIME_UNIT / KMS_RTCP_TWCC_DELTA_UNIT)
+
+/* KmsTwccLocal begin */
+
+struct _KmsTwccLocal
+{
+  GObject *rtpsess;
+  GstPad *pad;
+  gulong probe_id;
+  gulong signal_id;
+  guint8 ext_id;
+
+  GMutex mutex;
+  GstClockTime arrivals[TWCC_WINDOW_SIZE];
+  gboolean started;
+  guint16 next_seq;             /* First sequence number not reported yet */
+  guint16 max_seq;
+  guint32 media_ssrc;
+  guint8 fb_pkt_count;
+  GQueue *reports;              /* Already built, pending to be sent */
+  GstClockTime last_request;
+};
+
+static void
+kms_twcc_local_clear_window (KmsTwccLocal * tl)
+{
+  guint i;
+
+  for (i = 0; i < TWCC_WINDOW_SIZE; i++) {
+    tl->arrivals[i] = GST_CLOCK_TIME_NONE;
+  }
+}
+
+static void
+kms_twcc_local_report_free (KmsRTCPTWCCPacket * twcc_packet)
+{
+  g_slice_free (KmsRTCPTWCCPacket, twcc_packet);
+}
+
+/*
+ * Builds feedback for the oldest pending packets and removes them from the
+ * window. Packets never received before the first arrival are skipped.
+ */
+static gboolean
+kms_twcc_local_build_feedback (KmsTwccLocal * tl,
+    KmsRTCPTWCCPacket * twcc_packet)
+{
+  GstClockTime first = GST_CLOCK_TIME_NONE;
+  guint count = 0, i;
+  gint64 prev;
+
+  while (!GST_CLOCK_TIME_IS_VALID (first)) {
+    if (!tl->started || (gint16) (tl->max_seq - tl->next_seq) < 0) {
+      /* Nothing pending */
+      return FALSE;
+    }
+
+    count = (guint16) (tl->max_seq - tl->next_seq) + 1;
+    count = MIN (count, TWCC_MAX_REPORT_PACKETS);
+
+    for (i = 0; i < count && !GST_CLOCK_TIME_IS_VALID (first); i++) {
+      first = tl->arrivals[(guint16) (tl->next_seq + i) & TWCC_WINDOW_MASK];
+    }
+
+    if (!GST_CLOCK_TIME_IS_VALID (first)) {
+      tl->next_seq += count;
+    }
+  }
+
+  twcc_packet->base_seq = tl->next_seq;
+  twcc_packet->reference_time = first / KMS_RTCP_TWCC_REFERENCE_TIME_UNIT;
+  twcc_packet->fb_pkt_count = tl->fb_pkt_count;
+
+  prev = (gint64) twcc_packet->reference_time * TWCC_DELTAS_PER_REFERENCE;
+
+  for (i = 0; i < count; i++) {
+    GstClockTime arrival;
+    gint64 units, delta;
+
+    arrival = tl->arrivals[(guint16) (tl->next_seq + i) & TWCC_WINDOW_MASK];
+
+    if (!GST_CLOCK_TIME_IS_VALID (arrival)) {
+      twcc_packet->status[i] = KMS_RTCP_TWCC_STATUS_NOT_RECEIVED;
+      twcc_packet->deltas[i] = 0;
+      continue;
+    }
+
+    units = arrival / KMS_RTCP_TWCC_DELTA_UNIT;
+    delta = units - prev;
+
+    if (delta >= 0 && delta <= G_MAXUINT8) {
+      twcc_packet->status[i] = KMS_RTCP_TWCC_STATUS_SMALL_DELTA;
+    } else if (delta >= G_MININT16 && delta <= G_MAXINT16) {
+      twcc_packet->status[i] = KMS_RTCP_TWCC_STATUS_LARGE_DELTA;
+    } else {
+      /* Not representable, it will be reported in the next feedback */
+      break;
+    }
+
+    twcc_packet->deltas[i] = delta;
+    prev = units;
+  }
+
+  twcc_packet->status_count = i;
+
+  for (i = 0; i < twcc_packet->status_count; i++) {
+    tl->arrivals[(guint16) (tl->next_seq + i) & TWCC_WINDOW_MASK] =
+        GST_CLOCK_TIME_NONE;
+  }
+
+  tl->next_seq += twcc_packet->status_count;
+  tl->fb_pkt_count++;
+
+  return TRUE;
+}
+
+/*
+ * Moves the oldest pending packets out of the window into a report queued
+ * for the next RTCP packet, so they are not lost when the window is full.
+ */
+static gboolean
+kms_twcc_local_queue_feedback (KmsTwccLocal * tl)
+{
+  KmsRTCPTWCCPacket *twcc_packet = g_slice_new (KmsRTCPTWCCPacket);
+
+  if (!kms_twcc_local_build_feedback (tl, twcc_packet)) {
+    kms_twcc_local_report_free (twcc_packet);
+    return FALSE;
+  }
+
+  if (g_queue_get_length (tl->reports) >= TWCC_MAX_QUEUED_REPORTS) {
+    GST_WARNING_OBJECT (tl->pad, "RTCP is not being sent, dropping feedback");
+    kms_twcc_local_report_free (g_queue_pop_head (tl->reports));
+  }
+
+  g_queue_push_tail (tl->reports, twcc_packet);
+
+  return TRUE;
+}
+
+static gboolean
+kms_twcc_local_packet_received (KmsTwccLocal * tl, guint16 seq, guint32 ssrc,
+    GstClockTime now)
+{
+  gboolean request = FALSE;
+  gint16 diff;
+
+  g_mutex_lock (&tl->mutex);
+
+  if (!tl->started) {
+    kms_twcc_local_clear_window (tl);
+    tl->next_seq = seq;
+    tl->max_seq = seq;
+    tl->started = TRUE;
+  }
+
+  diff = (gint16) (seq - tl->next_seq);
+  if (diff < 0) {
+    GST_TRACE_OBJECT (tl->pad, "Packet %" G_GUINT16_FORMAT
+        " already reported", seq);
+    goto end;
+  }
+
+  while (diff >= TWCC_WINDOW_SIZE && kms_twcc_local_queue_feedback (tl)) {
+    diff = (gint16) (seq - tl->next_seq);
+  }
+
+  if (diff >= TWCC_WINDOW_SIZE) {
+    GST_DEBUG_OBJECT (tl->pad, "Sequence number jump (%" G_GUINT16_FORMAT
+        " -> %" G_GUINT16_FORMAT ")", tl->next_seq, seq);
+    kms_twcc_local_clear_window (tl);
+    tl->next_seq = seq;
+    tl->max_seq = seq;
+  }
+
+  tl->arrivals[seq & TWCC_WINDOW_MASK] = now;
+  tl->media_ssrc = ssrc;
+
+  if ((gint16) (seq - tl->max_seq) > 0) {
+    tl->max_seq = seq;
+  }
+
+  /* Do not wait for the regular RTCP interval to report them */
+  if (!GST_CLOCK_TIME_IS_VALID (tl->last_request)
+      || now - tl->last_request >= TWCC_FEEDBACK_INTERVAL) {
+    tl->last_request = now;
+    request = TRUE;
+  }
+
+end:
+  g_mutex_unlock (&tl->mutex);
+
+  return request;
+}
+
+static void
+kms_twcc_local_process_buffer (KmsTwccLocal * tl, GstBuffer * buffer,
+    GstClockTime now)
+{
+  GstRTPBuffer rtp = { NULL, };
+  gboolean request = FALSE;
+  gpointer data;
+  guint size;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    GST_WARNING_OBJECT (tl->pad, "Can not map RTP buffer");
+    return;
+  }
+
+  if (gst_rtp_buffer_get_extension_onebyte_header (&rtp, tl->ext_id, 0, &data,
+          &size) && size >= RTP_HDR_EXT_TRANSPORT_CC_SIZE) {
+    request = kms_twcc_local_packet_received (tl, GST_READ_UINT16_BE (data),
+        gst_rtp_buffer_get_ssrc (&rtp), now);
+  }
+
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (request) {
+    g_signal_emit_by_name (tl->rtpsess, "send-rtcp",
+        (guint64) TWCC_FEEDBACK_MAX_DELAY);
+  }
+}
+
+typedef struct _ProcessListData
+{
+  KmsTwccLocal *tl;
+  GstClockTime now;
+} ProcessListData;
+
+static gboolean
+kms_twcc_local_process_list_item (GstBuffer ** buf, guint idx,
+    ProcessListData * data)
+{
+  kms_twcc_local_process_buffer (data->tl, *buf, data->now);
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+kms_twcc_local_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  KmsTwccLocal *tl = user_data;
+  GstClockTime now = kms_utils_get_time_nsecs ();
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    kms_twcc_local_process_buffer (tl, GST_PAD_PROBE_INFO_BUFFER (info), now);
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    ProcessListData data;
+
+    data.tl = tl;
+    data.now = now;
+    gst_buffer_list_foreach (GST_PAD_PROBE_INFO_BUFFER_LIST (info),
+        (GstBufferListFunc) kms_twcc_local_process_list_item, &data);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static KmsRTCPTWCCPacket *
+kms_twcc_local_next_report (KmsTwccLocal * tl)
+{
+  KmsRTCPTWCCPacket *twcc_packet;
+
+  twcc_packet = g_queue_pop_head (tl->reports);
+  if (twcc_packet != NULL) {
+    return twcc_packet;
+  }
+
+  twcc_packet = g_slice_new (KmsRTCPTWCCPacket);
+  if (!kms_twcc_local_build_feedback (tl, twcc_packet)) {
+    kms_twcc_local_report_free (twcc_packet);
+    return NULL;
+  }
+
+  return twcc_packet;
+}
+
+static gboolean
+kms_twcc_local_on_sending_rtcp (GObject * sess, GstBuffer * buffer,
+    gboolean is_early, KmsTwccLocal * tl)
+{
+  KmsRTCPTWCCPacket *twcc_packet;
+  GstRTCPBuffer rtcp = { NULL, };
+  GstRTCPPacket packet;
+  gboolean added = FALSE;
+  guint sender_ssrc;
+
+  g_object_get (sess, "internal-ssrc", &sender_ssrc, NULL);
+
+  if (!gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &rtcp)) {
+    GST_WARNING_OBJECT (sess, "Cannot map buffer to RTCP");
+    return FALSE;
+  }
+
+  g_mutex_lock (&tl->mutex);
+
+  /* Add as many reports as they fit until nothing is pending */
+  while (rtcp.map.maxsize - rtcp.map.size >= TWCC_MAX_REPORT_SIZE) {
+    twcc_packet = kms_twcc_local_next_report (tl);
+    if (twcc_packet == NULL) {
+      break;
+    }
+
+    if (!gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_RTPFB, &packet)) {
+      GST_WARNING_OBJECT (sess, "Cannot add RTCP packet");
+      g_queue_push_head (tl->reports, twcc_packet);
+      break;
+    }
+
+    if (!kms_rtcp_twcc_marshall_packet (&packet, twcc_packet, sender_ssrc,
+            tl->media_ssrc)) {
+      gst_rtcp_packet_remove (&packet);
+      g_queue_push_head (tl->reports, twcc_packet);
+      break;
+    }
+
+    GST_TRACE_OBJECT (sess, "Sending TWCC feedback (base: %"
+        G_GUINT16_FORMAT ", count: %" G_GUINT16_FORMAT ")",
+        twcc_packet->base_seq, twcc_packet->status_count);
+
+    kms_twcc_local_report_free (twcc_packet);
+    added = TRUE;
+  }
+
+  g_mutex_unlock (&tl->mutex);
+
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  return added;
+}
+
+void
+kms_twcc_local_destroy (KmsTwccLocal * tl)
+{
+  if (tl == NULL) {
+    return;
+  }
+
+  g_signal_handler_disconnect (tl->rtpsess, tl->signal_id);
+  gst_pad_remove_probe (tl->pad, tl->probe_id);
+
+  g_queue_free_full (tl->reports, (GDestroyNotify) kms_twcc_local_report_free);
+  g_clear_object (&tl->rtpsess);
+  g_clear_object (&tl->pad);
+  g_mutex_clear (&tl->mutex);
+
+  g_slice_free (KmsTwccLocal, tl);
+}
+
+KmsTwccLocal *
+kms_twcc_local_create (GObject * rtpsess, GstPad * pad, guint8 ext_id)
+{
+  KmsTwccLocal *tl = g_slice_new0 (KmsTwccLocal);
+
+  tl->rtpsess = g_object_ref (rtpsess);
+  tl->pad = g_object_ref (pad);
+  tl->ext_id = ext_id;
+  tl->reports = g_queue_new ();
+  tl->last_request = GST_CLOCK_TIME_NONE;
+  g_mutex_init (&tl->mutex);
+
+  tl->signal_id = g_signal_connect (rtpsess, "on-sending-rtcp",
+      G_CALLBACK (kms_twcc_local_on_sending_rtcp), tl);
+  tl->probe_id = gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      kms_twcc_local_probe, tl, NULL);
+
+  return tl;
+}
+
+/* KmsTwccLocal end */
+
+/* KmsTwccRemote begin */
+
+#define DEFAULT_TWCC_ON_CONNECT 300000  /* bps */
+#define DEFAULT_TWCC_OVERUSE_THRESHOLD 10.0     /* ms */
+#define DEFAULT_TWCC_DECREASE_FACTOR 0.85
+#define DEFAULT_TWCC_INCREASE_FACTOR 0.08       /* per second */
+#define DEFAULT_TWCC_SMOOTHING_FACTOR 0.6
+
+#define TWCC_DECREASE_INTERVAL (300 * GST_MSECOND)
+#define TWCC_MIN_ACKED_INTERVAL (50 * GST_MSECOND)
+#define TWCC_MAX_ACKED_FACTOR 1.5
+#define TWCC_ACKED_HEADROOM 10000       /* bps */
+#define TWCC_HIGH_LOSSES 0.1
+
+typedef enum
+{
+  TWCC_USAGE_NORMAL,
+  TWCC_USAGE_OVERUSE,
+  TWCC_USAGE_UNDERUSE,
+} KmsTwccUsage;
+
+typedef struct _KmsTwccSentPacket
+{
+  guint16 seq;
+  gboolean valid;
+  GstClockTime send_time;
+  guint size;
+} KmsTwccSentPacket;
+
+struct _KmsTwccRemote
+{
+  GObject *rtpsess;
+  gulong signal_id;
+  GstPad *pad_event;
+
+  guint local_ssrc;
+  guint min_bw;
+  guint max_bw;
+
+  gint twcc_on_connect;
+  gfloat overuse_threshold;
+  gfloat decrease_factor;
+  gfloat increase_factor;
+
+  GMutex mutex;
+  KmsTwccSentPacket history[TWCC_WINDOW_SIZE];
+
+  gdouble delay_trend;          /* ms */
+  KmsTwccUsage usage;
+  guint acked_bitrate;
+  gint target;                  /* atomic */
+  GstClockTime last_update;
+  GstClockTime last_decrease;
+};
+
+static guint
+kms_twcc_remote_clamp (KmsTwccRemote * tr, guint bitrate)
+{
+  if (tr->min_bw > 0) {
+    bitrate = MAX (bitrate, tr->min_bw * 1000);
+  }
+
+  if (tr->max_bw > 0) {
+    bitrate = MIN (bitrate, tr->max_bw * 1000);
+  }
+
+  return MAX (bitrate, TWCC_MIN);
+}
+
+static void
+send_twcc_event (KmsTwccRemote * tr, guint bitrate)
+{
+  GstEvent *event;
+
+  if (tr->pad_event == NULL) {
+    return;
+  }
+
+  GST_TRACE_OBJECT (tr->rtpsess, "Target bitrate: %" G_GUINT32_FORMAT
+      ", ssrc: %" G_GUINT32_FORMAT, bitrate, tr->local_ssrc);
+
+  event = kms_utils_remb_event_upstream_new (bitrate, tr->local_ssrc);
+  gst_pad_push_event (tr->pad_event, event);
+}
+
+static GstPadProbeReturn
+send_twcc_event_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsTwccRemote *tr = user_data;
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CAPS) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  send_twcc_event (tr, g_atomic_int_get (&tr->target));
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+static guint
+kms_twcc_remote_update_target (KmsTwccRemote * tr, gdouble loss_fraction)
+{
+  GstClockTime now = kms_utils_get_time_nsecs ();
+  gdouble target = g_atomic_int_get (&tr->target);
+
+  switch (tr->usage) {
+    case TWCC_USAGE_OVERUSE:
+      if (!GST_CLOCK_TIME_IS_VALID (tr->last_decrease)
+          || now - tr->last_decrease >= TWCC_DECREASE_INTERVAL) {
+        if (tr->acked_bitrate > 0) {
+          target = MIN (target, tr->acked_bitrate);
+        }
+
+        target *= tr->decrease_factor;
+        tr->last_decrease = now;
+      }
+      break;
+    case TWCC_USAGE_NORMAL:
+      if (GST_CLOCK_TIME_IS_VALID (tr->last_update)) {
+        GstClockTime elapsed = MIN (now - tr->last_update, GST_SECOND);
+
+        target += target * tr->increase_factor * elapsed / GST_SECOND;
+      }
+
+      if (tr->acked_bitrate > 0) {
+        target = MIN (target, TWCC_MAX_ACKED_FACTOR * tr->acked_bitrate +
+            TWCC_ACKED_HEADROOM);
+      }
+      break;
+    case TWCC_USAGE_UNDERUSE:
+    default:
+      /* Hold until queues are drained */
+      break;
+  }
+
+  if (loss_fraction > TWCC_HIGH_LOSSES) {
+    target *= 1.0 - 0.5 * loss_fraction;
+  }
+
+  tr->last_update = now;
+
+  return kms_twcc_remote_clamp (tr, target);
+}
+
+static void
+kms_twcc_remote_update (KmsTwccRemote * tr, KmsRTCPTWCCPacket * twcc_packet)
+{
+  GstClockTime first_send = 0, last_send = 0;
+  gint64 arrival, first_arrival = 0, last_arrival = 0, arrival_span;
+  guint64 acked_bytes = 0;
+  guint acked = 0, lost = 0, i, target;
+  gdouble delay_gradient, loss_fraction;
+
+  arrival =
+      (gint64) twcc_packet->reference_time * KMS_RTCP_TWCC_REFERENCE_TIME_UNIT;
+
+  g_mutex_lock (&tr->mutex);
+
+  for (i = 0; i < twcc_packet->status_count; i++) {
+    guint16 seq = twcc_packet->base_seq + i;
+    KmsTwccSentPacket *sent = &tr->history[seq & TWCC_WINDOW_MASK];
+    gboolean known = sent->valid && sent->seq == seq;
+
+    if (twcc_packet->status[i] == KMS_RTCP_TWCC_STATUS_NOT_RECEIVED) {
+      lost += known ? 1 : 0;
+      continue;
+    }
+
+    arrival += (gint64) twcc_packet->deltas[i] * KMS_RTCP_TWCC_DELTA_UNIT;
+
+    if (!known) {
+      continue;
+    }
+
+    if (acked == 0) {
+      first_arrival = arrival;
+      first_send = sent->send_time;
+    }
+
+    last_arrival = arrival;
+    last_send = sent->send_time;
+    acked_bytes += sent->size;
+    acked++;
+    sent->valid = FALSE;
+  }
+
+  if (acked < 2) {
+    GST_TRACE_OBJECT (tr->rtpsess, "Not enough packets acked (%u)", acked);
+    g_mutex_unlock (&tr->mutex);
+    return;
+  }
+
+  /* Queuing delay variation along the feedback interval */
+  arrival_span = last_arrival - first_arrival;
+  delay_gradient = (gdouble) (arrival_span -
+      (gint64) (last_send - first_send)) / GST_MSECOND;
+  tr->delay_trend = DEFAULT_TWCC_SMOOTHING_FACTOR * tr->delay_trend +
+      (1.0 - DEFAULT_TWCC_SMOOTHING_FACTOR) * delay_gradient;
+
+  if (tr->delay_trend > tr->overuse_threshold) {
+    tr->usage = TWCC_USAGE_OVERUSE;
+  } else if (tr->delay_trend < -tr->overuse_threshold) {
+    tr->usage = TWCC_USAGE_UNDERUSE;
+  } else {
+    tr->usage = TWCC_USAGE_NORMAL;
+  }
+
+  if (arrival_span >= TWCC_MIN_ACKED_INTERVAL) {
+    tr->acked_bitrate = acked_bytes * 8 * GST_SECOND / arrival_span;
+  }
+
+  loss_fraction = (gdouble) lost / (lost + acked);
+  target = kms_twcc_remote_update_target (tr, loss_fraction);
+  g_atomic_int_set (&tr->target, target);
+
+  GST_TRACE_OBJECT (tr->rtpsess, "Delay trend: %.2f ms, usage: %d, acked: %"
+      G_GUINT32_FORMAT " bps, losses: %.2f, target: %" G_GUINT32_FORMAT " bps",
+      tr->delay_trend, tr->usage, tr->acked_bitrate, loss_fraction, target);
+
+  g_mutex_unlock (&tr->mutex);
+
+  send_twcc_event (tr, target);
+}
+
+static void
+kms_twcc_remote_on_feedback_rtcp (GObject * sess, guint type, guint fbtype,
+    guint sender_ssrc, guint media_ssrc, GstBuffer * fci,
+    KmsTwccRemote * tr)
+{
+  KmsRTCPTWCCPacket twcc_packet;
+  GstMapInfo map;
+  gboolean ret;
+
+  if (type != GST_RTCP_TYPE_RTPFB || fbtype != KMS_RTCP_RTPFB_TYPE_TWCC
+      || fci == NULL) {
+    return;
+  }
+
+  if (!gst_buffer_map (fci, &map, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (fci, "Buffer cannot be mapped");
+    return;
+  }
+
+  ret = kms_rtcp_twcc_get_packet (map.data, map.size, &twcc_packet);
+  gst_buffer_unmap (fci, &map);
+
+  if (!ret) {
+    GST_WARNING_OBJECT (sess, "Cannot get RTCP TWCC packet");
+    return;
+  }
+
+  kms_twcc_remote_update (tr, &twcc_packet);
+}
+
+void
+kms_twcc_remote_packet_sent (KmsTwccRemote * tr, guint16 seqnum,
+    GstClockTime send_time, guint size)
+{
+  KmsTwccSentPacket *sent;
+
+  g_mutex_lock (&tr->mutex);
+
+  sent = &tr->history[seqnum & TWCC_WINDOW_MASK];
+  sent->seq = seqnum;
+  sent->send_time = send_time;
+  sent->size = size;
+  sent->valid = TRUE;
+
+  g_mutex_unlock (&tr->mutex);
+}
+
+guint
+kms_twcc_remote_get_target_bitrate (KmsTwccRemote * tr)
+{
+  return g_atomic_int_get (&tr->target);
+}
+
+void
+kms_twcc_remote_destroy (KmsTwccRemote * tr)
+{
+  if (tr == NULL) {
+    return;
+  }
+
+  g_signal_handler_disconnect (tr->rtpsess, tr->signal_id);
+
+  g_clear_object (&tr->pad_event);
+  g_clear_object (&tr->rtpsess);
+  g_mutex_clear (&tr->mutex);
+
+  g_slice_free (KmsTwccRemote, tr);
+}
+
+KmsTwccRemote *
+kms_twcc_remote_create (GObject * rtpsess, guint local_ssrc,
+    guint min_bw, guint max_bw, GstPad * pad)
+{
+  KmsTwccRemote *tr = g_slice_new0 (KmsTwccRemote);
+
+  tr->rtpsess = g_object_ref (rtpsess);
+  g_mutex_init (&tr->mutex);
+
+  tr->local_ssrc = local_ssrc;
+  tr->min_bw = min_bw;
+  tr->max_bw = max_bw;
+
+  tr->twcc_on_connect = DEFAULT_TWCC_ON_CONNECT;
+  tr->overuse_threshold = DEFAULT_TWCC_OVERUSE_THRESHOLD;
+  tr->decrease_factor = DEFAULT_TWCC_DECREASE_FACTOR;
+  tr->increase_factor = DEFAULT_TWCC_INCREASE_FACTOR;
+
+  tr->usage = TWCC_USAGE_NORMAL;
+  tr->target = kms_twcc_remote_clamp (tr, tr->twcc_on_connect);
+  tr->last_update = GST_CLOCK_TIME_NONE;
+  tr->last_decrease = GST_CLOCK_TIME_NONE;
+
+  tr->signal_id = g_signal_connect (rtpsess, "on-feedback-rtcp",
+      G_CALLBACK (kms_twcc_remote_on_feedback_rtcp), tr);
+
+  tr->pad_event = g_object_ref (pad);
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      send_twcc_event_probe, tr, NULL);
+
+  return tr;
+}
+
+void
+kms_twcc_remote_set_params (KmsTwccRemote * tr, GstStructure * params)
+{
+  gfloat auxf;
+  gint auxi;
+  gboolean is_set;
+
+  is_set =
+      gst_structure_get (params, "twcc-on-connect", G_TYPE_INT, &auxi, NULL);
+  if (is_set) {
+    tr->twcc_on_connect = auxi;
+
+    g_mutex_lock (&tr->mutex);
+    if (!GST_CLOCK_TIME_IS_VALID (tr->last_update)) {
+      /* No feedback received yet */
+      g_atomic_int_set (&tr->target, kms_twcc_remote_clamp (tr, auxi));
+    }
+    g_mutex_unlock (&tr->mutex);
+  }
+
+  is_set =
+      gst_structure_get (params, "twcc-overuse-threshold", G_TYPE_FLOAT,
+      &auxf, NULL);
+  if (is_set) {
+    tr->overuse_threshold = auxf;
+  }
+
+  is_set =
+      gst_structure_get (params, "twcc-decrease-factor", G_TYPE_FLOAT,
+      &auxf, NULL);
+  if (is_set) {
+    tr->decrease_factor = auxf;
+  }
+
+  is_set =
+      gst_structure_get (params, "twcc-increase-factor", G_TYPE_FLOAT,
+      &auxf, NULL);
+  if (is_set) {
+    tr->increase_factor = auxf;
+  }
+}
+
+void
+kms_twcc_remote_get_params (KmsTwccRemote * tr, GstStructure ** params)
+{
+  gst_structure_set (*params,
+      "twcc-on-connect", G_TYPE_INT, tr->twcc_on_connect,
+      "twcc-overuse-threshold", G_TYPE_FLOAT, tr->overuse_threshold,
+      "twcc-decrease-factor", G_TYPE_FLOAT, tr->decrease_factor,
+      "twcc-increase-factor", G_TYPE_FLOAT, tr->increase_factor, NULL);
+}
+
+/* KmsTwccRemote end */
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
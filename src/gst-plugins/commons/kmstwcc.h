@@ -0,0 +1,59 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_TWCC_H__
+#define __KMS_TWCC_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* KmsTwccLocal begin */
+typedef struct _KmsTwccLocal KmsTwccLocal;
+
+/*
+ * Receiver side: arrival times of the packets received through @pad are
+ * recorded by transport-wide sequence number and reported to the remote
+ * peer using TWCC RTCP feedback each time @rtpsess sends RTCP. Early RTCP is
+ * requested while packets arrive, so feedback keeps up with high rates.
+ */
+KmsTwccLocal * kms_twcc_local_create (GObject *rtpsess, GstPad *pad,
+  guint8 ext_id);
+void kms_twcc_local_destroy (KmsTwccLocal *tl);
+/* KmsTwccLocal end */
+
+/* KmsTwccRemote begin */
+typedef struct _KmsTwccRemote KmsTwccRemote;
+
+/*
+ * Sender side: TWCC feedback received by @rtpsess is matched against the
+ * packets notified with kms_twcc_remote_packet_sent. The delay based target
+ * bitrate is pushed upstream through @pad as a REMB event, so it reaches the
+ * same RembEventManager callbacks used by the encoders.
+ */
+KmsTwccRemote * kms_twcc_remote_create (GObject *rtpsess,
+  guint local_ssrc, guint min_bw, guint max_bw, GstPad * pad);
+void kms_twcc_remote_destroy (KmsTwccRemote *tr);
+void kms_twcc_remote_packet_sent (KmsTwccRemote *tr, guint16 seqnum,
+  GstClockTime send_time, guint size);
+guint kms_twcc_remote_get_target_bitrate (KmsTwccRemote *tr);
+void kms_twcc_remote_set_params (KmsTwccRemote *tr, GstStructure *params);
+void kms_twcc_remote_get_params (KmsTwccRemote *tr, GstStructure **params);
+/* KmsTwccRemote end */
+
+G_END_DECLS
+#endif /* __KMS_TWCC_H__ */
@@ -16,6 +16,7 @@
  */
 
 #include "kmsrtpsynchronizer.h"
+#include "kmsrtcp.h"
 
 #define GST_DEFAULT_NAME "rtpsynchronizer"
 GST_DEBUG_CATEGORY_STATIC (kms_rtp_synchronizer_debug_category);
@@ -164,33 +165,22 @@ end:
 }
 
 static void
-kms_rtp_synchronizer_process_rtcp_packet (KmsRtpSynchronizer * self,
-    GstRTCPPacket * packet, GstClockTime current_time)
+kms_rtp_synchronizer_process_rtcp_sr (KmsRtpSynchronizer * self,
+    guint32 ssrc, KmsRTCPSenderInfo * info, GstClockTime current_time)
 {
-  GstRTCPType type;
-  guint32 ssrc, rtp_time;
-  guint64 ntp_time, ntp_ns_time;
-
-  type = gst_rtcp_packet_get_type (packet);
-  GST_DEBUG_OBJECT (self, "Received RTCP buffer of type: %d", type);
-
-  if (type != GST_RTCP_TYPE_SR) {
-    return;
-  }
-
-  gst_rtcp_packet_sr_get_sender_info (packet, &ssrc, &ntp_time, &rtp_time,
-      NULL, NULL);
+  guint64 ntp_ns_time;
 
   /* convert ntp_time to nanoseconds */
   ntp_ns_time =
-      gst_util_uint64_scale (ntp_time, GST_SECOND,
+      gst_util_uint64_scale (info->ntp_time, GST_SECOND,
       (G_GINT64_CONSTANT (1) << 32));
 
   KMS_RTP_SYNCHRONIZER_LOCK (self);
 
   GST_DEBUG_OBJECT (self,
       "Received RTCP SR packet SSRC: %u, rtp_time: %u, ntp_time: %lu, ntp_ns_time: %"
-      GST_TIME_FORMAT, ssrc, rtp_time, ntp_time, GST_TIME_ARGS (ntp_ns_time));
+      GST_TIME_FORMAT, ssrc, info->rtp_time, info->ntp_time,
+      GST_TIME_ARGS (ntp_ns_time));
 
   if (!self->priv->base_initiated) {
     kms_rtp_sync_context_get_time_matching (self->priv->context, ntp_ns_time,
@@ -200,7 +190,7 @@ kms_rtp_synchronizer_process_rtcp_packet (KmsRtpSynchronizer * self,
   }
 
   self->priv->last_sr_ext_ts =
-      gst_rtp_buffer_ext_timestamp (&self->priv->ext_ts, rtp_time);
+      gst_rtp_buffer_ext_timestamp (&self->priv->ext_ts, info->rtp_time);
   self->priv->last_sr_ntp_ns_time = ntp_ns_time;
 
   KMS_RTP_SYNCHRONIZER_UNLOCK (self);
@@ -210,10 +200,13 @@ gboolean
 kms_rtp_synchronizer_process_rtcp_buffer (KmsRtpSynchronizer * self,
     GstBuffer * buffer, GstClockTime current_time, GError ** error)
 {
-  GstRTCPBuffer rtcp_buffer = GST_RTCP_BUFFER_INIT;
-  GstRTCPPacket packet;
+  KmsRTCPCompoundReader reader;
+  KmsRTCPCompoundPacket packet;
+  KmsRTCPSenderInfo info;
+  gboolean empty = TRUE;
+  GstMapInfo map;
 
-  if (!gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcp_buffer)) {
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
     const gchar *msg = "Buffer cannot be mapped as RTCP";
 
     GST_ERROR_OBJECT (self, "%s", msg);
@@ -223,15 +216,26 @@ kms_rtp_synchronizer_process_rtcp_buffer (KmsRtpSynchronizer * self,
     return FALSE;
   }
 
-  if (!gst_rtcp_buffer_get_first_packet (&rtcp_buffer, &packet)) {
-    GST_WARNING_OBJECT (self, "Empty RTCP buffer");
-    goto unmap;
+  /* Only the first SR of the compound packet is taken into account */
+  kms_rtcp_compound_reader_init (&reader, map.data, map.size);
+  while (kms_rtcp_compound_reader_next (&reader, &packet)) {
+    empty = FALSE;
+    GST_DEBUG_OBJECT (self, "Received RTCP buffer of type: %d", packet.pt);
+
+    if (kms_rtcp_compound_packet_get_sender_info (&packet, &info)) {
+      kms_rtp_synchronizer_process_rtcp_sr (self, packet.ssrc, &info,
+          current_time);
+      break;
+    }
   }
 
-  kms_rtp_synchronizer_process_rtcp_packet (self, &packet, current_time);
+  if (kms_rtcp_compound_reader_has_error (&reader)) {
+    GST_WARNING_OBJECT (self, "Malformed RTCP buffer");
+  } else if (empty) {
+    GST_WARNING_OBJECT (self, "Empty RTCP buffer");
+  }
 
-unmap:
-  gst_rtcp_buffer_unmap (&rtcp_buffer);
+  gst_buffer_unmap (buffer, &map);
 
   return TRUE;
 }
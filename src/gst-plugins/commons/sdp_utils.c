@@ -19,6 +19,7 @@
 #include <gst/gst.h>
 #include <glib.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "constants.h"
 
@@ -619,7 +620,7 @@ sdp_utils_media_has_remb (const GstSDPMedia * media)
 }
 
 gboolean
-sdp_utils_media_has_rtcp_nack (const GstSDPMedia * media)
+sdp_utils_media_has_transport_cc (const GstSDPMedia * media)
 {
   const gchar *payload = gst_sdp_media_get_format (media, 0);
   guint a;
@@ -636,7 +637,8 @@ sdp_utils_media_has_rtcp_nack (const GstSDPMedia * media)
       break;
     }
 
-    if (sdp_utils_rtcp_fb_attr_check_type (attr, payload, RTCP_FB_NACK)) {
+    if (sdp_utils_rtcp_fb_attr_check_type (attr, payload,
+            RTCP_FB_TRANSPORT_CC)) {
       return TRUE;
     }
   }
@@ -644,23 +646,25 @@ sdp_utils_media_has_rtcp_nack (const GstSDPMedia * media)
   return FALSE;
 }
 
-static gboolean
-sdp_media_contains_attr (const GstSDPMedia * m, const GstSDPAttribute * attr)
+gboolean
+sdp_utils_media_has_rtcp_nack (const GstSDPMedia * media)
 {
-  guint i;
+  const gchar *payload = gst_sdp_media_get_format (media, 0);
+  guint a;
 
-  for (i = 0;; i++) {
-    const gchar *val;
+  if (payload == NULL) {
+    return FALSE;
+  }
 
-    val = gst_sdp_media_get_attribute_val_n (m, attr->key, i);
+  for (a = 0;; a++) {
+    const gchar *attr;
 
-    if (val == NULL) {
-      /* Attribute is not present */
-      return FALSE;
+    attr = gst_sdp_media_get_attribute_val_n (media, RTCP_FB, a);
+    if (attr == NULL) {
+      break;
     }
 
-    if (g_strcmp0 (attr->value, val) == 0) {
-      /* Attribute found */
+    if (sdp_utils_rtcp_fb_attr_check_type (attr, payload, RTCP_FB_NACK)) {
       return TRUE;
     }
   }
@@ -671,6 +675,8 @@ sdp_media_contains_attr (const GstSDPMedia * m, const GstSDPAttribute * attr)
 static gboolean
 sdp_media_equal_attributes (const GstSDPMedia * m1, const GstSDPMedia * m2)
 {
+  SdpMediaIndex *index;
+  gboolean ret = TRUE;
   guint i, len;
 
   len = gst_sdp_media_attributes_len (m1);
@@ -679,16 +685,18 @@ sdp_media_equal_attributes (const GstSDPMedia * m1, const GstSDPMedia * m2)
     return FALSE;
   }
 
-  for (i = 0; i < len; i++) {
+  index = sdp_utils_media_index_new (m2);
+
+  for (i = 0; i < len && ret; i++) {
     const GstSDPAttribute *attr;
 
     attr = gst_sdp_media_get_attribute (m1, i);
-    if (!sdp_media_contains_attr (m2, attr)) {
-      return FALSE;
-    }
+    ret = sdp_utils_media_index_contains_attr (index, attr);
   }
 
-  return TRUE;
+  sdp_utils_media_index_free (index);
+
+  return ret;
 }
 
 static gboolean
@@ -996,7 +1004,7 @@ sdp_utils_get_pt_for_codec_name (const GstSDPMedia * media,
 }
 
 gint
-sdp_utils_get_abs_send_time_id (const GstSDPMedia * media)
+sdp_utils_get_extmap_id (const GstSDPMedia * media, const gchar * uri)
 {
   guint a;
 
@@ -1010,7 +1018,7 @@ sdp_utils_get_abs_send_time_id (const GstSDPMedia * media)
     }
 
     tokens = g_strsplit (attr, " ", 0);
-    if (g_strcmp0 (RTP_HDR_EXT_ABS_SEND_TIME_URI, tokens[1]) == 0) {
+    if (g_strcmp0 (uri, tokens[1]) == 0) {
       gint ret = atoi (tokens[0]);
 
       g_strfreev (tokens);
@@ -1023,6 +1031,12 @@ sdp_utils_get_abs_send_time_id (const GstSDPMedia * media)
   return -1;
 }
 
+gint
+sdp_utils_get_abs_send_time_id (const GstSDPMedia * media)
+{
+  return sdp_utils_get_extmap_id (media, RTP_HDR_EXT_ABS_SEND_TIME_URI);
+}
+
 gboolean
 sdp_utils_media_is_inactive (const GstSDPMedia * media)
 {
@@ -1030,6 +1044,178 @@ sdp_utils_media_is_inactive (const GstSDPMedia * media)
       || gst_sdp_media_get_port (media) == 0;
 }
 
+/* SdpMediaIndex begin */
+
+struct _SdpMediaIndex
+{
+  GHashTable *attrs;            /* key -> GPtrArray of values */
+  GHashTable *rtpmaps;          /* format -> rtpmap value */
+  GHashTable *fmtps;            /* format -> fmtp value */
+};
+
+static void
+sdp_media_index_add_map_value (GHashTable * map, const gchar * val)
+{
+  const gchar *sep;
+  gchar *fmt;
+
+  if (*val == '\0') {
+    /* No format */
+    return;
+  }
+
+  sep = strchr (val, ' ');
+  fmt = (sep != NULL) ? g_strndup (val, sep - val) : g_strdup (val);
+
+  if (g_hash_table_contains (map, fmt)) {
+    /* Keep the first one, as linear lookups do */
+    g_free (fmt);
+    return;
+  }
+
+  g_hash_table_insert (map, fmt, (gpointer) val);
+}
+
+SdpMediaIndex *
+sdp_utils_media_index_new (const GstSDPMedia * media)
+{
+  SdpMediaIndex *index;
+  guint i, len;
+
+  index = g_slice_new (SdpMediaIndex);
+  index->attrs = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      (GDestroyNotify) g_ptr_array_unref);
+  index->rtpmaps = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      NULL);
+  index->fmtps = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  len = gst_sdp_media_attributes_len (media);
+
+  for (i = 0; i < len; i++) {
+    const GstSDPAttribute *attr = gst_sdp_media_get_attribute (media, i);
+    GPtrArray *values;
+
+    if (attr->key == NULL || attr->value == NULL) {
+      continue;
+    }
+
+    values = g_hash_table_lookup (index->attrs, attr->key);
+
+    if (values == NULL) {
+      values = g_ptr_array_new ();
+      g_hash_table_insert (index->attrs, attr->key, values);
+    }
+
+    g_ptr_array_add (values, attr->value);
+
+    if (g_strcmp0 (attr->key, RTPMAP) == 0) {
+      sdp_media_index_add_map_value (index->rtpmaps, attr->value);
+    } else if (g_strcmp0 (attr->key, FMTP) == 0) {
+      sdp_media_index_add_map_value (index->fmtps, attr->value);
+    }
+  }
+
+  return index;
+}
+
+void
+sdp_utils_media_index_free (SdpMediaIndex * index)
+{
+  g_hash_table_unref (index->attrs);
+  g_hash_table_unref (index->rtpmaps);
+  g_hash_table_unref (index->fmtps);
+
+  g_slice_free (SdpMediaIndex, index);
+}
+
+guint
+sdp_utils_media_index_attributes_len (const SdpMediaIndex * index,
+    const gchar * key)
+{
+  GPtrArray *values;
+
+  values = g_hash_table_lookup (index->attrs, key);
+
+  return (values != NULL) ? values->len : 0;
+}
+
+const gchar *
+sdp_utils_media_index_get_attribute_val_n (const SdpMediaIndex * index,
+    const gchar * key, guint nth)
+{
+  GPtrArray *values;
+
+  values = g_hash_table_lookup (index->attrs, key);
+
+  if (values == NULL || nth >= values->len) {
+    return NULL;
+  }
+
+  return g_ptr_array_index (values, nth);
+}
+
+const gchar *
+sdp_utils_media_index_get_attr_map_value (const SdpMediaIndex * index,
+    const gchar * name, const gchar * fmt)
+{
+  GPtrArray *values;
+  gsize len;
+  guint i;
+
+  if (g_strcmp0 (name, RTPMAP) == 0) {
+    return g_hash_table_lookup (index->rtpmaps, fmt);
+  } else if (g_strcmp0 (name, FMTP) == 0) {
+    return g_hash_table_lookup (index->fmtps, fmt);
+  }
+
+  values = g_hash_table_lookup (index->attrs, name);
+
+  if (values == NULL) {
+    return NULL;
+  }
+
+  len = strlen (fmt);
+
+  for (i = 0; i < values->len; i++) {
+    const gchar *val = g_ptr_array_index (values, i);
+
+    if (*val != '\0' && strncmp (val, fmt, len) == 0 &&
+        (val[len] == ' ' || val[len] == '\0')) {
+      return val;
+    }
+  }
+
+  return NULL;
+}
+
+gboolean
+sdp_utils_media_index_contains_attr (const SdpMediaIndex * index,
+    const GstSDPAttribute * attr)
+{
+  GPtrArray *values;
+  guint i;
+
+  if (attr->key == NULL) {
+    return FALSE;
+  }
+
+  values = g_hash_table_lookup (index->attrs, attr->key);
+
+  if (values == NULL) {
+    return FALSE;
+  }
+
+  for (i = 0; i < values->len; i++) {
+    if (g_strcmp0 (attr->value, g_ptr_array_index (values, i)) == 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/* SdpMediaIndex end */
+
 static void init_debug (void) __attribute__ ((constructor));
 
 static void
@@ -31,9 +31,12 @@
 #define RTCP_FB_NACK "nack"
 #define RTCP_FB_PLI "nack pli"
 #define RTCP_FB_REMB "goog-remb"
+#define RTCP_FB_TRANSPORT_CC "transport-cc"
 
 #define EXT_MAP "extmap"
 
+typedef struct _SdpMediaIndex SdpMediaIndex;
+
 typedef gboolean (*GstSDPMediaFunc) (const GstSDPMedia *media, gpointer user_data);
 typedef gboolean (*GstSDPIntersectMediaFunc) (const GstSDPAttribute *attr, gpointer user_data);
 
@@ -58,6 +61,7 @@ gboolean sdp_utils_media_is_active (const GstSDPMedia * media, gboolean offerer)
 
 gboolean sdp_utils_rtcp_fb_attr_check_type (const gchar * attr, const gchar * pt, const gchar * type);
 gboolean sdp_utils_media_has_remb (const GstSDPMedia * media);
+gboolean sdp_utils_media_has_transport_cc (const GstSDPMedia * media);
 gboolean sdp_utils_media_has_rtcp_nack (const GstSDPMedia * media);
 
 gboolean sdp_utils_equal_medias (const GstSDPMedia * m1, const GstSDPMedia * m2);
@@ -69,6 +73,21 @@ gboolean sdp_utils_is_pt_in_fmts (const GstSDPMedia * media, gint pt);
 
 gint sdp_utils_get_pt_for_codec_name (const GstSDPMedia *media, const gchar *codec_name);
 
+gint sdp_utils_get_extmap_id (const GstSDPMedia * media, const gchar * uri);
+
+/*
+ * Index of the attributes of a media, built in a single pass, so that
+ * attributes can be looked up by key and rtpmap/fmtp values by format without
+ * scanning the whole media each time. Values point into @media, so the index
+ * must be freed before @media is modified or freed.
+ */
+SdpMediaIndex *sdp_utils_media_index_new (const GstSDPMedia * media);
+void sdp_utils_media_index_free (SdpMediaIndex * index);
+
+guint sdp_utils_media_index_attributes_len (const SdpMediaIndex * index, const gchar * key);
+const gchar *sdp_utils_media_index_get_attribute_val_n (const SdpMediaIndex * index, const gchar * key, guint nth);
+const gchar *sdp_utils_media_index_get_attr_map_value (const SdpMediaIndex * index, const gchar * name, const gchar * fmt);
+gboolean sdp_utils_media_index_contains_attr (const SdpMediaIndex * index, const GstSDPAttribute * attr);
 gint sdp_utils_get_abs_send_time_id (const GstSDPMedia * media);
 gboolean sdp_utils_media_is_inactive (const GstSDPMedia * media);
 
@@ -51,6 +51,7 @@ struct _KmsSdpRtpAvpMediaHandlerPrivate
   KmsISdpPayloadManager *ptmanager;
   GSList *audio_fmts;
   GSList *video_fmts;
+  GString *signature;           /* configuration that defines offer templates */
 };
 
 #define SDP_AUDIO_MEDIA "audio"
@@ -59,6 +60,8 @@ struct _KmsSdpRtpAvpMediaHandlerPrivate
 #define DEFAULT_RTP_AUDIO_BASE_PAYLOAD 0
 #define DEFAULT_RTP_VIDEO_BASE_PAYLOAD 24
 
+#define MAX_OFFER_TEMPLATES 64
+
 /* Table extracted from rfc3551 [6] */
 static gchar *rtpmaps[] = {
   /* Payload types (PT) for audio encodings */
@@ -503,14 +506,14 @@ kms_sdp_rtp_avp_media_handler_encoding_supported (KmsSdpRtpAvpMediaHandler *
 
 static gboolean
 kms_sdp_rtp_avp_media_handler_format_supported (KmsSdpRtpAvpMediaHandler * self,
-    const GstSDPMedia * media, const gchar * fmt)
+    const GstSDPMedia * media, const SdpMediaIndex * index, const gchar * fmt)
 {
   const gchar *val;
   gchar **attrs;
   gboolean ret;
   gint pt;
 
-  val = sdp_utils_get_attr_map_value (media, "rtpmap", fmt);
+  val = sdp_utils_media_index_get_attr_map_value (index, "rtpmap", fmt);
   pt = atoi (fmt);
 
   if (val == NULL) {
@@ -536,7 +539,7 @@ kms_sdp_rtp_avp_media_handler_format_supported (KmsSdpRtpAvpMediaHandler * self,
 
 static gboolean
     kms_sdp_rtp_avp_media_handler_add_supported_extmaps
-    (KmsSdpRtpAvpMediaHandler * self, const GstSDPMedia * offer,
+    (KmsSdpRtpAvpMediaHandler * self, const SdpMediaIndex * offer,
     GstSDPMedia * answer, GError ** error)
 {
   guint a;
@@ -548,7 +551,7 @@ static gboolean
     gchar **tokens;
     const gchar *offer_uri;
 
-    attr = gst_sdp_media_get_attribute_val_n (offer, "extmap", a);
+    attr = sdp_utils_media_index_get_attribute_val_n (offer, "extmap", a);
     if (attr == NULL) {
       return TRUE;
     }
@@ -585,7 +588,7 @@ static gboolean
 static gboolean
     kms_sdp_rtp_avp_media_handler_add_supported_rtpmap_attrs
     (KmsSdpRtpAvpMediaHandler * self, const GstSDPMedia * offer,
-    GstSDPMedia * answer, GError ** error)
+    const SdpMediaIndex * index, GstSDPMedia * answer, GError ** error)
 {
   guint i, len;
 
@@ -595,7 +598,7 @@ static gboolean
     const gchar *fmt, *val;
 
     fmt = gst_sdp_media_get_format (answer, i);
-    val = sdp_utils_get_attr_map_value (offer, "rtpmap", fmt);
+    val = sdp_utils_media_index_get_attr_map_value (index, "rtpmap", fmt);
 
     if (val == NULL) {
       gint pt;
@@ -853,28 +856,155 @@ kms_sdp_rtp_avp_media_handler_init_offer (KmsSdpMediaHandler * handler,
   }
 }
 
+/* Offer templates begin */
+
+/*
+ * Formats, extmap, rtpmap and fmtp attributes of a new offer only depend on
+ * the codecs and header extensions configured in the handler, which are the
+ * same for every endpoint created from the same configuration. They are
+ * generated once and copied into each new offer. Templates are shared by all
+ * handlers and indexed by media and configuration signature.
+ */
+G_LOCK_DEFINE_STATIC (offer_templates);
+static GHashTable *offer_templates = NULL;
+
+static void
+kms_sdp_rtp_avp_media_handler_update_signature (KmsSdpRtpAvpMediaHandler *
+    self, const gchar * format, ...)
+{
+  va_list args;
+
+  va_start (args, format);
+  g_string_append_vprintf (self->priv->signature, format, args);
+  va_end (args);
+}
+
+static GstSDPMedia *
+kms_sdp_rtp_avp_media_handler_create_offer_template (KmsSdpRtpAvpMediaHandler *
+    self, const gchar * media, GError ** error)
+{
+  GstSDPMedia *tmpl;
+
+  if (gst_sdp_media_new (&tmpl) != GST_SDP_OK) {
+    g_set_error (error, KMS_SDP_AGENT_ERROR, SDP_AGENT_UNEXPECTED_ERROR,
+        "Can not create '%s' media", media);
+    return NULL;
+  }
+
+  if (gst_sdp_media_set_media (tmpl, media) != GST_SDP_OK) {
+    g_set_error (error, KMS_SDP_AGENT_ERROR, SDP_AGENT_UNEXPECTED_ERROR,
+        "Can not set '%s' media", media);
+    goto error;
+  }
+
+  if (!kms_sdp_rtp_avp_media_handler_add_supported_fmts (self, tmpl, error)) {
+    goto error;
+  }
+
+  if (!kms_sdp_rtp_avp_media_handler_add_extmaps (self, tmpl, error)) {
+    goto error;
+  }
+
+  if (!kms_sdp_rtp_avp_media_handler_add_rtpmap_attrs (self, tmpl, error)) {
+    goto error;
+  }
+
+  return tmpl;
+
+error:
+  gst_sdp_media_free (tmpl);
+
+  return NULL;
+}
+
+static gboolean
+kms_sdp_rtp_avp_media_handler_copy_offer_template (const GstSDPMedia * tmpl,
+    GstSDPMedia * offer, GError ** error)
+{
+  guint i, len;
+
+  len = gst_sdp_media_formats_len (tmpl);
+
+  for (i = 0; i < len; i++) {
+    const gchar *fmt = gst_sdp_media_get_format (tmpl, i);
+
+    if (gst_sdp_media_add_format (offer, fmt) != GST_SDP_OK) {
+      g_set_error (error, KMS_SDP_AGENT_ERROR, SDP_AGENT_UNEXPECTED_ERROR,
+          "Can not set format (%s)", fmt);
+      return FALSE;
+    }
+  }
+
+  len = gst_sdp_media_attributes_len (tmpl);
+
+  for (i = 0; i < len; i++) {
+    const GstSDPAttribute *attr = gst_sdp_media_get_attribute (tmpl, i);
+
+    if (gst_sdp_media_add_attribute (offer, attr->key,
+            attr->value) != GST_SDP_OK) {
+      g_set_error (error, KMS_SDP_AGENT_ERROR, SDP_AGENT_UNEXPECTED_ERROR,
+          "Can not to set attribute '%s:%s'", attr->key, attr->value);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
 static gboolean
 kms_sdp_rtp_avp_media_handler_add_new_offer_attributes (KmsSdpRtpAvpMediaHandler
     * self, GstSDPMedia * offer, GError ** error)
 {
-  if (!kms_sdp_rtp_avp_media_handler_add_supported_fmts (self, offer, error)) {
-    return FALSE;
-  }
+  const gchar *media = gst_sdp_media_get_media (offer);
+  GstSDPMedia *tmpl;
+  gboolean ret = FALSE;
+  gchar *key;
 
-  if (!kms_sdp_rtp_avp_media_handler_add_extmaps (self, offer, error)) {
-    return FALSE;
+  key = g_strdup_printf ("%s\n%s", media, self->priv->signature->str);
+
+  G_LOCK (offer_templates);
+
+  if (offer_templates == NULL) {
+    offer_templates = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify) gst_sdp_media_free);
   }
 
-  if (!kms_sdp_rtp_avp_media_handler_add_rtpmap_attrs (self, offer, error)) {
-    return FALSE;
+  tmpl = g_hash_table_lookup (offer_templates, key);
+
+  if (tmpl == NULL) {
+    tmpl = kms_sdp_rtp_avp_media_handler_create_offer_template (self, media,
+        error);
+
+    if (tmpl == NULL) {
+      goto end;
+    }
+
+    if (g_hash_table_size (offer_templates) >= MAX_OFFER_TEMPLATES) {
+      GST_DEBUG_OBJECT (self, "Too many offer templates, dropping them");
+      g_hash_table_remove_all (offer_templates);
+    }
+
+    GST_DEBUG_OBJECT (self, "New '%s' offer template", media);
+    g_hash_table_insert (offer_templates, key, tmpl);
+    key = NULL;
   }
 
-  return TRUE;
+  ret = kms_sdp_rtp_avp_media_handler_copy_offer_template (tmpl, offer, error);
+
+end:
+  G_UNLOCK (offer_templates);
+
+  g_free (key);
+
+  return ret;
 }
 
+/* Offer templates end */
+
 static gboolean
 kms_sdp_rtp_avp_media_handler_set_supported_fmts (KmsSdpRtpAvpMediaHandler *
-    self, const GstSDPMedia * origin, GstSDPMedia * target, GError ** error)
+    self, const GstSDPMedia * origin, const SdpMediaIndex * index,
+    GstSDPMedia * target, GError ** error)
 {
   guint i, len;
 
@@ -886,7 +1016,8 @@ kms_sdp_rtp_avp_media_handler_set_supported_fmts (KmsSdpRtpAvpMediaHandler *
 
     fmt = gst_sdp_media_get_format (origin, i);
 
-    if (!kms_sdp_rtp_avp_media_handler_format_supported (self, origin, fmt)) {
+    if (!kms_sdp_rtp_avp_media_handler_format_supported (self, origin, index,
+            fmt)) {
       continue;
     }
 
@@ -902,7 +1033,8 @@ kms_sdp_rtp_avp_media_handler_set_supported_fmts (KmsSdpRtpAvpMediaHandler *
 
 static gboolean
 kms_sdp_rtp_avp_media_handler_add_supported_fmtp (KmsSdpRtpAvpMediaHandler *
-    self, const GstSDPMedia * prev_offer, GstSDPMedia * offer, GError ** error)
+    self, const GstSDPMedia * prev_offer, const SdpMediaIndex * index,
+    GstSDPMedia * offer, GError ** error)
 {
   guint i, len;
 
@@ -920,7 +1052,7 @@ kms_sdp_rtp_avp_media_handler_add_supported_fmtp (KmsSdpRtpAvpMediaHandler *
       return FALSE;
     }
 
-    fmtp = sdp_utils_sdp_media_get_fmtp (prev_offer, payload);
+    fmtp = sdp_utils_media_index_get_attr_map_value (index, "fmtp", payload);
 
     if (fmtp == NULL) {
       continue;
@@ -941,11 +1073,15 @@ static gboolean
     (KmsSdpRtpAvpMediaHandler * self, GstSDPMedia * offer,
     const GstSDPMedia * prev_offer, GError ** error)
 {
+  SdpMediaIndex *index;
   guint port, num_ports;
+  gboolean ret = FALSE;
+
+  index = sdp_utils_media_index_new (prev_offer);
 
   if (!kms_sdp_rtp_avp_media_handler_set_supported_fmts (self, prev_offer,
-          offer, error)) {
-    return FALSE;
+          index, offer, error)) {
+    goto end;
   }
 
   if (gst_sdp_media_formats_len (offer) > 0) {
@@ -960,21 +1096,26 @@ static gboolean
   if (gst_sdp_media_set_port_info (offer, port, num_ports) != GST_SDP_OK) {
     g_set_error_literal (error, KMS_SDP_AGENT_ERROR,
         SDP_AGENT_INVALID_PARAMETER, "Can not set port attribute");
-    return FALSE;
+    goto end;
   }
 
-  if (!kms_sdp_rtp_avp_media_handler_add_supported_extmaps (self, prev_offer,
+  if (!kms_sdp_rtp_avp_media_handler_add_supported_extmaps (self, index,
           offer, error)) {
-    return FALSE;
+    goto end;
   }
 
   if (!kms_sdp_rtp_avp_media_handler_add_supported_rtpmap_attrs (self,
-          prev_offer, offer, error)) {
-    return FALSE;
+          prev_offer, index, offer, error)) {
+    goto end;
   }
 
-  return kms_sdp_rtp_avp_media_handler_add_supported_fmtp (self, prev_offer,
-      offer, error);
+  ret = kms_sdp_rtp_avp_media_handler_add_supported_fmtp (self, prev_offer,
+      index, offer, error);
+
+end:
+  sdp_utils_media_index_free (index);
+
+  return ret;
 }
 
 static gboolean
@@ -1044,25 +1185,16 @@ kms_sdp_rtp_avp_media_handler_add_answer_attributes_impl (KmsSdpMediaHandler *
     handler, const GstSDPMedia * offer, GstSDPMedia * answer, GError ** error)
 {
   KmsSdpRtpAvpMediaHandler *self = KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler);
-  guint i, len, port;
+  SdpMediaIndex *index;
+  gboolean ret = FALSE;
+  guint port;
 
-  len = gst_sdp_media_formats_len (offer);
+  index = sdp_utils_media_index_new (offer);
 
   /* Set only supported media formats in answer */
-  for (i = 0; i < len; i++) {
-    const gchar *fmt;
-
-    fmt = gst_sdp_media_get_format (offer, i);
-
-    if (!kms_sdp_rtp_avp_media_handler_format_supported (self, offer, fmt)) {
-      continue;
-    }
-
-    if (gst_sdp_media_add_format (answer, fmt) != GST_SDP_OK) {
-      g_set_error (error, KMS_SDP_AGENT_ERROR, SDP_AGENT_UNEXPECTED_ERROR,
-          "Can add format '%s'", fmt);
-      return FALSE;
-    }
+  if (!kms_sdp_rtp_avp_media_handler_set_supported_fmts (self, offer, index,
+          answer, error)) {
+    goto end;
   }
 
   if (gst_sdp_media_formats_len (answer) > 0) {
@@ -1075,21 +1207,26 @@ kms_sdp_rtp_avp_media_handler_add_answer_attributes_impl (KmsSdpMediaHandler *
   if (gst_sdp_media_set_port_info (answer, port, 1) != GST_SDP_OK) {
     g_set_error_literal (error, KMS_SDP_AGENT_ERROR,
         SDP_AGENT_INVALID_PARAMETER, "Can not set port attribute");
-    return FALSE;
+    goto end;
   }
 
-  if (!kms_sdp_rtp_avp_media_handler_add_supported_extmaps (self, offer,
+  if (!kms_sdp_rtp_avp_media_handler_add_supported_extmaps (self, index,
           answer, error)) {
-    return FALSE;
+    goto end;
   }
 
   if (!KMS_SDP_MEDIA_HANDLER_CLASS (parent_class)->add_answer_attributes
       (handler, offer, answer, error)) {
-    return FALSE;
+    goto end;
   }
 
-  return kms_sdp_rtp_avp_media_handler_add_supported_rtpmap_attrs (self, offer,
-      answer, error);
+  ret = kms_sdp_rtp_avp_media_handler_add_supported_rtpmap_attrs (self, offer,
+      index, answer, error);
+
+end:
+  sdp_utils_media_index_free (index);
+
+  return ret;
 }
 
 static void
@@ -1106,6 +1243,8 @@ kms_sdp_rtp_avp_media_handler_finalize (GObject * object)
   g_slist_free_full (self->priv->audio_fmts, kms_sdp_rtp_map_destroy_pointer);
   g_slist_free_full (self->priv->video_fmts, kms_sdp_rtp_map_destroy_pointer);
 
+  g_string_free (self->priv->signature, TRUE);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -1146,6 +1285,7 @@ kms_sdp_rtp_avp_media_handler_init (KmsSdpRtpAvpMediaHandler * self)
 
   self->priv->extmaps =
       g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+  self->priv->signature = g_string_new (NULL);
 }
 
 KmsSdpRtpAvpMediaHandler *
@@ -1173,6 +1313,7 @@ kms_sdp_rtp_avp_media_handler_add_extmap (KmsSdpRtpAvpMediaHandler * self,
 
   g_hash_table_insert (self->priv->extmaps, GUINT_TO_POINTER (id),
       g_strdup (uri));
+  kms_sdp_rtp_avp_media_handler_update_signature (self, "e%u %s\n", id, uri);
 
   return TRUE;
 }
@@ -1241,6 +1382,8 @@ kms_sdp_rtp_avp_media_handler_add_codec (KmsSdpRtpAvpMediaHandler * self,
   }
 
   *fmts = g_slist_append (*fmts, rtpmap);
+  kms_sdp_rtp_avp_media_handler_update_signature (self, "c%s %u %s\n", media,
+      rtpmap->payload, rtpmap->name);
 
   return rtpmap->payload;
 }
@@ -1319,6 +1462,8 @@ kms_sdp_rtp_avp_media_handler_add_fmtp (KmsSdpRtpAvpMediaHandler * self,
 
   rtpmap = l->data;
   rtpmap->fmtps = g_slist_prepend (rtpmap->fmtps, fmtp);
+  kms_sdp_rtp_avp_media_handler_update_signature (self, "f%u %s\n", payload,
+      value);
 
   return TRUE;
 }
@@ -98,6 +98,7 @@ enum
   PROP_MIN_BITRATE,
   PROP_MAX_BITRATE,
   PROP_CODEC_CONFIG,
+  PROP_DROPPED_FRAMES,
   N_PROPERTIES
 };
 
@@ -1091,6 +1092,24 @@ kms_agnostic_bin_set_encoders_bitrate (KmsAgnosticBin2 * self)
   }
 }
 
+static guint64
+kms_agnostic_bin_get_encoders_dropped_frames (KmsAgnosticBin2 * self)
+{
+  GList *bins, *l;
+  guint64 dropped = 0;
+
+  bins = g_hash_table_get_values (self->priv->bins);
+  for (l = bins; l != NULL; l = l->next) {
+    if (KMS_IS_ENC_TREE_BIN (l->data)) {
+      dropped +=
+          kms_enc_tree_bin_get_dropped_frames (KMS_ENC_TREE_BIN (l->data));
+    }
+  }
+  g_list_free (bins);
+
+  return dropped;
+}
+
 void
 kms_agnostic_bin2_set_property (GObject * object, guint property_id,
     const GValue * value, GParamSpec * pspec)
@@ -1179,6 +1198,12 @@ kms_agnostic_bin2_get_property (GObject * object, guint property_id,
       g_value_set_boxed (value, self->priv->codec_config);
       KMS_AGNOSTIC_BIN2_UNLOCK (self);
       break;
+    case PROP_DROPPED_FRAMES:
+      KMS_AGNOSTIC_BIN2_LOCK (self);
+      g_value_set_uint64 (value,
+          kms_agnostic_bin_get_encoders_dropped_frames (self));
+      KMS_AGNOSTIC_BIN2_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -1229,6 +1254,11 @@ kms_agnostic_bin2_class_init (KmsAgnosticBin2Class * klass)
       g_param_spec_boxed ("codec-config", "codec config",
           "Codec configuration", GST_TYPE_STRUCTURE, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_DROPPED_FRAMES,
+      g_param_spec_uint64 ("dropped-frames", "dropped frames",
+          "Frames dropped before encoding to keep latency bounded",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE));
+
   GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, PLUGIN_NAME, 0, PLUGIN_NAME);
 
   g_type_class_add_private (klass, sizeof (KmsAgnosticBin2Private));
@@ -81,9 +81,19 @@ struct _KmsBufferInjectorPrivate
   gboolean configured;
   gboolean still_waiting;
   MediaType type;
+  /* Handed off from the chain function with atomic operations */
   GstBuffer *previous_buffer;
+  /* Bumped with the lock held each time previous_buffer is reset */
+  gint generation;
+  /* Only accessed from the pad task */
+  GstBuffer *source_buffer;
+  GstBuffer *injected_buffer;
   GMutex mutex_generate;
   GCond cond_generate;
+  /* milliseconds since start_time, they may wrap around */
+  gint64 start_time;
+  gint last_arrival;
+  guint last_injection;
   /* milliseconds */
   gint64 wait_time;
   /* nanoseconds */
@@ -119,14 +129,97 @@ kms_buffer_injector_check_segment_event (KmsBufferInjector * self)
   gst_segment_free (segment);
 }
 
+static guint
+kms_buffer_injector_get_time (KmsBufferInjector * self)
+{
+  /* Only differences between values are used, so wrapping is harmless */
+  return (guint) ((g_get_monotonic_time () - self->priv->start_time) /
+      G_TIME_SPAN_MILLISECOND);
+}
+
+static GstBuffer *
+kms_buffer_injector_exchange_buffer (KmsBufferInjector * self,
+    GstBuffer * buffer)
+{
+  GstBuffer *old;
+
+  do {
+    old = g_atomic_pointer_get (&self->priv->previous_buffer);
+  } while (!g_atomic_pointer_compare_and_exchange (&self->priv->previous_buffer,
+          old, buffer));
+
+  return old;
+}
+
+static GstBuffer *
+kms_buffer_injector_prepare_buffer (KmsBufferInjector * self,
+    gint64 offset_time)
+{
+  GstBuffer *buffer, *injected;
+  gint generation;
+
+  /* Take the buffer out so that the chain function cannot release it */
+  generation = g_atomic_int_get (&self->priv->generation);
+  buffer = kms_buffer_injector_exchange_buffer (self, NULL);
+  if (buffer == NULL) {
+    return NULL;
+  }
+
+  if (buffer != self->priv->source_buffer) {
+    /* A new buffer was received since the last injection */
+    gst_buffer_replace (&self->priv->source_buffer, buffer);
+    gst_buffer_replace (&self->priv->injected_buffer, NULL);
+    self->priv->acumulated_time = 0;
+  }
+
+  /* Give it back unless a newer buffer was received or it was reset by a
+   * caps change meanwhile */
+  KMS_BUFFER_INJECTOR_LOCK (self);
+  if (generation != g_atomic_int_get (&self->priv->generation) ||
+      !g_atomic_pointer_compare_and_exchange (&self->priv->previous_buffer,
+          NULL, buffer)) {
+    gst_buffer_unref (buffer);
+  }
+  KMS_BUFFER_INJECTOR_UNLOCK (self);
+
+  self->priv->acumulated_time += offset_time * G_TIME_SPAN_SECOND;
+
+  injected = self->priv->injected_buffer;
+
+  if (injected == NULL || !gst_buffer_is_writable (injected)) {
+    /* Shallow copy, memories are shared with the source buffer */
+    gst_buffer_replace (&self->priv->injected_buffer, NULL);
+    injected = gst_buffer_copy (self->priv->source_buffer);
+    GST_BUFFER_FLAG_SET (injected, GST_BUFFER_FLAG_GAP);
+    GST_BUFFER_FLAG_SET (injected, GST_BUFFER_FLAG_DROPPABLE);
+    self->priv->injected_buffer = injected;
+  }
+
+  /* Injections of the same buffer only differ in their timestamps */
+  if (GST_BUFFER_DTS_IS_VALID (self->priv->source_buffer)) {
+    GST_BUFFER_DTS (injected) =
+        GST_BUFFER_DTS (self->priv->source_buffer) +
+        self->priv->acumulated_time;
+  }
+  if (GST_BUFFER_PTS_IS_VALID (self->priv->source_buffer)) {
+    GST_BUFFER_PTS (injected) =
+        GST_BUFFER_PTS (self->priv->source_buffer) +
+        self->priv->acumulated_time;
+  }
+
+  return gst_buffer_ref (injected);
+}
+
 static void
 kms_buffer_injector_generate_buffers (KmsBufferInjector * self)
 {
-  gint64 end_time;              /* microseconds */
+  GstBuffer *buffer;
   gint64 offset_time;           /* milliseconds */
+  guint now, elapsed;           /* milliseconds */
 
   KMS_BUFFER_INJECTOR_LOCK (self);
-  if ((!self->priv->configured) || (self->priv->previous_buffer == NULL)) {
+  if ((!g_atomic_int_get (&self->priv->configured)) ||
+      (g_atomic_pointer_get (&self->priv->previous_buffer) == NULL)) {
     GST_WARNING_OBJECT (self,
         "Buffer injector is not correctly configured, there is no buffer to send");
     KMS_BUFFER_INJECTOR_UNLOCK (self);
@@ -135,13 +228,12 @@ kms_buffer_injector_generate_buffers (KmsBufferInjector * self)
   }
 
   offset_time = (self->priv->factor_wait_time * self->priv->wait_time);
-  end_time = g_get_monotonic_time () + (offset_time) * G_TIME_SPAN_MILLISECOND;
-
-  self->priv->acumulated_time =
-      self->priv->acumulated_time + (offset_time * G_TIME_SPAN_SECOND);
-
   KMS_BUFFER_INJECTOR_UNLOCK (self);
 
+  now = kms_buffer_injector_get_time (self);
+  elapsed = MIN (now - (guint) g_atomic_int_get (&self->priv->last_arrival),
+      now - self->priv->last_injection);
+
   g_mutex_lock (&self->priv->mutex_generate);
 
   if (!self->priv->still_waiting) {
@@ -149,38 +241,29 @@ kms_buffer_injector_generate_buffers (KmsBufferInjector * self)
     return;
   }
 
-  if (!g_cond_wait_until (&self->priv->cond_generate,
-          &self->priv->mutex_generate, end_time)) {
-    GstBuffer *copy;
+  if (elapsed < offset_time) {
+    /* The chain function does not wake us up, sleep until the last
+     * received buffer is too old. Only state changes interrupt this */
+    g_cond_wait_until (&self->priv->cond_generate,
+        &self->priv->mutex_generate, g_get_monotonic_time () +
+        (offset_time - elapsed) * G_TIME_SPAN_MILLISECOND);
+    g_mutex_unlock (&self->priv->mutex_generate);
+    return;
+  }
 
-    //timeout reached, it is necessary to inject a new buffer
-    GST_DEBUG_OBJECT (self->priv->srcpad, "Injecting buffer");
-    KMS_BUFFER_INJECTOR_LOCK (self);
-    if (!self->priv->previous_buffer) {
-      KMS_BUFFER_INJECTOR_UNLOCK (self);
-      g_mutex_unlock (&self->priv->mutex_generate);
-      return;
-    }
-    copy = gst_buffer_copy (self->priv->previous_buffer);
+  //timeout reached, it is necessary to inject a new buffer
+  buffer = kms_buffer_injector_prepare_buffer (self, offset_time);
+  self->priv->last_injection = now;
 
-    if (GST_BUFFER_DTS_IS_VALID (copy)) {
-      GST_BUFFER_DTS (copy) =
-          GST_BUFFER_DTS (copy) + self->priv->acumulated_time;
-    }
-    if (GST_BUFFER_PTS_IS_VALID (copy)) {
-      GST_BUFFER_PTS (copy) =
-          GST_BUFFER_PTS (copy) + self->priv->acumulated_time;
-    }
-
-    GST_BUFFER_FLAG_SET (copy, GST_BUFFER_FLAG_GAP);
-    GST_BUFFER_FLAG_SET (copy, GST_BUFFER_FLAG_DROPPABLE);
-    KMS_BUFFER_INJECTOR_UNLOCK (self);
+  if (buffer != NULL) {
+    GST_DEBUG_OBJECT (self->priv->srcpad, "Injecting buffer");
 
     /* We need to check if segment event is present,
      * we could have receive a flush */
     kms_buffer_injector_check_segment_event (self);
-    gst_pad_push (self->priv->srcpad, copy);
+    gst_pad_push (self->priv->srcpad, buffer);
   }
+
   g_mutex_unlock (&self->priv->mutex_generate);
 }
 
@@ -190,6 +273,7 @@ kms_buffer_injector_config (KmsBufferInjector * self, GstCaps * caps)
   const GstStructure *str;
   const gchar *name;
   gint numerator, denominator;
+  GstBuffer *buffer;
   gboolean ret = TRUE;
 
   if (caps == NULL) {
@@ -214,9 +298,14 @@ kms_buffer_injector_config (KmsBufferInjector * self, GstCaps * caps)
     }
 
     GST_DEBUG_OBJECT (self, "Resetting last buffer");
-    gst_buffer_replace (&self->priv->previous_buffer, NULL);
+    g_atomic_int_inc (&self->priv->generation);
+    buffer = kms_buffer_injector_exchange_buffer (self, NULL);
     KMS_BUFFER_INJECTOR_UNLOCK (self);
 
+    if (buffer != NULL) {
+      gst_buffer_unref (buffer);
+    }
+
     GST_DEBUG ("Video: Wait time %" G_GINT64_FORMAT, self->priv->wait_time);
   } else {
     GST_DEBUG_OBJECT (self, "Injector configured as AUDIO");
@@ -230,38 +319,43 @@ kms_buffer_injector_config (KmsBufferInjector * self, GstCaps * caps)
 static GstFlowReturn
 kms_buffer_injector_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
-  KmsBufferInjector *buffer_injector = KMS_BUFFER_INJECTOR (parent);;
-
-  KMS_BUFFER_INJECTOR_LOCK (buffer_injector);
-  if ((buffer_injector->priv->type == AUDIO)
-      && (!buffer_injector->priv->configured)) {
-    //calculate waiting time based on buffer duration
-    if ((GST_CLOCK_TIME_IS_VALID (buffer->duration)) && (buffer->duration > 0)) {
-      buffer_injector->priv->wait_time = buffer->duration;
-    } else {
-      buffer_injector->priv->wait_time = DEFAULT_WAITING_TIME;
-    }
-    buffer_injector->priv->configured = TRUE;
+  KmsBufferInjector *buffer_injector = KMS_BUFFER_INJECTOR (parent);
+  GstBuffer *old;
 
-    GST_DEBUG_OBJECT (buffer_injector, "Audio: Wait time %" G_GINT64_FORMAT,
-        buffer_injector->priv->wait_time);
-  }
+  if (!g_atomic_int_get (&buffer_injector->priv->configured)) {
+    KMS_BUFFER_INJECTOR_LOCK (buffer_injector);
+    if ((buffer_injector->priv->type == AUDIO)
+        && (!buffer_injector->priv->configured)) {
+      //calculate waiting time based on buffer duration
+      if ((GST_CLOCK_TIME_IS_VALID (buffer->duration))
+          && (buffer->duration > 0)) {
+        buffer_injector->priv->wait_time = buffer->duration;
+      } else {
+        buffer_injector->priv->wait_time = DEFAULT_WAITING_TIME;
+      }
+      g_atomic_int_set (&buffer_injector->priv->configured, TRUE);
 
-  if (!buffer_injector->priv->configured) {
-    gst_buffer_unref (buffer);
+      GST_DEBUG_OBJECT (buffer_injector, "Audio: Wait time %" G_GINT64_FORMAT,
+          buffer_injector->priv->wait_time);
+    }
+
+    if (!buffer_injector->priv->configured) {
+      gst_buffer_unref (buffer);
+      KMS_BUFFER_INJECTOR_UNLOCK (buffer_injector);
+      return GST_FLOW_OK;
+    }
     KMS_BUFFER_INJECTOR_UNLOCK (buffer_injector);
-    return GST_FLOW_OK;
   }
 
-  gst_buffer_replace (&buffer_injector->priv->previous_buffer, buffer);
-  buffer_injector->priv->acumulated_time = 0;
+  /* Lock-free handoff, the pad task only needs a reference to the buffer */
+  old = kms_buffer_injector_exchange_buffer (buffer_injector,
+      gst_buffer_ref (buffer));
+  g_atomic_int_set (&buffer_injector->priv->last_arrival,
+      (gint) kms_buffer_injector_get_time (buffer_injector));
 
-  KMS_BUFFER_INJECTOR_UNLOCK (buffer_injector);
-
-  //wake up pad task
-  g_mutex_lock (&buffer_injector->priv->mutex_generate);
-  g_cond_signal (&buffer_injector->priv->cond_generate);
-  g_mutex_unlock (&buffer_injector->priv->mutex_generate);
+  if (old != NULL) {
+    gst_buffer_unref (old);
+  }
 
   return gst_pad_push (buffer_injector->priv->srcpad, buffer);
 }
@@ -277,8 +371,8 @@ kms_buffer_injector_handle_sink_event (GstPad * pad, GstObject * parent,
 
     gst_event_parse_caps (event, &caps);
     KMS_BUFFER_INJECTOR_LOCK (buffer_injector);
-    buffer_injector->priv->configured =
-        kms_buffer_injector_config (buffer_injector, caps);
+    g_atomic_int_set (&buffer_injector->priv->configured,
+        kms_buffer_injector_config (buffer_injector, caps));
     KMS_BUFFER_INJECTOR_UNLOCK (buffer_injector);
   }
 
@@ -341,6 +435,7 @@ kms_buffer_injector_init (KmsBufferInjector * self)
   self->priv->configured = FALSE;
   self->priv->still_waiting = TRUE;
   self->priv->acumulated_time = 0;
+  self->priv->start_time = g_get_monotonic_time ();
 
   self->priv->factor_wait_time = 2;
 }
@@ -382,6 +477,9 @@ kms_buffer_injector_finalize (GObject * object)
     gst_buffer_unref (buffer_injector->priv->previous_buffer);
   }
 
+  gst_buffer_replace (&buffer_injector->priv->source_buffer, NULL);
+  gst_buffer_replace (&buffer_injector->priv->injected_buffer, NULL);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -25,6 +25,7 @@
 #include "kmsaudiomixerbin.h"
 #include "kmsbitratefilter.h"
 #include "kmsbufferinjector.h"
+#include "kmsrtppacer.h"
 #include "kmspassthrough.h"
 #include "kmsdummysrc.h"
 #include "kmsdummysink.h"
@@ -60,6 +61,9 @@ kurento_init (GstPlugin * kurento)
   if (!kms_buffer_injector_plugin_init (kurento))
     return FALSE;
 
+  if (!kms_rtp_pacer_plugin_init (kurento))
+    return FALSE;
+
   if (!kms_pass_through_plugin_init (kurento))
     return FALSE;
 
@@ -39,6 +39,8 @@ GST_DEBUG_CATEGORY_STATIC (kms_dummy_src_debug_category);
 )
 
 #define DEFAULT_AUDIO_FREQ 440
+#define DEFAULT_DATA_BATCH 1
+#define MAX_DATA_BATCH 1024
 
 struct _KmsDummySrcPrivate
 {
@@ -50,6 +52,7 @@ struct _KmsDummySrcPrivate
   GstElement *audioappsrc;
   GstElement *dataappsrc;
   guint data_index;
+  guint data_batch;
 };
 
 G_DEFINE_TYPE_WITH_CODE (KmsDummySrc, kms_dummy_src,
@@ -65,6 +68,7 @@ enum
   PROP_AUDIO,
   PROP_VIDEO,
   PROP_AUDIO_FREQ,
+  PROP_DATA_BATCH,
   N_PROPERTIES
 };
 
@@ -72,6 +76,22 @@ enum
 
 static GParamSpec *obj_properties[N_PROPERTIES] = { NULL, };
 
+static GstBuffer *
+kms_dummy_src_new_data_buffer (KmsDummySrc * self, GstClockTime pts)
+{
+  GstBuffer *buffer;
+  gchar *buffer_data;
+
+  buffer_data = g_strdup_printf ("Test buffer %d",
+      g_atomic_int_add (&self->priv->data_index, 1));
+
+  buffer = gst_buffer_new_wrapped (buffer_data, strlen (buffer_data));
+
+  GST_BUFFER_PTS (buffer) = pts;
+
+  return buffer;
+}
+
 static void
 kms_dummy_src_feed_data_channel (GstElement * appsrc, guint unused_size,
     gpointer data)
@@ -79,38 +99,60 @@ kms_dummy_src_feed_data_channel (GstElement * appsrc, guint unused_size,
   KmsDummySrc *self = KMS_DUMMY_SRC (data);
   GstClockTime running_time, base_time, now;
   GstClock *clock;
-  GstBuffer *buffer;
-  gchar *buffer_data;
+  GstBufferList *list;
   GstFlowReturn ret;
+  guint i, batch;
 
   if ((clock = GST_ELEMENT_CLOCK (appsrc)) == NULL) {
     GST_ERROR_OBJECT (GST_ELEMENT (data), "no clock, we can't sync");
     return;
   }
 
-  buffer_data = g_strdup_printf ("Test buffer %d",
-      g_atomic_int_add (&self->priv->data_index, 1));
-
-  buffer = gst_buffer_new_wrapped (buffer_data, strlen (buffer_data));
-
   base_time = GST_ELEMENT_CAST (appsrc)->base_time;
 
   now = gst_clock_get_time (clock);
   running_time = now - base_time;
 
+  batch = g_atomic_int_get (&self->priv->data_batch);
+
   /* Live sources always timestamp their buffers with the running_time of the */
   /* pipeline. This is needed to be able to match the timestamps of different */
   /* live sources in order to synchronize them. */
-  GST_BUFFER_PTS (buffer) = running_time;
+  if (batch <= 1) {
+    GstBuffer *buffer = kms_dummy_src_new_data_buffer (self, running_time);
 
-  g_signal_emit_by_name (appsrc, "push-buffer", buffer, &ret);
+    g_signal_emit_by_name (appsrc, "push-buffer", buffer, &ret);
+    gst_buffer_unref (buffer);
+
+    goto end;
+  }
 
+  /* Messages of a batch are pushed downstream in a single list */
+  list = gst_buffer_list_new_sized (batch);
+
+  for (i = 0; i < batch; i++) {
+    gst_buffer_list_add (list, kms_dummy_src_new_data_buffer (self,
+            running_time));
+  }
+
+#if GST_CHECK_VERSION(1,14,0)
+  g_signal_emit_by_name (appsrc, "push-buffer-list", list, &ret);
+#else
+  /* This appsrc can not push lists, messages go one by one */
+  ret = GST_FLOW_OK;
+  for (i = 0; i < batch && ret == GST_FLOW_OK; i++) {
+    g_signal_emit_by_name (appsrc, "push-buffer",
+        gst_buffer_list_get (list, i), &ret);
+  }
+#endif
+
+  gst_buffer_list_unref (list);
+
+end:
   if (ret != GST_FLOW_OK) {
     /* something wrong */
     GST_WARNING ("Could not send buffer");
   }
-
-  gst_buffer_unref (buffer);
 }
 
 static void
@@ -181,6 +223,9 @@ kms_dummy_src_set_property (GObject * object, guint property_id,
         gst_element_sync_state_with_parent (self->priv->videoappsrc);
       }
       break;
+    case PROP_DATA_BATCH:
+      g_atomic_int_set (&self->priv->data_batch, g_value_get_uint (value));
+      break;
     case PROP_AUDIO_FREQ:
       self->priv->audio_freq = g_value_get_double (value);
 
@@ -216,6 +261,9 @@ kms_dummy_src_get_property (GObject * object, guint property_id,
     case PROP_AUDIO_FREQ:
       g_value_set_double (value, self->priv->audio_freq);
       break;
+    case PROP_DATA_BATCH:
+      g_value_set_uint (value, self->priv->data_batch);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -256,6 +304,11 @@ kms_dummy_src_class_init (KmsDummySrcClass * klass)
       "Audio frequesncy", "Sets audio frequency when audio is enabled", 0,
       20000, DEFAULT_AUDIO_FREQ, (G_PARAM_CONSTRUCT | G_PARAM_READWRITE));
 
+  obj_properties[PROP_DATA_BATCH] = g_param_spec_uint ("data-batch",
+      "Data batch", "Number of data messages pushed together in a buffer list",
+      1, MAX_DATA_BATCH, DEFAULT_DATA_BATCH,
+      (G_PARAM_CONSTRUCT | G_PARAM_READWRITE));
+
   g_object_class_install_properties (gobject_class,
       N_PROPERTIES, obj_properties);
 
@@ -25,10 +25,20 @@
 #include "kmsutils.h"
 #include "kms-core-enumtypes.h"
 #include "kmsfiltertype.h"
+#include "kmsframedropper.h"
+#include "kmsstats.h"
 
 #define PLUGIN_NAME "filterelement"
 
 #define DEFAULT_FILTER_TYPE KMS_FILTER_TYPE_AUTODETECT
+#define DEFAULT_BYPASS FALSE
+
+/* Video frames are dropped before the filter above this latency */
+#define FILTER_LATENCY_TARGET (200 * GST_MSECOND)
+
+/* The filter only processes the newest frame, bypassed media is not lost */
+#define FILTER_QUEUE_SIZE 1
+#define BYPASS_QUEUE_SIZE 200
 
 GST_DEBUG_CATEGORY_STATIC (kms_filter_element_debug_category);
 #define GST_CAT_DEFAULT kms_filter_element_debug_category
@@ -55,6 +65,13 @@ struct _KmsFilterElementPrivate
   gchar *filter_factory;
   GstElement *filter;
   KmsFilterType filter_type;
+
+  GstElement *queue;
+  gboolean bypass;
+  gboolean bypassed;
+  gulong bypass_probe;
+
+  KmsFrameDropper *dropper;
 };
 
 /* properties */
@@ -63,7 +80,8 @@ enum
   PROP_0,
   PROP_FILTER_FACTORY,
   PROP_FILTER,
-  PROP_FILTER_TYPE
+  PROP_FILTER_TYPE,
+  PROP_BYPASS
 };
 
 /* pad templates */
@@ -75,6 +93,157 @@ G_DEFINE_TYPE_WITH_CODE (KmsFilterElement, kms_filter_element,
     GST_DEBUG_CATEGORY_INIT (kms_filter_element_debug_category, PLUGIN_NAME,
         0, "debug category for filterelement element"));
 
+static GstPadProbeReturn
+kms_filter_element_drop_until_accepted_caps (GstPad * pad,
+    GstPadProbeInfo * info, gpointer filter_sink)
+{
+  GstEvent *event;
+  GstCaps *caps;
+
+  if (!(GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_BOTH)) {
+    /* Media negotiated while bypassed cannot be processed by the filter */
+    return GST_PAD_PROBE_DROP;
+  }
+
+  event = gst_pad_probe_info_get_event (info);
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CAPS) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  gst_event_parse_caps (event, &caps);
+
+  if (!gst_pad_query_accept_caps (GST_PAD (filter_sink), caps)) {
+    GST_DEBUG_OBJECT (pad, "Dropping caps not accepted by filter %"
+        GST_PTR_FORMAT, caps);
+    return GST_PAD_PROBE_DROP;
+  }
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+static void
+kms_filter_element_configure_queue (KmsFilterElement * self)
+{
+  if (self->priv->bypass) {
+    /* Encoded media would be broken if any buffer was dropped */
+    g_object_set (self->priv->queue, "leaky", 0, "max-size-buffers",
+        BYPASS_QUEUE_SIZE, NULL);
+  } else {
+    g_object_set (self->priv->queue, "leaky", 2, "max-size-buffers",
+        FILTER_QUEUE_SIZE, NULL);
+  }
+}
+
+/* Must be called with the lock held and the queue src pad blocked or idle */
+static void
+kms_filter_element_relink (KmsFilterElement * self)
+{
+  GstPad *queue_sink, *queue_src, *filter_sink, *filter_src, *output_sink;
+  GstCaps *caps;
+
+  queue_sink = gst_element_get_static_pad (self->priv->queue, "sink");
+  queue_src = gst_element_get_static_pad (self->priv->queue, "src");
+  filter_sink = gst_element_get_static_pad (self->priv->filter, "sink");
+  filter_src = gst_element_get_static_pad (self->priv->filter, "src");
+  /* The output element may have been replaced, use the one linked now */
+  output_sink = gst_pad_get_peer (self->priv->bypassed ? queue_src :
+      filter_src);
+
+  if (output_sink == NULL) {
+    GST_WARNING_OBJECT (self, "Filter output is not linked");
+  } else if (self->priv->bypass) {
+    GST_DEBUG_OBJECT (self, "Bypassing filter");
+    gst_pad_unlink (queue_src, filter_sink);
+    gst_pad_unlink (filter_src, output_sink);
+    gst_pad_link_full (queue_src, output_sink, GST_PAD_LINK_CHECK_NOTHING);
+  } else {
+    GST_DEBUG_OBJECT (self, "Connecting filter back");
+    gst_pad_unlink (queue_src, output_sink);
+    gst_pad_link_full (filter_src, output_sink, GST_PAD_LINK_CHECK_NOTHING);
+    gst_pad_link_full (queue_src, filter_sink, GST_PAD_LINK_CHECK_NOTHING);
+
+    caps = gst_pad_get_current_caps (queue_src);
+    if (caps != NULL) {
+      if (!gst_pad_query_accept_caps (filter_sink, caps)) {
+        gst_pad_add_probe (queue_src, GST_PAD_PROBE_TYPE_DATA_DOWNSTREAM,
+            kms_filter_element_drop_until_accepted_caps,
+            g_object_ref (filter_sink), g_object_unref);
+      }
+      gst_caps_unref (caps);
+    }
+  }
+
+  self->priv->bypassed = self->priv->bypass;
+  kms_filter_element_configure_queue (self);
+
+  if (self->priv->dropper != NULL) {
+    kms_frame_dropper_set_enabled (self->priv->dropper, !self->priv->bypass);
+  }
+
+  /* Let upstream negotiate the best format for the new path */
+  gst_pad_push_event (queue_sink, gst_event_new_reconfigure ());
+
+  g_object_unref (queue_sink);
+  g_object_unref (queue_src);
+  g_object_unref (filter_sink);
+  g_object_unref (filter_src);
+
+  if (output_sink != NULL) {
+    g_object_unref (output_sink);
+  }
+}
+
+static GstPadProbeReturn
+kms_filter_element_switch_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer data)
+{
+  KmsFilterElement *self = KMS_FILTER_ELEMENT (data);
+  GstBuffer *buffer = gst_pad_probe_info_get_buffer (info);
+
+  if (buffer != NULL && GST_BUFFER_FLAG_IS_SET (buffer,
+          GST_BUFFER_FLAG_DELTA_UNIT)) {
+    /* Switch on a keyframe so the new path starts decodable */
+    return GST_PAD_PROBE_PASS;
+  }
+
+  KMS_FILTER_ELEMENT_LOCK (self);
+  self->priv->bypass_probe = 0;
+  if (self->priv->bypass != self->priv->bypassed) {
+    kms_filter_element_relink (self);
+  }
+  KMS_FILTER_ELEMENT_UNLOCK (self);
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+/* Must be called with the lock held */
+static void
+kms_filter_element_set_bypass (KmsFilterElement * self, gboolean bypass)
+{
+  GstPad *queue_src;
+
+  self->priv->bypass = bypass;
+
+  if (self->priv->queue == NULL || self->priv->bypass_probe != 0 ||
+      self->priv->bypass == self->priv->bypassed) {
+    /* Not connected yet or switch already pending */
+    return;
+  }
+
+  if (GST_STATE (self) < GST_STATE_PAUSED) {
+    /* No data flowing, pads can be changed right away */
+    kms_filter_element_relink (self);
+    return;
+  }
+
+  queue_src = gst_element_get_static_pad (self->priv->queue, "src");
+  self->priv->bypass_probe = gst_pad_add_probe (queue_src,
+      GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_BUFFER,
+      kms_filter_element_switch_probe, self, NULL);
+  g_object_unref (queue_src);
+}
+
 static void
 kms_filter_element_connect_filter (KmsFilterElement * self,
     KmsElementPadType type, GstElement * filter, GstElement * agnosticbin)
@@ -82,13 +251,29 @@ kms_filter_element_connect_filter (KmsFilterElement * self,
   GstElement *queue = gst_element_factory_make ("queue", NULL);
   GstPad *target = gst_element_get_static_pad (queue, "sink");
 
-  g_object_set (queue, "leaky", 2, "max-size-buffers", 1, NULL);
+  if (type == KMS_ELEMENT_PAD_TYPE_VIDEO) {
+    GstPad *filter_src = gst_element_get_static_pad (filter, "src");
+
+    self->priv->dropper = kms_frame_dropper_new (target, filter_src,
+        FILTER_LATENCY_TARGET);
+    kms_frame_dropper_set_enabled (self->priv->dropper, !self->priv->bypass);
+    g_object_unref (filter_src);
+  }
 
   gst_bin_add_many (GST_BIN (self), queue, filter, NULL);
 
   self->priv->filter = filter;
+  self->priv->queue = queue;
+
+  if (self->priv->bypass) {
+    GST_DEBUG_OBJECT (self, "Filter connected in bypass mode");
+    gst_element_link (queue, agnosticbin);
+  } else {
+    gst_element_link_many (queue, filter, agnosticbin, NULL);
+  }
+  self->priv->bypassed = self->priv->bypass;
+  kms_filter_element_configure_queue (self);
 
-  gst_element_link_many (queue, filter, agnosticbin, NULL);
   gst_element_sync_state_with_parent (filter);
   gst_element_sync_state_with_parent (queue);
 
@@ -240,6 +425,9 @@ kms_filter_element_get_property (GObject * object, guint prop_id,
     case PROP_FILTER_TYPE:
       g_value_set_enum (value, self->priv->filter_type);
       break;
+    case PROP_BYPASS:
+      g_value_set_boolean (value, self->priv->bypass);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -285,6 +473,9 @@ kms_filter_element_set_property (GObject * object, guint prop_id,
     case PROP_FILTER_TYPE:
       self->priv->filter_type = g_value_get_enum (value);
       break;
+    case PROP_BYPASS:
+      kms_filter_element_set_bypass (self, g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -303,6 +494,12 @@ kms_filter_element_dispose (GObject * object)
 
   /* No need to release as bin is owning the reference */
   filter_element->priv->filter = NULL;
+  filter_element->priv->queue = NULL;
+
+  if (filter_element->priv->dropper != NULL) {
+    kms_frame_dropper_destroy (filter_element->priv->dropper);
+    filter_element->priv->dropper = NULL;
+  }
 
   G_OBJECT_CLASS (kms_filter_element_parent_class)->dispose (object);
 }
@@ -325,10 +522,41 @@ kms_filter_element_finalize (GObject * object)
   G_OBJECT_CLASS (kms_filter_element_parent_class)->finalize (object);
 }
 
+static GstStructure *
+kms_filter_element_stats (KmsElement * obj, gchar * selector)
+{
+  KmsFilterElement *self = KMS_FILTER_ELEMENT (obj);
+  GstStructure *stats, *e_stats;
+  guint64 dropped = 0;
+
+  /* chain up */
+  stats =
+      KMS_ELEMENT_CLASS (kms_filter_element_parent_class)->stats (obj,
+      selector);
+
+  e_stats = kms_stats_get_element_stats (stats);
+
+  if (e_stats == NULL) {
+    return stats;
+  }
+
+  KMS_FILTER_ELEMENT_LOCK (self);
+  if (self->priv->dropper != NULL) {
+    gst_structure_get_uint64 (e_stats, "dropped-frames", &dropped);
+    dropped += kms_frame_dropper_get_dropped (self->priv->dropper);
+    gst_structure_set (e_stats, "dropped-frames", G_TYPE_UINT64, dropped,
+        NULL);
+  }
+  KMS_FILTER_ELEMENT_UNLOCK (self);
+
+  return stats;
+}
+
 static void
 kms_filter_element_class_init (KmsFilterElementClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  KmsElementClass *kms_element_class = KMS_ELEMENT_CLASS (klass);
 
   gst_element_class_set_static_metadata (GST_ELEMENT_CLASS (klass),
       "FilterElement", "Generic/Filter", "Kurento filter_element",
@@ -340,6 +568,8 @@ kms_filter_element_class_init (KmsFilterElementClass * klass)
   gobject_class->set_property = kms_filter_element_set_property;
   gobject_class->get_property = kms_filter_element_get_property;
 
+  kms_element_class->stats = GST_DEBUG_FUNCPTR (kms_filter_element_stats);
+
   /* define properties */
   g_object_class_install_property (gobject_class, PROP_FILTER_FACTORY,
       g_param_spec_string ("filter-factory", "filter-factory",
@@ -355,6 +585,12 @@ kms_filter_element_class_init (KmsFilterElementClass * klass)
           "type of the filter",
           KMS_TYPE_FILTER_TYPE, DEFAULT_FILTER_TYPE, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_BYPASS,
+      g_param_spec_boolean ("bypass", "Bypass",
+          "Skip the filter and forward media untouched. Changes take effect "
+          "on the next keyframe", DEFAULT_BYPASS,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
   /* Registers a private structure for the instantiatable type */
   g_type_class_add_private (klass, sizeof (KmsFilterElementPrivate));
 }
@@ -368,6 +604,7 @@ kms_filter_element_init (KmsFilterElement * self)
 
   self->priv->filter = NULL;
   self->priv->filter_factory = NULL;
+  self->priv->bypass = DEFAULT_BYPASS;
 }
 
 gboolean
@@ -0,0 +1,867 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kmsrtppacer.h"
+#include <gst/rtp/gstrtpbuffer.h>
+
+#define PLUGIN_NAME "rtppacer"
+
+#define KMS_RTP_PACER_CAPS "application/x-rtp"
+
+#define DEFAULT_BITRATE 0
+#define DEFAULT_PACING_FACTOR 2.5
+#define DEFAULT_BURST_TIME 40   /* ms */
+#define DEFAULT_MAX_QUEUE_TIME 500      /* ms */
+
+/* Weight of the newest sample in the average queue delay is 1/N */
+#define QUEUE_DELAY_AVG_WEIGHT 16
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (KMS_RTP_PACER_CAPS)
+    );
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (KMS_RTP_PACER_CAPS)
+    );
+
+GST_DEBUG_CATEGORY_STATIC (kms_rtp_pacer_debug);
+#define GST_CAT_DEFAULT kms_rtp_pacer_debug
+#define kms_rtp_pacer_parent_class parent_class
+
+G_DEFINE_TYPE_WITH_CODE (KmsRtpPacer, kms_rtp_pacer, GST_TYPE_ELEMENT,
+    GST_DEBUG_CATEGORY_INIT (kms_rtp_pacer_debug, PLUGIN_NAME, 0,
+        "debug category for " PLUGIN_NAME " element"));
+
+#define KMS_RTP_PACER_GET_PRIVATE(obj) ( \
+  G_TYPE_INSTANCE_GET_PRIVATE (          \
+    (obj),                               \
+    KMS_TYPE_RTP_PACER,                  \
+    KmsRtpPacerPrivate                   \
+  )                                      \
+)
+
+#define KMS_RTP_PACER_LOCK(obj) (                 \
+  g_mutex_lock (&KMS_RTP_PACER (obj)->priv->mutex) \
+)
+
+#define KMS_RTP_PACER_UNLOCK(obj) (                 \
+  g_mutex_unlock (&KMS_RTP_PACER (obj)->priv->mutex) \
+)
+
+typedef struct _KmsRtpPacerItem
+{
+  GstMiniObject *object;
+  gint64 enqueued;              /* microseconds */
+  guint size;
+  guint64 events;               /* Serialized events queued before it */
+} KmsRtpPacerItem;
+
+struct _KmsRtpPacerPrivate
+{
+  GMutex mutex;
+  GCond cond;
+  /* Pending wait on the element clock */
+  GstClockID clock_id;
+
+  GstPad *sinkpad;
+  GstPad *srcpad;
+  GstFlowReturn srcresult;
+
+  /*
+   * Retransmissions are served before new media, but never before the
+   * serialized events that were queued ahead of them
+   */
+  GQueue *retransmissions;
+  GQueue *items;
+  guint64 queued_events;
+  guint64 sent_events;
+  /* ssrc -> highest seqnum received */
+  GHashTable *seqnums;
+  guint queued_packets;
+  guint queued_bytes;
+
+  /* bps */
+  gint bitrate;
+  gfloat pacing_factor;
+  /* milliseconds */
+  guint burst_time;
+  guint max_queue_time;
+
+  /* bytes */
+  gint64 budget;
+  /* microseconds */
+  gint64 last_refill;
+
+  /* stats */
+  GstClockTime avg_queue_delay;
+  GstClockTime max_queue_delay;
+  guint64 sent_packets;
+  guint64 forced_packets;
+};
+
+enum
+{
+  PROP_0,
+  PROP_BITRATE,
+  PROP_PACING_FACTOR,
+  PROP_BURST_TIME,
+  PROP_MAX_QUEUE_TIME,
+  PROP_STATS,
+  N_PROPERTIES
+};
+
+/*
+ * Times are taken from the element clock so that pacing follows the pipeline
+ * clock, falling back to the monotonic time while no clock is set.
+ */
+static GstClock *
+kms_rtp_pacer_get_clock (KmsRtpPacer * self)
+{
+  return gst_element_get_clock (GST_ELEMENT (self));
+}
+
+static gint64
+kms_rtp_pacer_get_now (KmsRtpPacer * self)
+{
+  GstClock *clock = kms_rtp_pacer_get_clock (self);
+  gint64 now;
+
+  if (clock == NULL) {
+    return g_get_monotonic_time ();
+  }
+
+  now = gst_clock_get_time (clock) / GST_USECOND;
+  gst_object_unref (clock);
+
+  return now;
+}
+
+/* Must be called with the lock held */
+static void
+kms_rtp_pacer_wake_up (KmsRtpPacer * self)
+{
+  g_cond_signal (&self->priv->cond);
+
+  if (self->priv->clock_id != NULL) {
+    gst_clock_id_unschedule (self->priv->clock_id);
+  }
+}
+
+/* Must be called with the lock held, returns with it held */
+static void
+kms_rtp_pacer_wait (KmsRtpPacer * self, gint64 now, gint64 wait)
+{
+  GstClock *clock = kms_rtp_pacer_get_clock (self);
+  GstClockID id;
+
+  if (clock == NULL) {
+    g_cond_wait_until (&self->priv->cond, &self->priv->mutex, now + wait);
+    return;
+  }
+
+  id = gst_clock_new_single_shot_id (clock, (now + wait) * GST_USECOND);
+  self->priv->clock_id = gst_clock_id_ref (id);
+  gst_object_unref (clock);
+
+  KMS_RTP_PACER_UNLOCK (self);
+  gst_clock_id_wait (id, NULL);
+  KMS_RTP_PACER_LOCK (self);
+
+  if (self->priv->clock_id == id) {
+    gst_clock_id_unref (self->priv->clock_id);
+    self->priv->clock_id = NULL;
+  }
+
+  gst_clock_id_unref (id);
+}
+
+static KmsRtpPacerItem *
+kms_rtp_pacer_item_new (GstMiniObject * object, gint64 enqueued, guint size)
+{
+  KmsRtpPacerItem *item = g_slice_new0 (KmsRtpPacerItem);
+
+  item->object = object;
+  item->enqueued = enqueued;
+  item->size = size;
+
+  return item;
+}
+
+static void
+kms_rtp_pacer_item_destroy (KmsRtpPacerItem * item)
+{
+  if (item->object != NULL) {
+    gst_mini_object_unref (item->object);
+  }
+
+  g_slice_free (KmsRtpPacerItem, item);
+}
+
+static void
+kms_rtp_pacer_flush_queue (KmsRtpPacer * self, GQueue * queue)
+{
+  KmsRtpPacerItem *item;
+
+  while ((item = g_queue_pop_head (queue)) != NULL) {
+    if (GST_IS_EVENT (item->object)) {
+      GstEvent *event = GST_EVENT_CAST (item->object);
+
+      /* Keep sticky events so that caps are not lost across a flush */
+      if (GST_EVENT_IS_STICKY (event)
+          && GST_EVENT_TYPE (event) != GST_EVENT_SEGMENT
+          && GST_EVENT_TYPE (event) != GST_EVENT_EOS) {
+        gst_pad_store_sticky_event (self->priv->srcpad, event);
+      }
+    }
+
+    kms_rtp_pacer_item_destroy (item);
+  }
+}
+
+/* Must be called with the lock held */
+static void
+kms_rtp_pacer_flush (KmsRtpPacer * self)
+{
+  kms_rtp_pacer_flush_queue (self, self->priv->retransmissions);
+  kms_rtp_pacer_flush_queue (self, self->priv->items);
+
+  self->priv->queued_packets = 0;
+  self->priv->queued_bytes = 0;
+  self->priv->queued_events = 0;
+  self->priv->sent_events = 0;
+  self->priv->budget = 0;
+  self->priv->last_refill = -1;
+}
+
+static gboolean
+kms_rtp_pacer_is_retransmission (KmsRtpPacer * self, GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  gpointer value;
+  guint32 ssrc;
+  guint16 seq;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    return FALSE;
+  }
+
+  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+  seq = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (g_hash_table_lookup_extended (self->priv->seqnums,
+          GUINT_TO_POINTER (ssrc), NULL, &value)) {
+    guint16 highest = GPOINTER_TO_UINT (value);
+
+    /* rtprtxqueue resends packets with their original seqnum */
+    if (gst_rtp_buffer_compare_seqnum (highest, seq) <= 0) {
+      return TRUE;
+    }
+  }
+
+  g_hash_table_insert (self->priv->seqnums, GUINT_TO_POINTER (ssrc),
+      GUINT_TO_POINTER (seq));
+
+  return FALSE;
+}
+
+/* Must be called with the lock held */
+static void
+kms_rtp_pacer_enqueue_buffer (KmsRtpPacer * self, GstBuffer * buffer,
+    gint64 now)
+{
+  KmsRtpPacerItem *item;
+
+  item = kms_rtp_pacer_item_new (GST_MINI_OBJECT_CAST (buffer), now,
+      gst_buffer_get_size (buffer));
+
+  if (kms_rtp_pacer_is_retransmission (self, buffer)) {
+    GST_LOG_OBJECT (self, "Prioritizing retransmission %" GST_PTR_FORMAT,
+        buffer);
+    item->events = self->priv->queued_events;
+    g_queue_push_tail (self->priv->retransmissions, item);
+  } else {
+    g_queue_push_tail (self->priv->items, item);
+  }
+
+  self->priv->queued_packets++;
+  self->priv->queued_bytes += item->size;
+}
+
+/* Must be called with the lock held */
+static GQueue *
+kms_rtp_pacer_get_next_queue (KmsRtpPacer * self)
+{
+  KmsRtpPacerItem *item = g_queue_peek_head (self->priv->retransmissions);
+
+  /* Otherwise the pending events are still in items, send them first */
+  if (item != NULL && item->events <= self->priv->sent_events) {
+    return self->priv->retransmissions;
+  }
+
+  if (!g_queue_is_empty (self->priv->items)) {
+    return self->priv->items;
+  }
+
+  return NULL;
+}
+
+/* Pacing rate in bytes per second, 0 if pacing is disabled */
+static gint64
+kms_rtp_pacer_get_rate (KmsRtpPacer * self)
+{
+  return (gint64) (self->priv->bitrate * self->priv->pacing_factor) / 8;
+}
+
+static void
+kms_rtp_pacer_refill (KmsRtpPacer * self, gint64 rate, gint64 now)
+{
+  gint64 max_budget, added;
+
+  if (self->priv->last_refill < 0) {
+    self->priv->last_refill = now;
+  }
+
+  added = rate * (now - self->priv->last_refill) / G_USEC_PER_SEC;
+
+  /* Keep fractions of a byte for the next refill */
+  if (added <= 0) {
+    return;
+  }
+
+  max_budget = MAX (rate * self->priv->burst_time / 1000, 1);
+
+  self->priv->budget = MIN (self->priv->budget + added, max_budget);
+  self->priv->last_refill = now;
+}
+
+/*
+ * Returns the time in microseconds to wait before @item can be sent. Packets
+ * that have been queued longer than max-queue-time are sent regardless of
+ * the budget so that the queue cannot grow without bound.
+ */
+static gint64
+kms_rtp_pacer_get_wait_time (KmsRtpPacer * self, KmsRtpPacerItem * item,
+    gint64 now)
+{
+  gint64 rate, wait, expiration;
+
+  if (!GST_IS_BUFFER (item->object)) {
+    return 0;
+  }
+
+  rate = kms_rtp_pacer_get_rate (self);
+
+  if (rate <= 0) {
+    /* Start with an empty budget when pacing gets enabled */
+    self->priv->budget = 0;
+    self->priv->last_refill = -1;
+    return 0;
+  }
+
+  kms_rtp_pacer_refill (self, rate, now);
+
+  if (self->priv->budget > 0) {
+    return 0;
+  }
+
+  expiration = item->enqueued +
+      self->priv->max_queue_time * G_TIME_SPAN_MILLISECOND - now;
+
+  if (expiration <= 0) {
+    self->priv->forced_packets++;
+    return 0;
+  }
+
+  wait = ((1 - self->priv->budget) * G_USEC_PER_SEC + rate - 1) / rate;
+
+  return MAX (MIN (wait, expiration), 1);
+}
+
+static void
+kms_rtp_pacer_update_stats (KmsRtpPacer * self, KmsRtpPacerItem * item,
+    gint64 now)
+{
+  GstClockTime delay = (now - item->enqueued) * GST_USECOND;
+
+  if (self->priv->sent_packets == 0) {
+    self->priv->avg_queue_delay = delay;
+  } else {
+    self->priv->avg_queue_delay +=
+        ((gint64) delay -
+        (gint64) self->priv->avg_queue_delay) / QUEUE_DELAY_AVG_WEIGHT;
+  }
+
+  self->priv->max_queue_delay = MAX (self->priv->max_queue_delay, delay);
+  self->priv->sent_packets++;
+}
+
+static void
+kms_rtp_pacer_loop (KmsRtpPacer * self)
+{
+  KmsRtpPacerItem *item;
+  GstMiniObject *object;
+  GstFlowReturn ret;
+  GQueue *queue;
+  gint64 now, wait;
+
+  KMS_RTP_PACER_LOCK (self);
+
+  while (TRUE) {
+    if (self->priv->srcresult != GST_FLOW_OK) {
+      goto paused;
+    }
+
+    queue = kms_rtp_pacer_get_next_queue (self);
+    if (queue != NULL) {
+      break;
+    }
+
+    g_cond_wait (&self->priv->cond, &self->priv->mutex);
+  }
+
+  item = g_queue_peek_head (queue);
+  now = kms_rtp_pacer_get_now (self);
+  wait = kms_rtp_pacer_get_wait_time (self, item, now);
+
+  if (wait > 0) {
+    /* A retransmission may arrive meanwhile, so decide again after waking */
+    kms_rtp_pacer_wait (self, now, wait);
+    KMS_RTP_PACER_UNLOCK (self);
+    return;
+  }
+
+  g_queue_pop_head (queue);
+
+  if (GST_IS_BUFFER (item->object)) {
+    self->priv->budget -= item->size;
+    self->priv->queued_packets--;
+    self->priv->queued_bytes -= item->size;
+    kms_rtp_pacer_update_stats (self, item, now);
+  } else {
+    self->priv->sent_events++;
+  }
+
+  object = item->object;
+  item->object = NULL;
+  kms_rtp_pacer_item_destroy (item);
+
+  KMS_RTP_PACER_UNLOCK (self);
+
+  if (GST_IS_BUFFER (object)) {
+    ret = gst_pad_push (self->priv->srcpad, GST_BUFFER_CAST (object));
+  } else {
+    GstEvent *event = GST_EVENT_CAST (object);
+
+    ret = GST_EVENT_TYPE (event) == GST_EVENT_EOS ? GST_FLOW_EOS : GST_FLOW_OK;
+    gst_pad_push_event (self->priv->srcpad, event);
+  }
+
+  /* RTP senders must keep going even if nothing is linked downstream */
+  if (ret == GST_FLOW_OK || ret == GST_FLOW_NOT_LINKED) {
+    return;
+  }
+
+  KMS_RTP_PACER_LOCK (self);
+
+  if (self->priv->srcresult == GST_FLOW_OK) {
+    self->priv->srcresult = ret;
+  }
+
+  if (ret < GST_FLOW_EOS) {
+    GST_ELEMENT_ERROR (self, STREAM, FAILED, ("Internal data flow error."),
+        ("streaming task paused, reason %s (%d)", gst_flow_get_name (ret),
+            ret));
+  }
+
+paused:
+  GST_DEBUG_OBJECT (self, "Pausing task, reason %s",
+      gst_flow_get_name (self->priv->srcresult));
+  KMS_RTP_PACER_UNLOCK (self);
+
+  gst_pad_pause_task (self->priv->srcpad);
+}
+
+static GstFlowReturn
+kms_rtp_pacer_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  KmsRtpPacer *self = KMS_RTP_PACER (parent);
+  GstFlowReturn ret;
+
+  KMS_RTP_PACER_LOCK (self);
+
+  ret = self->priv->srcresult;
+  if (ret != GST_FLOW_OK) {
+    KMS_RTP_PACER_UNLOCK (self);
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
+  kms_rtp_pacer_enqueue_buffer (self, buffer, kms_rtp_pacer_get_now (self));
+  kms_rtp_pacer_wake_up (self);
+
+  KMS_RTP_PACER_UNLOCK (self);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+kms_rtp_pacer_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  KmsRtpPacer *self = KMS_RTP_PACER (parent);
+  GstFlowReturn ret;
+  guint i, len;
+  gint64 now;
+
+  KMS_RTP_PACER_LOCK (self);
+
+  ret = self->priv->srcresult;
+  if (ret != GST_FLOW_OK) {
+    KMS_RTP_PACER_UNLOCK (self);
+    gst_buffer_list_unref (list);
+    return ret;
+  }
+
+  now = kms_rtp_pacer_get_now (self);
+  len = gst_buffer_list_length (list);
+
+  for (i = 0; i < len; i++) {
+    kms_rtp_pacer_enqueue_buffer (self,
+        gst_buffer_ref (gst_buffer_list_get (list, i)), now);
+  }
+
+  kms_rtp_pacer_wake_up (self);
+
+  KMS_RTP_PACER_UNLOCK (self);
+
+  gst_buffer_list_unref (list);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+kms_rtp_pacer_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  KmsRtpPacer *self = KMS_RTP_PACER (parent);
+  gboolean ret = TRUE;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      ret = gst_pad_push_event (self->priv->srcpad, event);
+
+      KMS_RTP_PACER_LOCK (self);
+      self->priv->srcresult = GST_FLOW_FLUSHING;
+      kms_rtp_pacer_flush (self);
+      kms_rtp_pacer_wake_up (self);
+      KMS_RTP_PACER_UNLOCK (self);
+
+      gst_pad_pause_task (self->priv->srcpad);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      ret = gst_pad_push_event (self->priv->srcpad, event);
+
+      KMS_RTP_PACER_LOCK (self);
+      self->priv->srcresult = GST_FLOW_OK;
+      g_hash_table_remove_all (self->priv->seqnums);
+      KMS_RTP_PACER_UNLOCK (self);
+
+      gst_pad_start_task (self->priv->srcpad,
+          (GstTaskFunction) kms_rtp_pacer_loop, self, NULL);
+      break;
+    default:
+      if (!GST_EVENT_IS_SERIALIZED (event)) {
+        return gst_pad_event_default (pad, parent, event);
+      }
+
+      /* Serialized events keep their position with respect to buffers */
+      KMS_RTP_PACER_LOCK (self);
+      if (self->priv->srcresult != GST_FLOW_OK) {
+        GST_DEBUG_OBJECT (self, "Dropping %" GST_PTR_FORMAT ", reason %s",
+            event, gst_flow_get_name (self->priv->srcresult));
+        KMS_RTP_PACER_UNLOCK (self);
+        gst_event_unref (event);
+        return FALSE;
+      }
+
+      g_queue_push_tail (self->priv->items,
+          kms_rtp_pacer_item_new (GST_MINI_OBJECT_CAST (event),
+              kms_rtp_pacer_get_now (self), 0));
+      self->priv->queued_events++;
+      kms_rtp_pacer_wake_up (self);
+      KMS_RTP_PACER_UNLOCK (self);
+      break;
+  }
+
+  return ret;
+}
+
+static gboolean
+kms_rtp_pacer_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  KmsRtpPacer *self = KMS_RTP_PACER (parent);
+  gboolean res;
+
+  switch (mode) {
+    case GST_PAD_MODE_PUSH:
+      if (active) {
+        KMS_RTP_PACER_LOCK (self);
+        self->priv->srcresult = GST_FLOW_OK;
+        KMS_RTP_PACER_UNLOCK (self);
+
+        res = gst_pad_start_task (pad, (GstTaskFunction) kms_rtp_pacer_loop,
+            self, NULL);
+      } else {
+        KMS_RTP_PACER_LOCK (self);
+        self->priv->srcresult = GST_FLOW_FLUSHING;
+        kms_rtp_pacer_flush (self);
+        kms_rtp_pacer_wake_up (self);
+        KMS_RTP_PACER_UNLOCK (self);
+
+        res = gst_pad_stop_task (pad);
+      }
+      break;
+    default:
+      res = FALSE;
+      break;
+  }
+
+  return res;
+}
+
+static GstStructure *
+kms_rtp_pacer_get_stats (KmsRtpPacer * self)
+{
+  GstStructure *stats;
+
+  KMS_RTP_PACER_LOCK (self);
+
+  stats = gst_structure_new ("rtp-pacer",
+      "bitrate", G_TYPE_INT, self->priv->bitrate,
+      "queue-delay", G_TYPE_UINT64, self->priv->avg_queue_delay,
+      "max-queue-delay", G_TYPE_UINT64, self->priv->max_queue_delay,
+      "queued-packets", G_TYPE_UINT, self->priv->queued_packets,
+      "queued-bytes", G_TYPE_UINT, self->priv->queued_bytes,
+      "sent-packets", G_TYPE_UINT64, self->priv->sent_packets,
+      "forced-packets", G_TYPE_UINT64, self->priv->forced_packets, NULL);
+
+  /* Maximum is reported per stats period */
+  self->priv->max_queue_delay = 0;
+
+  KMS_RTP_PACER_UNLOCK (self);
+
+  return stats;
+}
+
+static void
+kms_rtp_pacer_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  KmsRtpPacer *self = KMS_RTP_PACER (object);
+
+  KMS_RTP_PACER_LOCK (self);
+
+  switch (property_id) {
+    case PROP_BITRATE:
+      self->priv->bitrate = g_value_get_int (value);
+      GST_DEBUG_OBJECT (self, "Pacing for target bitrate %d",
+          self->priv->bitrate);
+      break;
+    case PROP_PACING_FACTOR:
+      self->priv->pacing_factor = g_value_get_float (value);
+      break;
+    case PROP_BURST_TIME:
+      self->priv->burst_time = g_value_get_uint (value);
+      break;
+    case PROP_MAX_QUEUE_TIME:
+      self->priv->max_queue_time = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+
+  /* Wake up the task so that the new configuration is applied */
+  kms_rtp_pacer_wake_up (self);
+
+  KMS_RTP_PACER_UNLOCK (self);
+}
+
+static void
+kms_rtp_pacer_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  KmsRtpPacer *self = KMS_RTP_PACER (object);
+
+  if (property_id == PROP_STATS) {
+    g_value_take_boxed (value, kms_rtp_pacer_get_stats (self));
+    return;
+  }
+
+  KMS_RTP_PACER_LOCK (self);
+
+  switch (property_id) {
+    case PROP_BITRATE:
+      g_value_set_int (value, self->priv->bitrate);
+      break;
+    case PROP_PACING_FACTOR:
+      g_value_set_float (value, self->priv->pacing_factor);
+      break;
+    case PROP_BURST_TIME:
+      g_value_set_uint (value, self->priv->burst_time);
+      break;
+    case PROP_MAX_QUEUE_TIME:
+      g_value_set_uint (value, self->priv->max_queue_time);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+
+  KMS_RTP_PACER_UNLOCK (self);
+}
+
+static void
+kms_rtp_pacer_finalize (GObject * object)
+{
+  KmsRtpPacer *self = KMS_RTP_PACER (object);
+
+  g_queue_free_full (self->priv->retransmissions,
+      (GDestroyNotify) kms_rtp_pacer_item_destroy);
+  g_queue_free_full (self->priv->items,
+      (GDestroyNotify) kms_rtp_pacer_item_destroy);
+  g_hash_table_unref (self->priv->seqnums);
+
+  g_mutex_clear (&self->priv->mutex);
+  g_cond_clear (&self->priv->cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+kms_rtp_pacer_init (KmsRtpPacer * self)
+{
+  self->priv = KMS_RTP_PACER_GET_PRIVATE (self);
+
+  self->priv->sinkpad =
+      gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (self->priv->sinkpad, kms_rtp_pacer_chain);
+  gst_pad_set_chain_list_function (self->priv->sinkpad,
+      kms_rtp_pacer_chain_list);
+  gst_pad_set_event_function (self->priv->sinkpad, kms_rtp_pacer_sink_event);
+  GST_PAD_SET_PROXY_CAPS (self->priv->sinkpad);
+  GST_PAD_SET_PROXY_ALLOCATION (self->priv->sinkpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->sinkpad);
+
+  self->priv->srcpad = gst_pad_new_from_static_template (&srctemplate, "src");
+  gst_pad_set_activatemode_function (self->priv->srcpad,
+      kms_rtp_pacer_activate_mode);
+  GST_PAD_SET_PROXY_CAPS (self->priv->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->srcpad);
+
+  g_mutex_init (&self->priv->mutex);
+  g_cond_init (&self->priv->cond);
+
+  self->priv->srcresult = GST_FLOW_FLUSHING;
+  self->priv->retransmissions = g_queue_new ();
+  self->priv->items = g_queue_new ();
+  self->priv->seqnums = g_hash_table_new (NULL, NULL);
+
+  self->priv->bitrate = DEFAULT_BITRATE;
+  self->priv->pacing_factor = DEFAULT_PACING_FACTOR;
+  self->priv->burst_time = DEFAULT_BURST_TIME;
+  self->priv->max_queue_time = DEFAULT_MAX_QUEUE_TIME;
+  self->priv->last_refill = -1;
+}
+
+static void
+kms_rtp_pacer_class_init (KmsRtpPacerClass * klass)
+{
+  GstElementClass *gstelement_class;
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = kms_rtp_pacer_finalize;
+  gobject_class->set_property = kms_rtp_pacer_set_property;
+  gobject_class->get_property = kms_rtp_pacer_get_property;
+
+  gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "RTP pacer",
+      "Generic/Network",
+      "Spreads outgoing RTP packets according to the target bitrate",
+      "Kurento <kurento@googlegroups.com>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&srctemplate));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&sinktemplate));
+
+  GST_DEBUG_REGISTER_FUNCPTR (kms_rtp_pacer_chain);
+  GST_DEBUG_REGISTER_FUNCPTR (kms_rtp_pacer_chain_list);
+  GST_DEBUG_REGISTER_FUNCPTR (kms_rtp_pacer_sink_event);
+  GST_DEBUG_REGISTER_FUNCPTR (kms_rtp_pacer_activate_mode);
+
+  g_object_class_install_property (gobject_class, PROP_BITRATE,
+      g_param_spec_int ("bitrate", "Target bitrate",
+          "Target bitrate in bps the output is paced for (0 = no pacing)",
+          0, G_MAXINT, DEFAULT_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PACING_FACTOR,
+      g_param_spec_float ("pacing-factor", "Pacing factor",
+          "Packets are sent at bitrate multiplied by this factor so that "
+          "bursts are drained without adding much delay",
+          1.0, 10.0, DEFAULT_PACING_FACTOR,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BURST_TIME,
+      g_param_spec_uint ("burst-time", "Burst time",
+          "Maximum burst allowed after an idle period, in milliseconds "
+          "at the pacing rate", 0, G_MAXUINT, DEFAULT_BURST_TIME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_QUEUE_TIME,
+      g_param_spec_uint ("max-queue-time", "Maximum queue time",
+          "Packets queued longer than this time (in milliseconds) are sent "
+          "without waiting for the budget", 0, G_MAXUINT,
+          DEFAULT_MAX_QUEUE_TIME, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Pacing statistics (queue delays are in nanoseconds)",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_type_class_add_private (klass, sizeof (KmsRtpPacerPrivate));
+}
+
+gboolean
+kms_rtp_pacer_plugin_init (GstPlugin * plugin)
+{
+  return gst_element_register (plugin, PLUGIN_NAME, GST_RANK_NONE,
+      KMS_TYPE_RTP_PACER);
+}
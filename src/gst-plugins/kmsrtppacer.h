@@ -0,0 +1,57 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_RTP_PACER_H__
+#define __KMS_RTP_PACER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+#define KMS_TYPE_RTP_PACER \
+  (kms_rtp_pacer_get_type())
+#define KMS_RTP_PACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),KMS_TYPE_RTP_PACER,KmsRtpPacer))
+#define KMS_RTP_PACER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),KMS_TYPE_RTP_PACER,KmsRtpPacerClass))
+#define KMS_IS_RTP_PACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),KMS_TYPE_RTP_PACER))
+#define KMS_IS_RTP_PACER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),KMS_TYPE_RTP_PACER))
+#define KMS_RTP_PACER_CAST(obj) ((KmsRtpPacer*)(obj))
+
+typedef struct _KmsRtpPacer KmsRtpPacer;
+typedef struct _KmsRtpPacerClass KmsRtpPacerClass;
+typedef struct _KmsRtpPacerPrivate KmsRtpPacerPrivate;
+
+struct _KmsRtpPacer
+{
+  GstElement element;
+
+  KmsRtpPacerPrivate *priv;
+};
+
+struct _KmsRtpPacerClass
+{
+  GstElementClass parent_class;
+};
+
+GType kms_rtp_pacer_get_type (void);
+
+gboolean kms_rtp_pacer_plugin_init (GstPlugin * plugin);
+
+G_END_DECLS
+#endif /* __KMS_RTP_PACER_H__ */
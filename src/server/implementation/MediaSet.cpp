@@ -33,6 +33,7 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 #define GST_DEFAULT_NAME "KurentoMediaSet"
 
 const int MEDIASET_THREADS_DEFAULT = 1;
+const int MEDIASET_TEARDOWN_THREADS_DEFAULT = 2;
 
 namespace kurento
 {
@@ -136,9 +137,12 @@ void MediaSet::doGarbageCollection ()
 MediaSet::MediaSet()
 {
   terminated = false;
+  teardownBacklog = 0;
 
   workers = std::shared_ptr<WorkerPool> (new WorkerPool (
       MEDIASET_THREADS_DEFAULT) );
+  teardownWorkers = std::shared_ptr<WorkerPool> (new WorkerPool (
+                      MEDIASET_TEARDOWN_THREADS_DEFAULT) );
 
   thread = std::thread ( [&] () {
     std::unique_lock <std::recursive_mutex> lock (recMutex);
@@ -177,6 +181,7 @@ MediaSet::~MediaSet ()
   lock.unlock();
 
   workers.reset();
+  teardownWorkers.reset();
 
   if (std::this_thread::get_id() != thread.get_id() ) {
     try {
@@ -208,6 +213,23 @@ MediaSet::post (std::function<void (void) > f)
   }
 }
 
+void
+MediaSet::postTeardown (std::function<void (void) > f)
+{
+  std::unique_lock <std::recursive_mutex> lock (recMutex);
+
+  if (!terminated && teardownWorkers) {
+    teardownBacklog++;
+    teardownWorkers->post ([this, f] () {
+      f();
+      teardownBacklog--;
+    });
+  } else {
+    lock.unlock();
+    f();
+  }
+}
+
 void
 MediaSet::setServerManager (std::shared_ptr <ServerManagerImpl> serverManager)
 {
@@ -322,6 +344,7 @@ MediaSet::keepAliveSession (const std::string &sessionId, bool create)
 void
 MediaSet::releaseSession (const std::string &sessionId)
 {
+  std::vector<std::shared_ptr<MediaObjectImpl>> released;
   std::unique_lock <std::recursive_mutex> lock (recMutex);
 
   auto it = sessionMap.find (sessionId);
@@ -329,8 +352,20 @@ MediaSet::releaseSession (const std::string &sessionId)
   if (it != sessionMap.end() ) {
     auto objects = it->second;
 
+    /* Detach the whole tree at once, release calls are done afterwards */
     for (auto it2 : objects) {
-      release (it2.second);
+      auto sessionsIt = reverseSessionMap.find (it2.second->getId() );
+
+      if (sessionsIt == reverseSessionMap.end() ) {
+        /* Already released */
+        continue;
+      }
+
+      auto sessions = sessionsIt->second;
+
+      for (auto session : sessions) {
+        detach (session, it2.second, released);
+      }
     }
   }
 
@@ -339,6 +374,10 @@ MediaSet::releaseSession (const std::string &sessionId)
   eventHandler.erase (sessionId);
   lock.unlock ();
 
+  GST_DEBUG ("Session %s released %zu objects, teardown backlog: %d",
+             sessionId.c_str(), released.size(), getTeardownBacklog () );
+
+  postRelease (std::move (released) );
 }
 
 void
@@ -371,6 +410,28 @@ call_release (std::shared_ptr<MediaObjectImpl> mediaObject)
   }
 }
 
+static void
+call_release_all (std::vector<std::shared_ptr<MediaObjectImpl>> &objects)
+{
+  for (auto mediaObject : objects) {
+    call_release (mediaObject);
+  }
+
+  /* Last references are dropped here, out of the MediaSet lock */
+  objects.clear();
+}
+
+void
+MediaSet::postRelease (std::vector<std::shared_ptr<MediaObjectImpl>>
+                       released)
+{
+  if (released.empty() ) {
+    return;
+  }
+
+  post (std::bind (call_release_all, std::move (released) ) );
+}
+
 bool
 MediaSet::isServerManager (std::shared_ptr< MediaObjectImpl > mediaObject)
 {
@@ -385,13 +446,31 @@ void
 MediaSet::unref (const std::string &sessionId,
                  std::shared_ptr< MediaObjectImpl > mediaObject)
 {
+  std::vector<std::shared_ptr<MediaObjectImpl>> released;
   std::unique_lock <std::recursive_mutex> lock (recMutex);
-  bool released = false;
 
   if (!mediaObject) {
     return;
   }
 
+  detach (sessionId, mediaObject, released);
+  postRelease (std::move (released) );
+
+  lock.unlock();
+}
+
+/*
+ * Removes the session reference to the object and its children. Objects not
+ * referenced by any other session are appended to released, children first.
+ * Must be called with recMutex held.
+ */
+void
+MediaSet::detach (const std::string &sessionId,
+                  std::shared_ptr< MediaObjectImpl > mediaObject,
+                  std::vector<std::shared_ptr<MediaObjectImpl>> &released)
+{
+  bool isReleased = false;
+
   auto it = sessionMap.find (sessionId);
 
   if (it != sessionMap.end() ) {
@@ -408,7 +487,7 @@ MediaSet::unref (const std::string &sessionId,
     auto childMap = childrenIt->second;
 
     for (auto child : childMap) {
-      unref (sessionId, child.second);
+      detach (sessionId, child.second, released);
     }
   }
 
@@ -418,13 +497,13 @@ MediaSet::unref (const std::string &sessionId,
     it3->second.erase (sessionId);
 
     if (it3->second.empty() ) {
-      released = true;
+      isReleased = true;
     }
   } else {
-    released = true;
+    isReleased = true;
   }
 
-  if (released && !isServerManager (mediaObject) ) {
+  if (isReleased && !isServerManager (mediaObject) ) {
     std::shared_ptr<MediaObjectImpl> parent;
     parent = std::dynamic_pointer_cast<MediaObjectImpl> (mediaObject->getParent() );
 
@@ -441,11 +520,9 @@ MediaSet::unref (const std::string &sessionId,
     eventIt->second.erase (mediaObject->getId() );
   }
 
-  if (released) {
-    post (std::bind (call_release, mediaObject) );
+  if (isReleased) {
+    released.push_back (mediaObject);
   }
-
-  lock.unlock();
 }
 
 void
@@ -478,7 +555,7 @@ void MediaSet::releasePointer (MediaObjectImpl *mediaObject)
 
   objectsMap.erase (id );
 
-  post (std::bind (async_delete, mediaObject, id) );
+  postTeardown (std::bind (async_delete, mediaObject, id) );
 
   if (this->serverManager && !terminated) {
     serverManager->signalObjectDestroyed (ObjectDestroyed (this->serverManager,
@@ -492,6 +569,7 @@ void MediaSet::releasePointer (MediaObjectImpl *mediaObject)
 
 void MediaSet::release (std::shared_ptr< MediaObjectImpl > mediaObject)
 {
+  std::vector<std::shared_ptr<MediaObjectImpl>> released;
   std::unique_lock <std::recursive_mutex> lock (recMutex);
 
   auto it = reverseSessionMap.find (mediaObject->getId() );
@@ -504,9 +582,11 @@ void MediaSet::release (std::shared_ptr< MediaObjectImpl > mediaObject)
   auto sessions = it->second;
 
   for (auto it2 : sessions) {
-    unref (it2, mediaObject);
+    detach (it2, mediaObject, released);
   }
 
+  postRelease (std::move (released) );
+
   lock.unlock();
 }
 
@@ -633,6 +713,12 @@ MediaSet::empty()
   }
 }
 
+int
+MediaSet::getTeardownBacklog ()
+{
+  return teardownBacklog;
+}
+
 std::vector<std::string>
 MediaSet::getSessions ()
 {
@@ -27,6 +27,7 @@
 #include <thread>
 #include <condition_variable>
 #include <atomic>
+#include <vector>
 
 #include "WorkerPool.hpp"
 
@@ -81,6 +82,9 @@ public:
 
   bool empty();
 
+  /* Number of released objects waiting to be destroyed */
+  int getTeardownBacklog ();
+
   static std::shared_ptr<MediaSet> getMediaSet();
   static void deleteMediaSet();
   static void setCollectorInterval (std::chrono::seconds interval);
@@ -98,10 +102,16 @@ private:
 
   void releasePointer (MediaObjectImpl *obj);
 
+  void detach (const std::string &sessionId,
+               std::shared_ptr<MediaObjectImpl> mediaObject,
+               std::vector<std::shared_ptr<MediaObjectImpl>> &released);
+  void postRelease (std::vector<std::shared_ptr<MediaObjectImpl>> released);
+
   void checkEmpty ();
   bool isServerManager (std::shared_ptr< MediaObjectImpl > mediaObject);
 
   void post (std::function<void (void) > f);
+  void postTeardown (std::function<void (void) > f);
 
   MediaSet ();
 
@@ -126,6 +136,9 @@ private:
   std::map<std::string, std::unordered_set<std::string>> reverseSessionMap;
 
   std::shared_ptr<WorkerPool> workers;
+  /* Destructors block on GStreamer state changes, they run apart */
+  std::shared_ptr<WorkerPool> teardownWorkers;
+  std::atomic<int> teardownBacklog;
 
   static std::chrono::seconds collectorInterval;
 
@@ -35,79 +35,143 @@ typedef const char * (*GetNameFunc) ();
 typedef const char * (*GetDescFunc) ();
 typedef const char * (*GetGenerationTimeFunc) ();
 
-int
-ModuleManager::loadModule (std::string modulePath)
+class OpenedModule
 {
-  const kurento::FactoryRegistrar *registrar;
-  void *registrarFactory, *getVersion = NULL, *getName = NULL,
-                           *getDescriptor = NULL, *getGenerationTime = NULL;
-  std::string moduleFileName;
-  std::string moduleName;
-  std::string moduleVersion;
+public:
+  OpenedModule (const std::string &path) : path (path)
+  {
+    fileName = boost::filesystem::path (path).filename().string();
+  }
+
+  std::string path;
+  std::string fileName;
+  std::shared_ptr<Glib::Module> module;
+  void *registrarFactory = NULL;
+  void *getVersion = NULL;
+  void *getName = NULL;
+  void *getDescriptor = NULL;
+  void *getGenerationTime = NULL;
+  const kurento::FactoryRegistrar *registrar = NULL;
+  std::string name;
+  std::string version;
   std::string generationTime;
-  const char *moduleDescriptor = NULL;
+  const char *descriptor = NULL;
+  std::chrono::microseconds loadTime;
+};
+
+/* Opens the library, which runs its static constructors, and looks its entry
+ * points up */
+static std::shared_ptr<OpenedModule>
+openModule (const std::string &modulePath)
+{
+  std::shared_ptr<OpenedModule> opened (new OpenedModule (modulePath) );
+  auto start = std::chrono::steady_clock::now ();
 
-  boost::filesystem::path path (modulePath);
+  opened->module = std::shared_ptr<Glib::Module> (new Glib::Module (
+                     modulePath) );
 
-  moduleFileName = path.filename().string();
+  if (!*opened->module) {
+    GST_WARNING ("Module %s cannot be loaded: %s", modulePath.c_str(),
+                 Glib::Module::get_last_error().c_str() );
+    return std::shared_ptr<OpenedModule> ();
+  }
 
-  if (loadedModules.find (moduleFileName) != loadedModules.end() ) {
-    GST_WARNING ("Module named %s already loaded", moduleFileName.c_str() );
-    return -1;
+  if (!opened->module->get_symbol ("getFactoryRegistrar",
+                                   opened->registrarFactory) ) {
+    GST_WARNING ("Symbol 'getFactoryRegistrar' not found in library %s",
+                 opened->fileName.c_str() );
+    return std::shared_ptr<OpenedModule> ();
   }
 
-  Glib::Module module (modulePath);
+  if (!opened->module->get_symbol ("getModuleVersion", opened->getVersion) ) {
+    GST_WARNING ("Cannot get module version");
+  }
 
-  if (!module) {
-    GST_WARNING ("Module %s cannot be loaded: %s", modulePath.c_str(),
-                 Glib::Module::get_last_error().c_str() );
-    return -1;
+  if (!opened->module->get_symbol ("getModuleName", opened->getName) ) {
+    GST_WARNING ("Cannot get module name");
   }
 
-  if (!module.get_symbol ("getFactoryRegistrar", registrarFactory) ) {
-    GST_WARNING ("Symbol 'getFactoryRegistrar' not found in library %s",
-                 moduleFileName.c_str() );
+  if (!opened->module->get_symbol ("getModuleDescriptor",
+                                   opened->getDescriptor) ) {
+    GST_WARNING ("Cannot get module descriptor");
+  }
+
+  if (!opened->module->get_symbol ("getGenerationTime",
+                                   opened->getGenerationTime) ) {
+    GST_WARNING ("Cannot get module generationTime");
+  }
+
+  opened->loadTime = std::chrono::duration_cast<std::chrono::microseconds>
+                     (std::chrono::steady_clock::now () - start);
+
+  return opened;
+}
+
+/* Calls the module entry points to get its registrar and metadata */
+static void
+readModule (std::shared_ptr<OpenedModule> opened)
+{
+  auto start = std::chrono::steady_clock::now ();
+
+  opened->registrar = ( (RegistrarFactoryFunc) opened->registrarFactory) ();
+
+  if (opened->getVersion != NULL) {
+    opened->version = ( (GetVersionFunc) opened->getVersion) ();
+  }
+
+  if (opened->getName != NULL) {
+    opened->name = ( (GetNameFunc) opened->getName) ();
+  }
+
+  if (opened->getDescriptor != NULL) {
+    opened->descriptor = ( (GetDescFunc) opened->getDescriptor) ();
+  }
+
+  if (opened->getGenerationTime != NULL) {
+    opened->generationTime =
+      ( (GetGenerationTimeFunc) opened->getGenerationTime) ();
+  }
+
+  opened->loadTime += std::chrono::duration_cast<std::chrono::microseconds>
+                      (std::chrono::steady_clock::now () - start);
+}
+
+int
+ModuleManager::registerModule (std::shared_ptr<OpenedModule> opened)
+{
+  if (!opened) {
     return -1;
   }
 
-  registrar = ( (RegistrarFactoryFunc) registrarFactory) ();
+  readModule (opened);
+
   const std::map <std::string, std::shared_ptr <kurento::Factory > > &factories =
-    registrar->getFactories();
+    opened->registrar->getFactories();
 
   for (auto it : factories) {
     if (loadedFactories.find (it.first) != loadedFactories.end() ) {
       GST_WARNING ("Factory %s is already registered, skiping module %s",
-                   it.first.c_str(), module.get_name().c_str() );
+                   it.first.c_str(), opened->module->get_name().c_str() );
       return -1;
     }
   }
 
-  module.make_resident();
+  opened->module->make_resident();
 
   loadedFactories.insert (factories.begin(), factories.end() );
 
-  GST_DEBUG ("Module loaded from %s", module.get_name().c_str() );
-
-  if (!module.get_symbol ("getModuleVersion", getVersion) ) {
-    GST_WARNING ("Cannot get module version");
-  } else {
-    moduleVersion = ( (GetNameFunc) getVersion) ();
-  }
+  GST_DEBUG ("Module loaded from %s", opened->module->get_name().c_str() );
 
-  if (!module.get_symbol ("getModuleName", getName) ) {
-    GST_WARNING ("Cannot get module name");
-  } else {
+  if (!opened->name.empty () ) {
     std::string finalModuleName;
 
-    moduleName = ( (GetVersionFunc) getName) ();
-
     // Factories are also registered using the module name as a prefix
     // Modules core, elements and filters use kurento as prefix
-    if (moduleName == "core" || moduleName == "elements"
-        || moduleName == "filters")  {
+    if (opened->name == "core" || opened->name == "elements"
+        || opened->name == "filters")  {
       finalModuleName = "kurento";
     } else {
-      finalModuleName = moduleName;
+      finalModuleName = opened->name;
     }
 
     for (auto it : factories) {
@@ -115,26 +179,29 @@ ModuleManager::loadModule (std::string modulePath)
     }
   }
 
-  if (!module.get_symbol ("getModuleDescriptor", getDescriptor) ) {
-    GST_WARNING ("Cannot get module descriptor");
-  } else {
-    moduleDescriptor = ( (GetDescFunc) getDescriptor) ();
-  }
+  loadedModules[opened->fileName] = std::shared_ptr<ModuleData> (new ModuleData (
+                                      opened->name, opened->version, opened->generationTime,
+                                      opened->descriptor, factories, opened->loadTime) );
 
-  if (!module.get_symbol ("getGenerationTime", getGenerationTime) ) {
-    GST_WARNING ("Cannot get module generationTime");
-  } else {
-    generationTime = ( (GetGenerationTimeFunc) getGenerationTime) ();
-  }
+  GST_INFO ("Loaded %s version %s generated at %s in %" G_GINT64_FORMAT " us",
+            opened->name.c_str() , opened->version.c_str(),
+            opened->generationTime.c_str(), (gint64) opened->loadTime.count () );
+
+  return 0;
+}
 
-  loadedModules[moduleFileName] = std::shared_ptr<ModuleData> (new ModuleData (
-                                    moduleName, moduleVersion, generationTime,
-                                    moduleDescriptor, factories) );
+int
+ModuleManager::loadModule (std::string modulePath)
+{
+  std::string moduleFileName =
+    boost::filesystem::path (modulePath).filename().string();
 
-  GST_INFO ("Loaded %s version %s generated at %s", moduleName.c_str() ,
-            moduleVersion.c_str(), generationTime.c_str() );
+  if (loadedModules.find (moduleFileName) != loadedModules.end() ) {
+    GST_WARNING ("Module named %s already loaded", moduleFileName.c_str() );
+    return -1;
+  }
 
-  return 0;
+  return registerModule (openModule (modulePath) );
 }
 
 std::list<std::string> split (const std::string &s, char delim)
@@ -151,7 +218,8 @@ std::list<std::string> split (const std::string &s, char delim)
 }
 
 void
-ModuleManager::loadModules (std::string dirPath)
+ModuleManager::findModules (std::string dirPath,
+                            std::list<std::string> &modules)
 {
   GST_INFO ("Looking for modules in %s", dirPath.c_str() );
   boost::filesystem::path dir (dirPath);
@@ -170,33 +238,52 @@ ModuleManager::loadModules (std::string dirPath)
       boost::filesystem::path extension = itr->path().extension();
 
       if (extension.string() == ".so") {
-
-        loadModule (itr->path().string() );
+        modules.push_back (itr->path().string() );
       }
     } else if (boost::filesystem::is_directory (*itr) ) {
-      this->loadModules (itr->path().string() );
+      this->findModules (itr->path().string(), modules);
     }
   }
 }
 
+void
+ModuleManager::loadModules (const std::list<std::string> &modules)
+{
+  auto start = std::chrono::steady_clock::now ();
+
+  // A module name is only taken once its library is registered, so if a
+  // library cannot be loaded the next one with the same name is tried
+  for (const std::string &modulePath : modules) {
+    loadModule (modulePath);
+  }
+
+  GST_INFO ("Loaded %" G_GSIZE_FORMAT " modules in %" G_GINT64_FORMAT " ms",
+            loadedModules.size (),
+            (gint64) std::chrono::duration_cast<std::chrono::milliseconds>
+            (std::chrono::steady_clock::now () - start).count () );
+}
+
 void
 ModuleManager::loadModulesFromDirectories (std::string path)
 {
   std::list <std::string> locations;
+  std::list <std::string> modules;
 
   locations = split (path, ':');
 
   for (std::string location : locations) {
-    this->loadModules (location);
+    this->findModules (location, modules);
   }
 
   //try to load modules from the default path
-  this->loadModules (KURENTO_MODULES_DIR);
+  this->findModules (KURENTO_MODULES_DIR, modules);
+
+  this->loadModules (modules);
 
   return;
 }
 
-const std::map <std::string, std::shared_ptr <kurento::Factory > >
+const std::map <std::string, std::shared_ptr <kurento::Factory > > &
 ModuleManager::getLoadedFactories ()
 {
   return loadedFactories;
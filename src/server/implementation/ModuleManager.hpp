@@ -24,6 +24,8 @@
 #include <memory>
 #include <string>
 #include <set>
+#include <list>
+#include <chrono>
 #include <FactoryRegistrar.hpp>
 #include <MediaObjectImpl.hpp>
 
@@ -36,9 +38,10 @@ public:
   ModuleData (const std::string &name, const std::string &version,
               const std::string &compilationTime,
               const char *descriptor,
-              const std::map <std::string, std::shared_ptr <kurento::Factory > > &factories) :
+              const std::map <std::string, std::shared_ptr <kurento::Factory > > &factories,
+              std::chrono::microseconds loadTime) :
     name (name), version (version), generationTime (compilationTime),
-    descriptor (descriptor), factories (factories)
+    descriptor (descriptor), factories (factories), loadTime (loadTime)
   {
   }
 
@@ -72,6 +75,11 @@ public:
     return factories;
   }
 
+  /* Time spent opening the library and reading its factories */
+  std::chrono::microseconds getLoadTime () const
+  {
+    return loadTime;
+  }
 
 private:
   std::string name;
@@ -79,8 +87,11 @@ private:
   std::string generationTime;
   const char *descriptor;
   const std::map <std::string, std::shared_ptr <kurento::Factory > > &factories;
+  std::chrono::microseconds loadTime;
 };
 
+class OpenedModule;
+
 class ModuleManager
 {
 public:
@@ -90,10 +101,10 @@ public:
   int loadModule (std::string modulePath);
   void loadModulesFromDirectories (std::string dirPath);
   const std::map <std::string, std::shared_ptr <kurento::Factory > >
-  getLoadedFactories ();
+  &getLoadedFactories ();
   std::shared_ptr<kurento::Factory> getFactory (std::string symbolName);
 
-  const std::map <std::string, std::shared_ptr <ModuleData>> getModules () const
+  const std::map <std::string, std::shared_ptr <ModuleData>> &getModules () const
   {
     return loadedModules;
   }
@@ -102,7 +113,9 @@ private:
 
   std::map <std::string, std::shared_ptr <kurento::Factory > > loadedFactories;
   std::map <std::string, std::shared_ptr <ModuleData>> loadedModules;
-  void loadModules (std::string path);
+  void findModules (std::string path, std::list<std::string> &modules);
+  void loadModules (const std::list<std::string> &modules);
+  int registerModule (std::shared_ptr<OpenedModule> opened);
 
 
   class StaticConstructor
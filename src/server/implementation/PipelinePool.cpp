@@ -0,0 +1,193 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "PipelinePool.hpp"
+#include <KurentoException.hpp>
+
+#define GST_CAT_DEFAULT kurento_pipeline_pool
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "KurentoPipelinePool"
+
+#define DEFAULT_MAX_IDLE_PIPELINES 16
+
+namespace kurento
+{
+
+static std::shared_ptr<PipelinePool> pipelinePool;
+static std::mutex poolMutex;
+
+std::shared_ptr<PipelinePool>
+PipelinePool::getPipelinePool ()
+{
+  std::unique_lock <std::mutex> lock (poolMutex);
+
+  if (!pipelinePool) {
+    pipelinePool = std::shared_ptr<PipelinePool> (new PipelinePool (
+                     DEFAULT_MAX_IDLE_PIPELINES) );
+  }
+
+  return pipelinePool;
+}
+
+PipelinePool::PipelinePool (guint maxIdle) : maxIdle (maxIdle)
+{
+}
+
+PipelinePool::~PipelinePool ()
+{
+  for (GstElement *pipeline : idle) {
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    g_object_unref (pipeline);
+  }
+}
+
+GstElement *
+PipelinePool::createPipeline ()
+{
+  GstElement *pipeline;
+  GstClock *clock;
+
+  pipeline = gst_pipeline_new (NULL);
+
+  if (pipeline == NULL) {
+    throw KurentoException (MEDIA_OBJECT_NOT_AVAILABLE,
+                            "Cannot create gstreamer pipeline");
+  }
+
+  clock = gst_system_clock_obtain ();
+  gst_pipeline_use_clock (GST_PIPELINE (pipeline), clock);
+  g_object_unref (clock);
+
+  return pipeline;
+}
+
+bool
+PipelinePool::reset (GstElement *pipeline)
+{
+  GstBus *bus;
+
+  if (gst_element_set_state (pipeline, GST_STATE_NULL) ==
+      GST_STATE_CHANGE_FAILURE) {
+    return false;
+  }
+
+  if (GST_BIN_NUMCHILDREN (pipeline) > 0) {
+    GST_DEBUG ("Not reusing %" GST_PTR_FORMAT ", it still has elements",
+               pipeline);
+    return false;
+  }
+
+  /* Drop messages the previous owner did not handle */
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline) );
+  gst_bus_set_flushing (bus, TRUE);
+  gst_bus_set_flushing (bus, FALSE);
+  g_object_unref (bus);
+
+  return true;
+}
+
+GstElement *
+PipelinePool::acquire ()
+{
+  GstElement *pipeline = NULL;
+  std::unique_lock <std::mutex> lock (mutex);
+
+  if (!idle.empty () ) {
+    pipeline = idle.front ();
+    idle.pop_front ();
+  }
+
+  lock.unlock ();
+
+  if (pipeline == NULL) {
+    pipeline = createPipeline ();
+  } else {
+    GST_DEBUG ("Reusing %" GST_PTR_FORMAT, pipeline);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  return pipeline;
+}
+
+void
+PipelinePool::release (GstElement *pipeline)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+
+  if (idle.size () < maxIdle && reset (pipeline) ) {
+    idle.push_back (pipeline);
+    return;
+  }
+
+  lock.unlock ();
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_object_unref (pipeline);
+}
+
+void
+PipelinePool::warmUp (guint count)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+
+  count = MIN (count, maxIdle);
+
+  while (idle.size () < count) {
+    idle.push_back (createPipeline () );
+  }
+}
+
+guint
+PipelinePool::getMaxIdle ()
+{
+  std::unique_lock <std::mutex> lock (mutex);
+
+  return maxIdle;
+}
+
+void
+PipelinePool::setMaxIdle (guint maxIdle)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+
+  this->maxIdle = maxIdle;
+
+  while (idle.size () > maxIdle) {
+    GstElement *pipeline = idle.back ();
+
+    idle.pop_back ();
+    g_object_unref (pipeline);
+  }
+}
+
+guint
+PipelinePool::getIdleCount ()
+{
+  std::unique_lock <std::mutex> lock (mutex);
+
+  return idle.size ();
+}
+
+PipelinePool::StaticConstructor PipelinePool::staticConstructor;
+
+PipelinePool::StaticConstructor::StaticConstructor()
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+                           GST_DEFAULT_NAME);
+}
+
+} /* kurento */
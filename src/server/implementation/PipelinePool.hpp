@@ -0,0 +1,73 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __PIPELINE_POOL_HPP__
+#define __PIPELINE_POOL_HPP__
+
+#include <gst/gst.h>
+#include <memory>
+#include <mutex>
+#include <deque>
+
+namespace kurento
+{
+
+/*
+ * Keeps the empty pipelines of released MediaPipelines so that new ones do
+ * not have to be built from scratch. At most getMaxIdle () pipelines are
+ * kept idle, the rest are destroyed when released.
+ */
+class PipelinePool
+{
+public:
+  PipelinePool (guint maxIdle);
+  ~PipelinePool ();
+
+  static std::shared_ptr<PipelinePool> getPipelinePool ();
+
+  /* Returns a new reference to a PLAYING pipeline using the system clock */
+  GstElement *acquire ();
+  /* Takes the reference to a pipeline returned by acquire */
+  void release (GstElement *pipeline);
+
+  /* Builds idle pipelines until there are count of them, up to getMaxIdle */
+  void warmUp (guint count);
+
+  guint getMaxIdle ();
+  void setMaxIdle (guint maxIdle);
+  guint getIdleCount ();
+
+private:
+  static GstElement *createPipeline ();
+  bool reset (GstElement *pipeline);
+
+  std::mutex mutex;
+  std::deque<GstElement *> idle;
+  guint maxIdle;
+
+  class StaticConstructor
+  {
+  public:
+    StaticConstructor();
+  };
+
+  static StaticConstructor staticConstructor;
+};
+
+} /* kurento */
+
+#endif /* __PIPELINE_POOL_HPP__ */
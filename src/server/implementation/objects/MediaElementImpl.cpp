@@ -842,6 +842,30 @@ void MediaElementImpl::connect (std::shared_ptr<MediaElement> sink,
                                 std::shared_ptr<MediaType> mediaType,
                                 const std::string &sourceMediaDescription,
                                 const std::string &sinkMediaDescription)
+{
+  std::vector <std::function <void () >> events;
+
+  connectInternal (sink, mediaType, sourceMediaDescription,
+                   sinkMediaDescription, events);
+  emitConnectionEvents (events);
+}
+
+void
+MediaElementImpl::emitConnectionEvents (std::vector <std::function <void () >>
+                                        &events)
+{
+  for (auto &event : events) {
+    event ();
+  }
+
+  events.clear ();
+}
+
+void MediaElementImpl::connectInternal (std::shared_ptr<MediaElement> sink,
+                                        std::shared_ptr<MediaType> mediaType,
+                                        const std::string &sourceMediaDescription,
+                                        const std::string &sinkMediaDescription,
+                                        std::vector <std::function <void () >> &events)
 {
   KmsElementPadType type;
   gchar *padName;
@@ -870,9 +894,12 @@ void MediaElementImpl::connect (std::shared_ptr<MediaElement> sink,
 
   if (!connections.empty () ) {
     std::shared_ptr <ElementConnectionData> connection = connections.at (0);
-    connection->getSource()->disconnect (connection->getSink (), mediaType,
-                                         sourceMediaDescription,
-                                         connection->getSinkDescription () );
+    std::shared_ptr <MediaElementImpl> sourceImpl =
+      std::dynamic_pointer_cast<MediaElementImpl> (connection->getSource () );
+
+    sourceImpl->disconnectInternal (connection->getSink (), mediaType,
+                                    sourceMediaDescription,
+                                    connection->getSinkDescription (), events);
   }
 
   sinkImpl->prepareSinkConnection (connectionData->getSource(), mediaType,
@@ -904,7 +931,12 @@ void MediaElementImpl::connect (std::shared_ptr<MediaElement> sink,
                                      ElementConnected::getName (),
                                      sink, mediaType, sourceMediaDescription,
                                      sinkMediaDescription);
-  signalElementConnected (elementConnected);
+  std::shared_ptr<MediaElementImpl> self =
+    std::dynamic_pointer_cast<MediaElementImpl> (shared_from_this () );
+
+  events.push_back ([self, elementConnected] () {
+    self->signalElementConnected (elementConnected);
+  });
 }
 
 void
@@ -977,6 +1009,19 @@ void MediaElementImpl::disconnect (std::shared_ptr<MediaElement> sink,
                                    std::shared_ptr<MediaType> mediaType,
                                    const std::string &sourceMediaDescription,
                                    const std::string &sinkMediaDescription)
+{
+  std::vector <std::function <void () >> events;
+
+  disconnectInternal (sink, mediaType, sourceMediaDescription,
+                      sinkMediaDescription, events);
+  emitConnectionEvents (events);
+}
+
+void MediaElementImpl::disconnectInternal (std::shared_ptr<MediaElement> sink,
+    std::shared_ptr<MediaType> mediaType,
+    const std::string &sourceMediaDescription,
+    const std::string &sinkMediaDescription,
+    std::vector <std::function <void () >> &events)
 {
   if (!sink) {
     GST_WARNING ("Sink not available while disconnecting");
@@ -994,25 +1039,33 @@ void MediaElementImpl::disconnect (std::shared_ptr<MediaElement> sink,
 
   try {
     std::shared_ptr<ElementConnectionDataInternal> connectionData;
+    std::shared_ptr<MediaElementImpl> connectedSource;
     gboolean ret;
 
     connectionData = sinkImpl->sources.at (mediaType).at (sinkMediaDescription);
+    connectedSource = connectionData->getSource ();
 
-    if (connectionData->toInterface()->getSourceDescription() ==
-        sourceMediaDescription) {
-      sinkImpl->sources.at (mediaType).erase (sinkMediaDescription);
-    }
+    if (connectedSource && connectedSource->getId () != getId () ) {
+      /* The sink is fed by another element, which keeps its connection */
+      GST_DEBUG ("%s is not connected to %s", getName().c_str(),
+                 sink->getName ().c_str () );
+    } else {
+      if (connectionData->toInterface()->getSourceDescription() ==
+          sourceMediaDescription) {
+        sinkImpl->sources.at (mediaType).erase (sinkMediaDescription);
+      }
 
-    for (auto conn : sinks.at (mediaType).at (sourceMediaDescription) ) {
-      if (conn->toInterface()->getSink() == sink &&
-          conn->toInterface()->getSinkDescription() == sinkMediaDescription) {
-        sinks.at (mediaType).at (sourceMediaDescription).erase (conn);
-        break;
+      for (auto conn : sinks.at (mediaType).at (sourceMediaDescription) ) {
+        if (conn->toInterface()->getSink() == sink &&
+            conn->toInterface()->getSinkDescription() == sinkMediaDescription) {
+          sinks.at (mediaType).at (sourceMediaDescription).erase (conn);
+          break;
+        }
       }
-    }
 
-    g_signal_emit_by_name (getGstreamerElement (), "release-requested-pad",
-                           connectionData->getSourcePadName (), &ret, NULL);
+      g_signal_emit_by_name (getGstreamerElement (), "release-requested-pad",
+                             connectionData->getSourcePadName (), &ret, NULL);
+    }
   } catch (std::out_of_range) {
 
   }
@@ -1024,7 +1077,12 @@ void MediaElementImpl::disconnect (std::shared_ptr<MediaElement> sink,
       ElementDisconnected::getName (),
       sink, mediaType, sourceMediaDescription,
       sinkMediaDescription);
-  signalElementDisconnected (elementDisconnected);
+  std::shared_ptr<MediaElementImpl> self =
+    std::dynamic_pointer_cast<MediaElementImpl> (shared_from_this () );
+
+  events.push_back ([self, elementDisconnected] () {
+    self->signalElementDisconnected (elementDisconnected);
+  });
 }
 
 void MediaElementImpl::setAudioFormat (std::shared_ptr<AudioCaps> caps)
@@ -1302,8 +1360,10 @@ MediaElementImpl::fillStatsReport (std::map
                                    &report, const GstStructure *stats, double timestamp)
 {
   std::shared_ptr<Stats> elementStats;
+  std::shared_ptr<ElementStats> eStats;
   GstStructure *latencies;
   const GValue *value;
+  guint64 droppedFrames = 0;
 
   value = gst_structure_get_value (stats, KMS_MEDIA_ELEMENT_FIELD);
 
@@ -1331,19 +1391,23 @@ MediaElementImpl::fillStatsReport (std::map
     gst_structure_free (latencies);
   }
 
+  gst_structure_get_uint64 (gst_value_get_structure (value), "dropped-frames",
+                            &droppedFrames);
+
   if (report.find (getId () ) != report.end() ) {
-    std::shared_ptr<ElementStats> eStats =
-      std::dynamic_pointer_cast <ElementStats> (report[getId ()]);
+    eStats = std::dynamic_pointer_cast <ElementStats> (report[getId ()]);
     eStats->setInputLatency (inputLatencies);
   } else {
     elementStats = std::make_shared <ElementStats> (getId (),
                    std::make_shared <StatsType> (StatsType::element), timestamp,
                    0.0, 0.0, inputLatencies);
     report[getId ()] = elementStats;
+    eStats = std::dynamic_pointer_cast <ElementStats> (elementStats);
   }
 
-  setDeprecatedProperties (std::dynamic_pointer_cast <ElementStats>
-                           (report[getId ()]) );
+  eStats->setDroppedFrames (droppedFrames);
+
+  setDeprecatedProperties (eStats);
 }
 
 bool MediaElementImpl::isMediaFlowingIn (std::shared_ptr<MediaType> mediaType)
@@ -26,6 +26,7 @@
 #include <mutex>
 #include <set>
 #include <random>
+#include <functional>
 #include "MediaFlowOutStateChange.hpp"
 #include "MediaFlowInStateChange.hpp"
 #include "MediaFlowState.hpp"
@@ -216,6 +217,22 @@ private:
 
   void disconnectAll();
   void performConnection (std::shared_ptr <ElementConnectionDataInternal> data);
+
+  /* Like connect and disconnect, but the ElementConnected and
+   * ElementDisconnected events are appended to events instead of being
+   * emitted, so that a batch of changes can notify once it is applied */
+  void connectInternal (std::shared_ptr<MediaElement> sink,
+                        std::shared_ptr<MediaType> mediaType,
+                        const std::string &sourceMediaDescription,
+                        const std::string &sinkMediaDescription,
+                        std::vector <std::function <void () >> &events);
+  void disconnectInternal (std::shared_ptr<MediaElement> sink,
+                           std::shared_ptr<MediaType> mediaType,
+                           const std::string &sourceMediaDescription,
+                           const std::string &sinkMediaDescription,
+                           std::vector <std::function <void () >> &events);
+  static void emitConnectionEvents (std::vector <std::function <void () >>
+                                    &events);
   std::map <std::string, std::shared_ptr<Stats>> generateStats (
         const gchar *selector);
   void mediaFlowOutStateChange (gboolean isFlowing, gchar *padName,
@@ -235,6 +252,7 @@ private:
       gpointer data);
   friend void _media_element_pad_added (GstElement *elem, GstPad *pad,
                                         gpointer data);
+  friend class MediaPipelineImpl;
 };
 
 } /* kurento */
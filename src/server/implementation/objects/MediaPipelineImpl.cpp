@@ -23,14 +23,83 @@
 #include <DotGraph.hpp>
 #include <GstreamerDotDetails.hpp>
 #include <SignalHandler.hpp>
+#include <ConnectionOperation.hpp>
+#include <ConnectionAction.hpp>
+#include <MediaType.hpp>
+#include <ElementConnectionData.hpp>
+#include "MediaElementImpl.hpp"
+#include <PipelinePool.hpp>
 #include "kmselement.h"
 
 #define GST_CAT_DEFAULT kurento_media_pipeline_impl
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 #define GST_DEFAULT_NAME "KurentoMediaPipelineImpl"
 
+#define PARAM_IDLE_PIPELINES "idlePipelines"
+
 namespace kurento
 {
+
+const static std::string DEFAULT = "default";
+
+class PendingConnection
+{
+public:
+  PendingConnection (bool connect, std::shared_ptr<MediaElementImpl> source,
+                     std::shared_ptr<MediaElementImpl> sink,
+                     std::shared_ptr<MediaType> type,
+                     const std::string &sourceDescription,
+                     const std::string &sinkDescription)
+    : connect (connect), source (source), sink (sink), type (type),
+      sourceDescription (sourceDescription), sinkDescription (sinkDescription)
+  {
+  }
+
+  std::string getSinkKey () const
+  {
+    return sink->getId () + "/" + type->getString () + "/" + sinkDescription;
+  }
+
+  bool connect;
+  std::shared_ptr<MediaElementImpl> source;
+  std::shared_ptr<MediaElementImpl> sink;
+  std::shared_ptr<MediaType> type;
+  std::string sourceDescription;
+  std::string sinkDescription;
+};
+
+/* An operation being applied and what it has to restore if the batch fails */
+class AppliedConnection
+{
+public:
+  AppliedConnection (const PendingConnection &op) : op (op), completed (false)
+  {
+    std::vector<std::shared_ptr<ElementConnectionData>> connections =
+          op.sink->getSourceConnections (op.type, op.sinkDescription);
+
+    if (!connections.empty () ) {
+      previousSource = std::dynamic_pointer_cast<MediaElementImpl>
+                       (connections.at (0)->getSource () );
+      previousSourceDescription = connections.at (0)->getSourceDescription ();
+    }
+  }
+
+  /* Connecting the current source or disconnecting any other one does not
+   * modify the sink, so there is nothing to undo */
+  bool changesLink () const
+  {
+    bool isCurrent = previousSource == op.source &&
+                     previousSourceDescription == op.sourceDescription;
+
+    return op.connect ? !isCurrent : isCurrent;
+  }
+
+  PendingConnection op;
+  std::shared_ptr<MediaElementImpl> previousSource;
+  std::string previousSourceDescription;
+  bool completed;
+};
+
 void
 MediaPipelineImpl::busMessage (GstMessage *message)
 {
@@ -97,20 +166,11 @@ void MediaPipelineImpl::postConstructor ()
 MediaPipelineImpl::MediaPipelineImpl (const boost::property_tree::ptree &config)
   : MediaObjectImpl (config)
 {
-  GstClock *clock;
-
-  pipeline = gst_pipeline_new (NULL);
-
-  if (pipeline == NULL) {
-    throw KurentoException (MEDIA_OBJECT_NOT_AVAILABLE,
-                            "Cannot create gstreamer pipeline");
-  }
-
-  clock = gst_system_clock_obtain ();
-  gst_pipeline_use_clock (GST_PIPELINE (pipeline), clock);
-  g_object_unref (clock);
+  std::shared_ptr<PipelinePool> pool = PipelinePool::getPipelinePool ();
 
-  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  pool->setMaxIdle (getConfigValue <guint, MediaPipeline> (PARAM_IDLE_PIPELINES,
+                    pool->getMaxIdle () ) );
+  pipeline = pool->acquire ();
 
   busMessageHandler = 0;
 }
@@ -127,7 +187,7 @@ MediaPipelineImpl::~MediaPipelineImpl ()
 
   gst_bus_remove_signal_watch (bus);
   g_object_unref (bus);
-  g_object_unref (pipeline);
+  PipelinePool::getPipelinePool ()->release (pipeline);
 }
 
 std::string MediaPipelineImpl::getGstreamerDot (
@@ -193,6 +253,141 @@ MediaPipelineImpl::setLatencyStats (bool latencyStats)
   gst_iterator_free (it);
 }
 
+void
+MediaPipelineImpl::applyConnections (const
+                                     std::vector<std::shared_ptr<ConnectionOperation>> &operations)
+{
+  std::vector<PendingConnection> pending;
+  std::vector<PendingConnection> batch;
+  std::vector<AppliedConnection> applied;
+  std::set<std::string> connectedSinks;
+  std::vector <std::function <void () >> events;
+  std::unique_lock <std::recursive_mutex> lock (recMutex);
+
+  /* Everything is checked before the graph is modified, so an invalid
+   * operation does not leave the batch half applied */
+  for (auto operation : operations) {
+    std::shared_ptr<MediaElementImpl> source =
+      std::dynamic_pointer_cast<MediaElementImpl> (operation->getSource () );
+    std::shared_ptr<MediaElementImpl> sink =
+      std::dynamic_pointer_cast<MediaElementImpl> (operation->getSink () );
+    std::vector<std::shared_ptr<MediaType>> types;
+    std::string sourceDescription = DEFAULT;
+    std::string sinkDescription = DEFAULT;
+    bool connect;
+
+    if (!source || !sink) {
+      throw KurentoException (CONNECT_ERROR,
+                              "Connection operation without source or sink");
+    }
+
+    if (source->getMediaPipeline ()->getId () != getId () ||
+        sink->getMediaPipeline ()->getId () != getId () ) {
+      throw KurentoException (CONNECT_ERROR,
+                              "Media elements are not part of pipeline " + getId () );
+    }
+
+    connect = operation->getAction ()->getValue () == ConnectionAction::CONNECT;
+
+    if (operation->isSetMediaType () ) {
+      types.push_back (operation->getMediaType () );
+    } else {
+      types.push_back (std::shared_ptr<MediaType> (new MediaType (
+                         MediaType::AUDIO) ) );
+      types.push_back (std::shared_ptr<MediaType> (new MediaType (
+                         MediaType::VIDEO) ) );
+      types.push_back (std::shared_ptr<MediaType> (new MediaType (
+                         MediaType::DATA) ) );
+    }
+
+    if (operation->isSetSourceMediaDescription () ) {
+      sourceDescription = operation->getSourceMediaDescription ();
+    }
+
+    if (operation->isSetSinkMediaDescription () ) {
+      sinkDescription = operation->getSinkMediaDescription ();
+    }
+
+    for (auto type : types) {
+      pending.push_back (PendingConnection (connect, source, sink, type,
+                                            sourceDescription, sinkDescription) );
+    }
+  }
+
+  /* A sink has one source per media type and description, so whatever was
+   * done to it before its last connection in the batch would be undone by
+   * that connection. Skip those operations to avoid relinking pads and
+   * renegotiating the source agnosticbins more than once */
+  for (auto it = pending.rbegin (); it != pending.rend (); it++) {
+    std::string key = it->getSinkKey ();
+
+    if (connectedSinks.find (key) != connectedSinks.end () ) {
+      GST_DEBUG ("Skipping superseded operation on %s", key.c_str () );
+      continue;
+    }
+
+    if (it->connect) {
+      connectedSinks.insert (key);
+    }
+
+    batch.insert (batch.begin (), *it);
+  }
+
+  GST_DEBUG ("Applying %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT
+             " connection operations", batch.size (), pending.size () );
+
+  try {
+    for (auto &op : batch) {
+      applied.push_back (AppliedConnection (op) );
+
+      if (op.connect) {
+        op.source->connectInternal (op.sink, op.type, op.sourceDescription,
+                                    op.sinkDescription, events);
+      } else {
+        op.source->disconnectInternal (op.sink, op.type, op.sourceDescription,
+                                       op.sinkDescription, events);
+      }
+
+      applied.back ().completed = true;
+    }
+  } catch (KurentoException &e) {
+    GST_WARNING ("Connection batch interrupted, undoing %" G_GSIZE_FORMAT
+                 " operations: %s", applied.size (), e.what () );
+
+    /* Give each sink back the source it had before the batch, newest
+     * operation first. Only operations that modified the sink are undone.
+     * A failed connection is, as connecting releases the previous source
+     * before it can fail */
+    for (auto it = applied.rbegin (); it != applied.rend (); it++) {
+      if (!it->changesLink () && (it->completed || !it->op.connect) ) {
+        continue;
+      }
+
+      try {
+        if (it->previousSource) {
+          it->previousSource->connectInternal (it->op.sink, it->op.type,
+                                               it->previousSourceDescription,
+                                               it->op.sinkDescription, events);
+        } else if (it->op.connect && it->completed) {
+          it->op.source->disconnectInternal (it->op.sink, it->op.type,
+                                             it->op.sourceDescription,
+                                             it->op.sinkDescription, events);
+        }
+      } catch (KurentoException &undoError) {
+        GST_ERROR ("Cannot undo operation on %s: %s",
+                   it->op.getSinkKey ().c_str (), undoError.what () );
+      }
+    }
+
+    lock.unlock ();
+    MediaElementImpl::emitConnectionEvents (events);
+    throw;
+  }
+
+  lock.unlock ();
+  MediaElementImpl::emitConnectionEvents (events);
+}
+
 bool
 MediaPipelineImpl::addElement (GstElement *element)
 {
@@ -27,6 +27,7 @@ namespace kurento
 {
 
 class MediaPipelineImpl;
+class ConnectionOperation;
 
 void Serialize (std::shared_ptr<MediaPipelineImpl> &object,
                 JsonSerializer &serializer);
@@ -52,6 +53,9 @@ public:
   virtual bool getLatencyStats ();
   virtual void setLatencyStats (bool latencyStats);
 
+  virtual void applyConnections (const
+                                 std::vector<std::shared_ptr<ConnectionOperation>> &operations);
+
   /* Next methods are automatically implemented by code generator */
   virtual bool connect (const std::string &eventType,
                         std::shared_ptr<EventHandler> handler);
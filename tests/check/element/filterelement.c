@@ -17,6 +17,35 @@
 #include <gst/check/gstcheck.h>
 #include <gst/gst.h>
 #include <glib.h>
+#include "../../src/gst-plugins/commons/kmselementpadtype.h"
+
+/* Buffers fed to the filter element, one keyframe every KEYFRAME_INTERVAL */
+#define KEYFRAME_INTERVAL 5
+#define BUFFERS_PER_STEP 20
+
+typedef enum
+{
+  BYPASS_STEP_FILTERING,
+  BYPASS_STEP_BYPASS_REQUESTED,
+  BYPASS_STEP_BYPASSED,
+  BYPASS_STEP_FILTER_REQUESTED,
+  BYPASS_STEP_FILTERING_AGAIN,
+  BYPASS_STEP_DONE
+} BypassStep;
+
+typedef struct _KmsBypassData
+{
+  GMutex mutex;
+  GMainLoop *loop;
+  GstElement *filterelement;
+  GstElement *fakesink;
+  BypassStep step;
+  guint64 next_offset;
+  /* Offset of the last buffer processed by the filter */
+  guint64 filtered;
+  guint count;
+} KmsBypassData;
+
 GST_START_TEST (check_invalid_factory)
 {
   GstElement *filterelement, *filter;
@@ -153,6 +182,251 @@ GST_START_TEST (check_properties)
 
 GST_END_TEST;
 
+GST_START_TEST (check_bypass)
+{
+  GstElement *filterelement, *filter;
+  GstPad *filter_sink;
+  gboolean bypass;
+
+  filterelement = gst_element_factory_make ("filterelement", NULL);
+
+  g_object_get (G_OBJECT (filterelement), "bypass", &bypass, NULL);
+  fail_if (bypass);
+
+  g_object_set (G_OBJECT (filterelement), "filter_factory", "videoflip",
+      NULL);
+  g_object_get (G_OBJECT (filterelement), "filter", &filter, NULL);
+  fail_unless (filter != NULL);
+
+  filter_sink = gst_element_get_static_pad (filter, "sink");
+  fail_unless (gst_pad_is_linked (filter_sink));
+
+  /* Without data flowing the filter is unlinked right away */
+  g_object_set (G_OBJECT (filterelement), "bypass", TRUE, NULL);
+  g_object_get (G_OBJECT (filterelement), "bypass", &bypass, NULL);
+  fail_unless (bypass);
+  fail_if (gst_pad_is_linked (filter_sink));
+
+  g_object_set (G_OBJECT (filterelement), "bypass", FALSE, NULL);
+  fail_unless (gst_pad_is_linked (filter_sink));
+
+  g_object_unref (filter_sink);
+  g_object_unref (filter);
+  gst_object_unref (filterelement);
+}
+
+GST_END_TEST;
+
+static gboolean
+quit_main_loop_idle (gpointer loop)
+{
+  g_main_loop_quit (loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+toggle_bypass (gpointer user_data)
+{
+  KmsBypassData *data = user_data;
+  gboolean bypass;
+
+  g_object_get (data->filterelement, "bypass", &bypass, NULL);
+  GST_DEBUG_OBJECT (data->filterelement, "Setting bypass to %d", !bypass);
+  g_object_set (data->filterelement, "bypass", !bypass, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static GstPadProbeReturn
+mark_keyframes (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  KmsBypassData *data = user_data;
+  GstBuffer *buffer = gst_pad_probe_info_get_buffer (info);
+
+  buffer = gst_buffer_make_writable (buffer);
+  GST_PAD_PROBE_INFO_DATA (info) = buffer;
+
+  g_mutex_lock (&data->mutex);
+  GST_BUFFER_OFFSET (buffer) = data->next_offset++;
+  g_mutex_unlock (&data->mutex);
+
+  if (GST_BUFFER_OFFSET (buffer) % KEYFRAME_INTERVAL == 0) {
+    GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  } else {
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+filter_buffer (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  KmsBypassData *data = user_data;
+  GstBuffer *buffer = gst_pad_probe_info_get_buffer (info);
+
+  g_mutex_lock (&data->mutex);
+  if (data->step == BYPASS_STEP_FILTER_REQUESTED) {
+    GST_DEBUG ("Filter connected back on buffer %" G_GUINT64_FORMAT,
+        GST_BUFFER_OFFSET (buffer));
+    fail_if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT));
+    data->step = BYPASS_STEP_FILTERING_AGAIN;
+    data->count = 0;
+  }
+  data->filtered = GST_BUFFER_OFFSET (buffer);
+  g_mutex_unlock (&data->mutex);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+bypass_handoff (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  KmsBypassData *data = user_data;
+  gboolean filtered;
+
+  g_mutex_lock (&data->mutex);
+
+  /* Buffers going through the filter were seen by it before */
+  filtered = GST_BUFFER_OFFSET (buf) <= data->filtered;
+  data->count++;
+
+  switch (data->step) {
+    case BYPASS_STEP_FILTERING:
+      fail_unless (filtered);
+      if (data->count >= BUFFERS_PER_STEP) {
+        data->step = BYPASS_STEP_BYPASS_REQUESTED;
+        g_idle_add (toggle_bypass, data);
+      }
+      break;
+    case BYPASS_STEP_BYPASS_REQUESTED:
+      if (!filtered) {
+        GST_DEBUG ("Filter bypassed on buffer %" G_GUINT64_FORMAT,
+            GST_BUFFER_OFFSET (buf));
+        fail_if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT));
+        data->step = BYPASS_STEP_BYPASSED;
+        data->count = 0;
+      }
+      break;
+    case BYPASS_STEP_BYPASSED:
+      fail_if (filtered);
+      if (data->count >= BUFFERS_PER_STEP) {
+        data->step = BYPASS_STEP_FILTER_REQUESTED;
+        g_idle_add (toggle_bypass, data);
+      }
+      break;
+    case BYPASS_STEP_FILTERING_AGAIN:
+      if (data->count >= BUFFERS_PER_STEP) {
+        data->step = BYPASS_STEP_DONE;
+        g_object_set (fakesink, "signal-handoffs", FALSE, NULL);
+        g_idle_add (quit_main_loop_idle, data->loop);
+      }
+      break;
+    default:
+      break;
+  }
+
+  g_mutex_unlock (&data->mutex);
+}
+
+static void
+bypass_link_output (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  KmsBypassData *data = user_data;
+  GstPad *sinkpad;
+
+  if (gst_pad_get_direction (pad) != GST_PAD_SRC) {
+    return;
+  }
+
+  sinkpad = gst_element_get_static_pad (data->fakesink, "sink");
+  fail_unless (gst_pad_link (pad, sinkpad) == GST_PAD_LINK_OK);
+  g_object_unref (sinkpad);
+}
+
+static gboolean
+bypass_timeout (gpointer user_data)
+{
+  KmsBypassData *data = user_data;
+
+  g_mutex_lock (&data->mutex);
+  GST_ERROR ("Timeout on step %d", data->step);
+  g_mutex_unlock (&data->mutex);
+  fail ("Media stopped flowing while toggling bypass");
+
+  return G_SOURCE_REMOVE;
+}
+
+GST_START_TEST (check_bypass_playing)
+{
+  GstElement *pipeline = gst_pipeline_new (__FUNCTION__);
+  GstElement *videotestsrc = gst_element_factory_make ("videotestsrc", NULL);
+  GstElement *filter;
+  GstPad *pad;
+  KmsBypassData data;
+  gchar *padname;
+  guint timeout;
+
+  g_mutex_init (&data.mutex);
+  data.loop = g_main_loop_new (NULL, TRUE);
+  data.filterelement = gst_element_factory_make ("filterelement", NULL);
+  data.fakesink = gst_element_factory_make ("fakesink", NULL);
+  data.step = BYPASS_STEP_FILTERING;
+  data.next_offset = 0;
+  data.filtered = 0;
+  data.count = 0;
+
+  g_object_set (videotestsrc, "is-live", TRUE, NULL);
+  g_object_set (data.fakesink, "sync", FALSE, "async", FALSE,
+      "signal-handoffs", TRUE, NULL);
+  g_signal_connect (data.fakesink, "handoff", G_CALLBACK (bypass_handoff),
+      &data);
+
+  g_object_set (data.filterelement, "filter_factory", "videoflip", NULL);
+  g_object_get (data.filterelement, "filter", &filter, NULL);
+  fail_unless (filter != NULL);
+
+  pad = gst_element_get_static_pad (filter, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, filter_buffer, &data,
+      NULL);
+  g_object_unref (pad);
+  g_object_unref (filter);
+
+  gst_bin_add_many (GST_BIN (pipeline), videotestsrc, data.filterelement,
+      data.fakesink, NULL);
+  fail_unless (gst_element_link_pads (videotestsrc, NULL, data.filterelement,
+          "sink_video_default"));
+
+  pad = gst_element_get_static_pad (data.filterelement, "sink_video_default");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, mark_keyframes, &data,
+      NULL);
+  g_object_unref (pad);
+
+  g_signal_connect (data.filterelement, "pad-added",
+      G_CALLBACK (bypass_link_output), &data);
+  g_signal_emit_by_name (data.filterelement, "request-new-pad",
+      KMS_ELEMENT_PAD_TYPE_VIDEO, NULL, GST_PAD_SRC, &padname);
+  fail_unless (padname != NULL);
+  g_free (padname);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  timeout = g_timeout_add_seconds (10, bypass_timeout, &data);
+
+  g_main_loop_run (data.loop);
+
+  g_source_remove (timeout);
+  fail_unless (data.step == BYPASS_STEP_DONE);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_object_unref (pipeline);
+  g_main_loop_unref (data.loop);
+  g_mutex_clear (&data.mutex);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (provide_created_filter)
 {
   GstElement *filterelement, *filter, *got_factory;
@@ -232,6 +506,8 @@ filterelement_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, check_properties);
+  tcase_add_test (tc_chain, check_bypass);
+  tcase_add_test (tc_chain, check_bypass_playing);
   tcase_add_test (tc_chain, check_invalid_pads_factory);
   tcase_add_test (tc_chain, check_invalid_factory);
   tcase_add_test (tc_chain, provide_created_filter);
@@ -21,9 +21,11 @@
 
 #include <gst/check/gstcheck.h>
 #include <gst/gst.h>
+#include <string.h>
 #include <time.h>
 
 #include "kmsbufferlacentymeta.h"
+#include "kmsserializablemeta.h"
 
 #define KMS_FACTORY_MAKE_IF_AVAILABLE(factory_name) ({      \
   GstElement *_element;                                     \
@@ -416,6 +418,109 @@ GST_START_TEST (check_metadata_enc)
   }
 }
 
+GST_END_TEST
+GST_START_TEST (serializable_meta_merge)
+{
+  GstBuffer *buffer = gst_buffer_new ();
+  GstStructure *data;
+  const gchar *str;
+  gint value;
+
+  kms_buffer_add_serializable_meta (buffer,
+      gst_structure_new ("metadata", "id", G_TYPE_INT, 1, "name",
+          G_TYPE_STRING, "first", NULL));
+  kms_buffer_add_serializable_meta (buffer,
+      gst_structure_new ("metadata", "name", G_TYPE_STRING, "second",
+          "extra", G_TYPE_BOOLEAN, TRUE, NULL));
+
+  data = kms_serializable_meta_get_metadata (buffer);
+  fail_if (data == NULL);
+
+  fail_unless (gst_structure_get_int (data, "id", &value));
+  fail_unless (value == 1);
+
+  str = gst_structure_get_string (data, "name");
+  fail_unless (g_strcmp0 (str, "second") == 0);
+  fail_unless (gst_structure_has_field (data, "extra"));
+
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST
+GST_START_TEST (serializable_meta_binary_format)
+{
+  GstBuffer *buffer = gst_buffer_new (), *received = gst_buffer_new ();
+  GstStructure *data, *nested;
+  gchar *serialized, *text;
+  GBytes *bytes;
+
+  nested = gst_structure_new ("nested", "count", G_TYPE_UINT, 7, NULL);
+  data = gst_structure_new ("metadata",
+      "negative", G_TYPE_INT, -12345,
+      "big", G_TYPE_UINT64, G_GUINT64_CONSTANT (1) << 40,
+      "ratio", G_TYPE_DOUBLE, 0.25,
+      "enabled", G_TYPE_BOOLEAN, TRUE,
+      "label", G_TYPE_STRING, "telemetry",
+      "fraction", GST_TYPE_FRACTION, 30, 1,
+      "child", GST_TYPE_STRUCTURE, nested, NULL);
+  gst_structure_free (nested);
+
+  kms_buffer_add_serializable_meta (buffer, data);
+
+  bytes = kms_serializable_meta_serialize (buffer);
+  fail_if (bytes == NULL);
+
+  text = gst_structure_to_string (kms_serializable_meta_get_metadata (buffer));
+  GST_INFO ("Binary metadata: %" G_GSIZE_FORMAT " bytes, string metadata: %"
+      G_GSIZE_FORMAT " bytes", g_bytes_get_size (bytes), strlen (text));
+  fail_unless (g_bytes_get_size (bytes) < strlen (text));
+
+  fail_if (kms_buffer_add_serializable_meta_from_bytes (received,
+          bytes) == NULL);
+
+  serialized =
+      gst_structure_to_string (kms_serializable_meta_get_metadata (received));
+  fail_unless (g_strcmp0 (text, serialized) == 0);
+
+  g_free (serialized);
+  g_free (text);
+  g_bytes_unref (bytes);
+  gst_buffer_unref (received);
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST
+static void
+check_malformed_binary (const guint8 * data, gsize size)
+{
+  GstBuffer *buffer = gst_buffer_new ();
+  GBytes *bytes;
+
+  bytes = g_bytes_new_static (data, size);
+  fail_unless (kms_buffer_add_serializable_meta_from_bytes (buffer,
+          bytes) == NULL);
+  fail_unless (kms_serializable_meta_get_metadata (buffer) == NULL);
+
+  g_bytes_unref (bytes);
+  gst_buffer_unref (buffer);
+}
+
+GST_START_TEST (serializable_meta_malformed_binary)
+{
+  const guint8 truncated[] = { 1, 9, 'm', 'e', 't' };
+  /* Values whose type cannot be held by a GValue */
+  const guint8 not_value_type[] = { 1, 2, 'm', 1, 2, 'f', 'v',
+    5, 'v', 'o', 'i', 'd', 2, 'x'
+  };
+  const guint8 abstract_type[] = { 1, 2, 'm', 1, 2, 'f', 'v',
+    10, 'G', 's', 't', 'O', 'b', 'j', 'e', 'c', 't', 2, 'x'
+  };
+
+  check_malformed_binary (truncated, sizeof (truncated));
+  check_malformed_binary (not_value_type, sizeof (not_value_type));
+  check_malformed_binary (abstract_type, sizeof (abstract_type));
+}
+
 GST_END_TEST
 /******************************/
 /* metadata test suite        */
@@ -429,6 +534,9 @@ metadata_suite (void)
   suite_add_tcase (s, tc_chain);
 
   tcase_add_test (tc_chain, check_metadata_enc);
+  tcase_add_test (tc_chain, serializable_meta_merge);
+  tcase_add_test (tc_chain, serializable_meta_binary_format);
+  tcase_add_test (tc_chain, serializable_meta_malformed_binary);
 
   return s;
 }
@@ -1431,6 +1431,305 @@ GST_START_TEST (request_data_sink_pad)
   kms_connect_data_destroy (data);
 }
 
+GST_END_TEST typedef struct _KmsFlowOutData
+{
+  GstElement *src;
+  gchar *padname;
+  gint requested;
+} KmsFlowOutData;
+
+static gboolean
+release_flow_out_pad (KmsFlowOutData * data)
+{
+  gboolean ret;
+
+  g_signal_emit_by_name (data->src, "release-requested-pad", data->padname,
+      &ret);
+  fail_unless (ret);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+flow_out_media_cb (GstElement * element, gboolean flowing, gchar * desc,
+    gint type, KmsFlowOutData * data)
+{
+  GST_DEBUG_OBJECT (element, "Media flowing out: %d", flowing);
+
+  /* Nothing flows out of an element until a src pad is requested */
+  fail_unless (g_atomic_int_get (&data->requested));
+  fail_unless (type == KMS_ELEMENT_PAD_TYPE_AUDIO);
+
+  if (flowing) {
+    g_idle_add ((GSourceFunc) release_flow_out_pad, data);
+  } else {
+    /* Tracking stops when the last src pad is released */
+    g_idle_add (quit_main_loop_idle, NULL);
+  }
+}
+
+static gboolean
+request_flow_out_pad (KmsFlowOutData * data)
+{
+  g_atomic_int_set (&data->requested, TRUE);
+  g_signal_emit_by_name (data->src, "request-new-pad",
+      KMS_ELEMENT_PAD_TYPE_AUDIO, NULL, GST_PAD_SRC, &data->padname);
+  fail_if (data->padname == NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+GST_START_TEST (flow_out_tracked_while_src_pad_requested)
+{
+  KmsFlowOutData data = { 0 };
+  GstBus *bus;
+
+  loop = g_main_loop_new (NULL, TRUE);
+  pipeline = gst_pipeline_new (__FUNCTION__);
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+
+  gst_bus_add_signal_watch (bus);
+  g_signal_connect (bus, "message", G_CALLBACK (bus_msg), pipeline);
+
+  data.src = gst_element_factory_make ("dummysrc", NULL);
+  g_signal_connect (data.src, "flow-out-media",
+      G_CALLBACK (flow_out_media_cb), &data);
+
+  gst_bin_add (GST_BIN (pipeline), data.src);
+
+  /* Audio reaches the output element before any src pad is requested */
+  g_object_set (G_OBJECT (data.src), "audio", TRUE, NULL);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  g_timeout_add_seconds (1, (GSourceFunc) request_flow_out_pad, &data);
+  g_timeout_add_seconds (4, print_timedout_pipeline, NULL);
+  g_main_loop_run (loop);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  g_object_unref (bus);
+  g_object_unref (pipeline);
+  g_free (data.padname);
+  g_main_loop_unref (loop);
+}
+
+GST_END_TEST typedef struct _KmsLazyOutputData
+{
+  GstElement *src;
+  gchar *padname;
+  guint step;
+} KmsLazyOutputData;
+
+static guint
+count_agnosticbins (GstElement * element)
+{
+  GValue item = G_VALUE_INIT;
+  gboolean done = FALSE;
+  GstIterator *it;
+  guint count = 0;
+
+  it = gst_bin_iterate_elements (GST_BIN (element));
+
+  while (!done) {
+    switch (gst_iterator_next (it, &item)) {
+      case GST_ITERATOR_OK:{
+        GstElementFactory *factory;
+
+        factory = gst_element_get_factory (g_value_get_object (&item));
+        if (factory != NULL &&
+            g_strcmp0 (GST_OBJECT_NAME (factory), "agnosticbin") == 0) {
+          count++;
+        }
+        g_value_reset (&item);
+        break;
+      }
+      case GST_ITERATOR_RESYNC:
+        gst_iterator_resync (it);
+        count = 0;
+        break;
+      case GST_ITERATOR_ERROR:
+      case GST_ITERATOR_DONE:
+        done = TRUE;
+        break;
+    }
+  }
+
+  gst_iterator_free (it);
+
+  return count;
+}
+
+static gboolean
+check_lazy_output_element (KmsLazyOutputData * data)
+{
+  gboolean ret;
+
+  switch (data->step++) {
+    case 0:
+      /* Audio is flowing in but nobody consumes it */
+      fail_unless (count_agnosticbins (data->src) == 0);
+
+      g_signal_emit_by_name (data->src, "request-new-pad",
+          KMS_ELEMENT_PAD_TYPE_AUDIO, NULL, GST_PAD_SRC, &data->padname);
+      fail_if (data->padname == NULL);
+      fail_unless (count_agnosticbins (data->src) == 1);
+      break;
+    case 1:
+      g_signal_emit_by_name (data->src, "release-requested-pad",
+          data->padname, &ret);
+      fail_unless (ret);
+      break;
+    default:
+      /* Output element is removed once its upstream is idle */
+      if (count_agnosticbins (data->src) == 0) {
+        g_main_loop_quit (loop);
+        return G_SOURCE_REMOVE;
+      }
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+GST_START_TEST (output_element_created_on_src_pad_request)
+{
+  KmsLazyOutputData data = { 0 };
+  GstBus *bus;
+
+  loop = g_main_loop_new (NULL, TRUE);
+  pipeline = gst_pipeline_new (__FUNCTION__);
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+
+  gst_bus_add_signal_watch (bus);
+  g_signal_connect (bus, "message", G_CALLBACK (bus_msg), pipeline);
+
+  data.src = gst_element_factory_make ("dummysrc", NULL);
+  gst_bin_add (GST_BIN (pipeline), data.src);
+
+  g_object_set (G_OBJECT (data.src), "audio", TRUE, NULL);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  g_timeout_add (200, (GSourceFunc) check_lazy_output_element, &data);
+  g_timeout_add_seconds (4, print_timedout_pipeline, NULL);
+  g_main_loop_run (loop);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  g_object_unref (bus);
+  g_object_unref (pipeline);
+  g_free (data.padname);
+  g_main_loop_unref (loop);
+}
+
+GST_END_TEST typedef struct _KmsDataCounter
+{
+  gint messages;
+  gint lists;
+} KmsDataCounter;
+
+static GstPadProbeReturn
+count_data_messages (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  KmsDataCounter *counter = data;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    g_atomic_int_add (&counter->messages,
+        gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info)));
+    g_atomic_int_inc (&counter->lists);
+  } else {
+    g_atomic_int_inc (&counter->messages);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+pad_added_count_data (GstElement * element, GstPad * new_pad,
+    gpointer counter)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (G_OBJECT (sink), "async", FALSE, "sync", FALSE, NULL);
+
+  gst_bin_add (GST_BIN (pipeline), sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (sinkpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      count_data_messages, counter, NULL);
+
+  if (gst_pad_link (new_pad, sinkpad) != GST_PAD_LINK_OK) {
+    fail ("Could not link pads");
+  }
+
+  g_object_unref (sinkpad);
+  gst_element_sync_state_with_parent (sink);
+}
+
+static gint
+count_data_messages_with_batch (guint batch, gint * lists)
+{
+  KmsDataCounter counter = { 0, 0 };
+  gchar *padname = NULL;
+  GstElement *dummysrc;
+  GstBus *bus;
+
+  loop = g_main_loop_new (NULL, TRUE);
+  pipeline = gst_pipeline_new (__FUNCTION__);
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+
+  gst_bus_add_signal_watch (bus);
+  g_signal_connect (bus, "message", G_CALLBACK (bus_msg), pipeline);
+
+  dummysrc = gst_element_factory_make ("dummysrc", NULL);
+  g_object_set (G_OBJECT (dummysrc), "data-batch", batch, "data", TRUE, NULL);
+  g_signal_connect (dummysrc, "pad-added", G_CALLBACK (pad_added_count_data),
+      &counter);
+
+  gst_bin_add (GST_BIN (pipeline), dummysrc);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  g_signal_emit_by_name (dummysrc, "request-new-pad",
+      KMS_ELEMENT_PAD_TYPE_DATA, NULL, GST_PAD_SRC, &padname);
+  fail_if (padname == NULL);
+  g_free (padname);
+
+  g_timeout_add_seconds (1, quit_main_loop_idle, NULL);
+  g_main_loop_run (loop);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  g_object_unref (bus);
+  g_object_unref (pipeline);
+  g_main_loop_unref (loop);
+
+  *lists = g_atomic_int_get (&counter.lists);
+
+  return g_atomic_int_get (&counter.messages);
+}
+
+GST_START_TEST (data_batch_benchmark)
+{
+  guint batches[] = { 1, 8, 64 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (batches); i++) {
+    gint lists;
+    gint messages = count_data_messages_with_batch (batches[i], &lists);
+
+    GST_INFO ("Data batch %u: %d messages/s in %d lists", batches[i],
+        messages, lists);
+    fail_unless (messages > 0);
+
+    /* Batched messages must reach the sink as buffer lists */
+    if (batches[i] > 1) {
+      fail_unless (lists > 0);
+    }
+  }
+}
+
 GST_END_TEST
 /*
  * End of test cases
@@ -1458,6 +1757,9 @@ pads_connection_suite (void)
   tcase_add_test (tc_chain,
       disconnect_requested_src_pad_linked_with_buffer_injector);
   tcase_add_test (tc_chain, request_data_sink_pad);
+  tcase_add_test (tc_chain, flow_out_tracked_while_src_pad_requested);
+  tcase_add_test (tc_chain, output_element_created_on_src_pad_request);
+  tcase_add_test (tc_chain, data_batch_benchmark);
 
   return s;
 }
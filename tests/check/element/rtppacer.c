@@ -0,0 +1,357 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
+#include <gst/gst.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <glib.h>
+
+#define PACKET_SIZE 1000
+#define N_PACKETS 10
+#define NO_CAPS_CHANGE G_MAXUINT
+
+typedef struct _Received
+{
+  GstClock *clock;
+  GArray *seqnums;
+  gint count;                   /* atomic */
+  GstClockTime first;
+  GstClockTime last;
+  guint caps_events;
+  gint caps_position;           /* Packets received before the last caps */
+} Received;
+
+#define RECEIVED_INIT { NULL, NULL, 0, 0, 0, 0, -1 }
+
+static void
+fakesink_hand_off (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer data)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  Received *received = data;
+  guint16 seq;
+
+  fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+  seq = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  received->last = gst_clock_get_time (received->clock);
+  if (received->seqnums->len == 0) {
+    received->first = received->last;
+  }
+
+  g_array_append_val (received->seqnums, seq);
+  g_atomic_int_inc (&received->count);
+}
+
+static GstPadProbeReturn
+caps_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+  Received *received = data;
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS
+      && received->caps_events++ > 0) {
+    received->caps_position = received->seqnums->len;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+push_rtp_buffer (GstElement * appsrc, guint16 seq)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstFlowReturn ret;
+  GstBuffer *buffer;
+
+  buffer = gst_rtp_buffer_new_allocate (PACKET_SIZE - 12, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_ssrc (&rtp, 1234);
+  gst_rtp_buffer_set_payload_type (&rtp, 96);
+  gst_rtp_buffer_set_seq (&rtp, seq);
+  gst_rtp_buffer_unmap (&rtp);
+
+  g_signal_emit_by_name (appsrc, "push-buffer", buffer, &ret);
+  fail_unless (ret == GST_FLOW_OK);
+  gst_buffer_unref (buffer);
+}
+
+static void
+wait_queued_packets (GstElement * pacer, guint n)
+{
+  GstStructure *stats;
+  guint queued = 0;
+
+  while (queued < n) {
+    g_object_get (pacer, "stats", &stats, NULL);
+    fail_unless (gst_structure_get_uint (stats, "queued-packets", &queued));
+    gst_structure_free (stats);
+
+    if (queued < n) {
+      g_usleep (G_USEC_PER_SEC / 1000);
+    }
+  }
+}
+
+/*
+ * The pacer waits on the pipeline clock, a test clock is advanced to each
+ * pending wait until every packet has been received. Caps are changed before
+ * pushing the packet in position @caps_change, once the previous ones are
+ * queued in the pacer.
+ */
+static void
+run_pacer (gint bitrate, const guint16 * seqnums, guint n, guint caps_change,
+    Received * received, GstStructure ** stats)
+{
+  GstElement *pipeline, *appsrc, *pacer, *fakesink;
+  GstClock *clock = gst_test_clock_new ();
+  GstMessage *msg;
+  GstCaps *caps;
+  GstPad *pad;
+  GstBus *bus;
+  guint i;
+
+  pipeline =
+      gst_parse_launch
+      ("appsrc name=src format=time caps=application/x-rtp ! rtppacer name=pacer"
+      " pacing-factor=1.0 burst-time=0 ! fakesink name=sink sync=false"
+      " async=false signal-handoffs=true", NULL);
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  gst_pipeline_use_clock (GST_PIPELINE (pipeline), clock);
+  received->clock = clock;
+
+  appsrc = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  pacer = gst_bin_get_by_name (GST_BIN (pipeline), "pacer");
+  fakesink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  g_object_set (pacer, "bitrate", bitrate, NULL);
+  g_signal_connect (G_OBJECT (fakesink), "handoff",
+      G_CALLBACK (fakesink_hand_off), received);
+
+  pad = gst_element_get_static_pad (fakesink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, caps_probe,
+      received, NULL);
+  g_object_unref (pad);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  for (i = 0; i < n; i++) {
+    if (i == caps_change) {
+      wait_queued_packets (pacer, i);
+      caps = gst_caps_from_string ("application/x-rtp, payload=(int)97");
+      g_object_set (appsrc, "caps", caps, NULL);
+      gst_caps_unref (caps);
+    }
+
+    push_rtp_buffer (appsrc, seqnums[i]);
+  }
+  g_signal_emit_by_name (appsrc, "end-of-stream", NULL);
+
+  if (bitrate > 0) {
+    /* Nothing leaves the pacer until the clock advances, so queue delays */
+    /* are measured from the same instant for every packet                */
+    wait_queued_packets (pacer, n);
+  }
+
+  while (g_atomic_int_get (&received->count) < n) {
+    GstClockID id;
+
+    if (!gst_test_clock_peek_next_pending_id (GST_TEST_CLOCK (clock), &id)) {
+      g_usleep (G_USEC_PER_SEC / 1000);
+      continue;
+    }
+
+    gst_clock_id_unref (id);
+    gst_test_clock_crank (GST_TEST_CLOCK (clock));
+  }
+
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS,
+      "Error received on bus");
+  gst_message_unref (msg);
+
+  g_object_get (pacer, "stats", stats, NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_object_unref (bus);
+  g_object_unref (appsrc);
+  g_object_unref (pacer);
+  g_object_unref (fakesink);
+  g_object_unref (pipeline);
+  received->clock = NULL;
+  gst_object_unref (clock);
+}
+
+GST_START_TEST (passthrough)
+{
+  Received received = RECEIVED_INIT;
+  guint16 seqnums[N_PACKETS];
+  GstStructure *stats;
+  guint64 sent;
+  guint i;
+
+  received.seqnums = g_array_new (FALSE, FALSE, sizeof (guint16));
+  for (i = 0; i < N_PACKETS; i++) {
+    seqnums[i] = i;
+  }
+
+  run_pacer (0, seqnums, N_PACKETS, NO_CAPS_CHANGE, &received, &stats);
+
+  fail_unless (received.seqnums->len == N_PACKETS);
+  for (i = 0; i < N_PACKETS; i++) {
+    fail_unless (g_array_index (received.seqnums, guint16, i) == i);
+  }
+
+  fail_unless (gst_structure_get_uint64 (stats, "sent-packets", &sent));
+  fail_unless (sent == N_PACKETS);
+
+  gst_structure_free (stats);
+  g_array_free (received.seqnums, TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (spread_burst)
+{
+  Received received = RECEIVED_INIT;
+  guint16 seqnums[N_PACKETS];
+  GstStructure *stats;
+  guint64 max_delay;
+  guint i;
+
+  received.seqnums = g_array_new (FALSE, FALSE, sizeof (guint16));
+  for (i = 0; i < N_PACKETS; i++) {
+    seqnums[i] = i;
+  }
+
+  /* 100000 bytes per second, 10 ms per packet */
+  run_pacer (800000, seqnums, N_PACKETS, NO_CAPS_CHANGE, &received,
+      &stats);
+
+  fail_unless (received.seqnums->len == N_PACKETS);
+  GST_DEBUG ("Burst sent in %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (received.last - received.first));
+  fail_unless (received.last - received.first >=
+      (N_PACKETS - 1) * 10 * GST_MSECOND);
+
+  fail_unless (gst_structure_get_uint64 (stats, "max-queue-delay",
+          &max_delay));
+  fail_unless (max_delay >= (N_PACKETS - 1) * 10 * GST_MSECOND);
+
+  gst_structure_free (stats);
+  g_array_free (received.seqnums, TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (retransmissions_first)
+{
+  Received received = RECEIVED_INIT;
+  guint16 seqnums[N_PACKETS + 1];
+  GstStructure *stats;
+  gint retransmission = -1;
+  guint i;
+
+  received.seqnums = g_array_new (FALSE, FALSE, sizeof (guint16));
+  for (i = 0; i < N_PACKETS; i++) {
+    seqnums[i] = i;
+  }
+  /* Resent with its original seqnum, as rtprtxqueue does */
+  seqnums[N_PACKETS] = 2;
+
+  run_pacer (800000, seqnums, N_PACKETS + 1, NO_CAPS_CHANGE, &received,
+      &stats);
+
+  fail_unless (received.seqnums->len == N_PACKETS + 1);
+
+  for (i = 3; i < received.seqnums->len; i++) {
+    if (g_array_index (received.seqnums, guint16, i) == 2) {
+      retransmission = i;
+      break;
+    }
+  }
+
+  GST_DEBUG ("Retransmission sent in position %d", retransmission);
+  fail_unless (retransmission != -1);
+  fail_unless (retransmission < N_PACKETS);
+
+  gst_structure_free (stats);
+  g_array_free (received.seqnums, TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (retransmission_after_caps)
+{
+  Received received = RECEIVED_INIT;
+  guint16 seqnums[N_PACKETS + 1];
+  GstStructure *stats;
+  gint retransmission = -1;
+  guint i;
+
+  received.seqnums = g_array_new (FALSE, FALSE, sizeof (guint16));
+  for (i = 0; i < N_PACKETS; i++) {
+    seqnums[i] = i;
+  }
+  /* Resent once new caps are queued behind the original packets */
+  seqnums[N_PACKETS] = 2;
+
+  run_pacer (800000, seqnums, N_PACKETS + 1, N_PACKETS, &received, &stats);
+
+  fail_unless (received.seqnums->len == N_PACKETS + 1);
+
+  for (i = 3; i < received.seqnums->len; i++) {
+    if (g_array_index (received.seqnums, guint16, i) == 2) {
+      retransmission = i;
+      break;
+    }
+  }
+
+  GST_DEBUG ("Retransmission sent in position %d, caps in position %d",
+      retransmission, received.caps_position);
+  fail_unless (received.caps_position == N_PACKETS);
+  fail_unless (retransmission == N_PACKETS);
+
+  gst_structure_free (stats);
+  g_array_free (received.seqnums, TRUE);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtp_pacer_suite (void)
+{
+  Suite *s = suite_create ("rtppacer");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, passthrough);
+  tcase_add_test (tc_chain, spread_burst);
+  tcase_add_test (tc_chain, retransmissions_first);
+  tcase_add_test (tc_chain, retransmission_after_caps);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtp_pacer);
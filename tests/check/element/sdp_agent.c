@@ -5704,6 +5704,145 @@ GST_START_TEST (sdp_agent_renegotiation_chrome)
 
 GST_END_TEST;
 
+static KmsSdpMediaHandler *
+create_avpf_handler (void)
+{
+  KmsSdpMediaHandler *handler;
+  GError *err = NULL;
+
+  handler = KMS_SDP_MEDIA_HANDLER (kms_sdp_rtp_avpf_media_handler_new ());
+  fail_if (handler == NULL);
+
+  set_default_codecs (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), audio_codecs,
+      G_N_ELEMENTS (audio_codecs), video_codecs, G_N_ELEMENTS (video_codecs));
+
+  fail_unless (kms_sdp_rtp_avp_media_handler_add_extmap
+      (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), 3,
+          "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time", &err));
+
+  return handler;
+}
+
+static gchar *
+create_video_offer_text (KmsSdpAgent * agent)
+{
+  GstSDPMessage *offer;
+  GError *err = NULL;
+  gchar *media_str;
+
+  offer = kms_sdp_agent_create_offer (agent, &err);
+  fail_if (err != NULL);
+
+  media_str = gst_sdp_media_as_text (gst_sdp_message_get_media (offer, 0));
+  GST_DEBUG ("Offered media:\n%s", media_str);
+
+  gst_sdp_message_free (offer);
+  fail_if (!kms_sdpagent_cancel_offer (agent, &err));
+
+  return media_str;
+}
+
+GST_START_TEST (sdp_agent_test_offer_templates)
+{
+  KmsSdpAgent *agent1, *agent2;
+  KmsSdpMediaHandler *handler;
+  gchar *media1, *media2, *pt_str;
+  GError *err = NULL;
+  gint pt;
+
+  agent1 = kms_sdp_agent_new ();
+  agent2 = kms_sdp_agent_new ();
+
+  add_media_handler (agent1, "video", create_avpf_handler ());
+  handler = create_avpf_handler ();
+  add_media_handler (agent2, "video", handler);
+
+  /* Same configuration, same codecs and extensions offered */
+  media1 = create_video_offer_text (agent1);
+  media2 = create_video_offer_text (agent2);
+  fail_if (g_strcmp0 (media1, media2) != 0);
+  g_free (media2);
+
+  /* Changing the configuration must not reuse the previous template */
+  pt = kms_sdp_rtp_avp_media_handler_add_generic_video_payload
+      (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), "VP9/90000", &err);
+  fail_if (pt < 0);
+  fail_unless (kms_sdp_rtp_avp_media_handler_add_fmtp
+      (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), pt, "profile-id=0", &err));
+
+  media2 = create_video_offer_text (agent2);
+  fail_if (g_strcmp0 (media1, media2) == 0);
+
+  pt_str = g_strdup_printf ("%d", pt);
+  fail_unless (g_strrstr (media2, pt_str) != NULL);
+  fail_unless (g_strrstr (media2, "VP9/90000") != NULL);
+  fail_unless (g_strrstr (media2, "profile-id=0") != NULL);
+  g_free (pt_str);
+
+  g_free (media1);
+  g_free (media2);
+
+  /* The first agent still offers the original configuration */
+  media1 = create_video_offer_text (agent1);
+  fail_if (g_strrstr (media1, "VP9/90000") != NULL);
+  g_free (media1);
+
+  g_object_unref (agent1);
+  g_object_unref (agent2);
+}
+
+GST_END_TEST;
+
+#define NEGOTIATION_ITERATIONS 500
+
+GST_START_TEST (sdp_agent_negotiation_throughput)
+{
+  GstSDPMessage *offer, *answer;
+  KmsSdpAgent *offerer, *answerer;
+  GError *err = NULL;
+  gint64 start, elapsed;
+  guint i;
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < NEGOTIATION_ITERATIONS; i++) {
+    offerer = kms_sdp_agent_new ();
+    g_object_set (offerer, "addr", OFFERER_ADDR, NULL);
+    add_media_handler (offerer, "audio", create_avpf_handler ());
+    add_media_handler (offerer, "video", create_avpf_handler ());
+
+    answerer = kms_sdp_agent_new ();
+    g_object_set (answerer, "addr", ANSWERER_ADDR, NULL);
+    add_media_handler (answerer, "audio", create_avpf_handler ());
+    add_media_handler (answerer, "video", create_avpf_handler ());
+
+    offer = kms_sdp_agent_create_offer (offerer, &err);
+    fail_if (err != NULL);
+    fail_if (!kms_sdp_agent_set_local_description (offerer, offer, &err));
+
+    fail_if (!kms_sdp_agent_set_remote_description (answerer, offer, &err));
+    answer = kms_sdp_agent_create_answer (answerer, &err);
+    fail_if (err != NULL);
+    fail_if (!kms_sdp_agent_set_local_description (answerer, answer, &err));
+
+    fail_if (!kms_sdp_agent_set_remote_description (offerer, answer, &err));
+    check_all_is_negotiated (offer, answer);
+
+    gst_sdp_message_free (offer);
+    gst_sdp_message_free (answer);
+    g_object_unref (offerer);
+    g_object_unref (answerer);
+  }
+
+  elapsed = g_get_monotonic_time () - start;
+
+  GST_INFO ("%u negotiations in %" G_GINT64_FORMAT " us (%.1f per second)",
+      NEGOTIATION_ITERATIONS, elapsed,
+      NEGOTIATION_ITERATIONS * (gdouble) G_USEC_PER_SEC / MAX (elapsed, 1));
+}
+
+GST_END_TEST;
+
 static Suite *
 sdp_agent_suite (void)
 {
@@ -5754,6 +5893,9 @@ sdp_agent_suite (void)
 
   tcase_add_test (tc_chain, sdp_agent_renegotiation_chrome);
 
+  tcase_add_test (tc_chain, sdp_agent_test_offer_templates);
+  tcase_add_test (tc_chain, sdp_agent_negotiation_throughput);
+
   return s;
 }
 
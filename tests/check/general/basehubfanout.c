@@ -0,0 +1,140 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsbasehub.h"
+#include "kmshubport.h"
+
+#include <gst/check/gstcheck.h>
+#include <glib.h>
+
+/* Minimal hub, ports are linked by the tests */
+#define KMS_TYPE_TEST_HUB kms_test_hub_get_type()
+
+typedef struct _KmsTestHub
+{
+  KmsBaseHub parent;
+} KmsTestHub;
+
+typedef struct _KmsTestHubClass
+{
+  KmsBaseHubClass parent_class;
+} KmsTestHubClass;
+
+GType kms_test_hub_get_type (void);
+
+G_DEFINE_TYPE (KmsTestHub, kms_test_hub, KMS_TYPE_BASE_HUB);
+
+static void
+kms_test_hub_class_init (KmsTestHubClass * klass)
+{
+}
+
+static void
+kms_test_hub_init (KmsTestHub * self)
+{
+}
+
+static guint
+count_elements (GstElement * bin, const gchar * factory_name)
+{
+  GstElementFactory *factory;
+  guint count = 0;
+  GList *l;
+
+  GST_OBJECT_LOCK (bin);
+  for (l = GST_BIN_CHILDREN (bin); l != NULL; l = l->next) {
+    factory = gst_element_get_factory (GST_ELEMENT (l->data));
+
+    if (factory != NULL &&
+        g_strcmp0 (GST_OBJECT_NAME (factory), factory_name) == 0) {
+      count++;
+    }
+  }
+  GST_OBJECT_UNLOCK (bin);
+
+  return count;
+}
+
+GST_START_TEST (link_and_unlink_ports)
+{
+  GstElement *pipe = gst_pipeline_new (NULL);
+  GstElement *hub = g_object_new (KMS_TYPE_TEST_HUB, NULL);
+  GstElement *port1 = g_object_new (KMS_TYPE_HUB_PORT, NULL);
+  GstElement *port2 = g_object_new (KMS_TYPE_HUB_PORT, NULL);
+  GstElement *src = gst_element_factory_make ("videotestsrc", NULL);
+  GstPad *src_pad;
+  gint id1, id2;
+
+  gst_bin_add_many (GST_BIN (pipe), hub, port1, port2, NULL);
+  g_signal_emit_by_name (hub, "handle-port", port1, &id1);
+  g_signal_emit_by_name (hub, "handle-port", port2, &id2);
+  fail_unless (id1 >= 0);
+  fail_unless (id2 >= 0);
+
+  gst_bin_add (GST_BIN (hub), src);
+  src_pad = gst_element_get_static_pad (src, "src");
+
+  fail_unless (kms_base_hub_link_video_src_fanout (KMS_BASE_HUB (hub), id1,
+          src, "src"));
+  fail_unless (kms_base_hub_link_video_src_fanout (KMS_BASE_HUB (hub), id2,
+          src, "src"));
+
+  /* Both ports are fed by the same tee, each one through its own queue */
+  fail_unless_equals_int (count_elements (hub, "tee"), 1);
+  fail_unless_equals_int (count_elements (hub, "queue"), 2);
+  fail_unless (gst_pad_is_linked (src_pad));
+
+  fail_unless (kms_base_hub_unlink_video_src (KMS_BASE_HUB (hub), id1));
+  fail_unless_equals_int (count_elements (hub, "tee"), 1);
+  fail_unless_equals_int (count_elements (hub, "queue"), 1);
+  fail_unless (gst_pad_is_linked (src_pad));
+
+  /* The fan-out is released with its last branch */
+  fail_unless (kms_base_hub_unlink_video_src (KMS_BASE_HUB (hub), id2));
+  fail_unless_equals_int (count_elements (hub, "tee"), 0);
+  fail_unless_equals_int (count_elements (hub, "queue"), 0);
+  fail_if (gst_pad_is_linked (src_pad));
+
+  /* A new link creates the fan-out again */
+  fail_unless (kms_base_hub_link_video_src_fanout (KMS_BASE_HUB (hub), id1,
+          src, "src"));
+  fail_unless_equals_int (count_elements (hub, "tee"), 1);
+  fail_unless_equals_int (count_elements (hub, "queue"), 1);
+
+  g_signal_emit_by_name (hub, "unhandle-port", id1);
+  g_signal_emit_by_name (hub, "unhandle-port", id2);
+
+  g_object_unref (src_pad);
+  g_object_unref (pipe);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+basehubfanout_suite (void)
+{
+  Suite *s = suite_create ("basehubfanout");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, link_and_unlink_ports);
+
+  return s;
+}
+
+GST_CHECK_MAIN (basehubfanout);
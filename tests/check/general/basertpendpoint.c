@@ -0,0 +1,700 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/sdp/gstsdpmessage.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "kmsbasertpendpoint.h"
+#include "kmsbasertpsession.h"
+#include "kmsirtpconnection.h"
+#include "kmsirtpsessionmanager.h"
+#include "kmsstats.h"
+#include "sdpagent/kmssdprtpavpmediahandler.h"
+
+/* Connection begin */
+
+/* Connection without transport: sent packets are dropped and nothing is */
+/* ever received */
+
+#define KMS_TYPE_TEST_CONNECTION (kms_test_connection_get_type ())
+
+typedef struct _KmsTestConnection
+{
+  GObject parent;
+
+  GstElement *rtp_src, *rtcp_src;
+  GstElement *rtp_funnel, *rtcp_funnel;
+  GstElement *rtp_sink, *rtcp_sink;
+  gboolean added;
+} KmsTestConnection;
+
+typedef struct _KmsTestConnectionClass
+{
+  GObjectClass parent_class;
+} KmsTestConnectionClass;
+
+enum
+{
+  PROP_0,
+  PROP_CONNECTED,
+  PROP_ADDED,
+  PROP_IS_CLIENT,
+  PROP_MIN_PORT,
+  PROP_MAX_PORT
+};
+
+static void kms_test_connection_interface_init (KmsIRtpConnectionInterface *
+    iface);
+
+static void
+kms_test_connection_empty_interface_init (gpointer iface)
+{
+  /* Nothing to do */
+}
+
+G_DEFINE_TYPE_WITH_CODE (KmsTestConnection, kms_test_connection,
+    G_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE (KMS_TYPE_I_RTP_CONNECTION,
+        kms_test_connection_interface_init)
+    G_IMPLEMENT_INTERFACE (KMS_TYPE_I_RTCP_MUX_CONNECTION,
+        kms_test_connection_empty_interface_init)
+    G_IMPLEMENT_INTERFACE (KMS_TYPE_I_BUNDLE_CONNECTION,
+        kms_test_connection_empty_interface_init));
+
+static GstElement *
+create_sink (GstBin * bin, GstElement ** funnel)
+{
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+
+  *funnel = gst_element_factory_make ("funnel", NULL);
+  g_object_set (sink, "async", FALSE, "sync", FALSE, NULL);
+
+  gst_bin_add_many (bin, *funnel, sink, NULL);
+  gst_element_link (*funnel, sink);
+
+  return sink;
+}
+
+static void
+kms_test_connection_add (KmsIRtpConnection * base, GstBin * bin,
+    gboolean active)
+{
+  KmsTestConnection *self = (KmsTestConnection *) base;
+
+  self->rtp_src = gst_element_factory_make ("fakesrc", NULL);
+  self->rtcp_src = gst_element_factory_make ("fakesrc", NULL);
+  gst_bin_add_many (bin, self->rtp_src, self->rtcp_src, NULL);
+
+  self->rtp_sink = create_sink (bin, &self->rtp_funnel);
+  self->rtcp_sink = create_sink (bin, &self->rtcp_funnel);
+}
+
+static void
+kms_test_connection_src_sync_state_with_parent (KmsIRtpConnection * base)
+{
+  KmsTestConnection *self = (KmsTestConnection *) base;
+
+  gst_element_sync_state_with_parent (self->rtp_src);
+  gst_element_sync_state_with_parent (self->rtcp_src);
+}
+
+static void
+kms_test_connection_sink_sync_state_with_parent (KmsIRtpConnection * base)
+{
+  KmsTestConnection *self = (KmsTestConnection *) base;
+
+  gst_element_sync_state_with_parent (self->rtp_sink);
+  gst_element_sync_state_with_parent (self->rtp_funnel);
+  gst_element_sync_state_with_parent (self->rtcp_sink);
+  gst_element_sync_state_with_parent (self->rtcp_funnel);
+}
+
+static GstPad *
+kms_test_connection_request_rtp_sink (KmsIRtpConnection * base)
+{
+  KmsTestConnection *self = (KmsTestConnection *) base;
+
+  /* Bundled medias share the connection */
+  return gst_element_get_request_pad (self->rtp_funnel, "sink_%u");
+}
+
+static GstPad *
+kms_test_connection_request_rtp_src (KmsIRtpConnection * base)
+{
+  KmsTestConnection *self = (KmsTestConnection *) base;
+
+  return gst_element_get_static_pad (self->rtp_src, "src");
+}
+
+static GstPad *
+kms_test_connection_request_rtcp_sink (KmsIRtpConnection * base)
+{
+  KmsTestConnection *self = (KmsTestConnection *) base;
+
+  return gst_element_get_request_pad (self->rtcp_funnel, "sink_%u");
+}
+
+static GstPad *
+kms_test_connection_request_rtcp_src (KmsIRtpConnection * base)
+{
+  KmsTestConnection *self = (KmsTestConnection *) base;
+
+  return gst_element_get_static_pad (self->rtcp_src, "src");
+}
+
+static void
+kms_test_connection_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  KmsTestConnection *self = (KmsTestConnection *) object;
+
+  switch (prop_id) {
+    case PROP_ADDED:
+      self->added = g_value_get_boolean (value);
+      break;
+    case PROP_CONNECTED:
+    case PROP_MIN_PORT:
+    case PROP_MAX_PORT:
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+kms_test_connection_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  KmsTestConnection *self = (KmsTestConnection *) object;
+
+  switch (prop_id) {
+    case PROP_CONNECTED:
+      /* Payloaders are connected as soon as they are created */
+      g_value_set_boolean (value, TRUE);
+      break;
+    case PROP_ADDED:
+      g_value_set_boolean (value, self->added);
+      break;
+    case PROP_IS_CLIENT:
+      g_value_set_boolean (value, FALSE);
+      break;
+    case PROP_MIN_PORT:
+    case PROP_MAX_PORT:
+      g_value_set_uint (value, 0);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+kms_test_connection_class_init (KmsTestConnectionClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->set_property = kms_test_connection_set_property;
+  gobject_class->get_property = kms_test_connection_get_property;
+
+  g_object_class_override_property (gobject_class, PROP_CONNECTED,
+      "connected");
+  g_object_class_override_property (gobject_class, PROP_ADDED, "added");
+  g_object_class_override_property (gobject_class, PROP_IS_CLIENT,
+      "is-client");
+  g_object_class_override_property (gobject_class, PROP_MIN_PORT, "min-port");
+  g_object_class_override_property (gobject_class, PROP_MAX_PORT, "max-port");
+}
+
+static void
+kms_test_connection_interface_init (KmsIRtpConnectionInterface * iface)
+{
+  iface->add = kms_test_connection_add;
+  iface->src_sync_state_with_parent =
+      kms_test_connection_src_sync_state_with_parent;
+  iface->sink_sync_state_with_parent =
+      kms_test_connection_sink_sync_state_with_parent;
+  iface->request_rtp_sink = kms_test_connection_request_rtp_sink;
+  iface->request_rtp_src = kms_test_connection_request_rtp_src;
+  iface->request_rtcp_sink = kms_test_connection_request_rtcp_sink;
+  iface->request_rtcp_src = kms_test_connection_request_rtcp_src;
+}
+
+static void
+kms_test_connection_init (KmsTestConnection * self)
+{
+}
+
+/* Connection end */
+
+/* Session begin */
+
+#define KMS_TYPE_TEST_RTP_SESSION (kms_test_rtp_session_get_type ())
+
+typedef struct _KmsTestRtpSession
+{
+  KmsBaseRtpSession parent;
+} KmsTestRtpSession;
+
+typedef struct _KmsTestRtpSessionClass
+{
+  KmsBaseRtpSessionClass parent_class;
+} KmsTestRtpSessionClass;
+
+G_DEFINE_TYPE (KmsTestRtpSession, kms_test_rtp_session,
+    KMS_TYPE_BASE_RTP_SESSION);
+
+static KmsIRtpConnection *
+kms_test_rtp_session_create_connection (KmsBaseRtpSession * self,
+    const GstSDPMedia * media, const gchar * name, guint16 min_port,
+    guint16 max_port)
+{
+  return KMS_I_RTP_CONNECTION (g_object_new (KMS_TYPE_TEST_CONNECTION, NULL));
+}
+
+static KmsIRtcpMuxConnection *
+kms_test_rtp_session_create_rtcp_mux_connection (KmsBaseRtpSession * self,
+    const gchar * name, guint16 min_port, guint16 max_port)
+{
+  return KMS_I_RTCP_MUX_CONNECTION (g_object_new (KMS_TYPE_TEST_CONNECTION,
+          NULL));
+}
+
+static KmsIBundleConnection *
+kms_test_rtp_session_create_bundle_connection (KmsBaseRtpSession * self,
+    const gchar * name, guint16 min_port, guint16 max_port)
+{
+  return KMS_I_BUNDLE_CONNECTION (g_object_new (KMS_TYPE_TEST_CONNECTION,
+          NULL));
+}
+
+static void
+kms_test_rtp_session_class_init (KmsTestRtpSessionClass * klass)
+{
+  KmsBaseRtpSessionClass *base_class = KMS_BASE_RTP_SESSION_CLASS (klass);
+
+  base_class->create_connection = kms_test_rtp_session_create_connection;
+  base_class->create_rtcp_mux_connection =
+      kms_test_rtp_session_create_rtcp_mux_connection;
+  base_class->create_bundle_connection =
+      kms_test_rtp_session_create_bundle_connection;
+}
+
+static void
+kms_test_rtp_session_init (KmsTestRtpSession * self)
+{
+}
+
+/* Session end */
+
+/* Endpoint begin */
+
+#define KMS_TYPE_TEST_RTP_ENDPOINT (kms_test_rtp_endpoint_get_type ())
+
+typedef struct _KmsTestRtpEndpoint
+{
+  KmsBaseRtpEndpoint parent;
+} KmsTestRtpEndpoint;
+
+typedef struct _KmsTestRtpEndpointClass
+{
+  KmsBaseRtpEndpointClass parent_class;
+} KmsTestRtpEndpointClass;
+
+G_DEFINE_TYPE (KmsTestRtpEndpoint, kms_test_rtp_endpoint,
+    KMS_TYPE_BASE_RTP_ENDPOINT);
+
+static void
+kms_test_rtp_endpoint_create_session_internal (KmsBaseSdpEndpoint * base_sdp,
+    gint id, KmsSdpSession ** sess)
+{
+  KmsBaseRtpSession *rtp_sess;
+
+  rtp_sess = g_object_new (KMS_TYPE_TEST_RTP_SESSION, NULL);
+  KMS_BASE_RTP_SESSION_CLASS (G_OBJECT_GET_CLASS (rtp_sess))->post_constructor
+      (rtp_sess, base_sdp, id, KMS_I_RTP_SESSION_MANAGER (base_sdp));
+  *sess = KMS_SDP_SESSION (rtp_sess);
+
+  /* Chain up */
+  KMS_BASE_SDP_ENDPOINT_CLASS
+      (kms_test_rtp_endpoint_parent_class)->create_session_internal (base_sdp,
+      id, sess);
+}
+
+static void
+kms_test_rtp_endpoint_create_media_handler (KmsBaseSdpEndpoint * base_sdp,
+    const gchar * media, KmsSdpMediaHandler ** handler)
+{
+  if (g_strcmp0 (media, "audio") == 0 || g_strcmp0 (media, "video") == 0) {
+    *handler = KMS_SDP_MEDIA_HANDLER (kms_sdp_rtp_avp_media_handler_new ());
+  }
+
+  /* Chain up */
+  KMS_BASE_SDP_ENDPOINT_CLASS
+      (kms_test_rtp_endpoint_parent_class)->create_media_handler (base_sdp,
+      media, handler);
+}
+
+static void
+kms_test_rtp_endpoint_class_init (KmsTestRtpEndpointClass * klass)
+{
+  KmsBaseSdpEndpointClass *base_sdp_class = KMS_BASE_SDP_ENDPOINT_CLASS (klass);
+
+  base_sdp_class->create_session_internal =
+      kms_test_rtp_endpoint_create_session_internal;
+  base_sdp_class->create_media_handler =
+      kms_test_rtp_endpoint_create_media_handler;
+}
+
+static void
+kms_test_rtp_endpoint_init (KmsTestRtpEndpoint * self)
+{
+}
+
+/* Endpoint end */
+
+static void
+append_codec (GArray * array, const gchar * codec)
+{
+  GValue v = G_VALUE_INIT;
+  GstStructure *s;
+
+  g_value_init (&v, GST_TYPE_STRUCTURE);
+  s = gst_structure_new_empty (codec);
+  gst_value_set_structure (&v, s);
+  gst_structure_free (s);
+  g_array_append_val (array, v);
+}
+
+static GstElement *
+create_endpoint (guint medias)
+{
+  GstElement *ep = g_object_new (KMS_TYPE_TEST_RTP_ENDPOINT, NULL);
+  GArray *audio_codecs, *video_codecs;
+
+  audio_codecs = g_array_new (FALSE, TRUE, sizeof (GValue));
+  append_codec (audio_codecs, "PCMU/8000");
+  video_codecs = g_array_new (FALSE, TRUE, sizeof (GValue));
+  append_codec (video_codecs, "VP8/90000");
+
+  /* The endpoint takes the codec arrays */
+  g_object_set (ep, "bundle", TRUE, "num-audio-medias", medias,
+      "audio-codecs", audio_codecs, "num-video-medias", medias,
+      "video-codecs", video_codecs, NULL);
+
+  return ep;
+}
+
+static void
+negotiate (GstElement * offerer, const gchar * offerer_sess,
+    GstElement * answerer, const gchar * answerer_sess)
+{
+  GstSDPMessage *offer = NULL, *answer = NULL;
+  gboolean ret = FALSE;
+
+  g_signal_emit_by_name (offerer, "generate-offer", offerer_sess, &offer);
+  fail_unless (offer != NULL);
+
+  g_signal_emit_by_name (answerer, "process-offer", answerer_sess, offer,
+      &answer);
+  fail_unless (answer != NULL);
+
+  g_signal_emit_by_name (offerer, "process-answer", offerer_sess, answer,
+      &ret);
+  fail_unless (ret);
+
+  gst_sdp_message_free (offer);
+  gst_sdp_message_free (answer);
+}
+
+static gint
+get_stats_session (GstElement * ep, const gchar * selector)
+{
+  GstStructure *stats, *rtc_stats;
+  gint session = -1;
+  gint i, n;
+
+  g_signal_emit_by_name (ep, "stats", selector, &stats);
+  fail_unless (gst_structure_get (stats, KMS_RTC_STATISTICS_FIELD,
+          GST_TYPE_STRUCTURE, &rtc_stats, NULL));
+
+  n = gst_structure_n_fields (rtc_stats);
+
+  /* Selected stats only hold the session of the selected media */
+  for (i = 0; i < n; i++) {
+    gint id;
+
+    if (sscanf (gst_structure_nth_field_name (rtc_stats, i), "session-%d",
+            &id) == 1) {
+      fail_unless_equals_int (session, -1);
+      session = id;
+    }
+  }
+
+  gst_structure_free (rtc_stats);
+  gst_structure_free (stats);
+
+  return session;
+}
+
+static gint
+is_rtpbin (const GValue * item, gpointer user_data)
+{
+  GstElement *element = g_value_get_object (item);
+  GstElementFactory *factory = gst_element_get_factory (element);
+
+  return (factory != NULL && g_strcmp0 (GST_OBJECT_NAME (factory),
+          "rtpbin") == 0) ? 0 : 1;
+}
+
+static gboolean
+has_rtp_session (GstElement * ep, gint session)
+{
+  GstIterator *it = gst_bin_iterate_elements (GST_BIN (ep));
+  GValue item = G_VALUE_INIT;
+  GObject *rtpsession = NULL;
+
+  fail_unless (gst_iterator_find_custom (it, (GCompareFunc) is_rtpbin, &item,
+          NULL));
+  g_signal_emit_by_name (g_value_get_object (&item), "get-internal-session",
+      session, &rtpsession);
+
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  if (rtpsession == NULL) {
+    return FALSE;
+  }
+
+  g_object_unref (rtpsession);
+
+  return TRUE;
+}
+
+static gboolean
+has_pad (GstElement * ep, const gchar * name)
+{
+  GstPad *pad = gst_element_get_static_pad (ep, name);
+
+  if (pad == NULL) {
+    return FALSE;
+  }
+
+  g_object_unref (pad);
+
+  return TRUE;
+}
+
+static void
+check_extra_medias (GstElement * ep)
+{
+  gint audio, video;
+
+  /* First medias keep their sessions, pads and selectors */
+  fail_unless_equals_int (get_stats_session (ep, "audio"), 0);
+  fail_unless_equals_int (get_stats_session (ep, "video"), 1);
+  fail_unless_equals_int (get_stats_session (ep, "audio0"), 0);
+  fail_unless_equals_int (get_stats_session (ep, "video0"), 1);
+  fail_unless (has_pad (ep, "sink_audio_default"));
+  fail_unless (has_pad (ep, "sink_video_default"));
+
+  /* Further ones get a session each, described by their mid */
+  audio = get_stats_session (ep, "audio1");
+  video = get_stats_session (ep, "video1");
+  fail_unless (audio > 1);
+  fail_unless (video > 1);
+  fail_unless (audio != video);
+  fail_unless (has_rtp_session (ep, audio));
+  fail_unless (has_rtp_session (ep, video));
+  fail_unless (has_pad (ep, "sink_audio_audio1"));
+  fail_unless (has_pad (ep, "sink_video_video1"));
+
+  fail_unless_equals_int (get_stats_session (ep, "audio2"), -1);
+}
+
+GST_START_TEST (extra_medias)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GstElement *offerer = create_endpoint (2);
+  GstElement *answerer = create_endpoint (2);
+  gchar *offerer_sess, *answerer_sess;
+
+  gst_bin_add_many (GST_BIN (pipeline), offerer, answerer, NULL);
+
+  g_signal_emit_by_name (offerer, "create-session", &offerer_sess);
+  g_signal_emit_by_name (answerer, "create-session", &answerer_sess);
+  fail_unless (offerer_sess != NULL && answerer_sess != NULL);
+
+  negotiate (offerer, offerer_sess, answerer, answerer_sess);
+
+  check_extra_medias (offerer);
+  check_extra_medias (answerer);
+
+  g_free (offerer_sess);
+  g_free (answerer_sess);
+  g_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static gint
+is_payloader (const GValue * item, gpointer user_data)
+{
+  GstElement *element = g_value_get_object (item);
+  GstElementFactory *factory = gst_element_get_factory (element);
+  const gchar *klass;
+
+  if (factory == NULL) {
+    return 1;
+  }
+
+  klass = gst_element_factory_get_metadata (factory,
+      GST_ELEMENT_METADATA_KLASS);
+
+  return (klass != NULL && strstr (klass, "Payloader") != NULL) ? 0 : 1;
+}
+
+static void
+count_payloader (const GValue * item, gpointer count)
+{
+  if (is_payloader (item, NULL) == 0) {
+    (*(guint *) count)++;
+  }
+}
+
+static guint
+count_payloaders (GstElement * ep)
+{
+  GstIterator *it = gst_bin_iterate_elements (GST_BIN (ep));
+  guint count = 0;
+
+  while (gst_iterator_foreach (it, count_payloader, &count) ==
+      GST_ITERATOR_RESYNC) {
+    gst_iterator_resync (it);
+    count = 0;
+  }
+
+  gst_iterator_free (it);
+
+  return count;
+}
+
+/* Rejects audio1 and makes video1 send only */
+static GstSDPMessage *
+modify_offer (const GstSDPMessage * offer)
+{
+  GstSDPMessage *copy;
+  guint i, j;
+
+  gst_sdp_message_copy (offer, &copy);
+
+  for (i = 0; i < gst_sdp_message_medias_len (copy); i++) {
+    GstSDPMedia *media = (GstSDPMedia *) gst_sdp_message_get_media (copy, i);
+    const gchar *mid = gst_sdp_media_get_attribute_val (media, "mid");
+
+    if (g_strcmp0 (mid, "audio1") == 0) {
+      gst_sdp_media_set_port_info (media, 0, 1);
+    } else if (g_strcmp0 (mid, "video1") == 0) {
+      for (j = gst_sdp_media_attributes_len (media); j > 0; j--) {
+        const GstSDPAttribute *attr = gst_sdp_media_get_attribute (media,
+            j - 1);
+
+        if (g_strcmp0 (attr->key, "sendrecv") == 0) {
+          gst_sdp_media_remove_attribute (media, j - 1);
+        }
+      }
+
+      gst_sdp_media_add_attribute (media, "sendonly", "");
+    }
+  }
+
+  return copy;
+}
+
+GST_START_TEST (renegotiation)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GstElement *offerer = create_endpoint (2);
+  GstElement *answerer = create_endpoint (2);
+  GstSDPMessage *offer = NULL, *modified, *answer = NULL;
+  gchar *offerer_sess, *answerer_sess;
+  gint video;
+  gboolean ret = FALSE;
+
+  gst_bin_add_many (GST_BIN (pipeline), offerer, answerer, NULL);
+
+  g_signal_emit_by_name (offerer, "create-session", &offerer_sess);
+  g_signal_emit_by_name (answerer, "create-session", &answerer_sess);
+  fail_unless (offerer_sess != NULL && answerer_sess != NULL);
+
+  negotiate (offerer, offerer_sess, answerer, answerer_sess);
+  fail_unless_equals_int (count_payloaders (answerer), 4);
+  video = get_stats_session (answerer, "video1");
+
+  /* Unchanged medias keep their payloaders */
+  negotiate (offerer, offerer_sess, answerer, answerer_sess);
+  fail_unless_equals_int (count_payloaders (answerer), 4);
+
+  g_signal_emit_by_name (offerer, "generate-offer", offerer_sess, &offer);
+  fail_unless (offer != NULL);
+  modified = modify_offer (offer);
+
+  g_signal_emit_by_name (answerer, "process-offer", answerer_sess, modified,
+      &answer);
+  fail_unless (answer != NULL);
+  g_signal_emit_by_name (offerer, "process-answer", offerer_sess, answer,
+      &ret);
+  fail_unless (ret);
+
+  /* Rejected media is torn down and changed one gets a single payloader */
+  fail_unless_equals_int (get_stats_session (answerer, "audio1"), -1);
+  fail_unless (!has_pad (answerer, "sink_audio_audio1"));
+  fail_unless_equals_int (get_stats_session (answerer, "video1"), video);
+  fail_unless (has_pad (answerer, "sink_video_video1"));
+  fail_unless_equals_int (count_payloaders (answerer), 3);
+
+  fail_unless_equals_int (get_stats_session (offerer, "audio1"), -1);
+  fail_unless (!has_pad (offerer, "sink_audio_audio1"));
+  fail_unless_equals_int (count_payloaders (offerer), 3);
+
+  gst_sdp_message_free (offer);
+  gst_sdp_message_free (modified);
+  gst_sdp_message_free (answer);
+  g_free (offerer_sess);
+  g_free (answerer_sess);
+  g_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+basertpendpoint_suite (void)
+{
+  Suite *s = suite_create ("basertpendpoint");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, extra_medias);
+  tcase_add_test (tc_chain, renegotiation);
+
+  return s;
+}
+
+GST_CHECK_MAIN (basertpendpoint);
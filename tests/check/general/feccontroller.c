@@ -0,0 +1,203 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsfeccontroller.h"
+
+#include <gst/check/gstcheck.h>
+
+/* 16.16 fixed point round trip times */
+#define SHORT_RTT (65536 / 50)  /* 20 ms */
+#define LONG_RTT (65536 / 4)    /* 250 ms */
+
+/* Fraction lost in 1/256 units */
+#define LOSS_2 5
+#define LOSS_5 13
+#define LOSS_25 64
+
+#define N_REPORTS 20
+
+typedef struct _FecTestData
+{
+  GstElement *fec;
+  GstElement *red;
+  KmsFecController *fc;
+} FecTestData;
+
+static void
+fec_test_data_init (FecTestData * data, gboolean nack)
+{
+  data->fec = gst_object_ref_sink (gst_element_factory_make ("ulpfecenc",
+          NULL));
+  data->red = gst_object_ref_sink (gst_element_factory_make ("redenc", NULL));
+  fail_unless (data->fec != NULL && data->red != NULL);
+
+  data->fc = kms_fec_controller_create (data->fec, data->red, nack);
+  fail_unless (data->fc != NULL);
+}
+
+static void
+fec_test_data_clear (FecTestData * data)
+{
+  kms_fec_controller_destroy (data->fc);
+  g_object_unref (data->fec);
+  g_object_unref (data->red);
+}
+
+static void
+send_reports (FecTestData * data, guint fraction_lost, guint rtt)
+{
+  guint i;
+
+  for (i = 0; i < N_REPORTS; i++) {
+    kms_fec_controller_update (data->fc, fraction_lost, rtt);
+  }
+}
+
+static guint
+get_percentage (FecTestData * data)
+{
+  guint percentage;
+
+  g_object_get (data->fec, "percentage", &percentage, NULL);
+
+  return percentage;
+}
+
+static guint
+get_distance (FecTestData * data)
+{
+  guint distance;
+
+  g_object_get (data->red, "distance", &distance, NULL);
+
+  return distance;
+}
+
+GST_START_TEST (no_losses)
+{
+  FecTestData data;
+
+  fec_test_data_init (&data, TRUE);
+
+  send_reports (&data, 0, LONG_RTT);
+  fail_unless (get_percentage (&data) == 0);
+  fail_unless (get_distance (&data) == 0);
+
+  fec_test_data_clear (&data);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (heavy_losses)
+{
+  GstStructure *stats;
+  guint percentage, distance;
+  FecTestData data;
+
+  fec_test_data_init (&data, FALSE);
+
+  send_reports (&data, LOSS_25, LONG_RTT);
+  fail_unless (get_percentage (&data) == 50);
+  fail_unless (get_distance (&data) == 1);
+
+  stats = gst_structure_new_empty ("stats");
+  kms_fec_controller_get_stats (data.fc, stats);
+  fail_unless (gst_structure_get_uint (stats, "fec-percentage", &percentage));
+  fail_unless (gst_structure_get_uint (stats, "red-distance", &distance));
+  fail_unless (gst_structure_has_field (stats, "protection-overhead"));
+  fail_unless (percentage == 50);
+  fail_unless (distance == 1);
+  gst_structure_free (stats);
+
+  /* Protection is removed once losses are gone */
+  send_reports (&data, 0, LONG_RTT);
+  fail_unless (get_percentage (&data) == 0);
+  fail_unless (get_distance (&data) == 0);
+
+  fec_test_data_clear (&data);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (nack_reduces_protection)
+{
+  FecTestData nack, no_nack;
+
+  fec_test_data_init (&nack, TRUE);
+  fec_test_data_init (&no_nack, FALSE);
+
+  send_reports (&nack, LOSS_2, SHORT_RTT);
+  send_reports (&no_nack, LOSS_2, SHORT_RTT);
+
+  fail_unless (get_percentage (&nack) > 0);
+  fail_unless (get_percentage (&nack) < get_percentage (&no_nack));
+  /* RED is only used for heavy losses */
+  fail_unless (get_distance (&nack) == 0);
+  fail_unless (get_distance (&no_nack) == 0);
+
+  /* Retransmissions are slower with long round trips */
+  send_reports (&nack, LOSS_2, LONG_RTT);
+  fail_unless (get_percentage (&nack) == get_percentage (&no_nack));
+
+  fec_test_data_clear (&nack);
+  fec_test_data_clear (&no_nack);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (remote_reports_only)
+{
+  GstStructure *stats;
+  FecTestData data;
+
+  fec_test_data_init (&data, FALSE);
+
+  stats = gst_structure_new ("application/x-rtp-source-stats",
+      "internal", G_TYPE_BOOLEAN, TRUE, "have-rb", G_TYPE_BOOLEAN, TRUE,
+      "rb-fractionlost", G_TYPE_UINT, LOSS_25, "rb-round-trip", G_TYPE_UINT,
+      LONG_RTT, NULL);
+  kms_fec_controller_process_source_stats (data.fc, stats);
+  fail_unless (get_percentage (&data) == 0);
+
+  gst_structure_set (stats, "internal", G_TYPE_BOOLEAN, FALSE, NULL);
+  kms_fec_controller_process_source_stats (data.fc, stats);
+  fail_unless (get_percentage (&data) > 0);
+  fail_unless (get_distance (&data) == 1);
+
+  gst_structure_free (stats);
+  fec_test_data_clear (&data);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+feccontroller_suite (void)
+{
+  Suite *s = suite_create ("feccontroller");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, no_losses);
+  tcase_add_test (tc_chain, heavy_losses);
+  tcase_add_test (tc_chain, nack_reduces_protection);
+  tcase_add_test (tc_chain, remote_reports_only);
+
+  return s;
+}
+
+GST_CHECK_MAIN (feccontroller);
@@ -0,0 +1,193 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsframedropper.h"
+
+#include <gst/check/gstcheck.h>
+#include <glib.h>
+
+#define LATENCY_TARGET (5 * GST_MSECOND)
+#define PROCESSING_TIME 30000   /* 30 ms */
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static GstPad *mysrcpad, *mysinkpad, *outpad;
+
+static GstElement *
+setup_identity (const gchar * caps_str)
+{
+  GstElement *identity;
+  GstCaps *caps;
+
+  identity = gst_check_setup_element ("identity");
+  mysrcpad = gst_check_setup_src_pad (identity, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (identity, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (identity, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  /* Unlinked pad standing for the output of a slow element */
+  outpad = gst_pad_new ("out", GST_PAD_SRC);
+  gst_pad_set_active (outpad, TRUE);
+
+  caps = gst_caps_from_string (caps_str);
+  gst_check_setup_events (mysrcpad, identity, caps, GST_FORMAT_TIME);
+  gst_check_setup_events (outpad, identity, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return identity;
+}
+
+static void
+cleanup_identity (GstElement * identity)
+{
+  gst_check_drop_buffers ();
+  gst_element_set_state (identity, GST_STATE_NULL);
+  gst_pad_set_active (outpad, FALSE);
+  gst_object_unref (outpad);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (identity);
+  gst_check_teardown_sink_pad (identity);
+  gst_check_teardown_element (identity);
+}
+
+static GstBuffer *
+create_buffer (guint frame, gboolean delta)
+{
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, 8, NULL);
+
+  GST_BUFFER_PTS (buffer) = frame * 33 * GST_MSECOND;
+
+  if (delta) {
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  }
+
+  return buffer;
+}
+
+static void
+admit_frame (guint frame, gboolean delta)
+{
+  fail_unless (gst_pad_push (mysrcpad, create_buffer (frame,
+              delta)) == GST_FLOW_OK);
+}
+
+static void
+process_frame (guint frame)
+{
+  g_usleep (PROCESSING_TIME);
+  /* Not linked, probes are called anyway */
+  gst_pad_push (outpad, create_buffer (frame, FALSE));
+}
+
+/* Leaves the dropper measuring a latency above the target */
+static void
+overload_dropper (KmsFrameDropper * dropper)
+{
+  admit_frame (0, FALSE);
+  process_frame (0);
+
+  fail_unless (kms_frame_dropper_get_latency (dropper) > LATENCY_TARGET);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+}
+
+GST_START_TEST (drop_raw_frames)
+{
+  GstElement *identity = setup_identity ("video/x-raw");
+  GstPad *sink = gst_element_get_static_pad (identity, "sink");
+  KmsFrameDropper *dropper;
+
+  dropper = kms_frame_dropper_new (sink, outpad, LATENCY_TARGET);
+  overload_dropper (dropper);
+
+  /* Nothing pending, the frame is admitted to refresh the measure */
+  admit_frame (1, FALSE);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+
+  /* Frame 1 is still being processed */
+  admit_frame (2, FALSE);
+  admit_frame (3, FALSE);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  fail_unless_equals_int (kms_frame_dropper_get_dropped (dropper), 2);
+
+  /* Disabled droppers let everything through */
+  kms_frame_dropper_set_enabled (dropper, FALSE);
+  admit_frame (4, FALSE);
+  fail_unless_equals_int (g_list_length (buffers), 3);
+
+  kms_frame_dropper_destroy (dropper);
+  g_object_unref (sink);
+  cleanup_identity (identity);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (drop_encoded_until_keyframe)
+{
+  GstElement *identity = setup_identity ("video/x-vp8");
+  GstPad *sink = gst_element_get_static_pad (identity, "sink");
+  KmsFrameDropper *dropper;
+
+  dropper = kms_frame_dropper_new (sink, outpad, LATENCY_TARGET);
+  overload_dropper (dropper);
+
+  admit_frame (1, TRUE);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+
+  /* Keyframes are never dropped */
+  admit_frame (2, FALSE);
+  fail_unless_equals_int (g_list_length (buffers), 3);
+
+  /* Once a delta frame is dropped, the rest depend on it */
+  admit_frame (3, TRUE);
+  fail_unless_equals_int (kms_frame_dropper_get_dropped (dropper), 1);
+  process_frame (3);
+  admit_frame (4, TRUE);
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  fail_unless_equals_int (kms_frame_dropper_get_dropped (dropper), 2);
+
+  admit_frame (5, FALSE);
+  fail_unless_equals_int (g_list_length (buffers), 4);
+
+  kms_frame_dropper_destroy (dropper);
+  g_object_unref (sink);
+  cleanup_identity (identity);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+framedropper_suite (void)
+{
+  Suite *s = suite_create ("framedropper");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, drop_raw_frames);
+  tcase_add_test (tc_chain, drop_encoded_until_keyframe);
+
+  return s;
+}
+
+GST_CHECK_MAIN (framedropper);
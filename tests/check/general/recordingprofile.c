@@ -0,0 +1,303 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsrecordingprofile.h"
+
+#include <gst/check/gstcheck.h>
+
+#define OPUS_CAPS "audio/x-opus, channels=(int)2, rate=(int)48000"
+#define AAC_CAPS "audio/mpeg, mpegversion=(int)4, stream-format=(string)raw"
+#define RAW_AUDIO_CAPS "audio/x-raw, format=(string)S16LE"
+#define VP8_CAPS "video/x-vp8, width=(int)640, height=(int)480"
+#define H264_CAPS "video/x-h264, stream-format=(string)byte-stream"
+
+#define BENCHMARK_ITERATIONS 1000
+
+static void
+check_profile_formats (GstEncodingContainerProfile * cprof,
+    const gchar * audio_format, const gchar * video_format)
+{
+  const GList *l;
+
+  for (l = gst_encoding_container_profile_get_profiles (cprof); l != NULL;
+      l = l->next) {
+    GstEncodingProfile *prof = l->data;
+    const gchar *expected;
+    GstCaps *format, *caps;
+
+    if (GST_IS_ENCODING_AUDIO_PROFILE (prof)) {
+      expected = audio_format;
+    } else {
+      expected = video_format;
+    }
+
+    fail_unless (expected != NULL);
+
+    format = gst_encoding_profile_get_format (prof);
+    caps = gst_caps_from_string (expected);
+    GST_DEBUG ("Format %" GST_PTR_FORMAT ", expected %" GST_PTR_FORMAT,
+        format, caps);
+    fail_unless (gst_caps_is_equal (format, caps));
+    gst_caps_unref (format);
+    gst_caps_unref (caps);
+  }
+}
+
+static KmsRecordingProfile
+select_profile (KmsRecordingProfile profile, const gchar * audio,
+    const gchar * video)
+{
+  GstCaps *audio_caps, *video_caps;
+  KmsRecordingProfile selected;
+
+  audio_caps = audio != NULL ? gst_caps_from_string (audio) : NULL;
+  video_caps = video != NULL ? gst_caps_from_string (video) : NULL;
+
+  selected = kms_recording_profile_select_passthrough (profile, audio_caps,
+      video_caps);
+
+  if (audio_caps != NULL) {
+    gst_caps_unref (audio_caps);
+  }
+
+  if (video_caps != NULL) {
+    gst_caps_unref (video_caps);
+  }
+
+  return selected;
+}
+
+static GstEncodingContainerProfile *
+create_profile (KmsRecordingProfile profile, const gchar * audio,
+    const gchar * video)
+{
+  GstEncodingContainerProfile *cprof;
+  GstCaps *audio_caps, *video_caps;
+
+  audio_caps = audio != NULL ? gst_caps_from_string (audio) : NULL;
+  video_caps = video != NULL ? gst_caps_from_string (video) : NULL;
+
+  cprof = kms_recording_profile_create_passthrough_profile (profile, TRUE,
+      TRUE, audio_caps, video_caps);
+  fail_unless (cprof != NULL);
+
+  if (audio_caps != NULL) {
+    gst_caps_unref (audio_caps);
+  }
+
+  if (video_caps != NULL) {
+    gst_caps_unref (video_caps);
+  }
+
+  return cprof;
+}
+
+GST_START_TEST (webm_passthrough)
+{
+  GstEncodingContainerProfile *cprof;
+
+  fail_unless (select_profile (KMS_RECORDING_PROFILE_WEBM, OPUS_CAPS,
+          VP8_CAPS) == KMS_RECORDING_PROFILE_WEBM);
+
+  cprof = create_profile (KMS_RECORDING_PROFILE_WEBM, OPUS_CAPS, VP8_CAPS);
+  check_profile_formats (cprof, "audio/x-opus", "video/x-vp8");
+  gst_encoding_profile_unref (cprof);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (mp4_passthrough)
+{
+  GstEncodingContainerProfile *cprof;
+
+  fail_unless (select_profile (KMS_RECORDING_PROFILE_MP4, AAC_CAPS,
+          H264_CAPS) == KMS_RECORDING_PROFILE_MP4);
+
+  /* Only the fields telling codecs apart are kept */
+  cprof = create_profile (KMS_RECORDING_PROFILE_MP4, AAC_CAPS, H264_CAPS);
+  check_profile_formats (cprof, "audio/mpeg, mpegversion=(int)4",
+      "video/x-h264");
+  gst_encoding_profile_unref (cprof);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (mkv_when_container_rejects)
+{
+  /* WebM does not accept H264 */
+  fail_unless (select_profile (KMS_RECORDING_PROFILE_WEBM, OPUS_CAPS,
+          H264_CAPS) == KMS_RECORDING_PROFILE_MKV);
+  fail_unless (select_profile (KMS_RECORDING_PROFILE_WEBM_VIDEO_ONLY, NULL,
+          H264_CAPS) == KMS_RECORDING_PROFILE_MKV_VIDEO_ONLY);
+
+  /* Audio is not recorded, so its caps do not matter */
+  fail_unless (select_profile (KMS_RECORDING_PROFILE_WEBM_VIDEO_ONLY,
+          AAC_CAPS, VP8_CAPS) == KMS_RECORDING_PROFILE_WEBM_VIDEO_ONLY);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (raw_is_transcoded)
+{
+  GstEncodingContainerProfile *cprof;
+
+  /* No container avoids encoding raw audio */
+  fail_unless (select_profile (KMS_RECORDING_PROFILE_WEBM, RAW_AUDIO_CAPS,
+          VP8_CAPS) == KMS_RECORDING_PROFILE_WEBM);
+
+  cprof = create_profile (KMS_RECORDING_PROFILE_WEBM, RAW_AUDIO_CAPS,
+      VP8_CAPS);
+  check_profile_formats (cprof, "audio/x-opus", "video/x-vp8");
+  gst_encoding_profile_unref (cprof);
+
+  /* Unknown caps get the default format */
+  cprof = create_profile (KMS_RECORDING_PROFILE_MP4, NULL, H264_CAPS);
+  check_profile_formats (cprof, "audio/mpeg, mpegversion=(int)1, "
+      "layer=(int)3", "video/x-h264");
+  gst_encoding_profile_unref (cprof);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (shared_profiles)
+{
+  GstEncodingContainerProfile *cprof, *other;
+
+  cprof = kms_recording_profile_get_profile (KMS_RECORDING_PROFILE_WEBM,
+      TRUE, TRUE);
+  fail_unless (cprof != NULL);
+  check_profile_formats (cprof, "audio/x-opus", "video/x-vp8");
+
+  other = kms_recording_profile_get_profile (KMS_RECORDING_PROFILE_WEBM,
+      TRUE, TRUE);
+  fail_unless (other == cprof);
+  gst_encoding_profile_unref (other);
+
+  other = kms_recording_profile_get_profile (KMS_RECORDING_PROFILE_WEBM,
+      FALSE, TRUE);
+  fail_unless (other != cprof);
+  gst_encoding_profile_unref (other);
+
+  other = kms_recording_profile_get_profile (KMS_RECORDING_PROFILE_MP4,
+      TRUE, TRUE);
+  fail_unless (other != cprof);
+  gst_encoding_profile_unref (other);
+
+  gst_encoding_profile_unref (cprof);
+
+  /* Media types a profile does not record share its entry */
+  cprof = kms_recording_profile_get_profile
+      (KMS_RECORDING_PROFILE_WEBM_VIDEO_ONLY, FALSE, TRUE);
+  other = kms_recording_profile_get_profile
+      (KMS_RECORDING_PROFILE_WEBM_VIDEO_ONLY, TRUE, TRUE);
+  fail_unless (other == cprof);
+  gst_encoding_profile_unref (other);
+  gst_encoding_profile_unref (cprof);
+
+  fail_unless (kms_recording_profile_get_profile (KMS_RECORDING_PROFILE_NONE,
+          TRUE, TRUE) == NULL);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (ksr_uses_matroska_caps)
+{
+  GstEncodingContainerProfile *cprof;
+  const GList *l;
+  guint n = 0;
+
+  cprof = kms_recording_profile_get_profile (KMS_RECORDING_PROFILE_KSR,
+      TRUE, TRUE);
+  fail_unless (cprof != NULL);
+
+  for (l = gst_encoding_container_profile_get_profiles (cprof); l != NULL;
+      l = l->next) {
+    GstCaps *format = gst_encoding_profile_get_format (l->data);
+
+    fail_if (gst_caps_is_empty (format));
+    gst_caps_unref (format);
+    n++;
+  }
+
+  fail_unless (n == 2);
+  gst_encoding_profile_unref (cprof);
+}
+
+GST_END_TEST;
+
+static gint64
+benchmark_profiles (gboolean shared)
+{
+  KmsRecordingProfile profiles[] = {
+    KMS_RECORDING_PROFILE_WEBM, KMS_RECORDING_PROFILE_MP4,
+    KMS_RECORDING_PROFILE_KSR
+  };
+  gint64 start;
+  guint i;
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    KmsRecordingProfile profile = profiles[i % G_N_ELEMENTS (profiles)];
+    GstEncodingContainerProfile *cprof;
+
+    if (shared) {
+      cprof = kms_recording_profile_get_profile (profile, TRUE, TRUE);
+    } else {
+      cprof = kms_recording_profile_create_profile (profile, TRUE, TRUE);
+    }
+
+    fail_unless (cprof != NULL);
+    gst_encoding_profile_unref (cprof);
+  }
+
+  return g_get_monotonic_time () - start;
+}
+
+GST_START_TEST (profile_creation_benchmark)
+{
+  gint64 created, shared;
+
+  created = benchmark_profiles (FALSE);
+  shared = benchmark_profiles (TRUE);
+
+  GST_INFO ("%d profiles: created in %" G_GINT64_FORMAT " us, shared in %"
+      G_GINT64_FORMAT " us", BENCHMARK_ITERATIONS, created, shared);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+recordingprofile_suite (void)
+{
+  Suite *s = suite_create ("recordingprofile");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, webm_passthrough);
+  tcase_add_test (tc_chain, mp4_passthrough);
+  tcase_add_test (tc_chain, mkv_when_container_rejects);
+  tcase_add_test (tc_chain, raw_is_transcoded);
+  tcase_add_test (tc_chain, shared_profiles);
+  tcase_add_test (tc_chain, ksr_uses_matroska_caps);
+  tcase_add_test (tc_chain, profile_creation_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (recordingprofile);
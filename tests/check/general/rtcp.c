@@ -0,0 +1,568 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsrtcp.h"
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+#include <glib.h>
+
+#define COMPOUND_MAX_SIZE 1500
+#define FUZZ_SEED 1234
+#define FUZZ_ITERATIONS 100000
+#define BENCHMARK_ITERATIONS 200000
+
+#define SENDER_SSRC 0x11111111
+#define MEDIA_SSRC 0x22222222
+
+static const KmsRTCPSenderInfo sender_info = {
+  G_GUINT64_CONSTANT (0x0102030405060708), 90000, 10, 12000
+};
+
+static const KmsRTCPReportBlock report_block = {
+  MEDIA_SSRC, 25, -3, 0x10005, 40, 0xabcd, 0x1234
+};
+
+static const guint16 nack_pids[] = { 100, 200 };
+static const guint16 nack_blps[] = { 0x0003, 0 };
+
+static const guint32 fir_ssrcs[] = { MEDIA_SSRC };
+static const guint8 fir_seqnums[] = { 7 };
+
+static const KmsRTCPPacketType compound_types[] = {
+  KMS_RTCP_PACKET_TYPE_SR,
+  KMS_RTCP_PACKET_TYPE_REMB,
+  KMS_RTCP_PACKET_TYPE_NACK,
+  KMS_RTCP_PACKET_TYPE_PLI,
+  KMS_RTCP_PACKET_TYPE_FIR,
+  KMS_RTCP_PACKET_TYPE_TWCC,
+  KMS_RTCP_PACKET_TYPE_RR,
+};
+
+static void
+fill_twcc_packet (KmsRTCPTWCCPacket * twcc_packet)
+{
+  guint i;
+
+  twcc_packet->base_seq = 65530;
+  twcc_packet->status_count = 20;
+  twcc_packet->reference_time = -2;
+  twcc_packet->fb_pkt_count = 9;
+
+  for (i = 0; i < twcc_packet->status_count; i++) {
+    twcc_packet->status[i] = i % 3;
+    switch (twcc_packet->status[i]) {
+      case KMS_RTCP_TWCC_STATUS_SMALL_DELTA:
+        twcc_packet->deltas[i] = i;
+        break;
+      case KMS_RTCP_TWCC_STATUS_LARGE_DELTA:
+        twcc_packet->deltas[i] = -300 * (gint) i;
+        break;
+      default:
+        twcc_packet->deltas[i] = 0;
+        break;
+    }
+  }
+}
+
+static guint
+build_compound (guint8 * data, guint size)
+{
+  KmsRTCPCompoundWriter writer;
+  KmsRTCPPSFBAFBREMBPacket remb_packet;
+  KmsRTCPTWCCPacket twcc_packet;
+
+  remb_packet.bitrate = 1500000;
+  remb_packet.n_ssrcs = 1;
+  remb_packet.ssrcs[0] = MEDIA_SSRC;
+  fill_twcc_packet (&twcc_packet);
+
+  kms_rtcp_compound_writer_init (&writer, data, size);
+  fail_unless (kms_rtcp_compound_writer_add_sr (&writer, SENDER_SSRC,
+          &sender_info, &report_block, 1));
+  fail_unless (kms_rtcp_compound_writer_add_remb (&writer, SENDER_SSRC,
+          &remb_packet));
+  fail_unless (kms_rtcp_compound_writer_add_nack (&writer, SENDER_SSRC,
+          MEDIA_SSRC, nack_pids, nack_blps, G_N_ELEMENTS (nack_pids)));
+  fail_unless (kms_rtcp_compound_writer_add_pli (&writer, SENDER_SSRC,
+          MEDIA_SSRC));
+  fail_unless (kms_rtcp_compound_writer_add_fir (&writer, SENDER_SSRC,
+          fir_ssrcs, fir_seqnums, G_N_ELEMENTS (fir_ssrcs)));
+  fail_unless (kms_rtcp_compound_writer_add_twcc (&writer, SENDER_SSRC,
+          MEDIA_SSRC, &twcc_packet));
+  fail_unless (kms_rtcp_compound_writer_add_rr (&writer, SENDER_SSRC,
+          &report_block, 1));
+
+  return kms_rtcp_compound_writer_get_size (&writer);
+}
+
+/* Reads every field of every packet, returns the number of packets */
+static guint
+walk_compound (const guint8 * data, guint size, gboolean * error)
+{
+  KmsRTCPCompoundReader reader;
+  KmsRTCPCompoundPacket packet;
+  KmsRTCPSenderInfo info;
+  KmsRTCPReportBlock block;
+  KmsRTCPPSFBAFBREMBPacket remb_packet;
+  KmsRTCPTWCCPacket twcc_packet;
+  guint n_packets = 0, i;
+
+  kms_rtcp_compound_reader_init (&reader, data, size);
+  while (kms_rtcp_compound_reader_next (&reader, &packet)) {
+    n_packets++;
+
+    kms_rtcp_compound_packet_get_sender_info (&packet, &info);
+    for (i = 0; i < kms_rtcp_compound_packet_get_report_block_count (&packet);
+        i++) {
+      fail_unless (kms_rtcp_compound_packet_get_report_block (&packet, i,
+              &block));
+    }
+    for (i = 0; i < kms_rtcp_compound_packet_get_nack_count (&packet); i++) {
+      fail_unless (kms_rtcp_compound_packet_get_nack (&packet, i, NULL, NULL));
+    }
+    for (i = 0; i < kms_rtcp_compound_packet_get_fir_count (&packet); i++) {
+      fail_unless (kms_rtcp_compound_packet_get_fir (&packet, i, NULL, NULL));
+    }
+    kms_rtcp_compound_packet_get_remb (&packet, &remb_packet);
+    kms_rtcp_compound_packet_get_twcc (&packet, &twcc_packet);
+  }
+
+  if (error != NULL) {
+    *error = kms_rtcp_compound_reader_has_error (&reader);
+  }
+
+  return n_packets;
+}
+
+GST_START_TEST (compound_roundtrip)
+{
+  guint8 data[COMPOUND_MAX_SIZE];
+  KmsRTCPCompoundReader reader;
+  KmsRTCPCompoundPacket packet;
+  KmsRTCPSenderInfo info;
+  KmsRTCPReportBlock block;
+  KmsRTCPPSFBAFBREMBPacket remb_packet;
+  KmsRTCPTWCCPacket twcc_packet, expected_twcc;
+  guint size, n = 0, i;
+  guint16 pid, blp;
+  guint32 ssrc;
+  guint8 seqnum;
+
+  size = build_compound (data, sizeof (data));
+  fail_unless (gst_rtcp_buffer_validate_data (data, size));
+
+  fill_twcc_packet (&expected_twcc);
+
+  kms_rtcp_compound_reader_init (&reader, data, size);
+  while (kms_rtcp_compound_reader_next (&reader, &packet)) {
+    fail_unless (n < G_N_ELEMENTS (compound_types));
+    fail_unless_equals_int (packet.type, compound_types[n++]);
+    fail_unless_equals_int (packet.ssrc, SENDER_SSRC);
+
+    switch (packet.type) {
+      case KMS_RTCP_PACKET_TYPE_SR:
+        fail_unless (kms_rtcp_compound_packet_get_sender_info (&packet,
+                &info));
+        fail_unless (info.ntp_time == sender_info.ntp_time);
+        fail_unless_equals_int (info.rtp_time, sender_info.rtp_time);
+        fail_unless_equals_int (info.packet_count, sender_info.packet_count);
+        fail_unless_equals_int (info.octet_count, sender_info.octet_count);
+        /* fall through */
+      case KMS_RTCP_PACKET_TYPE_RR:
+        fail_unless_equals_int (kms_rtcp_compound_packet_get_report_block_count
+            (&packet), 1);
+        fail_unless (kms_rtcp_compound_packet_get_report_block (&packet, 0,
+                &block));
+        fail_unless_equals_int (block.ssrc, report_block.ssrc);
+        fail_unless_equals_int (block.fraction_lost,
+            report_block.fraction_lost);
+        fail_unless_equals_int (block.packets_lost, report_block.packets_lost);
+        fail_unless_equals_int (block.exthighestseq,
+            report_block.exthighestseq);
+        fail_unless_equals_int (block.jitter, report_block.jitter);
+        fail_unless_equals_int (block.lsr, report_block.lsr);
+        fail_unless_equals_int (block.dlsr, report_block.dlsr);
+        fail_if (kms_rtcp_compound_packet_get_report_block (&packet, 1,
+                &block));
+        break;
+      case KMS_RTCP_PACKET_TYPE_REMB:
+        fail_unless (kms_rtcp_compound_packet_get_remb (&packet,
+                &remb_packet));
+        /* 18 bits mantissa loses precision */
+        fail_unless (remb_packet.bitrate <= 1500000);
+        fail_unless (remb_packet.bitrate > 1500000 - 8);
+        fail_unless_equals_int (remb_packet.n_ssrcs, 1);
+        fail_unless_equals_int (remb_packet.ssrcs[0], MEDIA_SSRC);
+        break;
+      case KMS_RTCP_PACKET_TYPE_NACK:
+        fail_unless_equals_int (packet.media_ssrc, MEDIA_SSRC);
+        fail_unless_equals_int (kms_rtcp_compound_packet_get_nack_count
+            (&packet), G_N_ELEMENTS (nack_pids));
+        for (i = 0; i < G_N_ELEMENTS (nack_pids); i++) {
+          fail_unless (kms_rtcp_compound_packet_get_nack (&packet, i, &pid,
+                  &blp));
+          fail_unless_equals_int (pid, nack_pids[i]);
+          fail_unless_equals_int (blp, nack_blps[i]);
+        }
+        break;
+      case KMS_RTCP_PACKET_TYPE_PLI:
+        fail_unless_equals_int (packet.media_ssrc, MEDIA_SSRC);
+        fail_unless_equals_int (packet.body_size, 0);
+        break;
+      case KMS_RTCP_PACKET_TYPE_FIR:
+        fail_unless_equals_int (kms_rtcp_compound_packet_get_fir_count
+            (&packet), 1);
+        fail_unless (kms_rtcp_compound_packet_get_fir (&packet, 0, &ssrc,
+                &seqnum));
+        fail_unless_equals_int (ssrc, fir_ssrcs[0]);
+        fail_unless_equals_int (seqnum, fir_seqnums[0]);
+        break;
+      case KMS_RTCP_PACKET_TYPE_TWCC:
+        fail_unless_equals_int (packet.media_ssrc, MEDIA_SSRC);
+        fail_unless (kms_rtcp_compound_packet_get_twcc (&packet,
+                &twcc_packet));
+        fail_unless_equals_int (twcc_packet.base_seq, expected_twcc.base_seq);
+        fail_unless_equals_int (twcc_packet.status_count,
+            expected_twcc.status_count);
+        fail_unless_equals_int (twcc_packet.reference_time,
+            expected_twcc.reference_time);
+        fail_unless_equals_int (twcc_packet.fb_pkt_count,
+            expected_twcc.fb_pkt_count);
+        for (i = 0; i < expected_twcc.status_count; i++) {
+          fail_unless_equals_int (twcc_packet.status[i],
+              expected_twcc.status[i]);
+          fail_unless_equals_int (twcc_packet.deltas[i],
+              expected_twcc.deltas[i]);
+        }
+        break;
+      default:
+        fail ("Unexpected packet type %d", packet.type);
+        break;
+    }
+  }
+
+  fail_if (kms_rtcp_compound_reader_has_error (&reader));
+  fail_unless_equals_int (n, G_N_ELEMENTS (compound_types));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (read_gst_compound)
+{
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  KmsRTCPPSFBAFBREMBPacket remb_packet;
+  KmsRTCPCompoundReader reader;
+  KmsRTCPCompoundPacket packet;
+  KmsRTCPSenderInfo info;
+  GstRTCPPacket rtcp_packet;
+  GstBuffer *buffer;
+  GstMapInfo map;
+
+  buffer = gst_rtcp_buffer_new (COMPOUND_MAX_SIZE);
+  gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &rtcp);
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_SR,
+          &rtcp_packet));
+  gst_rtcp_packet_sr_set_sender_info (&rtcp_packet, SENDER_SSRC,
+      sender_info.ntp_time, sender_info.rtp_time, 0, 0);
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_SDES,
+          &rtcp_packet));
+  fail_unless (gst_rtcp_packet_sdes_add_item (&rtcp_packet, SENDER_SSRC));
+  fail_unless (gst_rtcp_packet_sdes_add_entry (&rtcp_packet,
+          GST_RTCP_SDES_CNAME, 4, (const guint8 *) "test"));
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_PSFB,
+          &rtcp_packet));
+  remb_packet.bitrate = 300000;
+  remb_packet.n_ssrcs = 1;
+  remb_packet.ssrcs[0] = MEDIA_SSRC;
+  fail_unless (kms_rtcp_psfb_afb_remb_marshall_packet (&rtcp_packet,
+          &remb_packet, SENDER_SSRC));
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  kms_rtcp_compound_reader_init (&reader, map.data, map.size);
+
+  fail_unless (kms_rtcp_compound_reader_next (&reader, &packet));
+  fail_unless_equals_int (packet.type, KMS_RTCP_PACKET_TYPE_SR);
+  fail_unless_equals_int (packet.ssrc, SENDER_SSRC);
+  fail_unless (kms_rtcp_compound_packet_get_sender_info (&packet, &info));
+  fail_unless (info.ntp_time == sender_info.ntp_time);
+  fail_unless_equals_int (info.rtp_time, sender_info.rtp_time);
+
+  fail_unless (kms_rtcp_compound_reader_next (&reader, &packet));
+  fail_unless_equals_int (packet.type, KMS_RTCP_PACKET_TYPE_UNKNOWN);
+  fail_unless_equals_int (packet.pt, GST_RTCP_TYPE_SDES);
+
+  fail_unless (kms_rtcp_compound_reader_next (&reader, &packet));
+  fail_unless_equals_int (packet.type, KMS_RTCP_PACKET_TYPE_REMB);
+  fail_unless (kms_rtcp_compound_packet_get_remb (&packet, &remb_packet));
+  fail_unless_equals_int (remb_packet.bitrate, 300000);
+  fail_unless_equals_int (remb_packet.ssrcs[0], MEDIA_SSRC);
+
+  fail_if (kms_rtcp_compound_reader_next (&reader, &packet));
+  fail_if (kms_rtcp_compound_reader_has_error (&reader));
+
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (writer_no_room)
+{
+  guint8 data[32];
+  KmsRTCPCompoundWriter writer;
+
+  kms_rtcp_compound_writer_init (&writer, data, sizeof (data));
+  fail_unless (kms_rtcp_compound_writer_add_sr (&writer, SENDER_SSRC,
+          &sender_info, NULL, 0));
+  fail_unless_equals_int (kms_rtcp_compound_writer_get_size (&writer), 28);
+
+  /* 12 bytes needed, only 4 left */
+  fail_if (kms_rtcp_compound_writer_add_pli (&writer, SENDER_SSRC,
+          MEDIA_SSRC));
+  fail_unless_equals_int (kms_rtcp_compound_writer_get_size (&writer), 28);
+}
+
+GST_END_TEST;
+
+typedef struct _CorpusEntry
+{
+  const gchar *name;
+  const guint8 *data;
+  guint size;
+  guint n_packets;
+  gboolean error;
+} CorpusEntry;
+
+/* Malformed and corner case packets found while fuzzing the reader */
+static const guint8 corpus_truncated_header[] = { 0x80, 0xc8, 0x00 };
+static const guint8 corpus_bad_version[] = { 0x40, 0xc9, 0x00, 0x01,
+  0x11, 0x11, 0x11, 0x11
+};
+static const guint8 corpus_length_overflow[] = { 0x80, 0xc9, 0xff, 0xff,
+  0x11, 0x11, 0x11, 0x11
+};
+static const guint8 corpus_zero_padding[] = { 0xa0, 0xc9, 0x00, 0x01,
+  0x11, 0x11, 0x11, 0x00
+};
+static const guint8 corpus_padding_overflow[] = { 0xa0, 0xc9, 0x00, 0x01,
+  0x11, 0x11, 0x11, 0x09
+};
+static const guint8 corpus_padded_rr[] = { 0xa0, 0xc9, 0x00, 0x02,
+  0x11, 0x11, 0x11, 0x11, 0x00, 0x00, 0x00, 0x04
+};
+static const guint8 corpus_rr_count_overflow[] = { 0x81, 0xc9, 0x00, 0x01,
+  0x11, 0x11, 0x11, 0x11
+};
+static const guint8 corpus_short_sr[] = { 0x80, 0xc8, 0x00, 0x01,
+  0x11, 0x11, 0x11, 0x11
+};
+static const guint8 corpus_short_fb[] = { 0x81, 0xce, 0x00, 0x01,
+  0x11, 0x11, 0x11, 0x11
+};
+static const guint8 corpus_remb_n_ssrcs_overflow[] = { 0x8f, 0xce, 0x00, 0x04,
+  0x11, 0x11, 0x11, 0x11, 0x00, 0x00, 0x00, 0x00,
+  'R', 'E', 'M', 'B', 0xff, 0x00, 0x00, 0x01
+};
+static const guint8 corpus_remb_big_exponent[] = { 0x8f, 0xce, 0x00, 0x04,
+  0x11, 0x11, 0x11, 0x11, 0x00, 0x00, 0x00, 0x00,
+  'R', 'E', 'M', 'B', 0x00, 0xff, 0xff, 0xff
+};
+static const guint8 corpus_twcc_truncated[] = { 0x8f, 0xcd, 0x00, 0x04,
+  0x11, 0x11, 0x11, 0x11, 0x22, 0x22, 0x22, 0x22,
+  0x00, 0x01, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00
+};
+static const guint8 corpus_nack_odd_fci[] = { 0xa1, 0xcd, 0x00, 0x04,
+  0x11, 0x11, 0x11, 0x11, 0x22, 0x22, 0x22, 0x22,
+  0x00, 0x64, 0x00, 0x03, 0xaa, 0xbb, 0x00, 0x02
+};
+static const guint8 corpus_valid_then_garbage[] = { 0x80, 0xc9, 0x00, 0x01,
+  0x11, 0x11, 0x11, 0x11, 0x00, 0x00
+};
+
+#define CORPUS_ENTRY(name, n_packets, error) \
+  { #name, corpus_##name, sizeof (corpus_##name), n_packets, error }
+
+static const CorpusEntry corpus[] = {
+  CORPUS_ENTRY (truncated_header, 0, TRUE),
+  CORPUS_ENTRY (bad_version, 0, TRUE),
+  CORPUS_ENTRY (length_overflow, 0, TRUE),
+  CORPUS_ENTRY (zero_padding, 0, TRUE),
+  CORPUS_ENTRY (padding_overflow, 0, TRUE),
+  CORPUS_ENTRY (padded_rr, 1, FALSE),
+  CORPUS_ENTRY (rr_count_overflow, 0, TRUE),
+  CORPUS_ENTRY (short_sr, 0, TRUE),
+  CORPUS_ENTRY (short_fb, 0, TRUE),
+  CORPUS_ENTRY (remb_n_ssrcs_overflow, 1, FALSE),
+  CORPUS_ENTRY (remb_big_exponent, 1, FALSE),
+  CORPUS_ENTRY (twcc_truncated, 1, FALSE),
+  CORPUS_ENTRY (nack_odd_fci, 1, FALSE),
+  CORPUS_ENTRY (valid_then_garbage, 1, TRUE),
+};
+
+GST_START_TEST (fuzz_corpus)
+{
+  KmsRTCPPSFBAFBREMBPacket remb_packet;
+  KmsRTCPCompoundReader reader;
+  KmsRTCPCompoundPacket packet;
+  gboolean error;
+  guint i, n;
+
+  for (i = 0; i < G_N_ELEMENTS (corpus); i++) {
+    /* Copied so that out of bounds reads are caught by memory checkers */
+    guint8 *data = g_memdup (corpus[i].data, corpus[i].size);
+
+    GST_DEBUG ("Corpus entry '%s'", corpus[i].name);
+    n = walk_compound (data, corpus[i].size, &error);
+    fail_unless_equals_int (n, corpus[i].n_packets);
+    fail_unless_equals_int (error, corpus[i].error);
+
+    g_free (data);
+  }
+
+  kms_rtcp_compound_reader_init (&reader, corpus_remb_big_exponent,
+      sizeof (corpus_remb_big_exponent));
+  fail_unless (kms_rtcp_compound_reader_next (&reader, &packet));
+  fail_unless (kms_rtcp_compound_packet_get_remb (&packet, &remb_packet));
+  fail_unless_equals_int (remb_packet.bitrate, G_MAXUINT32);
+
+  kms_rtcp_compound_reader_init (&reader, corpus_nack_odd_fci,
+      sizeof (corpus_nack_odd_fci));
+  fail_unless (kms_rtcp_compound_reader_next (&reader, &packet));
+  fail_unless_equals_int (kms_rtcp_compound_packet_get_nack_count (&packet),
+      1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (fuzz_mutations)
+{
+  guint8 valid[COMPOUND_MAX_SIZE];
+  GRand *rand = g_rand_new_with_seed (FUZZ_SEED);
+  guint size, i, j;
+
+  size = build_compound (valid, sizeof (valid));
+
+  for (i = 0; i < FUZZ_ITERATIONS; i++) {
+    guint n_mutations = g_rand_int_range (rand, 1, 5);
+    guint mutated_size = size;
+    guint8 *data;
+
+    if (g_rand_int_range (rand, 0, 4) == 0) {
+      mutated_size = g_rand_int_range (rand, 0, size + 1);
+    }
+
+    data = g_memdup (valid, MAX (mutated_size, 1));
+    for (j = 0; j < n_mutations && mutated_size > 0; j++) {
+      data[g_rand_int_range (rand, 0, mutated_size)] =
+          g_rand_int_range (rand, 0, 256);
+    }
+
+    walk_compound (data, mutated_size, NULL);
+    g_free (data);
+  }
+
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (parse_throughput)
+{
+  guint8 data[COMPOUND_MAX_SIZE];
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket rtcp_packet;
+  GstBuffer *buffer;
+  gint64 start, kms_time, gst_time;
+  guint size, i, n = 0;
+
+  size = build_compound (data, sizeof (data));
+  buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, data,
+      sizeof (data), 0, size, NULL, NULL);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    GstMapInfo map;
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    n += walk_compound (map.data, map.size, NULL);
+    gst_buffer_unmap (buffer, &map);
+  }
+  kms_time = g_get_monotonic_time () - start;
+  fail_unless_equals_int (n, BENCHMARK_ITERATIONS *
+      G_N_ELEMENTS (compound_types));
+
+  /* Same walk with the GStreamer accessors, as done before */
+  n = 0;
+  start = g_get_monotonic_time ();
+  for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    gboolean more;
+
+    gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcp);
+    for (more = gst_rtcp_buffer_get_first_packet (&rtcp, &rtcp_packet); more;
+        more = gst_rtcp_packet_move_to_next (&rtcp_packet)) {
+      switch (gst_rtcp_packet_get_type (&rtcp_packet)) {
+        case GST_RTCP_TYPE_SR:
+          gst_rtcp_packet_sr_get_sender_info (&rtcp_packet, NULL, NULL, NULL,
+              NULL, NULL);
+          break;
+        case GST_RTCP_TYPE_RTPFB:
+        case GST_RTCP_TYPE_PSFB:
+          gst_rtcp_packet_fb_get_media_ssrc (&rtcp_packet);
+          gst_rtcp_packet_fb_get_fci (&rtcp_packet);
+          break;
+        default:
+          break;
+      }
+      n++;
+    }
+    gst_rtcp_buffer_unmap (&rtcp);
+  }
+  gst_time = g_get_monotonic_time () - start;
+  fail_unless_equals_int (n, BENCHMARK_ITERATIONS *
+      G_N_ELEMENTS (compound_types));
+
+  GST_INFO ("Compound reader: %" G_GINT64_FORMAT " us (%.0f packets/s)",
+      kms_time, n * (gdouble) G_USEC_PER_SEC / MAX (kms_time, 1));
+  GST_INFO ("GstRTCPBuffer: %" G_GINT64_FORMAT " us (%.0f packets/s)",
+      gst_time, n * (gdouble) G_USEC_PER_SEC / MAX (gst_time, 1));
+
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+rtcp_suite (void)
+{
+  Suite *s = suite_create ("rtcp");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, compound_roundtrip);
+  tcase_add_test (tc_chain, read_gst_compound);
+  tcase_add_test (tc_chain, writer_no_room);
+  tcase_add_test (tc_chain, fuzz_corpus);
+  tcase_add_test (tc_chain, fuzz_mutations);
+  tcase_add_test (tc_chain, parse_throughput);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtcp);
@@ -0,0 +1,400 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsrtpforward.h"
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <glib.h>
+
+#define PAYLOAD_SIZE 100
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static GstPad *mysrcpad, *mysinkpad;
+
+/* identity outputs one buffer per input, like audio depayloaders do */
+static GstElement *
+setup_identity (const gchar * caps_str)
+{
+  GstElement *identity;
+  GstCaps *caps;
+
+  identity = gst_check_setup_element ("identity");
+  mysrcpad = gst_check_setup_src_pad (identity, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (identity, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (identity, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string (caps_str);
+  gst_check_setup_events (mysrcpad, identity, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return identity;
+}
+
+static void
+cleanup_identity (GstElement * identity)
+{
+  gst_check_drop_buffers ();
+  gst_element_set_state (identity, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (identity);
+  gst_check_teardown_sink_pad (identity);
+  gst_check_teardown_element (identity);
+}
+
+static GstBuffer *
+create_rtp_buffer (guint8 pt, guint32 ssrc, guint16 seq, guint32 ts,
+    gboolean marker)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+
+  buffer = gst_rtp_buffer_new_allocate (PAYLOAD_SIZE, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_payload_type (&rtp, pt);
+  gst_rtp_buffer_set_ssrc (&rtp, ssrc);
+  gst_rtp_buffer_set_seq (&rtp, seq);
+  gst_rtp_buffer_set_timestamp (&rtp, ts);
+  gst_rtp_buffer_set_marker (&rtp, marker);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buffer;
+}
+
+static void
+check_rtp_buffer (GstBuffer * buffer, guint8 pt, guint32 ssrc, guint16 seq,
+    guint32 ts, gboolean marker)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_type (&rtp), pt);
+  fail_unless_equals_int (gst_rtp_buffer_get_ssrc (&rtp), ssrc);
+  fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtp), seq);
+  fail_unless_equals_int (gst_rtp_buffer_get_timestamp (&rtp), ts);
+  fail_unless_equals_int (gst_rtp_buffer_get_marker (&rtp), marker);
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp), PAYLOAD_SIZE);
+  fail_if (gst_rtp_buffer_get_extension (&rtp));
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+GST_START_TEST (collect_audio)
+{
+  GstElement *identity;
+  KmsRtpForwardMeta *meta;
+  GstBuffer *packet;
+
+  identity = setup_identity ("application/x-rtp, media=audio, "
+      "encoding-name=OPUS, clock-rate=48000, payload=111");
+  kms_rtp_forward_add_collector (identity);
+
+  packet = create_rtp_buffer (111, 1234, 1, 960, FALSE);
+  fail_unless (gst_pad_push (mysrcpad, gst_buffer_ref (packet)) ==
+      GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  meta = kms_buffer_get_rtp_forward_meta (GST_BUFFER (buffers->data));
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (gst_buffer_list_length (meta->packets), 1);
+  fail_unless (gst_buffer_list_get (meta->packets, 0) == packet);
+
+  /* Nothing is cached until the frame is forwarded */
+  fail_unless_equals_int (kms_rtx_cache_get_memory_usage (), 0);
+
+  gst_buffer_unref (packet);
+  cleanup_identity (identity);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (collect_unaligned_video)
+{
+  GstElement *identity;
+  GList *l;
+
+  identity = setup_identity ("application/x-rtp, media=video, "
+      "encoding-name=VP8, clock-rate=90000, payload=96");
+  kms_rtp_forward_add_collector (identity);
+
+  /* Output for a packet without marker: the frame is not complete yet */
+  fail_unless (gst_pad_push (mysrcpad, create_rtp_buffer (96, 1234, 1, 3000,
+              FALSE)) == GST_FLOW_OK);
+  fail_unless (gst_pad_push (mysrcpad, create_rtp_buffer (96, 1234, 2, 3000,
+              TRUE)) == GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  for (l = buffers; l != NULL; l = l->next) {
+    fail_if (kms_buffer_get_rtp_forward_meta (GST_BUFFER (l->data)));
+  }
+
+  cleanup_identity (identity);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (forward_and_payload)
+{
+  GstBufferList *packets;
+  GstElement *identity;
+  GstBuffer *frame, *payloaded;
+  GstCaps *caps;
+  guint i;
+
+  identity = setup_identity ("application/x-rtp, media=video, "
+      "encoding-name=VP8, clock-rate=90000, payload=100, ssrc=(uint)1111, "
+      "seqnum-offset=(uint)10, timestamp-offset=(uint)1000");
+  kms_rtp_forward_add_forwarder (identity);
+
+  /* Frame received from another peer */
+  packets = gst_buffer_list_new ();
+  for (i = 0; i < 3; i++) {
+    gst_buffer_list_add (packets, create_rtp_buffer (96, 5555, 500 + i, 3000,
+            i == 2));
+  }
+
+  caps = gst_caps_from_string ("application/x-rtp, media=video, "
+      "encoding-name=VP8, clock-rate=90000, payload=96");
+  frame = gst_buffer_new_allocate (NULL, 3 * PAYLOAD_SIZE, NULL);
+  GST_BUFFER_PTS (frame) = 0;
+  kms_buffer_add_rtp_forward_meta (frame, packets, caps);
+  gst_buffer_list_unref (packets);
+  gst_caps_unref (caps);
+
+  fail_unless (gst_pad_push (mysrcpad, frame) == GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  for (i = 0; i < 3; i++) {
+    check_rtp_buffer (GST_BUFFER (g_list_nth_data (buffers, i)), 100, 1111,
+        10 + i, 1000, i == 2);
+  }
+
+  /* Next frame is payloaded, it continues the forwarded sequence */
+  payloaded = create_rtp_buffer (100, 1111, 7, 50, TRUE);
+  GST_BUFFER_PTS (payloaded) = GST_SECOND / 30;
+  fail_unless (gst_pad_push (mysrcpad, payloaded) == GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 4);
+  check_rtp_buffer (GST_BUFFER (g_list_nth_data (buffers, 3)), 100, 1111, 13,
+      1000 + 3000, TRUE);
+
+  cleanup_identity (identity);
+}
+
+GST_END_TEST;
+
+/* Acts as a transform writing the modified frame into a copy */
+static GstPadProbeReturn
+transform_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstBuffer *buffer = gst_pad_probe_info_get_buffer (info);
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  buffer = gst_buffer_copy (buffer);
+  gst_buffer_unref (gst_pad_probe_info_get_buffer (info));
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READWRITE, &rtp));
+  ((guint8 *) gst_rtp_buffer_get_payload (&rtp))[0] = 0xff;
+  gst_rtp_buffer_unmap (&rtp);
+
+  GST_PAD_PROBE_INFO_DATA (info) = buffer;
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (transform_between)
+{
+  GstElement *depayloader, *payloader;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *packet;
+  GstCaps *caps;
+  GstPad *pad;
+
+  fail_unless (gst_meta_api_type_has_tag (KMS_RTP_FORWARD_META_API_TYPE,
+          g_quark_from_string (KMS_RTP_FORWARD_META_TAG_STR)));
+
+  depayloader = gst_check_setup_element ("identity");
+  payloader = gst_check_setup_element ("identity");
+  mysrcpad = gst_check_setup_src_pad (depayloader, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (payloader, &sinktemplate);
+  fail_unless (gst_element_link (depayloader, payloader));
+
+  kms_rtp_forward_add_collector (depayloader);
+
+  /* Added before the forwarder, so it runs first */
+  pad = gst_element_get_static_pad (payloader, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, transform_probe, NULL,
+      NULL);
+  g_object_unref (pad);
+
+  kms_rtp_forward_add_forwarder (payloader);
+
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless (gst_element_set_state (depayloader, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless (gst_element_set_state (payloader, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("application/x-rtp, media=audio, "
+      "encoding-name=OPUS, clock-rate=48000, payload=111, ssrc=(uint)1111");
+  gst_check_setup_events (mysrcpad, depayloader, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  packet = create_rtp_buffer (111, 5555, 1, 960, FALSE);
+  fail_unless (gst_pad_push (mysrcpad, gst_buffer_ref (packet)) ==
+      GST_FLOW_OK);
+
+  /* The modified frame is payloaded, not replaced by the received packet */
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  fail_unless (gst_rtp_buffer_map (GST_BUFFER (buffers->data), GST_MAP_READ,
+          &rtp));
+  fail_unless_equals_int (((guint8 *) gst_rtp_buffer_get_payload (&rtp))[0],
+      0xff);
+  gst_rtp_buffer_unmap (&rtp);
+
+  /* The received packet is not modified either */
+  fail_unless (gst_rtp_buffer_map (packet, GST_MAP_READ, &rtp));
+  fail_unless_equals_int (((guint8 *) gst_rtp_buffer_get_payload (&rtp))[0],
+      0);
+  gst_rtp_buffer_unmap (&rtp);
+  gst_buffer_unref (packet);
+
+  gst_check_drop_buffers ();
+  gst_element_set_state (depayloader, GST_STATE_NULL);
+  gst_element_set_state (payloader, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_element_unlink (depayloader, payloader);
+  gst_check_teardown_src_pad (depayloader);
+  gst_check_teardown_sink_pad (payloader);
+  gst_check_teardown_element (depayloader);
+  gst_check_teardown_element (payloader);
+}
+
+GST_END_TEST;
+
+static GstBuffer *
+create_forwardable_frame (guint16 seq, guint32 ts, GstClockTime pts)
+{
+  GstBufferList *packets;
+  GstBuffer *frame;
+  GstCaps *caps;
+  guint i;
+
+  packets = gst_buffer_list_new ();
+  for (i = 0; i < 3; i++) {
+    gst_buffer_list_add (packets, create_rtp_buffer (96, 5555, seq + i, ts,
+            i == 2));
+  }
+
+  caps = gst_caps_from_string ("application/x-rtp, media=application, "
+      "encoding-name=X-GST, clock-rate=90000, payload=96");
+  frame = gst_buffer_new_allocate (NULL, 3 * PAYLOAD_SIZE, NULL);
+  gst_buffer_memset (frame, 0, 0, 3 * PAYLOAD_SIZE);
+  GST_BUFFER_PTS (frame) = pts;
+  kms_buffer_add_rtp_forward_meta (frame, packets, caps);
+  gst_buffer_list_unref (packets);
+  gst_caps_unref (caps);
+
+  return frame;
+}
+
+GST_START_TEST (forward_within_mtu)
+{
+  GstElement *payloader;
+  GstCaps *caps;
+  guint forwarded = 0;
+  GList *l;
+
+  payloader = gst_check_setup_element ("rtpgstpay");
+  mysrcpad = gst_check_setup_src_pad (payloader, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (payloader, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  kms_rtp_forward_add_forwarder (payloader);
+
+  g_object_set (payloader, "mtu", 1400, NULL);
+  fail_unless (gst_element_set_state (payloader, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("application/x-test");
+  gst_check_setup_events (mysrcpad, payloader, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  fail_unless (gst_pad_push (mysrcpad, create_forwardable_frame (500, 3000,
+              0)) == GST_FLOW_OK);
+
+  for (l = buffers; l != NULL; l = l->next) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+    fail_unless (gst_rtp_buffer_map (GST_BUFFER (l->data), GST_MAP_READ,
+            &rtp));
+    if (gst_rtp_buffer_get_payload_len (&rtp) == PAYLOAD_SIZE) {
+      forwarded++;
+    }
+    gst_rtp_buffer_unmap (&rtp);
+  }
+  fail_unless_equals_int (forwarded, 3);
+  gst_check_drop_buffers ();
+
+  /* Received packets do not fit any more: the frame is payloaded */
+  g_object_set (payloader, "mtu", PAYLOAD_SIZE, NULL);
+  fail_unless (gst_pad_push (mysrcpad, create_forwardable_frame (503, 6000,
+              GST_SECOND / 30)) == GST_FLOW_OK);
+
+  fail_if (buffers == NULL);
+  for (l = buffers; l != NULL; l = l->next) {
+    fail_unless (gst_buffer_get_size (GST_BUFFER (l->data)) <= PAYLOAD_SIZE);
+  }
+
+  gst_check_drop_buffers ();
+  gst_element_set_state (payloader, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (payloader);
+  gst_check_teardown_sink_pad (payloader);
+  gst_check_teardown_element (payloader);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+rtpforward_suite (void)
+{
+  Suite *s = suite_create ("rtpforward");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, collect_audio);
+  tcase_add_test (tc_chain, collect_unaligned_video);
+  tcase_add_test (tc_chain, forward_and_payload);
+  tcase_add_test (tc_chain, transform_between);
+  tcase_add_test (tc_chain, forward_within_mtu);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpforward);
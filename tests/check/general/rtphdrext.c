@@ -0,0 +1,198 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsrtphdrext.h"
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <glib.h>
+#include <string.h>
+
+#define ABS_SEND_TIME_ID 3
+#define TRANSPORT_CC_ID 5
+#define VIDEO_ORIENTATION_ID 7
+
+static gboolean
+get_ext (GstBuffer * buffer, guint8 id, guint8 * data, guint * size)
+{
+  GstRTPBuffer rtp = { NULL, };
+  gpointer ext;
+  gboolean ret;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+  ret = gst_rtp_buffer_get_extension_onebyte_header (&rtp, id, 0, &ext, size);
+  if (ret) {
+    memcpy (data, ext, *size);
+  }
+  gst_rtp_buffer_unmap (&rtp);
+
+  return ret;
+}
+
+GST_START_TEST (reserve_and_stamp)
+{
+  KmsRtpHdrExtWriter *reserver, *stamper;
+  GstPad *pad;
+  GstBuffer *buffer;
+  guint8 data[4];
+  guint size;
+
+  pad = gst_pad_new (NULL, GST_PAD_SRC);
+  buffer = gst_rtp_buffer_new_allocate (16, 0, 0);
+
+  reserver = kms_rtp_hdr_ext_writer_create (pad, TRUE);
+  fail_unless (kms_rtp_hdr_ext_writer_add (reserver,
+          KMS_RTP_HDR_EXT_ABS_SEND_TIME, ABS_SEND_TIME_ID));
+  fail_unless (kms_rtp_hdr_ext_writer_add (reserver,
+          KMS_RTP_HDR_EXT_TRANSPORT_CC, TRANSPORT_CC_ID));
+  fail_unless (kms_rtp_hdr_ext_writer_add (reserver,
+          KMS_RTP_HDR_EXT_VIDEO_ORIENTATION, VIDEO_ORIENTATION_ID));
+  fail_if (kms_rtp_hdr_ext_writer_add (reserver,
+          KMS_RTP_HDR_EXT_TRANSPORT_CC, TRANSPORT_CC_ID));
+  kms_rtp_hdr_ext_writer_set_video_orientation (reserver, 1);
+
+  kms_rtp_hdr_ext_writer_process_buffer (reserver, buffer, GST_SECOND);
+
+  fail_unless (get_ext (buffer, ABS_SEND_TIME_ID, data, &size));
+  fail_unless (size == 3);
+  fail_unless (data[0] == 0 && data[1] == 0 && data[2] == 0);
+  fail_unless (get_ext (buffer, TRANSPORT_CC_ID, data, &size));
+  fail_unless (size == 2);
+  fail_unless (get_ext (buffer, VIDEO_ORIENTATION_ID, data, &size));
+  fail_unless (size == 1);
+  fail_unless (data[0] == 1);
+
+  stamper = kms_rtp_hdr_ext_writer_create (pad, FALSE);
+  fail_unless (kms_rtp_hdr_ext_writer_add (stamper,
+          KMS_RTP_HDR_EXT_ABS_SEND_TIME, ABS_SEND_TIME_ID));
+  fail_unless (kms_rtp_hdr_ext_writer_add (stamper,
+          KMS_RTP_HDR_EXT_TRANSPORT_CC, TRANSPORT_CC_ID));
+
+  /* 1 second in 6.18 fixed point format */
+  kms_rtp_hdr_ext_writer_process_buffer (stamper, buffer, GST_SECOND);
+  fail_unless (get_ext (buffer, ABS_SEND_TIME_ID, data, &size));
+  fail_unless (data[0] == 0x04 && data[1] == 0 && data[2] == 0);
+  fail_unless (get_ext (buffer, TRANSPORT_CC_ID, data, &size));
+  fail_unless (data[0] == 0 && data[1] == 0);
+
+  kms_rtp_hdr_ext_writer_process_buffer (stamper, buffer, GST_SECOND);
+  fail_unless (get_ext (buffer, TRANSPORT_CC_ID, data, &size));
+  fail_unless (data[0] == 0 && data[1] == 1);
+
+  kms_rtp_hdr_ext_writer_destroy (reserver);
+  kms_rtp_hdr_ext_writer_destroy (stamper);
+  gst_buffer_unref (buffer);
+  g_object_unref (pad);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (stamp_buffer_list)
+{
+  KmsRtpHdrExtWriter *reserver, *stamper;
+  GstBufferList *list;
+  GstPad *pad;
+  guint8 data[4];
+  guint i, size;
+
+  pad = gst_pad_new (NULL, GST_PAD_SRC);
+  list = gst_buffer_list_new ();
+
+  for (i = 0; i < 10; i++) {
+    gst_buffer_list_add (list, gst_rtp_buffer_new_allocate (16, 0, 0));
+  }
+
+  reserver = kms_rtp_hdr_ext_writer_create (pad, TRUE);
+  kms_rtp_hdr_ext_writer_add (reserver, KMS_RTP_HDR_EXT_TRANSPORT_CC,
+      TRANSPORT_CC_ID);
+  stamper = kms_rtp_hdr_ext_writer_create (pad, FALSE);
+  kms_rtp_hdr_ext_writer_add (stamper, KMS_RTP_HDR_EXT_TRANSPORT_CC,
+      TRANSPORT_CC_ID);
+
+  kms_rtp_hdr_ext_writer_process_list (reserver, list);
+  kms_rtp_hdr_ext_writer_process_list (stamper, list);
+
+  for (i = 0; i < 10; i++) {
+    fail_unless (get_ext (gst_buffer_list_get (list, i), TRANSPORT_CC_ID, data,
+            &size));
+    fail_unless (((data[0] << 8) | data[1]) == i);
+  }
+
+  kms_rtp_hdr_ext_writer_destroy (reserver);
+  kms_rtp_hdr_ext_writer_destroy (stamper);
+  gst_buffer_list_unref (list);
+  g_object_unref (pad);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (stamp_shared_memory)
+{
+  KmsRtpHdrExtWriter *reserver, *stamper;
+  GstBuffer *buffer, *history;
+  GstPad *pad;
+  guint8 data[4];
+  guint size;
+
+  pad = gst_pad_new (NULL, GST_PAD_SRC);
+  buffer = gst_rtp_buffer_new_allocate (16, 0, 0);
+
+  reserver = kms_rtp_hdr_ext_writer_create (pad, TRUE);
+  kms_rtp_hdr_ext_writer_add (reserver, KMS_RTP_HDR_EXT_TRANSPORT_CC,
+      TRANSPORT_CC_ID);
+  stamper = kms_rtp_hdr_ext_writer_create (pad, FALSE);
+  kms_rtp_hdr_ext_writer_add (stamper, KMS_RTP_HDR_EXT_TRANSPORT_CC,
+      TRANSPORT_CC_ID);
+
+  kms_rtp_hdr_ext_writer_process_buffer (reserver, buffer, GST_SECOND);
+  kms_rtp_hdr_ext_writer_process_buffer (stamper, buffer, GST_SECOND);
+
+  /* A history (e.g. rtprtxqueue) keeps a reference to the sent packet */
+  history = gst_buffer_ref (buffer);
+  buffer = gst_buffer_make_writable (buffer);
+  kms_rtp_hdr_ext_writer_process_buffer (stamper, buffer, GST_SECOND);
+
+  fail_unless (get_ext (buffer, TRANSPORT_CC_ID, data, &size));
+  fail_unless (data[0] == 0 && data[1] == 1);
+  fail_unless (get_ext (history, TRANSPORT_CC_ID, data, &size));
+  fail_unless (data[0] == 0 && data[1] == 0);
+
+  kms_rtp_hdr_ext_writer_destroy (reserver);
+  kms_rtp_hdr_ext_writer_destroy (stamper);
+  gst_buffer_unref (history);
+  gst_buffer_unref (buffer);
+  g_object_unref (pad);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+rtphdrext_suite (void)
+{
+  Suite *s = suite_create ("rtphdrext");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, reserve_and_stamp);
+  tcase_add_test (tc_chain, stamp_buffer_list);
+  tcase_add_test (tc_chain, stamp_shared_memory);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtphdrext);
@@ -0,0 +1,361 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsrtxcache.h"
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <glib.h>
+
+#define PAYLOAD_SIZE 100
+#define PACKET_SIZE (PAYLOAD_SIZE + 12)
+
+#define PT 96
+#define SSRC 1234
+#define CSRC 4321
+#define EXT_ID 3
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstElement *
+setup_identity (void)
+{
+  GstElement *identity;
+  GstCaps *caps;
+
+  identity = gst_check_setup_element ("identity");
+  mysrcpad = gst_check_setup_src_pad (identity, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (identity, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (identity, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("application/x-rtp");
+  gst_check_setup_events (mysrcpad, identity, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return identity;
+}
+
+static void
+cleanup_identity (GstElement * identity)
+{
+  gst_check_drop_buffers ();
+  gst_element_set_state (identity, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (identity);
+  gst_check_teardown_sink_pad (identity);
+  gst_check_teardown_element (identity);
+}
+
+static GstBuffer *
+create_rtp_buffer (guint8 pt, guint32 ssrc, guint16 seq, guint32 ts)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+
+  buffer = gst_rtp_buffer_new_allocate (PAYLOAD_SIZE, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_payload_type (&rtp, pt);
+  gst_rtp_buffer_set_ssrc (&rtp, ssrc);
+  gst_rtp_buffer_set_seq (&rtp, seq);
+  gst_rtp_buffer_set_timestamp (&rtp, ts);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buffer;
+}
+
+static void
+check_rtp_buffer (GstBuffer * buffer, guint8 pt, guint32 ssrc, guint16 seq,
+    guint32 ts)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_type (&rtp), pt);
+  fail_unless_equals_int (gst_rtp_buffer_get_ssrc (&rtp), ssrc);
+  fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtp), seq);
+  fail_unless_equals_int (gst_rtp_buffer_get_timestamp (&rtp), ts);
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp), PAYLOAD_SIZE);
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+/* Sent packet with a CSRC and a header extension */
+static GstBuffer *
+create_rtp_buffer_with_header (guint8 pt, guint32 ssrc, guint16 seq,
+    guint32 ts)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+  guint8 ext[] = { 0xab, 0xcd };
+
+  buffer = gst_rtp_buffer_new_allocate (PAYLOAD_SIZE, 0, 1);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_payload_type (&rtp, pt);
+  gst_rtp_buffer_set_ssrc (&rtp, ssrc);
+  gst_rtp_buffer_set_seq (&rtp, seq);
+  gst_rtp_buffer_set_timestamp (&rtp, ts);
+  gst_rtp_buffer_set_csrc (&rtp, 0, CSRC);
+  fail_unless (gst_rtp_buffer_add_extension_onebyte_header (&rtp, EXT_ID, ext,
+          sizeof (ext)));
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buffer;
+}
+
+static void
+check_rtp_header (GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  gpointer data;
+  guint size;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+  fail_unless_equals_int (gst_rtp_buffer_get_csrc_count (&rtp), 1);
+  fail_unless_equals_int (gst_rtp_buffer_get_csrc (&rtp, 0), CSRC);
+  fail_unless (gst_rtp_buffer_get_extension_onebyte_header (&rtp, EXT_ID, 0,
+          &data, &size));
+  fail_unless_equals_int (size, 2);
+  fail_unless_equals_int (((guint8 *) data)[0], 0xab);
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+static void
+store_packet (KmsRtxCache * cache, guint16 seq)
+{
+  GstBuffer *buffer = create_rtp_buffer (PT, SSRC, seq, 0);
+
+  kms_rtx_cache_store (cache, buffer);
+  gst_buffer_unref (buffer);
+}
+
+static KmsRtxCacheResult
+lookup_packet (KmsRtxCache * cache, guint16 seq)
+{
+  KmsRtxCacheResult result;
+  GstBuffer *buffer;
+
+  result = kms_rtx_cache_lookup (cache, seq, &buffer);
+  fail_unless ((result == KMS_RTX_CACHE_HIT) == (buffer != NULL));
+
+  if (buffer != NULL) {
+    check_rtp_buffer (buffer, PT, SSRC, seq, 0);
+    gst_buffer_unref (buffer);
+  }
+
+  return result;
+}
+
+static void
+request_retransmission (guint16 seq)
+{
+  GstEvent *event;
+
+  event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+      gst_structure_new ("GstRTPRetransmissionRequest", "seqnum", G_TYPE_UINT,
+          (guint) seq, "ssrc", G_TYPE_UINT, SSRC, NULL));
+  fail_unless (gst_pad_push_event (mysinkpad, event));
+}
+
+GST_START_TEST (store_and_lookup)
+{
+  KmsRtxCache *cache = kms_rtx_cache_new (8);
+  KmsRtxCacheStats stats;
+  guint16 seq;
+
+  fail_unless (lookup_packet (cache, 10) == KMS_RTX_CACHE_MISS);
+
+  store_packet (cache, 10);
+  store_packet (cache, 11);
+  store_packet (cache, 13);
+
+  fail_unless (lookup_packet (cache, 11) == KMS_RTX_CACHE_HIT);
+  fail_unless (lookup_packet (cache, 12) == KMS_RTX_CACHE_MISS);
+  fail_unless (lookup_packet (cache, 14) == KMS_RTX_CACHE_MISS);
+
+  for (seq = 14; seq < 30; seq++) {
+    store_packet (cache, seq);
+  }
+
+  /* Out of the window of the last 8 packets */
+  fail_unless (lookup_packet (cache, 13) == KMS_RTX_CACHE_EXPIRED);
+  fail_unless (lookup_packet (cache, 21) == KMS_RTX_CACHE_EXPIRED);
+  fail_unless (lookup_packet (cache, 22) == KMS_RTX_CACHE_HIT);
+
+  kms_rtx_cache_get_stats (cache, &stats);
+  fail_unless_equals_int (stats.hits, 2);
+  fail_unless_equals_int (stats.misses, 3);
+  fail_unless_equals_int (stats.expired, 2);
+
+  kms_rtx_cache_clear (cache);
+  fail_unless (lookup_packet (cache, 29) == KMS_RTX_CACHE_EXPIRED);
+  fail_unless_equals_int (kms_rtx_cache_get_memory_usage (), 0);
+
+  kms_rtx_cache_unref (cache);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (seqnum_wraparound)
+{
+  KmsRtxCache *cache = kms_rtx_cache_new (8);
+  guint16 seq;
+
+  for (seq = 65530; seq != 3; seq++) {
+    store_packet (cache, seq);
+  }
+
+  fail_unless (lookup_packet (cache, 65530) == KMS_RTX_CACHE_EXPIRED);
+  fail_unless (lookup_packet (cache, 65535) == KMS_RTX_CACHE_HIT);
+  fail_unless (lookup_packet (cache, 2) == KMS_RTX_CACHE_HIT);
+  fail_unless (lookup_packet (cache, 3) == KMS_RTX_CACHE_MISS);
+
+  /* Late packets older than the window are not stored */
+  store_packet (cache, 65529);
+  fail_unless (lookup_packet (cache, 65529) == KMS_RTX_CACHE_EXPIRED);
+
+  kms_rtx_cache_unref (cache);
+}
+
+GST_END_TEST;
+
+#define BUDGET_PACKETS (KMS_RTX_CACHE_RESERVED_PACKETS + 8)
+
+GST_START_TEST (memory_budget)
+{
+  KmsRtxCache *a = kms_rtx_cache_new (4 * KMS_RTX_CACHE_RESERVED_PACKETS);
+  KmsRtxCache *b = kms_rtx_cache_new (4 * KMS_RTX_CACHE_RESERVED_PACKETS);
+  guint16 seq;
+
+  kms_rtx_cache_set_memory_budget (BUDGET_PACKETS * PACKET_SIZE);
+
+  for (seq = 0; seq < 2 * KMS_RTX_CACHE_RESERVED_PACKETS; seq++) {
+    store_packet (a, seq);
+  }
+
+  /* Oldest packets are dropped once over budget */
+  fail_unless (kms_rtx_cache_get_memory_usage () <=
+      BUDGET_PACKETS * PACKET_SIZE);
+  fail_unless (lookup_packet (a, 0) == KMS_RTX_CACHE_EXPIRED);
+  fail_unless (lookup_packet (a, seq - BUDGET_PACKETS) ==
+      KMS_RTX_CACHE_HIT);
+
+  /* The budget is shared by every cache, but the last packets of each of */
+  /* them are kept                                                        */
+  for (seq = 0; seq < 2 * KMS_RTX_CACHE_RESERVED_PACKETS; seq++) {
+    store_packet (b, seq);
+    fail_unless (lookup_packet (b, seq) == KMS_RTX_CACHE_HIT);
+  }
+
+  fail_unless (lookup_packet (b, 0) == KMS_RTX_CACHE_EXPIRED);
+  fail_unless (lookup_packet (b, seq - KMS_RTX_CACHE_RESERVED_PACKETS) ==
+      KMS_RTX_CACHE_HIT);
+  fail_unless (lookup_packet (a, seq - KMS_RTX_CACHE_RESERVED_PACKETS) ==
+      KMS_RTX_CACHE_HIT);
+  fail_unless (kms_rtx_cache_get_memory_usage () <=
+      (BUDGET_PACKETS + KMS_RTX_CACHE_RESERVED_PACKETS) * PACKET_SIZE);
+
+  kms_rtx_cache_unref (a);
+  kms_rtx_cache_unref (b);
+  fail_unless_equals_int (kms_rtx_cache_get_memory_usage (), 0);
+
+  kms_rtx_cache_set_memory_budget (KMS_RTX_CACHE_DEFAULT_MEMORY_BUDGET);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (sender_retransmits)
+{
+  KmsRtxCache *shared = kms_rtx_cache_new (64);
+  KmsRtxCacheStats stats;
+  GstElement *identity;
+  KmsRtxSender *sender;
+  GstBuffer *buffer;
+
+  identity = setup_identity ();
+  sender = kms_rtx_sender_create (identity, 64);
+
+  /* Payloaded packet, kept by the sender */
+  fail_unless (gst_pad_push (mysrcpad,
+          create_rtp_buffer (PT, SSRC, 100, 1000)) == GST_FLOW_OK);
+
+  /* Forwarded packet, rewritten from the shared cache */
+  store_packet (shared, 5000);
+  buffer = create_rtp_buffer_with_header (PT, SSRC, 101, 1000);
+  kms_buffer_add_rtx_cache_meta (buffer, shared, 5000);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+  request_retransmission (100);
+  request_retransmission (101);
+  request_retransmission (102);
+
+  /* Retransmissions go out before the next packet */
+  fail_unless (gst_pad_push (mysrcpad,
+          create_rtp_buffer (PT, SSRC, 103, 2000)) == GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 5);
+  check_rtp_buffer (g_list_nth_data (buffers, 2), PT, SSRC, 100, 1000);
+  check_rtp_buffer (g_list_nth_data (buffers, 3), PT, SSRC, 101, 1000);
+  check_rtp_header (g_list_nth_data (buffers, 3));
+  check_rtp_buffer (g_list_nth_data (buffers, 4), PT, SSRC, 103, 2000);
+
+  kms_rtx_sender_get_stats (sender, &stats);
+  fail_unless_equals_int (stats.hits, 2);
+  fail_unless_equals_int (stats.misses, 1);
+  fail_unless_equals_int (stats.expired, 0);
+
+  kms_rtx_cache_get_stats (shared, &stats);
+  fail_unless_equals_int (stats.hits, 1);
+
+  /* The source is gone */
+  kms_rtx_cache_clear (shared);
+  request_retransmission (101);
+  kms_rtx_sender_get_stats (sender, &stats);
+  fail_unless_equals_int (stats.expired, 1);
+
+  kms_rtx_sender_destroy (sender);
+  kms_rtx_cache_unref (shared);
+  cleanup_identity (identity);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+rtxcache_suite (void)
+{
+  Suite *s = suite_create ("rtxcache");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, store_and_lookup);
+  tcase_add_test (tc_chain, seqnum_wraparound);
+  tcase_add_test (tc_chain, memory_budget);
+  tcase_add_test (tc_chain, sender_retransmits);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtxcache);
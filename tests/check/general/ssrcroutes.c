@@ -0,0 +1,208 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "kmsssrcroutes.h"
+
+#include <gst/check/gstcheck.h>
+#include <glib.h>
+
+#define N_MEDIAS 200
+
+static GstSDPMedia *
+create_media (const gchar * media_str, const gchar ** attrs)
+{
+  GstSDPMedia *media;
+  guint i;
+
+  gst_sdp_media_new (&media);
+  gst_sdp_media_set_media (media, media_str);
+
+  for (i = 0; attrs[i] != NULL; i += 2) {
+    gst_sdp_media_add_attribute (media, attrs[i], attrs[i + 1]);
+  }
+
+  return media;
+}
+
+static void
+check_route (const KmsSsrcRoutes * routes, guint32 ssrc, gint index,
+    KmsMediaType media, KmsSsrcRole role)
+{
+  const KmsSsrcRoute *route = kms_ssrc_routes_lookup (routes, ssrc);
+
+  fail_unless (route != NULL);
+  fail_unless_equals_int (route->index, index);
+  fail_unless_equals_int (route->media, media);
+  fail_unless_equals_int (route->role, role);
+}
+
+GST_START_TEST (add_media_groups)
+{
+  const gchar *attrs[] = {
+    "ssrc", "1000 cname:user",
+    "ssrc", "1001 cname:user",
+    "ssrc", "2000 cname:user",
+    "ssrc", "2001 cname:user",
+    "ssrc", "3000 cname:user",
+    "ssrc", "invalid",
+    "ssrc-group", "SIM 1000 2000",
+    "ssrc-group", "FID 1000 1001",
+    "ssrc-group", "FID 2000 2001",
+    "ssrc-group", "FEC-FR 1000 3000",
+    NULL
+  };
+  KmsSsrcRoutes *routes;
+  GstSDPMedia *media;
+
+  media = create_media ("video", attrs);
+  routes = kms_ssrc_routes_new (NULL);
+
+  fail_unless_equals_int (kms_ssrc_routes_add_media (routes, media, 1,
+          KMS_MEDIA_TYPE_VIDEO), 5);
+  fail_unless_equals_int (kms_ssrc_routes_size (routes), 5);
+
+  check_route (routes, 1000, 1, KMS_MEDIA_TYPE_VIDEO, KMS_SSRC_ROLE_MEDIA);
+  check_route (routes, 2000, 1, KMS_MEDIA_TYPE_VIDEO, KMS_SSRC_ROLE_MEDIA);
+  check_route (routes, 1001, 1, KMS_MEDIA_TYPE_VIDEO, KMS_SSRC_ROLE_RTX);
+  check_route (routes, 2001, 1, KMS_MEDIA_TYPE_VIDEO, KMS_SSRC_ROLE_RTX);
+  check_route (routes, 3000, 1, KMS_MEDIA_TYPE_VIDEO, KMS_SSRC_ROLE_FEC);
+  fail_unless (kms_ssrc_routes_lookup (routes, 4000) == NULL);
+
+  kms_ssrc_routes_destroy (routes);
+  gst_sdp_media_free (media);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (renegotiate_index)
+{
+  const gchar *audio_attrs[] = { "ssrc", "1 cname:user", NULL };
+  const gchar *video_attrs[] = { "ssrc", "2 cname:user", NULL };
+  const gchar *new_video_attrs[] = { "ssrc", "3 cname:user", NULL };
+  GstSDPMedia *audio, *video, *new_video;
+  KmsSsrcRoutes *routes, *copy;
+
+  audio = create_media ("audio", audio_attrs);
+  video = create_media ("video", video_attrs);
+  new_video = create_media ("video", new_video_attrs);
+
+  routes = kms_ssrc_routes_new (NULL);
+  kms_ssrc_routes_add_media (routes, audio, 0, KMS_MEDIA_TYPE_AUDIO);
+  kms_ssrc_routes_add_media (routes, video, 1, KMS_MEDIA_TYPE_VIDEO);
+
+  copy = kms_ssrc_routes_new (routes);
+  kms_ssrc_routes_remove_index (copy, 1);
+  kms_ssrc_routes_add_media (copy, new_video, 1, KMS_MEDIA_TYPE_VIDEO);
+
+  /* Original table is not modified */
+  check_route (routes, 2, 1, KMS_MEDIA_TYPE_VIDEO, KMS_SSRC_ROLE_MEDIA);
+  fail_unless (kms_ssrc_routes_lookup (routes, 3) == NULL);
+
+  check_route (copy, 1, 0, KMS_MEDIA_TYPE_AUDIO, KMS_SSRC_ROLE_MEDIA);
+  check_route (copy, 3, 1, KMS_MEDIA_TYPE_VIDEO, KMS_SSRC_ROLE_MEDIA);
+  fail_unless (kms_ssrc_routes_lookup (copy, 2) == NULL);
+
+  kms_ssrc_routes_destroy (routes);
+  kms_ssrc_routes_destroy (copy);
+  gst_sdp_media_free (audio);
+  gst_sdp_media_free (video);
+  gst_sdp_media_free (new_video);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (remove_learnt)
+{
+  const gchar *video_attrs[] = { "ssrc", "2 cname:user", NULL };
+  KmsSsrcRoutes *routes;
+  GstSDPMedia *video;
+
+  video = create_media ("video", video_attrs);
+
+  routes = kms_ssrc_routes_new (NULL);
+  kms_ssrc_routes_add_media (routes, video, 1, KMS_MEDIA_TYPE_VIDEO);
+  kms_ssrc_routes_add (routes, 10, KMS_SSRC_ROUTE_NO_INDEX,
+      KMS_MEDIA_TYPE_AUDIO, KMS_SSRC_ROLE_MEDIA);
+  kms_ssrc_routes_add (routes, 20, KMS_SSRC_ROUTE_NO_INDEX,
+      KMS_MEDIA_TYPE_VIDEO, KMS_SSRC_ROLE_MEDIA);
+
+  /* Learnt routes are not bound to any m-line */
+  kms_ssrc_routes_remove_index (routes, 1);
+  fail_unless (kms_ssrc_routes_lookup (routes, 2) == NULL);
+  check_route (routes, 20, KMS_SSRC_ROUTE_NO_INDEX, KMS_MEDIA_TYPE_VIDEO,
+      KMS_SSRC_ROLE_MEDIA);
+
+  kms_ssrc_routes_remove_learnt (routes, KMS_MEDIA_TYPE_VIDEO);
+  fail_unless (kms_ssrc_routes_lookup (routes, 20) == NULL);
+  check_route (routes, 10, KMS_SSRC_ROUTE_NO_INDEX, KMS_MEDIA_TYPE_AUDIO,
+      KMS_SSRC_ROLE_MEDIA);
+  fail_unless_equals_int (kms_ssrc_routes_size (routes), 1);
+
+  kms_ssrc_routes_destroy (routes);
+  gst_sdp_media_free (video);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (lookup)
+{
+  KmsSsrcRoutes *routes = kms_ssrc_routes_new (NULL);
+  const KmsSsrcRoute *route;
+  gint64 start, end;
+  guint i;
+
+  fail_unless (kms_ssrc_routes_lookup (routes, 1) == NULL);
+
+  for (i = 0; i < N_MEDIAS; i++) {
+    kms_ssrc_routes_add (routes, i + 1, i, KMS_MEDIA_TYPE_VIDEO,
+        KMS_SSRC_ROLE_MEDIA);
+  }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < 100 * N_MEDIAS; i++) {
+    route = kms_ssrc_routes_lookup (routes, (i % N_MEDIAS) + 1);
+    fail_unless (route != NULL);
+    fail_unless_equals_int (route->index, i % N_MEDIAS);
+  }
+  end = g_get_monotonic_time ();
+
+  GST_INFO ("%u lookups among %u medias in %" G_GINT64_FORMAT " us",
+      100 * N_MEDIAS, N_MEDIAS, end - start);
+
+  kms_ssrc_routes_destroy (routes);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+ssrcroutes_suite (void)
+{
+  Suite *s = suite_create ("ssrcroutes");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, add_media_groups);
+  tcase_add_test (tc_chain, renegotiate_index);
+  tcase_add_test (tc_chain, remove_learnt);
+  tcase_add_test (tc_chain, lookup);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ssrcroutes);
@@ -0,0 +1,181 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsssrcstats.h"
+
+#include <gst/check/gstcheck.h>
+#include <glib.h>
+
+#define N_THREADS 4
+#define N_PACKETS 100000
+#define PACKET_SIZE 1000
+
+GST_START_TEST (add_and_lookup)
+{
+  KmsSsrcStatsTable *table = kms_ssrc_stats_table_new ();
+  KmsSsrcStatsSnapshot snapshot;
+  KmsSsrcStats *audio, *video;
+
+  fail_if (kms_ssrc_stats_table_lookup (table, 0, 1234, &snapshot));
+
+  audio = kms_ssrc_stats_table_add (table, 0, 1234);
+  video = kms_ssrc_stats_table_add (table, 1, 1234);
+  fail_unless (audio != NULL);
+  fail_unless (video != NULL);
+  fail_if (audio == video);
+
+  kms_ssrc_stats_add_packets (audio, 1, 100);
+  kms_ssrc_stats_add_packets (audio, 2, 300);
+  kms_ssrc_stats_add_lost (audio, 1);
+  kms_ssrc_stats_set_latency (audio, 200);
+
+  fail_unless (kms_ssrc_stats_table_lookup (table, 0, 1234, &snapshot));
+  fail_unless_equals_int (snapshot.session, 0);
+  fail_unless_equals_int (snapshot.ssrc, 1234);
+  fail_unless_equals_int (snapshot.packets, 3);
+  fail_unless_equals_int (snapshot.octets, 400);
+  fail_unless_equals_int (snapshot.lost, 1);
+  fail_unless_equals_int (snapshot.latency, 200);
+
+  fail_unless (kms_ssrc_stats_table_lookup (table, 1, 1234, &snapshot));
+  fail_unless_equals_int (snapshot.packets, 0);
+
+  /* A new jitter buffer for the same SSRC starts counting again */
+  fail_unless (kms_ssrc_stats_table_add (table, 0, 1234) == audio);
+  fail_unless (kms_ssrc_stats_table_lookup (table, 0, 1234, &snapshot));
+  fail_unless_equals_int (snapshot.packets, 0);
+
+  kms_ssrc_stats_table_destroy (table);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (table_full)
+{
+  KmsSsrcStatsTable *table = kms_ssrc_stats_table_new ();
+  guint i;
+
+  for (i = 0; i < KMS_SSRC_STATS_MAX_SOURCES; i++) {
+    fail_unless (kms_ssrc_stats_table_add (table, 1, i) != NULL);
+  }
+
+  fail_unless (kms_ssrc_stats_table_add (table, 1, i) == NULL);
+
+  kms_ssrc_stats_table_destroy (table);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (release_and_reuse)
+{
+  KmsSsrcStatsTable *table = kms_ssrc_stats_table_new ();
+  KmsSsrcStatsSnapshot snapshot;
+  KmsSsrcStats *stats, *first = NULL;
+  guint i;
+
+  for (i = 0; i < KMS_SSRC_STATS_MAX_SOURCES; i++) {
+    stats = kms_ssrc_stats_table_add (table, 1, i);
+    fail_unless (stats != NULL);
+
+    if (i == 0) {
+      first = stats;
+    }
+  }
+
+  /* Slots are kept while any of its jitter buffers is alive */
+  fail_unless (kms_ssrc_stats_table_add (table, 1, 0) == first);
+  kms_ssrc_stats_release (first);
+  fail_unless (kms_ssrc_stats_table_lookup (table, 1, 0, &snapshot));
+  fail_unless (kms_ssrc_stats_table_add (table, 1, i) == NULL);
+
+  kms_ssrc_stats_release (first);
+  fail_if (kms_ssrc_stats_table_lookup (table, 1, 0, &snapshot));
+
+  /* The hole is reused by a new source, the rest are still found */
+  fail_unless (kms_ssrc_stats_table_add (table, 1, i) == first);
+  fail_unless (kms_ssrc_stats_table_lookup (table, 1, i, &snapshot));
+  fail_unless_equals_int (snapshot.packets, 0);
+  fail_unless (kms_ssrc_stats_table_lookup (table, 1, i - 1, &snapshot));
+
+  kms_ssrc_stats_table_destroy (table);
+}
+
+GST_END_TEST;
+
+static gpointer
+count_packets (gpointer stats)
+{
+  guint i;
+
+  for (i = 0; i < N_PACKETS; i++) {
+    kms_ssrc_stats_add_packets (stats, 1, PACKET_SIZE);
+  }
+
+  return NULL;
+}
+
+GST_START_TEST (concurrent_updates)
+{
+  KmsSsrcStatsTable *table = kms_ssrc_stats_table_new ();
+  KmsSsrcStatsSnapshot snapshot;
+  GThread *threads[N_THREADS];
+  KmsSsrcStats *stats;
+  guint i;
+
+  stats = kms_ssrc_stats_table_add (table, 1, 5678);
+
+  for (i = 0; i < N_THREADS; i++) {
+    threads[i] = g_thread_new ("counter", count_packets, stats);
+  }
+
+  /* Snapshots can be taken while packets are being counted */
+  while (kms_ssrc_stats_table_lookup (table, 1, 5678, &snapshot) &&
+      snapshot.packets < N_PACKETS) {
+    g_thread_yield ();
+  }
+
+  for (i = 0; i < N_THREADS; i++) {
+    g_thread_join (threads[i]);
+  }
+
+  fail_unless (kms_ssrc_stats_table_lookup (table, 1, 5678, &snapshot));
+  fail_unless (snapshot.packets == N_THREADS * N_PACKETS);
+  fail_unless (snapshot.octets ==
+      (guint64) N_THREADS * N_PACKETS * PACKET_SIZE);
+
+  kms_ssrc_stats_table_destroy (table);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+ssrcstats_suite (void)
+{
+  Suite *s = suite_create ("ssrcstats");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, add_and_lookup);
+  tcase_add_test (tc_chain, table_full);
+  tcase_add_test (tc_chain, release_and_reuse);
+  tcase_add_test (tc_chain, concurrent_updates);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ssrcstats);
@@ -0,0 +1,428 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsrtcp.h"
+#include "kmstwcc.h"
+#include "constants.h"
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+#include <glib.h>
+
+#define SENDER_SSRC 1234
+#define MEDIA_SSRC 5678
+
+#define PACKET_SIZE 1000
+#define PACKET_INTERVAL (10 * GST_MSECOND)
+#define FEEDBACK_PACKETS 20
+
+/* 2000 packets per second, more than the TWCC window before any RTCP */
+#define HIGH_RATE_PACKETS 1500
+#define HIGH_RATE_BURST 20
+#define HIGH_RATE_BURST_INTERVAL (10 * G_TIME_SPAN_MILLISECOND)
+
+GST_START_TEST (marshall_and_parse)
+{
+  KmsRTCPTWCCPacket in, out;
+  GstRTCPBuffer rtcp = { NULL, };
+  GstRTCPPacket packet;
+  GstBuffer *buffer;
+  guint i;
+
+  in.base_seq = 65530;          /* Wraps around */
+  in.status_count = 20;
+  in.reference_time = -2;
+  in.fb_pkt_count = 7;
+
+  for (i = 0; i < in.status_count; i++) {
+    if (i % 5 == 0) {
+      in.status[i] = KMS_RTCP_TWCC_STATUS_NOT_RECEIVED;
+      in.deltas[i] = 0;
+    } else if (i % 3 == 0) {
+      in.status[i] = KMS_RTCP_TWCC_STATUS_LARGE_DELTA;
+      in.deltas[i] = -1000 * (gint) i;
+    } else {
+      in.status[i] = KMS_RTCP_TWCC_STATUS_SMALL_DELTA;
+      in.deltas[i] = 10 * i;
+    }
+  }
+
+  buffer = gst_rtcp_buffer_new (1400);
+  fail_unless (gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &rtcp));
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_RTPFB,
+          &packet));
+  fail_unless (kms_rtcp_twcc_marshall_packet (&packet, &in, SENDER_SSRC,
+          MEDIA_SSRC));
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  fail_unless (gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcp));
+  fail_unless (gst_rtcp_buffer_get_first_packet (&rtcp, &packet));
+  fail_unless (gst_rtcp_packet_get_type (&packet) == GST_RTCP_TYPE_RTPFB);
+  fail_unless (gst_rtcp_packet_fb_get_type (&packet) ==
+      KMS_RTCP_RTPFB_TYPE_TWCC);
+  fail_unless (gst_rtcp_packet_fb_get_sender_ssrc (&packet) == SENDER_SSRC);
+  fail_unless (gst_rtcp_packet_fb_get_media_ssrc (&packet) == MEDIA_SSRC);
+  fail_unless (kms_rtcp_twcc_get_packet (gst_rtcp_packet_fb_get_fci (&packet),
+          gst_rtcp_packet_fb_get_fci_length (&packet) * 4, &out));
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  fail_unless (out.base_seq == in.base_seq);
+  fail_unless (out.status_count == in.status_count);
+  fail_unless (out.reference_time == in.reference_time);
+  fail_unless (out.fb_pkt_count == in.fb_pkt_count);
+
+  for (i = 0; i < in.status_count; i++) {
+    fail_unless (out.status[i] == in.status[i]);
+    fail_unless (out.deltas[i] == in.deltas[i]);
+  }
+
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (parse_chunks)
+{
+  KmsRTCPTWCCPacket out;
+  guint i;
+  guint8 fci[] = {
+    0x00, 0x10,                 /* base sequence number: 16 */
+    0x00, 0x18,                 /* packet status count: 24 */
+    0x00, 0x00, 0x01,           /* reference time: 1 */
+    0x00,                       /* fb pkt. count */
+    0x20, 0x08,                 /* run length: 8 small deltas */
+    0xa0, 0x00,                 /* 1 bit vector: 1 received, 13 lost */
+    0xd8, 0x00,                 /* 2 bits vector: small, large, 5 lost */
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+    0x09,
+    0x0a,
+    0xff, 0xfe,                 /* -2 */
+    0x00, 0x00,                 /* padding */
+  };
+
+  fail_unless (kms_rtcp_twcc_get_packet (fci, sizeof (fci), &out));
+  fail_unless (out.base_seq == 16);
+  fail_unless (out.status_count == 24);
+  fail_unless (out.reference_time == 1);
+
+  for (i = 0; i < 8; i++) {
+    fail_unless (out.status[i] == KMS_RTCP_TWCC_STATUS_SMALL_DELTA);
+    fail_unless (out.deltas[i] == i + 1);
+  }
+
+  fail_unless (out.status[8] == KMS_RTCP_TWCC_STATUS_SMALL_DELTA);
+  fail_unless (out.deltas[8] == 9);
+
+  for (i = 9; i < 22; i++) {
+    fail_unless (out.status[i] == KMS_RTCP_TWCC_STATUS_NOT_RECEIVED);
+  }
+
+  fail_unless (out.status[22] == KMS_RTCP_TWCC_STATUS_SMALL_DELTA);
+  fail_unless (out.deltas[22] == 10);
+  fail_unless (out.status[23] == KMS_RTCP_TWCC_STATUS_LARGE_DELTA);
+  fail_unless (out.deltas[23] == -2);
+
+  /* Truncated deltas */
+  fail_if (kms_rtcp_twcc_get_packet (fci, sizeof (fci) - 3, &out));
+}
+
+GST_END_TEST;
+
+static GObject *
+get_rtp_session (GstElement * rtpbin)
+{
+  GObject *rtpsession = NULL;
+
+  g_signal_emit_by_name (rtpbin, "get-internal-session", 0, &rtpsession);
+  fail_unless (rtpsession != NULL);
+
+  return rtpsession;
+}
+
+static GstFlowReturn
+drop_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static GstBuffer *
+create_rtp_packet (guint16 twcc_seq)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+  guint8 data[RTP_HDR_EXT_TRANSPORT_CC_SIZE];
+
+  GST_WRITE_UINT16_BE (data, twcc_seq);
+
+  buffer = gst_rtp_buffer_new_allocate (PACKET_SIZE, 0, 0);
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READWRITE, &rtp));
+  gst_rtp_buffer_set_ssrc (&rtp, MEDIA_SSRC);
+  fail_unless (gst_rtp_buffer_add_extension_onebyte_header (&rtp,
+          RTP_HDR_EXT_TRANSPORT_CC_ID, data, sizeof (data)));
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buffer;
+}
+
+static void
+send_feedback (GObject * rtpsession, KmsRTCPTWCCPacket * twcc_packet)
+{
+  GstRTCPBuffer rtcp = { NULL, };
+  GstRTCPPacket packet;
+  GstBuffer *buffer, *fci;
+  guint fci_size;
+
+  buffer = gst_rtcp_buffer_new (1400);
+  fail_unless (gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &rtcp));
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_RTPFB,
+          &packet));
+  fail_unless (kms_rtcp_twcc_marshall_packet (&packet, twcc_packet,
+          SENDER_SSRC, MEDIA_SSRC));
+  fci_size = gst_rtcp_packet_fb_get_fci_length (&packet) * 4;
+  fci = gst_buffer_new_allocate (NULL, fci_size, NULL);
+  gst_buffer_fill (fci, 0, gst_rtcp_packet_fb_get_fci (&packet), fci_size);
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  g_signal_emit_by_name (rtpsession, "on-feedback-rtcp", GST_RTCP_TYPE_RTPFB,
+      KMS_RTCP_RTPFB_TYPE_TWCC, SENDER_SSRC, MEDIA_SSRC, fci);
+
+  gst_buffer_unref (fci);
+  gst_buffer_unref (buffer);
+}
+
+/*
+ * Sends FEEDBACK_PACKETS packets every PACKET_INTERVAL starting at @seq and
+ * reports them as received every @arrival_interval.
+ */
+static void
+send_and_ack (KmsTwccRemote * tr, GObject * rtpsession, guint16 seq,
+    GstClockTime send_time, GstClockTime arrival_interval)
+{
+  KmsRTCPTWCCPacket twcc_packet;
+  guint i;
+
+  twcc_packet.base_seq = seq;
+  twcc_packet.status_count = FEEDBACK_PACKETS;
+  twcc_packet.reference_time = send_time / KMS_RTCP_TWCC_REFERENCE_TIME_UNIT;
+  twcc_packet.fb_pkt_count = 0;
+
+  for (i = 0; i < FEEDBACK_PACKETS; i++) {
+    kms_twcc_remote_packet_sent (tr, seq + i, send_time + i * PACKET_INTERVAL,
+        PACKET_SIZE);
+
+    twcc_packet.status[i] = KMS_RTCP_TWCC_STATUS_SMALL_DELTA;
+    twcc_packet.deltas[i] = i == 0 ? 0 :
+        arrival_interval / KMS_RTCP_TWCC_DELTA_UNIT;
+  }
+
+  send_feedback (rtpsession, &twcc_packet);
+}
+
+GST_START_TEST (local_feedback)
+{
+  GstElement *rtpbin = gst_element_factory_make ("rtpbin", NULL);
+  GObject *rtpsession = get_rtp_session (rtpbin);
+  GstPad *pad = gst_pad_new ("sink", GST_PAD_SINK);
+  GstRTCPBuffer rtcp = { NULL, };
+  KmsRTCPTWCCPacket out;
+  GstRTCPPacket packet;
+  KmsTwccLocal *tl;
+  GstBuffer *buffer;
+  gboolean added = FALSE;
+
+  gst_pad_set_chain_function (pad, drop_chain);
+  fail_unless (gst_pad_set_active (pad, TRUE));
+
+  tl = kms_twcc_local_create (rtpsession, pad, RTP_HDR_EXT_TRANSPORT_CC_ID);
+
+  /* Packet 12 is lost and 10 arrives out of order */
+  fail_unless (gst_pad_chain (pad, create_rtp_packet (11)) == GST_FLOW_OK);
+  fail_unless (gst_pad_chain (pad, create_rtp_packet (10)) == GST_FLOW_OK);
+  fail_unless (gst_pad_chain (pad, create_rtp_packet (13)) == GST_FLOW_OK);
+
+  buffer = gst_rtcp_buffer_new (1400);
+  g_signal_emit_by_name (rtpsession, "on-sending-rtcp", buffer, FALSE,
+      &added);
+  fail_unless (added);
+
+  fail_unless (gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcp));
+  fail_unless (gst_rtcp_buffer_get_first_packet (&rtcp, &packet));
+  fail_unless (gst_rtcp_packet_fb_get_type (&packet) ==
+      KMS_RTCP_RTPFB_TYPE_TWCC);
+  fail_unless (gst_rtcp_packet_fb_get_media_ssrc (&packet) == MEDIA_SSRC);
+  fail_unless (kms_rtcp_twcc_get_packet (gst_rtcp_packet_fb_get_fci (&packet),
+          gst_rtcp_packet_fb_get_fci_length (&packet) * 4, &out));
+  gst_rtcp_buffer_unmap (&rtcp);
+  gst_buffer_unref (buffer);
+
+  /* 10 was received after the window started, so it is already reported */
+  fail_unless (out.base_seq == 11);
+  fail_unless (out.status_count == 3);
+  fail_unless (out.status[0] != KMS_RTCP_TWCC_STATUS_NOT_RECEIVED);
+  fail_unless (out.status[1] == KMS_RTCP_TWCC_STATUS_NOT_RECEIVED);
+  fail_unless (out.status[2] != KMS_RTCP_TWCC_STATUS_NOT_RECEIVED);
+
+  /* Nothing pending */
+  buffer = gst_rtcp_buffer_new (1400);
+  added = FALSE;
+  g_signal_emit_by_name (rtpsession, "on-sending-rtcp", buffer, FALSE,
+      &added);
+  fail_if (added);
+  gst_buffer_unref (buffer);
+
+  kms_twcc_local_destroy (tl);
+  fail_unless (gst_pad_set_active (pad, FALSE));
+  g_object_unref (pad);
+  g_object_unref (rtpsession);
+  gst_object_unref (rtpbin);
+}
+
+GST_END_TEST;
+
+static void
+send_rtcp_cb (GObject * rtpsession, guint64 max_delay, guint * requests)
+{
+  (*requests)++;
+}
+
+GST_START_TEST (local_feedback_high_rate)
+{
+  GstElement *rtpbin = gst_element_factory_make ("rtpbin", NULL);
+  GObject *rtpsession = get_rtp_session (rtpbin);
+  GstPad *pad = gst_pad_new ("sink", GST_PAD_SINK);
+  GstRTCPBuffer rtcp = { NULL, };
+  KmsRTCPTWCCPacket out;
+  GstRTCPPacket packet;
+  KmsTwccLocal *tl;
+  GstBuffer *buffer;
+  guint requests = 0, reports = 0, compounds = 0, next = 0, i;
+  gboolean added, more;
+
+  gst_pad_set_chain_function (pad, drop_chain);
+  fail_unless (gst_pad_set_active (pad, TRUE));
+
+  tl = kms_twcc_local_create (rtpsession, pad, RTP_HDR_EXT_TRANSPORT_CC_ID);
+  g_signal_connect (rtpsession, "send-rtcp", G_CALLBACK (send_rtcp_cb),
+      &requests);
+
+  for (i = 0; i < HIGH_RATE_PACKETS; i++) {
+    if (i > 0 && i % HIGH_RATE_BURST == 0) {
+      g_usleep (HIGH_RATE_BURST_INTERVAL);
+    }
+
+    fail_unless (gst_pad_chain (pad, create_rtp_packet (i)) == GST_FLOW_OK);
+  }
+
+  /* Feedback is requested without waiting for the regular RTCP interval */
+  fail_unless (requests >= 5, "Only %u feedback requests", requests);
+
+  /* No arrival is dropped when the window is exceeded */
+  do {
+    buffer = gst_rtcp_buffer_new (1400);
+    added = FALSE;
+    g_signal_emit_by_name (rtpsession, "on-sending-rtcp", buffer, FALSE,
+        &added);
+
+    fail_unless (gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcp));
+    more = gst_rtcp_buffer_get_first_packet (&rtcp, &packet);
+
+    for (; more; more = gst_rtcp_packet_move_to_next (&packet)) {
+      fail_unless (gst_rtcp_packet_fb_get_type (&packet) ==
+          KMS_RTCP_RTPFB_TYPE_TWCC);
+      fail_unless (kms_rtcp_twcc_get_packet (gst_rtcp_packet_fb_get_fci
+              (&packet), gst_rtcp_packet_fb_get_fci_length (&packet) * 4,
+              &out));
+      fail_unless (out.base_seq == next, "Expected base %u, got %u", next,
+          out.base_seq);
+
+      for (i = 0; i < out.status_count; i++) {
+        fail_unless (out.status[i] != KMS_RTCP_TWCC_STATUS_NOT_RECEIVED);
+      }
+
+      next += out.status_count;
+      reports++;
+    }
+
+    gst_rtcp_buffer_unmap (&rtcp);
+    gst_buffer_unref (buffer);
+    compounds += added ? 1 : 0;
+  } while (added);
+
+  fail_unless (next == HIGH_RATE_PACKETS, "Only %u packets reported", next);
+  fail_unless (compounds < reports, "One report per RTCP packet");
+
+  kms_twcc_local_destroy (tl);
+  fail_unless (gst_pad_set_active (pad, FALSE));
+  g_object_unref (pad);
+  g_object_unref (rtpsession);
+  gst_object_unref (rtpbin);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (remote_estimation)
+{
+  GstElement *rtpbin = gst_element_factory_make ("rtpbin", NULL);
+  GObject *rtpsession = get_rtp_session (rtpbin);
+  GstPad *pad = gst_pad_new ("sink", GST_PAD_SINK);
+  KmsTwccRemote *tr;
+  guint initial, target;
+
+  tr = kms_twcc_remote_create (rtpsession, MEDIA_SSRC, 0, 0, pad);
+  initial = kms_twcc_remote_get_target_bitrate (tr);
+
+  /* Packets arrive as they were sent: no queuing */
+  send_and_ack (tr, rtpsession, 0, 0, PACKET_INTERVAL);
+  target = kms_twcc_remote_get_target_bitrate (tr);
+  fail_unless (target >= initial, "Target decreased without congestion "
+      "(%u -> %u)", initial, target);
+
+  /* Packets arrive twice slower than they were sent: queues are growing */
+  send_and_ack (tr, rtpsession, FEEDBACK_PACKETS,
+      FEEDBACK_PACKETS * PACKET_INTERVAL, 2 * PACKET_INTERVAL);
+  fail_unless (kms_twcc_remote_get_target_bitrate (tr) < target,
+      "Target not decreased on overuse");
+
+  kms_twcc_remote_destroy (tr);
+  g_object_unref (pad);
+  g_object_unref (rtpsession);
+  gst_object_unref (rtpbin);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+twcc_suite (void)
+{
+  Suite *s = suite_create ("twcc");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, marshall_and_parse);
+  tcase_add_test (tc_chain, parse_chunks);
+  tcase_add_test (tc_chain, local_feedback);
+  tcase_add_test (tc_chain, local_feedback_high_rate);
+  tcase_add_test (tc_chain, remote_estimation);
+
+  return s;
+}
+
+GST_CHECK_MAIN (twcc);
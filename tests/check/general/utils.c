@@ -102,6 +102,68 @@ GST_START_TEST (check_sdp_utils_media_get_fid_ssrc)
 
 GST_END_TEST;
 
+GST_START_TEST (check_sdp_utils_media_index)
+{
+  GstSDPMessage *message;
+  const GstSDPMedia *media;
+  SdpMediaIndex *index;
+  GstSDPAttribute attr;
+  guint i, len;
+
+  fail_unless (gst_sdp_message_new (&message) == GST_SDP_OK);
+  fail_unless (gst_sdp_message_parse_buffer ((const guint8 *)
+          sdp_str, -1, message) == GST_SDP_OK);
+
+  media = gst_sdp_message_get_media (message, 0);
+  fail_if (media == NULL);
+
+  index = sdp_utils_media_index_new (media);
+
+  /* Same results as linear lookups */
+  for (i = 0; i < gst_sdp_media_formats_len (media); i++) {
+    const gchar *fmt = gst_sdp_media_get_format (media, i);
+
+    fail_unless (sdp_utils_media_index_get_attr_map_value (index, "rtpmap",
+            fmt) == sdp_utils_get_attr_map_value (media, "rtpmap", fmt));
+    fail_unless (sdp_utils_media_index_get_attr_map_value (index, "fmtp",
+            fmt) == sdp_utils_get_attr_map_value (media, "fmtp", fmt));
+    fail_unless (sdp_utils_media_index_get_attr_map_value (index, "rtcp-fb",
+            fmt) == sdp_utils_get_attr_map_value (media, "rtcp-fb", fmt));
+  }
+
+  fail_unless_equals_string (sdp_utils_media_index_get_attr_map_value (index,
+          "rtpmap", "96"), "96 rtx/90000");
+  fail_unless (sdp_utils_media_index_get_attr_map_value (index, "rtpmap",
+          "9") == NULL);
+  fail_unless (sdp_utils_media_index_get_attr_map_value (index, "fmtp",
+          "100") == NULL);
+
+  len = sdp_utils_media_index_attributes_len (index, "ssrc");
+  fail_unless_equals_int (len, 6);
+  for (i = 0; i < len; i++) {
+    fail_unless (sdp_utils_media_index_get_attribute_val_n (index, "ssrc",
+            i) == gst_sdp_media_get_attribute_val_n (media, "ssrc", i));
+  }
+  fail_unless (sdp_utils_media_index_get_attribute_val_n (index, "ssrc",
+          len) == NULL);
+  fail_unless_equals_int (sdp_utils_media_index_attributes_len (index,
+          "unknown"), 0);
+
+  attr.key = "rtcp-fb";
+  attr.value = "100 nack pli";
+  fail_unless (sdp_utils_media_index_contains_attr (index, &attr));
+  attr.value = "100 nack fir";
+  fail_if (sdp_utils_media_index_contains_attr (index, &attr));
+
+  sdp_utils_media_index_free (index);
+
+  fail_unless (sdp_utils_equal_messages (message, message));
+
+  gst_sdp_message_free (message);
+}
+
+GST_END_TEST;
+
 GMainLoop *loop = NULL;
 gint callbacks = 2;
 gint destroy_count = 0;
@@ -391,6 +453,7 @@ utils_suite (void)
   tcase_add_test (tc_chain, check_urls);
 
   tcase_add_test (tc_chain, check_sdp_utils_media_get_fid_ssrc);
+  tcase_add_test (tc_chain, check_sdp_utils_media_index);
   tcase_add_test (tc_chain, check_kms_utils_set_pad_event_function_full);
 
   tcase_add_test (tc_chain, check_kms_utils_set_pad_query_function_full);
@@ -21,6 +21,8 @@
 #include <MediaPipelineImpl.hpp>
 #include <MediaElementImpl.hpp>
 #include <ElementConnectionData.hpp>
+#include <ConnectionOperation.hpp>
+#include <ConnectionAction.hpp>
 #include <MediaType.hpp>
 #include <KurentoException.hpp>
 #include <GstreamerDotDetails.hpp>
@@ -159,6 +161,110 @@ BOOST_AUTO_TEST_CASE (connection_test)
   src.reset();
 }
 
+static std::shared_ptr <ConnectionOperation>
+createOperation (ConnectionAction::type action,
+                 std::shared_ptr <MediaElementImpl> source,
+                 std::shared_ptr <MediaElementImpl> sink)
+{
+  return std::shared_ptr <ConnectionOperation> (new ConnectionOperation (
+           std::shared_ptr <ConnectionAction> (new ConnectionAction (action) ),
+           source, sink) );
+}
+
+/* Runs after the default handler, so the requested pad is never provided */
+static gchar *
+refuseSrcPad (GstElement *element, gint type, const gchar *description,
+                guint direction, gpointer data)
+{
+  return NULL;
+}
+
+BOOST_AUTO_TEST_CASE (batch_connection_test)
+{
+  std::string mediaPipelineId =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+  std::shared_ptr <MediaPipelineImpl> pipe = std::dynamic_pointer_cast
+      <MediaPipelineImpl> (MediaSet::getMediaSet()->getMediaObject (
+                             mediaPipelineId) );
+  std::shared_ptr <MediaElementImpl> sink = createDummyElement ("dummysink",
+      mediaPipelineId);
+  std::shared_ptr <MediaElementImpl> src1 = createDummyElement ("dummysrc",
+      mediaPipelineId);
+  std::shared_ptr <MediaElementImpl> src2 = createDummyElement ("dummysrc",
+      mediaPipelineId);
+  std::vector <std::shared_ptr <ConnectionOperation>> operations;
+  std::shared_ptr <MediaType> AUDIO (new MediaType (MediaType::AUDIO) );
+  std::shared_ptr <ConnectionOperation> audioOnly;
+  int connectedEvents = 0;
+
+  src1->signalElementConnected.connect ([&] (ElementConnected event) {
+    BOOST_CHECK (sink->getSourceConnections ().size () == 3);
+    connectedEvents++;
+  });
+
+  /* Only the last connection to each sink is applied */
+  operations.push_back (createOperation (ConnectionAction::CONNECT, src2,
+                                         sink) );
+  operations.push_back (createOperation (ConnectionAction::CONNECT, src1,
+                                         sink) );
+
+  pipe->applyConnections (operations);
+
+  BOOST_CHECK (connectedEvents == 3);
+
+  for (auto it : sink->getSourceConnections () ) {
+    BOOST_CHECK (it->getSource()->getId() == src1->getId() );
+  }
+
+  BOOST_CHECK (src2->getSinkConnections ().empty () );
+
+  operations.clear ();
+  audioOnly = createOperation (ConnectionAction::DISCONNECT, src1, sink);
+  audioOnly->setMediaType (AUDIO);
+  operations.push_back (audioOnly);
+
+  pipe->applyConnections (operations);
+
+  BOOST_CHECK (sink->getSourceConnections ().size () == 2);
+  BOOST_CHECK (sink->getSourceConnections (AUDIO).empty () );
+
+  /* Disconnecting a source that is not connected changes nothing, so there
+   * is nothing to undo when a later operation fails */
+  g_signal_connect_after (src2->getGstreamerElement (), "request-new-pad",
+                          G_CALLBACK (refuseSrcPad), NULL);
+
+  operations.clear ();
+  operations.push_back (createOperation (ConnectionAction::DISCONNECT, src2,
+                                         sink) );
+  audioOnly = createOperation (ConnectionAction::CONNECT, src2, sink);
+  audioOnly->setMediaType (AUDIO);
+  operations.push_back (audioOnly);
+
+  BOOST_CHECK_THROW (pipe->applyConnections (operations), KurentoException);
+
+  BOOST_CHECK (connectedEvents == 3);
+  BOOST_CHECK (sink->getSourceConnections ().size () == 2);
+  BOOST_CHECK (sink->getSourceConnections (AUDIO).empty () );
+
+  for (auto it : sink->getSourceConnections () ) {
+    BOOST_CHECK (it->getSource()->getId() == src1->getId() );
+  }
+
+  BOOST_CHECK (src2->getSinkConnections ().empty () );
+
+  releaseMediaObject (src1->getId() );
+  releaseMediaObject (src2->getId() );
+  releaseMediaObject (sink->getId() );
+  releaseMediaObject (mediaPipelineId);
+
+  sink.reset();
+  src1.reset();
+  src2.reset();
+  pipe.reset();
+}
+
 BOOST_AUTO_TEST_CASE (release_before_real_connection)
 {
   GstElement *srcElement;
@@ -29,6 +29,9 @@
 #include <ObjectCreated.hpp>
 #include <ObjectDestroyed.hpp>
 
+#include <set>
+#include <thread>
+
 #include <config.h>
 
 using namespace kurento;
@@ -243,3 +246,73 @@ BOOST_FIXTURE_TEST_CASE (get_pipelines, F)
 
   pipes.clear();
 }
+
+BOOST_FIXTURE_TEST_CASE (release_session, F)
+{
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::set<std::string> alive;
+
+  std::shared_ptr<kurento::Factory> mediaPipelineFactory;
+  std::shared_ptr<kurento::Factory> passThroughFactory;
+  std::string mediaPipelineId;
+
+  sigc::connection destroyedConn =
+  serverManager->signalObjectDestroyed.connect ([&] (ObjectDestroyed event) {
+    std::unique_lock<std::mutex> lck (mtx);
+
+    alive.erase (event.getObjectId() );
+    cv.notify_one();
+  });
+
+  mediaPipelineFactory = moduleManager->getFactory ("MediaPipeline");
+  passThroughFactory = moduleManager->getFactory ("PassThrough");
+
+  mediaPipelineId = mediaPipelineFactory->createObject (
+                      boost::property_tree::ptree(), "session1", Json::Value() )->getId();
+
+  Json::Value params;
+  params["mediaPipeline"] = mediaPipelineId;
+
+  std::vector<std::string> ids;
+  ids.push_back (mediaPipelineId);
+
+  for (int i = 0; i < 10; i++) {
+    ids.push_back (passThroughFactory->createObject (
+                     boost::property_tree::ptree(), "session1", params )->getId() );
+  }
+
+  std::unique_lock<std::mutex> lck (mtx);
+  alive.insert (ids.begin(), ids.end() );
+  lck.unlock();
+
+  /* The whole tree is detached at once, destruction happens afterwards */
+  kurento::MediaSet::getMediaSet()->releaseSession ("session1");
+
+  try {
+    MediaSet::getMediaSet()->ref ("session2", mediaPipelineId);
+    BOOST_FAIL ("This code should not be reached");
+  } catch (KurentoException e) {
+    BOOST_CHECK (e.getCode() == MEDIA_OBJECT_NOT_FOUND);
+  }
+
+  lck.lock();
+
+  if (!cv.wait_for (lck, std::chrono::seconds (5), [&alive] () {
+  return alive.empty();
+}) ) {
+    BOOST_FAIL ("Timeout waiting for session objects destruction");
+  }
+
+  lck.unlock();
+  destroyedConn.disconnect();
+
+  /* Destroyed event is sent before the object is deleted */
+  for (int i = 0; i < 50
+       && kurento::MediaSet::getMediaSet()->getTeardownBacklog() > 0; i++) {
+    std::this_thread::sleep_for (std::chrono::milliseconds (100) );
+  }
+
+  BOOST_CHECK_EQUAL (kurento::MediaSet::getMediaSet()->getTeardownBacklog(),
+                     0);
+}
@@ -108,3 +108,26 @@ BOOST_AUTO_TEST_CASE (load_modules)
 
   BOOST_CHECK (! data->getGenerationTime().empty() );
 }
+
+BOOST_AUTO_TEST_CASE (load_modules_from_directories)
+{
+  std::shared_ptr <ModuleManager> moduleManager (new ModuleManager() );
+
+  gst_init (NULL, NULL);
+
+  moduleManager->loadModulesFromDirectories ("../../src/server");
+
+  auto data = moduleManager->getModules().at ("libkmscoremodule.so");
+
+  BOOST_CHECK (data->getName() == "core");
+  BOOST_CHECK (data->getLoadTime().count() >= 0);
+  BOOST_CHECK (moduleManager->getFactory ("kurento.MediaPipeline") ==
+               moduleManager->getFactory ("MediaPipeline") );
+
+  /* Modules already loaded are skipped */
+  size_t loaded = moduleManager->getModules().size();
+
+  BOOST_CHECK (moduleManager->loadModule ("../../src/server/libkmscoremodule.so")
+               == -1);
+  BOOST_CHECK (moduleManager->getModules().size() == loaded);
+}
@@ -0,0 +1,112 @@
+/*
+ * (C) Copyright 2014 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE PipelinePool
+#include <boost/test/unit_test.hpp>
+#include <PipelinePool.hpp>
+#include <gst/gst.h>
+#include <chrono>
+
+#define BENCHMARK_ITERATIONS 1000
+
+using namespace kurento;
+
+struct InitTests {
+  InitTests();
+};
+
+BOOST_GLOBAL_FIXTURE (InitTests)
+
+InitTests::InitTests()
+{
+  gst_init (NULL, NULL);
+}
+
+BOOST_AUTO_TEST_CASE (reuse_empty_pipelines)
+{
+  PipelinePool pool (1);
+  GstElement *pipeline, *other;
+
+  pipeline = pool.acquire ();
+  BOOST_CHECK (GST_STATE (pipeline) == GST_STATE_PLAYING);
+  pool.release (pipeline);
+  BOOST_CHECK (pool.getIdleCount () == 1);
+
+  other = pool.acquire ();
+  BOOST_CHECK (other == pipeline);
+  BOOST_CHECK (GST_STATE (other) == GST_STATE_PLAYING);
+  BOOST_CHECK (pool.getIdleCount () == 0);
+
+  /* Pipelines that still have elements are not reused */
+  gst_bin_add (GST_BIN (other), gst_element_factory_make ("fakesink", NULL) );
+  pool.release (other);
+  BOOST_CHECK (pool.getIdleCount () == 0);
+}
+
+BOOST_AUTO_TEST_CASE (bounded_idle_size)
+{
+  PipelinePool pool (2);
+  GstElement *pipelines[3];
+
+  for (int i = 0; i < 3; i++) {
+    pipelines[i] = pool.acquire ();
+  }
+
+  for (int i = 0; i < 3; i++) {
+    pool.release (pipelines[i]);
+  }
+
+  BOOST_CHECK (pool.getIdleCount () == 2);
+
+  pool.setMaxIdle (1);
+  BOOST_CHECK (pool.getIdleCount () == 1);
+
+  pool.warmUp (5);
+  BOOST_CHECK (pool.getIdleCount () == 1);
+}
+
+static std::chrono::microseconds
+benchmarkPool (PipelinePool &pool)
+{
+  auto start = std::chrono::steady_clock::now ();
+
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    pool.release (pool.acquire () );
+  }
+
+  return std::chrono::duration_cast<std::chrono::microseconds>
+         (std::chrono::steady_clock::now () - start);
+}
+
+BOOST_AUTO_TEST_CASE (creation_benchmark)
+{
+  PipelinePool cold (0);
+  PipelinePool warm (1);
+  std::chrono::microseconds coldTime, warmTime;
+
+  warm.warmUp (1);
+
+  coldTime = benchmarkPool (cold);
+  warmTime = benchmarkPool (warm);
+
+  BOOST_CHECK (cold.getIdleCount () == 0);
+  BOOST_CHECK (warm.getIdleCount () == 1);
+
+  BOOST_TEST_MESSAGE (BENCHMARK_ITERATIONS << " pipelines: cold " <<
+                      coldTime.count () << " us, warm " << warmTime.count () << " us");
+}